@@ -0,0 +1,39 @@
+/*! \file */
+/*! \brief BenchUtil.h.
+ *
+ *  Helpers shared by the benchmarks: the key streams and the timers.
+*/
+#ifndef BenchUtil_H_
+#define BenchUtil_H_
+
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+using namespace std;
+
+/*! Random keys (fixed seed, so every run sees the same stream), below range if not 0 */
+inline vector<int> randomKeys( size_t n, unsigned seed, size_t range = 0 )
+{
+    vector<int> keys(n);
+    srand(seed);
+
+    for ( size_t i = 0; i < n; i++ )
+        keys[i] = ( range != 0 ) ? int( size_t( rand() ) % range ) : rand();
+
+    return keys;
+}
+
+/*! Elapsed milliseconds since start */
+inline double elapsedMs( chrono::steady_clock::time_point start )
+{
+    return chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+}
+
+/*! Elapsed nanoseconds since start */
+inline double elapsedNs( chrono::steady_clock::time_point start )
+{
+    return chrono::duration<double, nano>( chrono::steady_clock::now() - start ).count();
+}
+
+#endif // BenchUtil_H_
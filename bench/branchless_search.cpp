@@ -0,0 +1,64 @@
+/*! \file */
+/*! \brief branchless_search.cpp.
+ *
+ *  Benchmark: random lookups on int keys. The default order (child picked by index, the
+ *  branchless descent) against the same order given as a custom Compare (the three way
+ *  branch of the generic descent), hits and misses mixed.
+ *  Usage: bin/branchless_search [tree size] [lookups]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! Same order as std::less, but not the default, so the generic descent is used */
+struct PlainLess
+{
+    bool operator () ( int a, int b ) const { return a < b; }
+};
+
+/*! Times contains() for every probe */
+template <class Tree>
+void run( const char* name, const vector<int>& keys, const vector<int>& probes )
+{
+    Tree tree;
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        tree.insert(keys[i]);
+
+    size_t hits = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        hits += tree.contains(probes[i]);
+
+    cout << "  " << name << elapsedMs(start) << " ms (" << hits << " hits)" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 100000;
+    size_t lookups = ( argc > 2 ) ? atol(argv[2]) : 5000000;
+
+    vector<int> keys = randomKeys(treeSize, 1, 2 * treeSize);
+    vector<int> probes = randomKeys(lookups, 2, 2 * lookups);
+
+    for ( size_t i = 0; i < lookups; i++ )
+        probes[i] %= int( 2 * treeSize );
+
+    cout << treeSize << " values, " << lookups << " lookups" << endl;
+
+    run< RedBlackTree<int> >("branchless    ", keys, probes);
+    run< RedBlackTree<int, PlainLess> >("three way     ", keys, probes);
+    run< CompactRedBlackTree<int> >("compact       ", keys, probes);
+
+    return 0;
+}
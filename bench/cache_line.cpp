@@ -0,0 +1,120 @@
+/*! \file */
+/*! \brief cache_line.cpp.
+ *
+ *  Benchmark: big trees of int keys, out of the cache. RedBlackTree (a node per value) and its
+ *  compact layout against CacheLineRedBlackTree (a 2-3-4 node per cache line) and std::set:
+ *  random insertions, random lookups (hits and misses mixed) and removals, with the height
+ *  of each tree (nodes on the longest path, so lines touched by the deepest lookup).
+ *  Then the same lookups on trees built from sorted input, where the 2-3-4 nodes are full.
+ *  Usage: bin/cache_line [tree size] [lookups]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "CacheLineRedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+bool has( const set<int>& c, int k ) { return c.count(k) > 0; }
+bool drop( set<int>& c, int k ) { return c.erase(k) > 0; }
+int height( const set<int>& ) { return 0; }
+
+template <class Tree>
+bool has( const Tree& c, int k ) { return c.contains(k); }
+
+template <class Tree>
+bool drop( Tree& c, int k ) { return c.remove(k); }
+
+template <class Tree>
+int height( const Tree& c ) { return c.stats().height; }
+
+/*! Fills a tree, probes it and empties half of it */
+template <class Container>
+void run( const char* name, const vector<int>& keys, const vector<int>& probes )
+{
+    Container tree;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        tree.insert(keys[i]);
+
+    double insertMs = elapsedMs(start);
+    size_t hits = 0;
+    start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        hits += has(tree, probes[i]);
+
+    double lookupMs = elapsedMs(start);
+    int levels = height(tree);
+    size_t removed = 0;
+    start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < keys.size(); i += 2 )
+        removed += drop(tree, keys[i]);
+
+    double removeMs = elapsedMs(start);
+
+    printf("  %-22s height %3d   insert %8.1f ms   lookup %6.1f ns (%zu hits)   remove %8.1f ms (%zu)\n",
+           name, levels, insertMs, lookupMs * 1e6 / double( probes.size() ), hits, removeMs, removed);
+}
+
+/*! Builds a tree from the sorted keys and probes it */
+template <class Container>
+void runBuilt( const char* name, const vector<int>& sorted, const vector<int>& probes )
+{
+    Container tree( sorted.begin(), sorted.end() );
+
+    size_t hits = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        hits += has(tree, probes[i]);
+
+    double lookupMs = elapsedMs(start);
+
+    printf("  %-22s height %3d   lookup %6.1f ns (%zu hits)\n",
+           name, height(tree), lookupMs * 1e6 / double( probes.size() ), hits);
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 4000000;
+    size_t lookups = ( argc > 2 ) ? atol(argv[2]) : 4000000;
+
+    vector<int> keys = randomKeys(treeSize, 1);
+    vector<int> probes = randomKeys(lookups, 2);
+
+    //! Every other probe is a key of the tree
+    for ( size_t i = 0; i < lookups; i += 2 )
+        probes[i] = keys[ probes[i] % treeSize ];
+
+    cout << treeSize << " values, " << lookups << " lookups" << endl;
+
+    run< RedBlackTree<int> >("RedBlackTree", keys, probes);
+    run< CompactRedBlackTree<int> >("CompactRedBlackTree", keys, probes);
+    run< CacheLineRedBlackTree<int> >("CacheLineRedBlackTree", keys, probes);
+    run< set<int> >("std::set", keys, probes);
+
+    vector<int> sorted(keys);
+    sort(sorted.begin(), sorted.end());
+
+    cout << "built from sorted input" << endl;
+
+    runBuilt< RedBlackTree<int> >("RedBlackTree", sorted, probes);
+    runBuilt< CompactRedBlackTree<int> >("CompactRedBlackTree", sorted, probes);
+    runBuilt< CacheLineRedBlackTree<int> >("CacheLineRedBlackTree", sorted, probes);
+    runBuilt< set<int> >("std::set", sorted, probes);
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*! \file */
+/*! \brief concurrent_read.cpp.
+ *
+ *  Benchmark: read throughput with 1, 2, 4 and 8 reader threads while one writer keeps
+ *  inserting and removing, for a RedBlackTree behind a mutex and a ConcurrentRedBlackTree.
+ *  The scaling is bounded by the number of cores of the machine.
+ *  Usage: bin/concurrent_read [tree size] [milliseconds per run]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "RedBlackTree.h"
+#include "ConcurrentRedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! The global mutex wrapper the concurrent tree replaces */
+struct LockedTree
+{
+    RedBlackTree<int>   tree;
+    mutable mutex       lock;
+
+    void insert( int v ) { lock_guard<mutex> guard(lock); tree.insert(v); }
+    void remove( int v ) { lock_guard<mutex> guard(lock); tree.remove(v); }
+    bool contains( int v ) const { lock_guard<mutex> guard(lock); return tree.contains(v); }
+};
+
+/*! Lookups per second of all the readers, with one writer running */
+template <class Tree>
+double readThroughput( Tree& tree, const vector<int>& probes, const vector<int>& updates,
+                       unsigned readers, unsigned milliseconds )
+{
+    atomic<bool> stop(false);
+    atomic<size_t> lookups(0), hits(0);
+    vector<thread> threads;
+
+    //! The writer removes a key and puts it back
+    threads.push_back( thread( [&]()
+    {
+        for ( size_t i = 0; !stop.load(); i = ( i + 1 ) % updates.size() )
+        {
+            tree.remove(updates[i]);
+            tree.insert(updates[i]);
+        }
+    } ) );
+
+    for ( unsigned r = 0; r < readers; r++ )
+    {
+        threads.push_back( thread( [&, r]()
+        {
+            size_t done = 0, found = 0;
+
+            for ( size_t i = r * 7919; !stop.load(memory_order_relaxed); i++, done++ )
+                found += tree.contains( probes[i % probes.size()] );
+
+            lookups += done;
+            hits += found;
+        } ) );
+    }
+
+    this_thread::sleep_for( chrono::milliseconds(milliseconds) );
+    stop = true;
+
+    for ( size_t t = 0; t < threads.size(); t++ )
+        threads[t].join();
+
+    return lookups.load() / ( milliseconds / 1000.0 );
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+    unsigned milliseconds = ( argc > 2 ) ? atoi(argv[2]) : 300;
+
+    vector<int> keys = randomKeys(treeSize, 1);
+    vector<int> probes = randomKeys(treeSize, 2);
+    vector<int> updates( keys.begin(), keys.begin() + keys.size() / 10 );
+
+    //! Half of the probes are hits
+    for ( size_t i = 0; i < probes.size(); i += 2 )
+        probes[i] = keys[probes[i] % keys.size()];
+
+    LockedTree locked;
+    ConcurrentRedBlackTree<int> concurrent;
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        locked.tree.insert(keys[i]);
+
+    concurrent.insert_batch(keys.begin(), keys.end());
+
+    cout << "tree " << treeSize << ", one writer, " << thread::hardware_concurrency() << " cores" << endl;
+
+    unsigned readers[] = { 1, 2, 4, 8 };
+    double lockedBase = 0, concurrentBase = 0;
+
+    for ( size_t r = 0; r < sizeof(readers) / sizeof(readers[0]); r++ )
+    {
+        double lockedRate = readThroughput(locked, probes, updates, readers[r], milliseconds);
+        double concurrentRate = readThroughput(concurrent, probes, updates, readers[r], milliseconds);
+
+        if ( r == 0 )
+        {
+            lockedBase = lockedRate;
+            concurrentBase = concurrentRate;
+        }
+
+        cout << "  " << readers[r] << " readers: mutex " << lockedRate / 1e6 << " M/s (" << lockedRate / lockedBase
+             << "x), concurrent " << concurrentRate / 1e6 << " M/s (" << concurrentRate / concurrentBase << "x)" << endl;
+    }
+
+    return ( concurrent.size() == keys.size() ) ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+/*! \file */
+/*! \brief copy_teardown.cpp.
+ *
+ *  Benchmark: copying and clearing a big tree. The node by node clone (heap nodes) against
+ *  the arena copy of the pooled trees (pointer links relocated, index links as they are),
+ *  sequential and on a thread pool, then clear() against clear(pool).
+ *  Usage: bin/copy_teardown [tree size]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "ThreadPool.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! Times one copy and one clear of a tree of type Tree, with and without the pool */
+template <class Tree>
+void run( const char* name, const vector<int>& keys, ThreadPool& pool )
+{
+    Tree source(keys.begin(), keys.end(), Tree::Unsorted);
+
+    for ( int parallel = 0; parallel < 2; parallel++ )
+    {
+        ThreadPool* workers = parallel ? &pool : NULL;
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        Tree copy(source, workers);
+        double copyMs = elapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        copy.clear(workers);
+        double clearMs = elapsedMs(start);
+
+        cout << "  " << name << ( parallel ? " (pool)" : "       " )
+             << "  copy " << copyMs << " ms, clear " << clearMs << " ms" << endl;
+    }
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 2000000;
+
+    vector<int> keys = randomKeys(treeSize, 1);
+    ThreadPool pool;
+
+    cout << treeSize << " values, " << pool.size() + 1 << " threads" << endl;
+
+    run< RedBlackTree< int, less<int>, HeapNodeAllocator< RBTreeNode<int, false> > > >("heap    ", keys, pool);
+    run< RedBlackTree<int> >("pool    ", keys, pool);
+    run< CompactRedBlackTree<int> >("compact ", keys, pool);
+
+    return 0;
+}
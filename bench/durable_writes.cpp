@@ -0,0 +1,92 @@
+/*! \file */
+/*! \brief durable_writes.cpp.
+ *
+ *  Benchmark: logged inserts on a DurableRedBlackTree from several threads, under each
+ *  sync policy (SyncAlways shows the group commit: the syncs per insert drop as threads are
+ *  added), then the restart: replaying the log against rebuilding by insert().
+ *  Usage: bin/durable_writes [inserts per thread] [threads] [log path]
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+
+#include "DurableRedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+typedef DurableRedBlackTree<int> Durable;
+
+/*! Times threads writers doing n inserts each */
+void run( const char* name, Durable::Log::SyncPolicy policy, size_t n, size_t threads, const string& path )
+{
+    remove(path.c_str());
+
+    Durable tree(path, policy);
+    vector<thread> writers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t t = 0; t < threads; t++ )
+        writers.push_back( thread( [&tree, n, t]() {
+            for ( size_t i = 0; i < n; i++ )
+                tree.insert( int( t * n + i ) );
+        } ) );
+
+    for ( size_t t = 0; t < writers.size(); t++ )
+        writers[t].join();
+
+    double ms = elapsedMs(start);
+    cout << "  " << name << ms << " ms, " << ( ms * 1e6 ) / double( n * threads ) << " ns/insert" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t n = ( argc > 1 ) ? atol(argv[1]) : 2000;
+    size_t threads = ( argc > 2 ) ? atol(argv[2]) : 8;
+    string path = ( argc > 3 ) ? argv[3] : "durable_writes.log";
+
+    cout << threads << " threads x " << n << " inserts" << endl;
+
+    run("SyncAlways   ", Durable::Log::SyncAlways, n, threads, path);
+    run("SyncInterval ", Durable::Log::SyncInterval, n, threads, path);
+    run("SyncNever    ", Durable::Log::SyncNever, n, threads, path);
+
+    //! Restart: a log of random inserts (no compaction on the way, the values are all distinct)
+    size_t restart = 50 * n * threads;
+    vector<int> keys(restart);
+    srand(1);
+
+    for ( size_t i = 0; i < restart; i++ )
+        keys[i] = rand();
+
+    remove(path.c_str());
+
+    {
+        Durable tree(path, Durable::Log::SyncNever);
+
+        for ( size_t i = 0; i < restart; i++ )
+            tree.insert(keys[i]);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Durable replayed(path);
+    cout << "replay " << replayed.size() << " records  " << elapsedMs(start) << " ms, ";
+
+    start = chrono::steady_clock::now();
+    RedBlackTree<int> inserted;
+
+    for ( size_t i = 0; i < restart; i++ )
+        inserted.insert(keys[i]);
+    cout << "insert() rebuild " << elapsedMs(start) << " ms" << endl;
+
+    remove(path.c_str());
+
+    return 0;
+}
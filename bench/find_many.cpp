@@ -0,0 +1,68 @@
+/*! \file */
+/*! \brief find_many.cpp.
+ *
+ *  Benchmark: a plain loop of find() against find_many() with several group sizes.
+ *  The tree is built by random insertions, so the nodes are scattered in memory.
+ *  Usage: bin/find_many [tree size] [lookups]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+    size_t lookups = ( argc > 2 ) ? atol(argv[2]) : 2000000;
+
+    vector<int> keys = randomKeys(treeSize, 1);
+    vector<int> probes = randomKeys(lookups, 2);
+
+    //! Half of the probes are hits
+    for ( size_t i = 0; i < probes.size(); i += 2 )
+        probes[i] = keys[probes[i] % keys.size()];
+
+    RedBlackTree<int> tree;
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        tree.insert(keys[i]);
+
+    vector<const int*> loopOut(probes.size());
+    vector<const int*> manyOut(probes.size());
+
+    //! One find() per key
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        loopOut[i] = tree.find(probes[i]);
+
+    double loopNs = elapsedNs(start) / probes.size();
+
+    cout << "tree " << treeSize << ", " << lookups << " lookups" << endl;
+    cout << "  find() loop        : " << loopNs << " ns/key" << endl;
+
+    size_t groups[] = { 1, 4, 8, 16, 32, 64 };
+    bool same = true;
+
+    for ( size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++ )
+    {
+        start = chrono::steady_clock::now();
+        tree.find_many(probes.begin(), probes.end(), manyOut.begin(), groups[g]);
+        double manyNs = elapsedNs(start) / probes.size();
+
+        cout << "  find_many(), G = " << groups[g] << ( groups[g] < 10 ? " " : "" ) << " : " << manyNs
+             << " ns/key (" << loopNs / manyNs << "x)" << endl;
+
+        same = same && ( manyOut == loopOut );
+    }
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/*! \file */
+/*! \brief frozen_lookup.cpp.
+ *
+ *  Benchmark: lookups in a RedBlackTree against its frozen snapshot
+ *  (scalar branchless search and SIMD kernel) and a sorted vector.
+ *  The SIMD kernel needs AVX2: make bench also builds and runs bin/frozen_lookup_avx2
+ *  (-mavx2) when the CPU has it.
+ *  Usage: bin/frozen_lookup [tree size] [lookups]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+
+#include "RedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+    size_t lookups = ( argc > 2 ) ? atol(argv[2]) : 2000000;
+
+    vector<int> keys = randomKeys(treeSize, 1);
+    vector<int> probes = randomKeys(lookups, 2);
+
+    //! Half of the probes are hits
+    for ( size_t i = 0; i < probes.size(); i += 2 )
+        probes[i] = keys[probes[i] % keys.size()];
+
+    RedBlackTree<int> tree(keys.begin(), keys.end(), RedBlackTree<int>::Unsorted);
+    FrozenRedBlackTree<int> frozen = tree.freeze();
+    vector<int> sorted(tree.begin(), tree.end());
+
+    size_t treeHits = 0, scalarHits = 0, simdHits = 0, vectorHits = 0;
+
+    //! Pointer chasing
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        treeHits += tree.contains(probes[i]);
+
+    double treeNs = elapsedNs(start) / probes.size();
+
+    //! Branchless walk (a long key doesn't take the int kernel)
+    start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        scalarHits += frozen.contains( long(probes[i]) );
+
+    double scalarNs = elapsedNs(start) / probes.size();
+
+    //! Four levels per step
+    start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        simdHits += frozen.contains(probes[i]);
+
+    double simdNs = elapsedNs(start) / probes.size();
+
+    //! Binary search
+    start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        vectorHits += binary_search(sorted.begin(), sorted.end(), probes[i]);
+
+    double vectorNs = elapsedNs(start) / probes.size();
+
+    cout << "tree " << treeSize << ", " << lookups << " lookups" << endl;
+    cout << "  RedBlackTree::contains   : " << treeNs << " ns" << endl;
+    cout << "  frozen, branchless       : " << scalarNs << " ns" << endl;
+#if defined(__AVX2__)
+    cout << "  frozen, SIMD kernel      : " << simdNs << " ns" << endl;
+#else
+    cout << "  frozen, int key          : " << simdNs << " ns (no AVX2: same walk, see bin/frozen_lookup_avx2)" << endl;
+#endif
+    cout << "  sorted vector            : " << vectorNs << " ns" << endl;
+
+    bool same = ( treeHits == scalarHits ) && ( treeHits == simdHits ) && ( treeHits == vectorHits );
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/*! \file */
+/*! \brief ingest_strings.cpp.
+ *
+ *  Benchmark: filling a RedBlackTree<string> with insert(const&) (one copy per value),
+ *  insert(&&) and emplace() (no copy), then handing the tree over by copy and by move.
+ *  Usage: bin/ingest_strings [values]
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <utility>
+
+#include "RedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! Random strings long enough to live on the heap (fixed seed) */
+vector<string> randomStrings( size_t n, unsigned seed )
+{
+    vector<string> keys(n);
+    srand(seed);
+
+    for ( size_t i = 0; i < n; i++ )
+        keys[i] = "ingest-key-" + to_string( rand() ) + "-" + to_string( rand() );
+
+    return keys;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t n = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+
+    vector<string> keys = randomStrings(n, 1);
+    chrono::steady_clock::time_point start;
+
+    {
+        vector<string> batch(keys);
+        RedBlackTree<string> tree;
+
+        start = chrono::steady_clock::now();
+        for ( size_t i = 0; i < n; i++ )
+            tree.insert(batch[i]);
+        cout << "insert copy  " << elapsedMs(start) << " ms" << endl;
+    }
+
+    {
+        vector<string> batch(keys);
+        RedBlackTree<string> tree;
+
+        start = chrono::steady_clock::now();
+        for ( size_t i = 0; i < n; i++ )
+            tree.insert( std::move(batch[i]) );
+        cout << "insert move  " << elapsedMs(start) << " ms" << endl;
+    }
+
+    {
+        RedBlackTree<string> tree;
+
+        start = chrono::steady_clock::now();
+        for ( size_t i = 0; i < n; i++ )
+            tree.emplace( keys[i].data(), keys[i].size() );
+        cout << "emplace      " << elapsedMs(start) << " ms" << endl;
+
+        start = chrono::steady_clock::now();
+        RedBlackTree<string> copied(tree);
+        cout << "hand over: copy " << elapsedMs(start) << " ms, ";
+
+        start = chrono::steady_clock::now();
+        RedBlackTree<string> moved( std::move(tree) );
+        cout << "move " << elapsedMs(start) << " ms" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*! \file */
+/*! \brief insert_batch.cpp.
+ *
+ *  Benchmark: insert() in a loop against insert_batch(), same keys.
+ *  Usage: bin/insert_batch [tree size] [batch size] [batches]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+    size_t batchSize = ( argc > 2 ) ? atol(argv[2]) : 50000;
+    size_t batches = ( argc > 3 ) ? atol(argv[3]) : 4;
+
+    vector<int> initial = randomKeys(treeSize, 1);
+    vector<int> keys = randomKeys(batchSize * batches, 2);
+
+    RedBlackTree<int> loopTree(initial.begin(), initial.end(), RedBlackTree<int>::Unsorted);
+    RedBlackTree<int> batchTree(loopTree);
+
+    //! One insert() per key
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        loopTree.insert(keys[i]);
+
+    double loopNs = elapsedNs(start) / keys.size();
+
+    //! One insert_batch() per batch
+    start = chrono::steady_clock::now();
+
+    for ( size_t b = 0; b < batches; b++ )
+        batchTree.insert_batch(keys.begin() + b * batchSize, keys.begin() + (b + 1) * batchSize);
+
+    double batchNs = elapsedNs(start) / keys.size();
+
+    cout << "tree " << treeSize << ", " << batches << " batches of " << batchSize << endl;
+    cout << "  insert() loop  : " << loopNs << " ns/key" << endl;
+    cout << "  insert_batch() : " << batchNs << " ns/key" << endl;
+    cout << "  speedup        : " << loopNs / batchNs << "x" << endl;
+
+    return ( loopTree.size() == batchTree.size() ) ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/*! \file */
+/*! \brief map_payload.cpp.
+ *
+ *  Benchmark: records keyed by id, with a 256 byte payload. The records embedded in a
+ *  RedBlackTree (every descent drags them through cache) against a RedBlackMap (ids in the
+ *  tree, payloads in the value pool): insertion, then random lookups.
+ *  Usage: bin/map_payload [records] [lookups]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <stdint.h>
+
+#include "RedBlackTree.h"
+#include "RedBlackMap.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! The payload of a record */
+struct Payload
+{
+    char bytes[256];
+};
+
+/*! A whole record, ordered by id */
+struct Record
+{
+    Record( void ) : id(0) { /*! empty */ }
+    explicit Record( uint64_t i ) : id(i) { memset(payload.bytes, int(i), sizeof(payload.bytes)); }
+
+    bool operator < ( const Record& rhs ) const { return id < rhs.id; }
+    bool operator <= ( const Record& rhs ) const { return id <= rhs.id; }
+
+    uint64_t    id;
+    Payload     payload;
+};
+
+bool operator < ( const Record& r, uint64_t id ) { return r.id < id; }
+bool operator < ( uint64_t id, const Record& r ) { return id < r.id; }
+
+/*! Random ids (fixed seed, so every run sees the same stream) */
+vector<uint64_t> randomIds( size_t n, unsigned seed )
+{
+    vector<uint64_t> ids(n);
+    srand(seed);
+
+    for ( size_t i = 0; i < n; i++ )
+        ids[i] = ( uint64_t(rand()) << 31 ) | uint64_t(rand());
+
+    return ids;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t n = ( argc > 1 ) ? atol(argv[1]) : 500000;
+    size_t lookups = ( argc > 2 ) ? atol(argv[2]) : 2000000;
+
+    vector<uint64_t> ids = randomIds(n, 1);
+    vector<uint64_t> probes(lookups);
+
+    for ( size_t i = 0; i < lookups; i++ )
+        probes[i] = ids[ size_t(rand()) % n ];
+
+    chrono::steady_clock::time_point start;
+    size_t hits = 0;
+
+    {
+        RedBlackTree<Record> records;
+
+        start = chrono::steady_clock::now();
+        for ( size_t i = 0; i < n; i++ )
+            records.emplace(ids[i]);
+        cout << "tree of records  insert " << elapsedMs(start) << " ms, ";
+
+        start = chrono::steady_clock::now();
+        for ( size_t i = 0; i < lookups; i++ )
+            hits += records.find(probes[i])->payload.bytes[0] != 1;
+        cout << "lookup " << elapsedMs(start) << " ms" << endl;
+    }
+
+    {
+        RedBlackMap< uint64_t, Payload, IndexNodePool< IndexedRBTreeNode< RBMapEntry<uint64_t> > > > records;
+
+        start = chrono::steady_clock::now();
+        for ( size_t i = 0; i < n; i++ )
+            memset( records[ids[i]].bytes, int(ids[i]), sizeof(Payload) );
+        cout << "map (hot/cold)   insert " << elapsedMs(start) << " ms, ";
+
+        start = chrono::steady_clock::now();
+        for ( size_t i = 0; i < lookups; i++ )
+            hits += records.find(probes[i])->bytes[0] != 1;
+        cout << "lookup " << elapsedMs(start) << " ms" << endl;
+    }
+
+    cout << "(" << hits << ")" << endl;
+
+    return 0;
+}
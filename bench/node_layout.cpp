@@ -0,0 +1,78 @@
+/*! \file */
+/*! \brief node_layout.cpp.
+ *
+ *  Benchmark: default, packed and compact (32 bit index) node layouts.
+ *  Same keys for each: insertion, random lookups and a full in-order scan.
+ *  Usage: bin/node_layout [tree size] [lookups]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+
+#include "RedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! Runs the three phases on one tree type and prints a line */
+template <class Tree>
+size_t run( const string& name, const vector<int>& keys, const vector<int>& probes )
+{
+    Tree tree;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        tree.insert(keys[i]);
+
+    double insertNs = elapsedNs(start) / keys.size();
+
+    //! Lookups (the hits are counted so the loop can't be dropped)
+    size_t hits = 0;
+    start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        hits += tree.contains(probes[i]);
+
+    double findNs = elapsedNs(start) / probes.size();
+
+    //! In-order scan
+    long long sum = 0;
+    start = chrono::steady_clock::now();
+
+    for ( typename Tree::const_iterator it = tree.begin(); it != tree.end(); ++it )
+        sum += *it;
+
+    double scanNs = elapsedNs(start) / keys.size();
+
+    cout << "  " << name << " node " << sizeof(typename Tree::Node) << " bytes | insert "
+         << insertNs << " ns | contains " << findNs << " ns | scan " << scanNs << " ns" << endl;
+
+    return hits + size_t(sum & 1);
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+    size_t lookups = ( argc > 2 ) ? atol(argv[2]) : 1000000;
+
+    vector<int> keys = randomKeys(treeSize, 1);
+    vector<int> probes = randomKeys(lookups, 2);
+
+    //! Half of the probes are hits
+    for ( size_t i = 0; i < probes.size(); i += 2 )
+        probes[i] = keys[probes[i] % keys.size()];
+
+    cout << "tree " << treeSize << ", " << lookups << " lookups" << endl;
+
+    size_t check = run< RedBlackTree<int> >("default", keys, probes);
+    check += run< PackedRedBlackTree<int> >("packed ", keys, probes);
+    check += run< CompactRedBlackTree<int> >("compact", keys, probes);
+
+    return ( check > 0 ) ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/*! \file */
+/*! \brief set_algebra.cpp.
+ *
+ *  Benchmark: union, intersection and difference of a big tree with smaller and smaller
+ *  ones, one insert()/remove() per value against the join based unite(), intersect() and
+ *  subtract() (sequential and on a thread pool), then erase_range() against remove().
+ *  Usage: bin/set_algebra [tree size]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "ThreadPool.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! One insert() for every value of b not in a (the way it was done before unite) */
+void naiveUnite( RedBlackTree<int>& a, const RedBlackTree<int>& b )
+{
+    for ( RedBlackTree<int>::const_iterator it = b.begin(); it != b.end(); ++it )
+        if ( !a.contains(*it) )
+            a.insert(*it);
+}
+
+/*! One remove() for every value of b */
+void naiveSubtract( RedBlackTree<int>& a, const RedBlackTree<int>& b )
+{
+    for ( RedBlackTree<int>::const_iterator it = b.begin(); it != b.end(); ++it )
+        a.remove(*it);
+}
+
+/*! A new tree with the values of a also in b */
+void naiveIntersect( RedBlackTree<int>& a, const RedBlackTree<int>& b )
+{
+    RedBlackTree<int> kept;
+
+    for ( RedBlackTree<int>::const_iterator it = a.begin(); it != a.end(); ++it )
+        if ( b.contains(*it) )
+            kept.insert(*it);
+
+    a = kept;
+}
+
+/*! Runs op on a copy of a (the copy isn't timed), in milliseconds */
+template <class Operation>
+double timed( const RedBlackTree<int>& a, Operation op )
+{
+    RedBlackTree<int> copy(a);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    op(copy);
+
+    return elapsedMs(start);
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+
+    vector<int> keys = randomKeys(treeSize, 1, 4 * treeSize);
+    RedBlackTree<int> a(keys.begin(), keys.end(), RedBlackTree<int>::Unsorted | RedBlackTree<int>::Unique);
+    ThreadPool pool;
+
+    cout << a.size() << " values, " << pool.size() + 1 << " threads" << endl;
+
+    for ( size_t m = treeSize; m >= 1000; m /= 10 )
+    {
+        vector<int> other = randomKeys(m, 2, 4 * m);
+        RedBlackTree<int> b(other.begin(), other.end(), RedBlackTree<int>::Unsorted | RedBlackTree<int>::Unique);
+
+        cout << "  m = " << b.size() << endl;
+        cout << "    union:        insert " << timed(a, [&]( RedBlackTree<int>& t ) { naiveUnite(t, b); }) << " ms, "
+             << "unite " << timed(a, [&]( RedBlackTree<int>& t ) { t.unite(b); }) << " ms, "
+             << "pool " << timed(a, [&]( RedBlackTree<int>& t ) { t.unite(b, &pool); }) << " ms" << endl;
+        cout << "    intersection: rebuild " << timed(a, [&]( RedBlackTree<int>& t ) { naiveIntersect(t, b); }) << " ms, "
+             << "intersect " << timed(a, [&]( RedBlackTree<int>& t ) { t.intersect(b); }) << " ms, "
+             << "pool " << timed(a, [&]( RedBlackTree<int>& t ) { t.intersect(b, &pool); }) << " ms" << endl;
+        cout << "    difference:   remove " << timed(a, [&]( RedBlackTree<int>& t ) { naiveSubtract(t, b); }) << " ms, "
+             << "subtract " << timed(a, [&]( RedBlackTree<int>& t ) { t.subtract(b); }) << " ms, "
+             << "pool " << timed(a, [&]( RedBlackTree<int>& t ) { t.subtract(b, &pool); }) << " ms" << endl;
+    }
+
+    //! A tenth of the key range
+    int lo = int(treeSize), hi = int(treeSize + treeSize * 4 / 10);
+    vector<int> range(a.lower_bound(lo), a.upper_bound(hi));
+
+    cout << "  erase " << range.size() << " values in a range: remove "
+         << timed(a, [&]( RedBlackTree<int>& t ) { for ( size_t i = 0; i < range.size(); i++ ) t.remove(range[i]); }) << " ms, "
+         << "erase_range " << timed(a, [&]( RedBlackTree<int>& t ) { t.erase_range(lo, hi); }) << " ms" << endl;
+
+    return 0;
+}
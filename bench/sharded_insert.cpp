@@ -0,0 +1,110 @@
+/*! \file */
+/*! \brief sharded_insert.cpp.
+ *
+ *  Benchmark: write throughput with 1, 2, 4 and 8 writer threads (uniform keys) for a
+ *  RedBlackTree behind a mutex and a ShardedRedBlackTree, then one parallel insert_batch.
+ *  The scaling is bounded by the number of cores of the machine.
+ *  Usage: bin/sharded_insert [insertions per run]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <mutex>
+
+#include "RedBlackTree.h"
+#include "ShardedRedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! The global mutex wrapper the sharded tree replaces */
+struct LockedTree
+{
+    RedBlackTree<int>   tree;
+    mutex               lock;
+
+    void insert( int v ) { lock_guard<mutex> guard(lock); tree.insert(v); }
+};
+
+/*! Insertions per second, keys split evenly among the writers */
+template <class Tree>
+double writeThroughput( Tree& tree, const vector<int>& keys, unsigned writers )
+{
+    vector<thread> threads;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( unsigned w = 0; w < writers; w++ )
+    {
+        threads.push_back( thread( [&, w]()
+        {
+            for ( size_t i = w; i < keys.size(); i += writers )
+                tree.insert(keys[i]);
+        } ) );
+    }
+
+    for ( size_t t = 0; t < threads.size(); t++ )
+        threads[t].join();
+
+    return keys.size() / ( elapsedNs(start) / 1e9 );
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t insertions = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+
+    vector<int> keys = randomKeys(insertions, 1);
+    vector<int> bounds;
+
+    //! Uniform keys: even bounds over [0, RAND_MAX]
+    size_t shards = thread::hardware_concurrency() > 8 ? thread::hardware_concurrency() : 8;
+
+    for ( size_t i = 1; i < shards; i++ )
+        bounds.push_back( int( (long long) RAND_MAX * i / shards ) );
+
+    cout << insertions << " insertions, " << shards << " shards, " << thread::hardware_concurrency() << " cores" << endl;
+
+    unsigned writers[] = { 1, 2, 4, 8 };
+    double lockedBase = 0, shardedBase = 0;
+    bool same = true;
+
+    for ( size_t w = 0; w < sizeof(writers) / sizeof(writers[0]); w++ )
+    {
+        LockedTree locked;
+        ShardedRedBlackTree<int> sharded(bounds);
+
+        double lockedRate = writeThroughput(locked, keys, writers[w]);
+        double shardedRate = writeThroughput(sharded, keys, writers[w]);
+
+        if ( w == 0 )
+        {
+            lockedBase = lockedRate;
+            shardedBase = shardedRate;
+        }
+
+        cout << "  " << writers[w] << " writers: mutex " << lockedRate / 1e6 << " M/s (" << lockedRate / lockedBase
+             << "x), sharded " << shardedRate / 1e6 << " M/s (" << shardedRate / shardedBase << "x)" << endl;
+
+        same = same && ( locked.tree.size() == sharded.size() );
+    }
+
+    //! One batch, one task per shard
+    RedBlackTree<int> single;
+    ShardedRedBlackTree<int> sharded(bounds);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    single.insert_batch(keys.begin(), keys.end());
+    double singleNs = elapsedNs(start);
+
+    start = chrono::steady_clock::now();
+    sharded.insert_batch(keys.begin(), keys.end());
+    double shardedNs = elapsedNs(start);
+
+    cout << "  insert_batch: RedBlackTree " << singleNs / 1e6 << " ms, sharded " << shardedNs / 1e6 << " ms" << endl;
+
+    return ( same && single.size() == sharded.size() ) ? 0 : 1;
+}
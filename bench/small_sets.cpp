@@ -0,0 +1,92 @@
+/*! \file */
+/*! \brief small_sets.cpp.
+ *
+ *  Benchmark: many tiny sets. SmallRedBlackTree<int> keeps them inline (no node, no allocation),
+ *  against RedBlackTree<int> (always in nodes) and std::set: time to fill them, heap taken
+ *  and lookups.
+ *  Usage: bin/small_sets [sets] [values per set]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! Bytes asked to operator new since the start */
+static size_t heapBytes = 0;
+
+void* operator new( size_t bytes )
+{
+    heapBytes += bytes;
+
+    void* p = malloc( bytes ? bytes : 1 );
+
+    if ( p == NULL )
+        throw bad_alloc();
+
+    return p;
+}
+
+void* operator new[]( size_t bytes ) { return operator new(bytes); }
+void operator delete( void* p ) noexcept { free(p); }
+void operator delete[]( void* p ) noexcept { free(p); }
+
+bool has( const set<int>& c, int k ) { return c.count(k) > 0; }
+
+template <class Tree>
+bool has( const Tree& c, int k ) { return c.contains(k); }
+
+/*! Fills sets of perSet values each, then probes each set perSet times */
+template <class Container>
+void run( const char* name, size_t sets, size_t perSet, const vector<int>& keys, const vector<int>& probes )
+{
+    size_t before = heapBytes;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    vector<Container> all(sets);
+
+    for ( size_t s = 0; s < sets; s++ )
+        for ( size_t i = 0; i < perSet; i++ )
+            all[s].insert( keys[s * perSet + i] );
+
+    double fillMs = elapsedMs(start);
+    double bytes = double( heapBytes - before ) / double(sets);
+
+    size_t hits = 0;
+    start = chrono::steady_clock::now();
+
+    for ( size_t s = 0; s < sets; s++ )
+        for ( size_t i = 0; i < perSet; i++ )
+            hits += has( all[s], probes[s * perSet + i] );
+
+    double lookupMs = elapsedMs(start);
+
+    printf("  %-22s fill %8.1f ms   %7.1f bytes/set   lookups %8.1f ms (%zu hits)\n",
+           name, fillMs, bytes, lookupMs, hits);
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t sets = ( argc > 1 ) ? atol(argv[1]) : 200000;
+    size_t perSet = ( argc > 2 ) ? atol(argv[2]) : 8;
+
+    vector<int> keys = randomKeys(sets * perSet, 1, 64);
+    vector<int> probes = randomKeys(sets * perSet, 2, 64);
+
+    cout << sets << " sets of " << perSet << " values (keys below 64)" << endl;
+
+    run< SmallRedBlackTree<int> >("SmallRedBlackTree", sets, perSet, keys, probes);
+    run< RedBlackTree<int> >("RedBlackTree", sets, perSet, keys, probes);
+    run< set<int> >("std::set", sets, perSet, keys, probes);
+
+    return 0;
+}
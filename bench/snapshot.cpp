@@ -0,0 +1,81 @@
+/*! \file */
+/*! \brief snapshot.cpp.
+ *
+ *  Benchmark: point in time copies. RedBlackTree's copy constructor (deep copy) against
+ *  PersistentRedBlackTree::snapshot(), and the insertion cost of each tree.
+ *  Usage: bin/snapshot [tree size] [insertions between snapshots]
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "PersistentRedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 1000000;
+    size_t between = ( argc > 2 ) ? atol(argv[2]) : 1000;
+
+    vector<int> keys = randomKeys(treeSize, 1);
+    vector<int> more = randomKeys(between * 10, 2);
+
+    //! Insertion cost
+    RedBlackTree<int> plain;
+    PersistentRedBlackTree<int> persistent;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        plain.insert(keys[i]);
+
+    double plainNs = elapsedNs(start) / keys.size();
+    start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        persistent.insert(keys[i]);
+
+    double persistentNs = elapsedNs(start) / keys.size();
+
+    //! Ten snapshots, with insertions in between
+    vector< RedBlackTree<int> > copies;
+    vector< PersistentRedBlackTree<int>::Snapshot > snapshots;
+    double copyNs = 0, snapshotNs = 0;
+
+    for ( size_t s = 0; s < 10; s++ )
+    {
+        start = chrono::steady_clock::now();
+        copies.push_back(plain);
+        copyNs += elapsedNs(start);
+
+        start = chrono::steady_clock::now();
+        snapshots.push_back( persistent.snapshot() );
+        snapshotNs += elapsedNs(start);
+
+        for ( size_t i = s * between; i < ( s + 1 ) * between; i++ )
+        {
+            plain.insert(more[i]);
+            persistent.insert(more[i]);
+        }
+    }
+
+    cout << "tree " << treeSize << ", 10 snapshots, " << between << " insertions between them" << endl;
+    cout << "  insert, RedBlackTree           : " << plainNs << " ns" << endl;
+    cout << "  insert, PersistentRedBlackTree : " << persistentNs << " ns" << endl;
+    cout << "  copy constructor               : " << copyNs / 10 / 1000 << " us per copy" << endl;
+    cout << "  snapshot()                     : " << snapshotNs / 10 / 1000 << " us per snapshot" << endl;
+
+    bool same = true;
+
+    for ( size_t s = 0; s < 10; s++ )
+        same = same && ( copies[s].size() == snapshots[s].size() );
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/*! \file */
+/*! \brief snapshot_image.cpp.
+ *
+ *  Benchmark: restarting from disk. Rebuilding the tree by insert() (from a key dump)
+ *  against open_mmap() of the image written by save(), then random lookups on both
+ *  (the mapped pages load on the first touch, so the first lookups pay for them).
+ *  Usage: bin/snapshot_image [tree size] [lookups] [image path]
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "BenchUtil.h"
+
+using namespace std;
+
+/*! Times contains() for every probe */
+template <class Tree>
+void lookups( const char* name, const Tree& tree, const vector<int>& probes )
+{
+    size_t hits = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for ( size_t i = 0; i < probes.size(); i++ )
+        hits += tree.contains(probes[i]);
+
+    cout << "  " << name << elapsedMs(start) << " ms (" << hits << " hits)" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    size_t treeSize = ( argc > 1 ) ? atol(argv[1]) : 5000000;
+    size_t lookupCount = ( argc > 2 ) ? atol(argv[2]) : 5000000;
+    string path = ( argc > 3 ) ? argv[3] : "snapshot_image.bin";
+
+    vector<int> keys = randomKeys(treeSize, 1, 2 * treeSize);
+    vector<int> probes = randomKeys(lookupCount, 2, 2 * lookupCount);
+    chrono::steady_clock::time_point start;
+
+    cout << treeSize << " values, " << lookupCount << " lookups" << endl;
+
+    {
+        RedBlackTree<int> tree;
+
+        start = chrono::steady_clock::now();
+        for ( size_t i = 0; i < treeSize; i++ )
+            tree.insert(keys[i]);
+        cout << "rebuild by insert  " << elapsedMs(start) << " ms" << endl;
+
+        start = chrono::steady_clock::now();
+        tree.save(path);
+        cout << "save               " << elapsedMs(start) << " ms" << endl;
+
+        lookups("heap tree      ", tree, probes);
+    }
+
+    {
+        start = chrono::steady_clock::now();
+        MappedRedBlackTree<int> mapped = RedBlackTree<int>::open_mmap(path);
+        cout << "open_mmap          " << elapsedMs(start) << " ms" << endl;
+
+        lookups("mapped (cold)  ", mapped, probes);
+        lookups("mapped (warm)  ", mapped, probes);
+
+        start = chrono::steady_clock::now();
+        MappedRedBlackTree<int> verified = RedBlackTree<int>::open_mmap(path, true);
+        cout << "open_mmap verified " << elapsedMs(start) << " ms (" << verified.size() << " values)" << endl;
+    }
+
+    remove(path.c_str());
+
+    return 0;
+}
@@ -0,0 +1,437 @@
+/*! \file */
+/*! \brief suite.cpp.
+ *
+ *  Benchmark suite: RedBlackTree and RedBlackMap against std::set, std::multiset and std::map.
+ *  For every key stream (sequential, reverse, uniform random, Zipfian) and size it times
+ *  insert, search, copy, destruction and removal, and reports ns/op, throughput,
+ *  allocations per op and the peak RSS of the run. Every (container, stream, size) runs
+ *  in a process of its own, so the peak RSS is its own too. The key streams come from fixed
+ *  seeds, so two runs see the same keys. Small sizes are repeated until about a million
+ *  operations, and the times averaged.
+ *  Usage: bin/suite [--sizes 1000,100000,...] [--json results.json]
+ *  ("make bench-suite BENCH_SIZES=1000,...,100000000" for the whole range)
+*/
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <ctime>
+#include <chrono>
+#include <stdint.h>
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "RedBlackTree.h"
+#include "RedBlackMap.h"
+
+using namespace std;
+
+/*! Allocations made through operator new since the start */
+static size_t allocations = 0;
+
+void* operator new( size_t bytes )
+{
+    allocations++;
+
+    void* p = malloc( bytes ? bytes : 1 );
+
+    if ( p == NULL )
+        throw bad_alloc();
+
+    return p;
+}
+
+void* operator new[]( size_t bytes ) { return operator new(bytes); }
+void operator delete( void* p ) noexcept { free(p); }
+void operator delete[]( void* p ) noexcept { free(p); }
+
+/*! Containers and their insert / search / remove */
+typedef RedBlackTree<uint64_t>              Tree;
+typedef RedBlackMap<uint64_t, uint64_t>     Map;
+
+void put( Tree& c, uint64_t k ) { c.insert(k); }
+void put( set<uint64_t>& c, uint64_t k ) { c.insert(k); }
+void put( multiset<uint64_t>& c, uint64_t k ) { c.insert(k); }
+void put( Map& c, uint64_t k ) { c.try_emplace(k, k); }
+void put( map<uint64_t, uint64_t>& c, uint64_t k ) { c.emplace(k, k); }
+
+bool has( const Tree& c, uint64_t k ) { return c.contains(k); }
+bool has( const set<uint64_t>& c, uint64_t k ) { return c.find(k) != c.end(); }
+bool has( const multiset<uint64_t>& c, uint64_t k ) { return c.find(k) != c.end(); }
+bool has( const Map& c, uint64_t k ) { return c.find(k) != NULL; }
+bool has( const map<uint64_t, uint64_t>& c, uint64_t k ) { return c.find(k) != c.end(); }
+
+void drop( Tree& c, uint64_t k ) { c.remove(k); }
+void drop( set<uint64_t>& c, uint64_t k ) { c.erase(k); }
+void drop( multiset<uint64_t>& c, uint64_t k ) { multiset<uint64_t>::iterator it = c.find(k); if ( it != c.end() ) c.erase(it); }
+void drop( Map& c, uint64_t k ) { c.erase(k); }
+void drop( map<uint64_t, uint64_t>& c, uint64_t k ) { c.erase(k); }
+
+/*! Copy of c (false for the containers that can't be copied) */
+template <class Container>
+bool copyOf( const Container& c, Container*& copy ) { copy = new Container(c); return true; }
+
+bool copyOf( const Map&, Map*& ) { return false; }
+
+/*! SplitMix64: a well mixed 64 bit value out of any counter */
+uint64_t mix( uint64_t x )
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBULL;
+    return x ^ ( x >> 31 );
+}
+
+/*! Key streams */
+enum Stream { Sequential, Reverse, Uniform, Zipfian, StreamCount };
+
+const char* streamName( int s )
+{
+    static const char* names[] = { "sequential", "reverse", "uniform", "zipfian" };
+    return names[s];
+}
+
+/*! n keys of stream s. The Zipfian ranks (theta 0.99, drawn as in YCSB: Gray et al.) are
+ *  scrambled, so the hot keys are spread over the key space rather than packed at 0
+*/
+vector<uint64_t> keyStream( int s, size_t n )
+{
+    vector<uint64_t> keys(n);
+
+    if ( s == Sequential || s == Reverse )
+    {
+        for ( size_t i = 0; i < n; i++ )
+            keys[i] = ( s == Sequential ) ? i : n - 1 - i;
+    }
+    else if ( s == Uniform )
+    {
+        for ( size_t i = 0; i < n; i++ )
+            keys[i] = mix(i);
+    }
+    else
+    {
+        const double theta = 0.99;
+        double zetan = 0;
+
+        for ( size_t i = 1; i <= n; i++ )
+            zetan += 1.0 / pow(double(i), theta);
+
+        double zeta2 = 1.0 + pow(0.5, theta);
+        double alpha = 1.0 / ( 1.0 - theta );
+        double eta = ( 1.0 - pow(2.0 / double(n), 1.0 - theta) ) / ( 1.0 - zeta2 / zetan );
+
+        for ( size_t i = 0; i < n; i++ )
+        {
+            double u = double( mix(i) >> 11 ) / 9007199254740992.0;
+            double uz = u * zetan;
+            uint64_t rank = ( uz < 1.0 ) ? 0 : ( uz < zeta2 ) ? 1 :
+                            uint64_t( double(n) * pow(eta * u - eta + 1.0, alpha) );
+
+            keys[i] = mix( ( rank < n ? rank : n - 1 ) ^ 0x5A5A5A5A5A5A5A5AULL );
+        }
+    }
+
+    return keys;
+}
+
+/*! Operations timed on every container */
+enum Operation { Insert, Search, Copy, Destroy, Remove, OperationCount };
+
+const char* operationName( int op )
+{
+    static const char* names[] = { "insert", "search", "copy", "destroy", "remove" };
+    return names[op];
+}
+
+/*! Totals of one operation over the repetitions */
+struct Measure
+{
+    double  ns;         //!< elapsed nanoseconds
+    double  ops;        //!< operations (values, for copy and destroy)
+    double  allocs;     //!< calls to operator new
+};
+
+/*! One result line, sent by the child process */
+struct Result
+{
+    char        container[24];
+    int         stream;
+    size_t      size;
+    int         op;
+    double      nsPerOp;
+    double      allocsPerOp;
+    long        peakRssKb;
+};
+
+/*! Runs a measured block */
+class Timer
+{
+    public:
+
+        explicit Timer( Measure& m, double ops ) : m_measure(m), m_ops(ops), m_allocs(allocations),
+                                                   m_start( chrono::steady_clock::now() ) { /*! empty */ }
+
+        ~Timer()
+        {
+            m_measure.ns += chrono::duration<double, nano>( chrono::steady_clock::now() - m_start ).count();
+            m_measure.ops += m_ops;
+            m_measure.allocs += double( allocations - m_allocs );
+        }
+
+    private:
+
+        Measure&                        m_measure;
+        double                          m_ops;
+        size_t                          m_allocs;
+        chrono::steady_clock::time_point m_start;
+};
+
+/*! The whole cycle on one container, repeated reps times:
+ *  insert the stream, search it, copy the container, destroy the original, remove the
+ *  stream from the copy (the containers that can't be copied are destroyed and rebuilt)
+*/
+template <class Container>
+void cycle( const vector<uint64_t>& keys, size_t reps, Measure* measures, size_t& sink )
+{
+    for ( size_t r = 0; r < reps; r++ )
+    {
+        Container* original = new Container;
+        Container* copy = NULL;
+
+        {
+            Timer timer(measures[Insert], double( keys.size() ));
+
+            for ( size_t i = 0; i < keys.size(); i++ )
+                put(*original, keys[i]);
+        }
+
+        {
+            Timer timer(measures[Search], double( keys.size() ));
+
+            for ( size_t i = 0; i < keys.size(); i++ )
+                sink += has(*original, keys[i]);
+        }
+
+        bool copied;
+
+        {
+            Timer timer(measures[Copy], double( keys.size() ));
+            copied = copyOf(*original, copy);
+        }
+
+        if ( !copied )
+            measures[Copy].ops = 0;
+
+        {
+            Timer timer(measures[Destroy], double( keys.size() ));
+            delete original;
+        }
+
+        if ( !copied )
+        {
+            copy = new Container;
+
+            for ( size_t i = 0; i < keys.size(); i++ )
+                put(*copy, keys[i]);
+        }
+
+        {
+            Timer timer(measures[Remove], double( keys.size() ));
+
+            for ( size_t i = 0; i < keys.size(); i++ )
+                drop(*copy, keys[i]);
+        }
+
+        delete copy;
+    }
+}
+
+/*! Runs one container on one stream and size in a child process, results sent through a pipe.
+ *  Returns false if the child didn't exit cleanly (its results may be missing)
+*/
+template <class Container>
+bool runCase( const char* name, int stream, size_t size, vector<Result>& results )
+{
+    int channel[2];
+
+    if ( pipe(channel) != 0 )
+    {
+        cerr << "suite: pipe failed" << endl;
+        exit(1);
+    }
+
+    pid_t child = fork();
+
+    if ( child < 0 )
+    {
+        cerr << "suite: fork failed" << endl;
+        exit(1);
+    }
+
+    if ( child == 0 )
+    {
+        close(channel[0]);
+
+        vector<uint64_t> keys = keyStream(stream, size);
+        size_t reps = ( size < 1000000 ) ? 1000000 / size : 1;
+        size_t sink = 0;
+
+        Measure measures[OperationCount];
+        memset(measures, 0, sizeof(measures));
+
+        cycle<Container>(keys, reps, measures, sink);
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        for ( int op = 0; op < OperationCount; op++ )
+        {
+            if ( measures[op].ops == 0 )
+                continue;
+
+            Result result;
+            memset(&result, 0, sizeof(result));
+            strncpy(result.container, name, sizeof(result.container) - 1);
+            result.stream = stream;
+            result.size = size;
+            result.op = op;
+            result.nsPerOp = measures[op].ns / measures[op].ops;
+            result.allocsPerOp = measures[op].allocs / measures[op].ops;
+            result.peakRssKb = usage.ru_maxrss;
+
+            if ( write(channel[1], &result, sizeof(result)) != ssize_t( sizeof(result) ) )
+                _exit(1);
+        }
+
+        _exit( sink == size_t(-1) );
+    }
+
+    close(channel[1]);
+
+    Result result;
+
+    while ( read(channel[0], &result, sizeof(result)) == ssize_t( sizeof(result) ) )
+    {
+        results.push_back(result);
+
+        cout << "  " << left << setw(10) << result.container << setw(12) << streamName(result.stream)
+             << right << setw(11) << result.size << "  " << left << setw(8) << operationName(result.op)
+             << right << fixed << setprecision(1) << setw(10) << result.nsPerOp << " ns/op"
+             << setw(10) << setprecision(2) << 1e3 / result.nsPerOp << " Mops/s"
+             << setw(8) << setprecision(3) << result.allocsPerOp << " allocs/op"
+             << setw(10) << result.peakRssKb << " KB" << endl;
+    }
+
+    close(channel[0]);
+
+    int status;
+
+    if ( waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0 )
+    {
+        cerr << "suite: " << name << " on " << streamName(stream) << " keys of size " << size << " failed" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/*! The results as JSON */
+void writeJson( const string& path, const vector<Result>& results )
+{
+    ofstream out( path.c_str() );
+
+    out << "{\n  \"suite\": \"red_black_tree\",\n  \"timestamp\": " << long( time(NULL) )
+        << ",\n  \"compiler\": \"" << __VERSION__ << "\",\n  \"results\": [\n";
+
+    for ( size_t i = 0; i < results.size(); i++ )
+    {
+        const Result& r = results[i];
+
+        out << "    { \"container\": \"" << r.container << "\", \"stream\": \"" << streamName(r.stream)
+            << "\", \"size\": " << r.size << ", \"op\": \"" << operationName(r.op)
+            << "\", \"ns_per_op\": " << r.nsPerOp << ", \"ops_per_sec\": " << 1e9 / r.nsPerOp
+            << ", \"allocs_per_op\": " << r.allocsPerOp << ", \"peak_rss_kb\": " << r.peakRssKb
+            << " }" << ( i + 1 < results.size() ? "," : "" ) << "\n";
+    }
+
+    out << "  ]\n}\n";
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    vector<size_t> sizes;
+    string json;
+
+    for ( int i = 1; i + 1 < argc; i += 2 )
+    {
+        if ( strcmp(argv[i], "--sizes") == 0 )
+        {
+            stringstream list(argv[i + 1]);
+            string size;
+
+            while ( getline(list, size, ',') )
+            {
+                //! A whole positive number ("1k" or 0 would divide by zero in runCase)
+                char* end;
+                errno = 0;
+                unsigned long long n = strtoull(size.c_str(), &end, 10);
+
+                if ( size.empty() || !isdigit(size[0]) || *end != '\0' || errno != 0 || n == 0 )
+                {
+                    cerr << "suite: bad size '" << size << "' in --sizes" << endl;
+                    return 1;
+                }
+
+                sizes.push_back( size_t(n) );
+            }
+        }
+        else if ( strcmp(argv[i], "--json") == 0 )
+            json = argv[i + 1];
+    }
+
+    if ( sizes.empty() )
+    {
+        sizes.push_back(1000);
+        sizes.push_back(100000);
+        sizes.push_back(1000000);
+    }
+
+    vector<Result> results;
+    bool ok = true;
+
+    for ( size_t s = 0; s < sizes.size(); s++ )
+    {
+        for ( int stream = 0; stream < StreamCount; stream++ )
+        {
+            ok &= runCase<Tree>("rbtree", stream, sizes[s], results);
+            ok &= runCase< set<uint64_t> >("std::set", stream, sizes[s], results);
+            ok &= runCase< multiset<uint64_t> >("std::mset", stream, sizes[s], results);
+            ok &= runCase<Map>("rbmap", stream, sizes[s], results);
+            ok &= runCase< map<uint64_t, uint64_t> >("std::map", stream, sizes[s], results);
+        }
+    }
+
+    if ( !json.empty() )
+    {
+        writeJson(json, results);
+        cout << "results written to " << json << endl;
+    }
+
+    //! A failed case fails the run (make bench-suite stops)
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,1488 @@
+/*! \file */
+/*! \brief CacheLineRedBlackTree.cpp.
+ *
+ *  Implements the functions from CacheLineRedBlackTree class.
+*/
+
+#include "CacheLineRedBlackTree.h"
+
+template <class Comparable, class Compare>
+const uint32_t CacheLineRedBlackTree<Comparable, Compare>::NoNode;
+
+/*!
+ * Class constructor
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+CacheLineRedBlackTree<Comparable, Compare>::CacheLineRedBlackTree( void )
+	: m_compare(), m_freeList(NoNode), m_next(0), m_root(NoNode), m_nodes(0), m_size(0)
+{
+	/*! empty */
+}
+
+/*!
+ * Class constructor with an order object
+ *
+ * @param compare => the order of the values
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+CacheLineRedBlackTree<Comparable, Compare>::CacheLineRedBlackTree( const Compare& compare )
+	: m_compare(compare), m_freeList(NoNode), m_next(0), m_root(NoNode), m_nodes(0), m_size(0)
+{
+	/*! empty */
+}
+
+/*!
+ * Bulk constructor
+ * it throws an invalid_argument exception if the input isn't sorted (unless
+ * Unsorted is given) and a bad_alloc exception if no enough space
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ * @param flags => BuildFlags
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+template <class InputIterator>
+CacheLineRedBlackTree<Comparable, Compare>::CacheLineRedBlackTree( InputIterator first, InputIterator last, unsigned flags )
+	: m_compare(), m_freeList(NoNode), m_next(0), m_root(NoNode), m_nodes(0), m_size(0)
+{
+	assign(first, last, flags);
+}
+
+/*!
+ * Copy constructor
+ * the values are copied in order and the tree is built again, O(n)
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param old => the tree to be copied
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+CacheLineRedBlackTree<Comparable, Compare>::CacheLineRedBlackTree( const CacheLineRedBlackTree& old )
+	: m_compare(old.m_compare), m_freeList(NoNode), m_next(0), m_root(NoNode), m_nodes(0), m_size(0)
+{
+	vector<Comparable> values( old.begin(), old.end() );
+
+	rebuild(values);
+}
+
+/*!
+ * Move constructor
+ * takes the chunks of old, which is left empty
+ *
+ * @param old => the tree to be moved
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+CacheLineRedBlackTree<Comparable, Compare>::CacheLineRedBlackTree( CacheLineRedBlackTree&& old )
+	: m_compare(old.m_compare), m_freeList(NoNode), m_next(0), m_root(NoNode), m_nodes(0), m_size(0)
+{
+	swap(old);
+}
+
+/*!
+ * Assignment operator
+ * it throws a bad_alloc exception if no enough space (the tree is left unchanged)
+ *
+ * @param rhs => the tree to be copied
+ *
+ * @return => the tree itself
+*/
+template <class Comparable, class Compare>
+const CacheLineRedBlackTree<Comparable, Compare>& CacheLineRedBlackTree<Comparable, Compare>::operator = ( const CacheLineRedBlackTree& rhs )
+{
+	if ( this != &rhs )
+	{
+		CacheLineRedBlackTree copy(rhs);
+		swap(copy);
+	}
+
+	return *this;
+}
+
+/*!
+ * Move assignment operator
+ * the current values are removed, then the chunks of rhs are taken
+ *
+ * @param rhs => the tree to be moved
+ *
+ * @return => the tree itself
+*/
+template <class Comparable, class Compare>
+const CacheLineRedBlackTree<Comparable, Compare>& CacheLineRedBlackTree<Comparable, Compare>::operator = ( CacheLineRedBlackTree&& rhs )
+{
+	if ( this != &rhs )
+	{
+		clear();
+		swap(rhs);
+	}
+
+	return *this;
+}
+
+/*!
+ * Class destructor
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+CacheLineRedBlackTree<Comparable, Compare>::~CacheLineRedBlackTree()
+{
+	releaseNodes();
+}
+
+/*!
+ * Assign function
+ * replaces the content with the range [first, last) in O(n) for sorted input
+ * it throws an invalid_argument exception if the input isn't sorted (unless
+ * Unsorted is given) and a bad_alloc exception if no enough space
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ * @param flags => BuildFlags
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+template <class InputIterator>
+void CacheLineRedBlackTree<Comparable, Compare>::assign( InputIterator first, InputIterator last, unsigned flags )
+{
+	vector<Comparable> values(first, last);
+
+	//! Sort the input if asked, otherwise make sure it is sorted
+	if ( flags & Unsorted )
+		sort(values.begin(), values.end(), m_compare);
+	else
+	{
+		for ( size_t i = 1; i < values.size(); i++ )
+			if ( lessThan(values[i], values[i - 1]) )
+				throw invalid_argument("CacheLineRedBlackTree::assign: input not sorted");
+	}
+
+	//! Drop the repeated values
+	if ( flags & Unique )
+	{
+		size_t kept = 0;
+
+		for ( size_t i = 0; i < values.size(); i++ )
+			if ( kept == 0 || lessThan(values[kept - 1], values[i]) )
+				values[kept++] = values[i];
+
+		values.resize(kept);
+	}
+
+	rebuild(values);
+}
+
+/*!
+ * Clear function
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::clear( void )
+{
+	releaseNodes();
+}
+
+/*!
+ * Swap function
+ *
+ * @param other => the tree to exchange the contents with
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::swap( CacheLineRedBlackTree& other )
+{
+	std::swap(m_compare, other.m_compare);
+	m_chunks.swap(other.m_chunks);
+	std::swap(m_freeList, other.m_freeList);
+	std::swap(m_next, other.m_next);
+	std::swap(m_root, other.m_root);
+	std::swap(m_nodes, other.m_nodes);
+	std::swap(m_size, other.m_size);
+}
+
+/*!
+ * Insertion function
+ * goes down from the root, splitting every full node on the way (the root
+ * first, which adds a level), so the leaf reached has room for the value.
+ * Equal values go to the right of the ones already there.
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param v => the value
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::insert( Comparable&& v )
+{
+	OperationTimer timer(*this, TreeStats::Insert);
+
+	//! The first value makes a root leaf
+	if ( m_root == NoNode )
+	{
+		m_root = allocate(NoNode);
+		insertKey( node(m_root), 0, std::move(v) );
+		m_size++;
+
+		return;
+	}
+
+	//! A full root gets a new node on top and is split below it
+	if ( node(m_root)->count == 3 )
+	{
+		uint32_t top = allocate(NoNode);
+		node(top)->child[0] = m_root;
+
+		try
+		{
+			splitChild(top, 0);
+		}
+		catch ( ... )
+		{
+			node(top)->child[0] = NoNode;
+			deallocate(top);
+			throw;
+		}
+
+		node(m_root)->parent = top;
+		m_root = top;
+	}
+
+	uint32_t l = m_root;
+
+	while ( true )
+	{
+		countStep();
+
+		Node* nodePtr = node(l);
+		unsigned i = rankIn(nodePtr, v, true);
+
+		if ( nodePtr->leaf() )
+		{
+			insertKey( nodePtr, i, std::move(v) );
+			break;
+		}
+
+		//! The child gets room before the descent: its middle value comes up here
+		if ( node(nodePtr->child[i])->count == 3 )
+		{
+			splitChild(l, i);
+
+			if ( !lessThan(v, nodePtr->key(i)) )
+				i++;
+		}
+
+		l = nodePtr->child[i];
+	}
+
+	m_size++;
+}
+
+/*!
+ * Insert batch function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+template <class InputIterator>
+void CacheLineRedBlackTree<Comparable, Compare>::insert_batch( InputIterator first, InputIterator last )
+{
+	vector<Comparable> batch(first, last);
+
+	stable_sort(batch.begin(), batch.end(), m_compare);
+
+	//! A big batch is merged with the values and the tree is rebuilt
+	if ( batch.size() * RebuildRatio >= m_size && m_size > 0 )
+	{
+		vector<Comparable> values;
+		values.reserve( m_size + batch.size() );
+		std::merge( begin(), end(), batch.begin(), batch.end(), back_inserter(values), m_compare );
+
+		rebuild(values);
+		return;
+	}
+
+	for ( size_t i = 0; i < batch.size(); i++ )
+		insert( std::move(batch[i]) );
+}
+
+/*!
+ * Remove function
+ * goes down from the root making sure every node entered below it has at
+ * least 2 values (fixChild), so the leaf reached can lose one. A value
+ * found in an inner node is replaced by its predecessor (or successor),
+ * taken from a child with 2 values or more; when both children have one,
+ * the three are merged and the descent goes on in the merged node
+ *
+ * @param v => value to be removed
+ *
+ * @return => true if a value was removed
+*/
+template <class Comparable, class Compare>
+bool CacheLineRedBlackTree<Comparable, Compare>::remove( const Comparable& v )
+{
+	OperationTimer timer(*this, TreeStats::Remove);
+
+	uint32_t l = m_root;
+
+	while ( l != NoNode )
+	{
+		countStep();
+
+		Node* nodePtr = node(l);
+		unsigned i = rankIn(nodePtr, v, false);
+		bool found = i < nodePtr->count && !lessThan(v, nodePtr->key(i));
+
+		if ( nodePtr->leaf() )
+		{
+			if ( !found )
+				return false;
+
+			eraseKey(nodePtr, i);
+
+			//! Only the root can be left with no value
+			if ( nodePtr->count == 0 )
+			{
+				deallocate(l);
+				m_root = NoNode;
+			}
+
+			m_size--;
+			return true;
+		}
+
+		if ( !found )
+		{
+			l = fixChild(l, i);
+			continue;
+		}
+
+		//! An inner value: the predecessor or the successor takes its place
+		if ( node(nodePtr->child[i])->count > 1 )
+		{
+			nodePtr->key(i) = takeMax( nodePtr->child[i] );
+			m_size--;
+			return true;
+		}
+
+		if ( node(nodePtr->child[i + 1])->count > 1 )
+		{
+			nodePtr->key(i) = takeMin( nodePtr->child[i + 1] );
+			m_size--;
+			return true;
+		}
+
+		//! Both children have one value: the value goes down with them
+		uint32_t child = nodePtr->child[i];
+
+		merge(l, i);
+		l = child;
+	}
+
+	return false;
+}
+
+/*!
+ * Find function
+ * arithmetic keys go down to the leaf with no branch: the child is picked
+ * by the count of the values less than key, and the last value not less
+ * than key is kept (a conditional move), then that value is checked once.
+ * The others stop at the first equal value
+ *
+ * @param key => value to be searched
+ *
+ * @return => pointer to the value, NULL if not found
+*/
+template <class Comparable, class Compare>
+template <class Key>
+const Comparable* CacheLineRedBlackTree<Comparable, Compare>::find( const Key& key ) const
+{
+	OperationTimer timer(*this, TreeStats::Search);
+
+	uint32_t l = m_root;
+
+	if ( Branchless<Key>::value )
+	{
+		const Comparable* boundPtr = NULL;
+
+		while ( l != NoNode )
+		{
+			countStep();
+
+			const Node* nodePtr = node(l);
+			unsigned i = rankIn(nodePtr, key, false);
+
+			boundPtr = ( i < nodePtr->count ) ? nodePtr->keys() + i : boundPtr;
+			l = nodePtr->child[i];
+		}
+
+		return ( boundPtr != NULL && !( key < *boundPtr ) ) ? boundPtr : NULL;
+	}
+
+	while ( l != NoNode )
+	{
+		countStep();
+
+		const Node* nodePtr = node(l);
+		unsigned i = rankIn(nodePtr, key, false);
+
+		if ( i < nodePtr->count && !lessThan(key, nodePtr->key(i)) )
+			return &nodePtr->key(i);
+
+		l = nodePtr->child[i];
+	}
+
+	return NULL;
+}
+
+/*!
+ * Count function
+ * the equal values are contiguous in order: from lower_bound to upper_bound
+ *
+ * @param key => value to be counted
+ *
+ * @return => number of equal values
+*/
+template <class Comparable, class Compare>
+template <class Key>
+size_t CacheLineRedBlackTree<Comparable, Compare>::count( const Key& key ) const
+{
+	OperationTimer timer(*this, TreeStats::Search);
+
+	size_t total = 0;
+
+	for ( const_iterator it = lower_bound(key), last = upper_bound(key); it != last; ++it )
+		total++;
+
+	return total;
+}
+
+/*!
+ * Find many function
+ * a lookup takes one line per level, so they just run one after the other
+ *
+ * @param first => first key
+ * @param last 	=> past the last key
+ * @param out 	=> where the results go
+ *
+ * @return => out past the last result
+*/
+template <class Comparable, class Compare>
+template <class InputIterator, class OutputIterator>
+OutputIterator CacheLineRedBlackTree<Comparable, Compare>::find_many( InputIterator first, InputIterator last, OutputIterator out ) const
+{
+	for ( ; first != last; ++first )
+		*out++ = find(*first);
+
+	return out;
+}
+
+/*!
+ * Begin function
+ *
+ * @return => iterator to the smallest value (end() if empty)
+*/
+template <class Comparable, class Compare>
+typename CacheLineRedBlackTree<Comparable, Compare>::const_iterator CacheLineRedBlackTree<Comparable, Compare>::begin( void ) const
+{
+	uint32_t l = m_root;
+
+	if ( l == NoNode )
+		return end();
+
+	while ( !node(l)->leaf() )
+		l = node(l)->child[0];
+
+	return const_iterator(l, 0, this);
+}
+
+/*!
+ * Lower bound function
+ * the last value not less than key met on the way down
+ *
+ * @param key => value to be searched
+ *
+ * @return => iterator to the first value not less than key (end() if none)
+*/
+template <class Comparable, class Compare>
+template <class Key>
+typename CacheLineRedBlackTree<Comparable, Compare>::const_iterator CacheLineRedBlackTree<Comparable, Compare>::lower_bound( const Key& key ) const
+{
+	const_iterator bound = end();
+
+	for ( uint32_t l = m_root; l != NoNode; )
+	{
+		const Node* nodePtr = node(l);
+		unsigned i = rankIn(nodePtr, key, false);
+
+		if ( i < nodePtr->count )
+			bound = const_iterator(l, i, this);
+
+		l = nodePtr->child[i];
+	}
+
+	return bound;
+}
+
+/*!
+ * Upper bound function
+ * the last value greater than key met on the way down
+ *
+ * @param key => value to be searched
+ *
+ * @return => iterator to the first value greater than key (end() if none)
+*/
+template <class Comparable, class Compare>
+template <class Key>
+typename CacheLineRedBlackTree<Comparable, Compare>::const_iterator CacheLineRedBlackTree<Comparable, Compare>::upper_bound( const Key& key ) const
+{
+	const_iterator bound = end();
+
+	for ( uint32_t l = m_root; l != NoNode; )
+	{
+		const Node* nodePtr = node(l);
+		unsigned i = rankIn(nodePtr, key, true);
+
+		if ( i < nodePtr->count )
+			bound = const_iterator(l, i, this);
+
+		l = nodePtr->child[i];
+	}
+
+	return bound;
+}
+
+/*!
+ * Unite function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param other => the other tree
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::unite( const CacheLineRedBlackTree& other )
+{
+	vector<Comparable> values;
+	values.reserve( m_size + other.m_size );
+	set_union( begin(), end(), other.begin(), other.end(), back_inserter(values), m_compare );
+
+	rebuild(values);
+}
+
+/*!
+ * Intersect function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param other => the other tree
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::intersect( const CacheLineRedBlackTree& other )
+{
+	vector<Comparable> values;
+	values.reserve( min(m_size, other.m_size) );
+	set_intersection( begin(), end(), other.begin(), other.end(), back_inserter(values), m_compare );
+
+	rebuild(values);
+}
+
+/*!
+ * Subtract function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param other => the other tree
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::subtract( const CacheLineRedBlackTree& other )
+{
+	vector<Comparable> values;
+	values.reserve(m_size);
+	set_difference( begin(), end(), other.begin(), other.end(), back_inserter(values), m_compare );
+
+	rebuild(values);
+}
+
+/*!
+ * Split at function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param key 	=> the split value
+ * @param upper => receives the values not less than key
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+template <class Key>
+void CacheLineRedBlackTree<Comparable, Compare>::split_at( const Key& key, CacheLineRedBlackTree& upper )
+{
+	if ( &upper == this )
+		return;
+
+	const_iterator middle = lower_bound(key);
+	vector<Comparable> lowValues( begin(), middle ), highValues( middle, end() );
+
+	upper.rebuild(highValues);
+	rebuild(lowValues);
+}
+
+/*!
+ * Erase range function
+ * it throws a bad_alloc exception if no enough space (only when the rest is rebuilt)
+ *
+ * @param lo => smallest value to be removed
+ * @param hi => biggest value to be removed
+ *
+ * @return => number of values removed
+*/
+template <class Comparable, class Compare>
+template <class Key>
+size_t CacheLineRedBlackTree<Comparable, Compare>::erase_range( const Key& lo, const Key& hi )
+{
+	if ( lessThan(hi, lo) )
+		return 0;
+
+	const_iterator first = lower_bound(lo), last = upper_bound(hi);
+	size_t removed = distance(first, last);
+
+	//! A few values go one by one (each removal moves the values, so the first one is looked up again)
+	if ( removed * RebuildRatio < m_size )
+	{
+		for ( size_t i = 0; i < removed; i++ )
+		{
+			Comparable v = *lower_bound(lo);
+			remove(v);
+		}
+
+		return removed;
+	}
+
+	vector<Comparable> values( begin(), first );
+	values.insert( values.end(), last, end() );
+
+	rebuild(values);
+
+	return removed;
+}
+
+/*!
+ * Freeze function
+ * copies the values, in order, to a read only snapshot
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @return => the snapshot
+*/
+template <class Comparable, class Compare>
+FrozenRedBlackTree<Comparable> CacheLineRedBlackTree<Comparable, Compare>::freeze( void ) const
+{
+	//! The snapshot searches with '<'
+	static_assert(DefaultOrder, "freeze() needs the default order");
+
+	return FrozenRedBlackTree<Comparable>(begin(), end());
+}
+
+/*!
+ * Iterator increment
+ * an inner value is followed by the leftmost value of its right child; in
+ * a leaf, by the next value, or by the first ancestor value on the right
+ *
+ * @return => the iterator itself
+*/
+template <class Comparable, class Compare>
+typename CacheLineRedBlackTree<Comparable, Compare>::const_iterator& CacheLineRedBlackTree<Comparable, Compare>::const_iterator::operator ++ ( void )
+{
+	const Node* nodePtr = m_tree->node(m_node);
+
+	if ( !nodePtr->leaf() )
+	{
+		m_node = nodePtr->child[m_slot + 1];
+
+		while ( !m_tree->node(m_node)->leaf() )
+			m_node = m_tree->node(m_node)->child[0];
+
+		m_slot = 0;
+		return *this;
+	}
+
+	if ( ++m_slot < nodePtr->count )
+		return *this;
+
+	//! Climb while coming from the last child. Past the biggest value it stops at end()
+	while ( nodePtr->parent != NoNode )
+	{
+		const Node* parentPtr = m_tree->node(nodePtr->parent);
+		unsigned i = childIndex(parentPtr, m_node);
+
+		m_node = nodePtr->parent;
+		nodePtr = parentPtr;
+
+		if ( i < parentPtr->count )
+		{
+			m_slot = i;
+			return *this;
+		}
+	}
+
+	m_node = NoNode;
+	m_slot = 0;
+
+	return *this;
+}
+
+/*!
+ * Iterator decrement
+ * goes to the previous value; from end() it goes to the biggest value
+ *
+ * @return => the iterator itself
+*/
+template <class Comparable, class Compare>
+typename CacheLineRedBlackTree<Comparable, Compare>::const_iterator& CacheLineRedBlackTree<Comparable, Compare>::const_iterator::operator -- ( void )
+{
+	//! From end() (or an inner value) go to the rightmost value below
+	if ( m_node == NoNode || !m_tree->node(m_node)->leaf() )
+	{
+		m_node = ( m_node == NoNode ) ? m_tree->m_root : m_tree->node(m_node)->child[m_slot];
+
+		while ( !m_tree->node(m_node)->leaf() )
+			m_node = m_tree->node(m_node)->child[ m_tree->node(m_node)->count ];
+
+		m_slot = m_tree->node(m_node)->count - 1;
+		return *this;
+	}
+
+	if ( m_slot > 0 )
+	{
+		m_slot--;
+		return *this;
+	}
+
+	//! Climb while coming from the first child
+	const Node* nodePtr = m_tree->node(m_node);
+
+	while ( true )
+	{
+		const Node* parentPtr = m_tree->node(nodePtr->parent);
+		unsigned i = childIndex(parentPtr, m_node);
+
+		m_node = nodePtr->parent;
+		nodePtr = parentPtr;
+
+		if ( i > 0 )
+		{
+			m_slot = i - 1;
+			return *this;
+		}
+	}
+}
+
+/*!
+ * Stats function
+ * the shape is measured now, the counters are the ones kept since construction
+ *
+ * @return => the snapshot
+*/
+template <class Comparable, class Compare>
+TreeStats CacheLineRedBlackTree<Comparable, Compare>::stats( void ) const
+{
+	TreeStats snapshot;
+
+	snapshot.size = m_size;
+	snapshot.inlined = false;
+
+	//! Every leaf is at the same level
+	int levels = 0;
+
+	for ( uint32_t l = m_root; l != NoNode; l = node(l)->child[0] )
+		levels++;
+
+	snapshot.height = snapshot.blackHeight = levels;
+	snapshot.nodeBytes = m_nodes * sizeof(Node);
+	snapshot.reservedBytes = m_chunks.size() * ChunkSize * sizeof(Node);
+
+	fillStats(snapshot);
+
+	return snapshot;
+}
+
+/*!
+ * Print trigger function
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::print( void ) const
+{
+	if ( m_root != NoNode )
+		print(m_root, 0);
+}
+
+/*!
+ * Rank function
+ * arithmetic values are compared all three with no branch, the values past
+ * count masked (the free slots hold zeros or old values, never garbage);
+ * the others are scanned until the first one out of the range
+ *
+ * @param nodePtr 	=> the node
+ * @param key 		=> value to be searched
+ * @param upper 	=> count the values not greater than key (true) or less than key (false)
+ *
+ * @return => the number of values counted, the child to enter
+*/
+template <class Comparable, class Compare>
+template <class Key>
+unsigned CacheLineRedBlackTree<Comparable, Compare>::rankIn( const Node* nodePtr, const Key& key, bool upper ) const
+{
+	const Comparable* keys = nodePtr->keys();
+	unsigned count = nodePtr->count;
+
+	if ( Branchless<Key>::value )
+	{
+		countComparison();
+
+		if ( upper )
+			return unsigned( !( key < keys[0] ) ) + unsigned( !( key < keys[1] ) & ( count > 1 ) ) +
+			       unsigned( !( key < keys[2] ) & ( count > 2 ) );
+
+		return unsigned( keys[0] < key ) + unsigned( ( keys[1] < key ) & ( count > 1 ) ) +
+		       unsigned( ( keys[2] < key ) & ( count > 2 ) );
+	}
+
+	unsigned i = 0;
+
+	if ( upper )
+	{
+		while ( i < count && !lessThan(key, keys[i]) )
+			i++;
+	}
+	else
+	{
+		while ( i < count && lessThan(keys[i], key) )
+			i++;
+	}
+
+	return i;
+}
+
+/*!
+ * Allocation function
+ * takes a node from the free list or a fresh one (a new chunk if needed)
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param parent => the parent link of the new node
+ *
+ * @return => index of the node (no value, no child)
+*/
+template <class Comparable, class Compare>
+uint32_t CacheLineRedBlackTree<Comparable, Compare>::allocate( uint32_t parent )
+{
+	uint32_t l;
+
+	if ( m_freeList != NoNode )
+	{
+		l = m_freeList;
+		m_freeList = node(l)->child[0];
+	}
+	else
+	{
+		if ( m_next == m_chunks.size() * ChunkSize )
+			newChunk();
+
+		l = m_next++;
+	}
+
+	Node* nodePtr = node(l);
+
+	nodePtr->child[0] = nodePtr->child[1] = nodePtr->child[2] = nodePtr->child[3] = NoNode;
+	nodePtr->parent = parent;
+	nodePtr->count = 0;
+
+	m_nodes++;
+	countAllocations(1);
+
+	return l;
+}
+
+/*!
+ * Deallocation function
+ * puts the node (already empty) in the free list
+ *
+ * @param l => index of the node
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::deallocate( uint32_t l )
+{
+	Node* nodePtr = node(l);
+
+	assert(nodePtr->count == 0);
+
+	nodePtr->child[0] = m_freeList;
+	m_freeList = l;
+
+	m_nodes--;
+	countReleases(1);
+}
+
+/*!
+ * Chunk creation function
+ * the chunk is aligned to a cache line (new doesn't give more than 16 bytes
+ * before C++17) and zeroed, so the branchless search never reads garbage
+ * it throws a bad_alloc exception if no enough space (or no index left)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::newChunk( void )
+{
+	if ( m_chunks.size() >= NoNode / ChunkSize )
+		throw bad_alloc();
+
+	void* chunk = NULL;
+
+	if ( posix_memalign(&chunk, alignof(Node), ChunkSize * sizeof(Node)) != 0 )
+		throw bad_alloc();
+
+	memset(chunk, 0, ChunkSize * sizeof(Node));
+
+	try
+	{
+		m_chunks.push_back( static_cast<Node*>(chunk) );
+	}
+	catch ( ... )
+	{
+		free(chunk);
+		throw;
+	}
+}
+
+/*!
+ * Release function
+ * a node in use holds count values and a free one none, so the values are
+ * destroyed chunk by chunk, with no walk down the tree
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::releaseNodes( void )
+{
+	if ( !is_trivially_destructible<Comparable>::value )
+	{
+		for ( uint32_t l = 0; l < m_next; l++ )
+		{
+			Node* nodePtr = node(l);
+
+			for ( unsigned i = 0; i < nodePtr->count; i++ )
+				nodePtr->key(i).~Comparable();
+		}
+	}
+
+	for ( size_t c = 0; c < m_chunks.size(); c++ )
+		free( m_chunks[c] );
+
+	countReleases(m_nodes);
+
+	m_chunks.clear();
+	m_freeList = NoNode;
+	m_next = 0;
+	m_root = NoNode;
+	m_nodes = 0;
+	m_size = 0;
+}
+
+/*!
+ * Move key function
+ *
+ * @param to 		=> node that receives the value
+ * @param toSlot 	=> its slot (empty)
+ * @param from 		=> node that gives the value
+ * @param fromSlot 	=> its slot (left empty)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::moveKey( Node* to, unsigned toSlot, Node* from, unsigned fromSlot )
+{
+	new ( &to->m_keys[toSlot] ) Comparable( std::move( from->key(fromSlot) ) );
+	from->key(fromSlot).~Comparable();
+}
+
+/*!
+ * Insert key function
+ * shifts the values from slot one place to the right
+ *
+ * @param nodePtr 	=> the node (not full)
+ * @param slot 		=> where the value goes
+ * @param v 		=> the value
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::insertKey( Node* nodePtr, unsigned slot, Comparable&& v )
+{
+	for ( unsigned j = nodePtr->count; j > slot; j-- )
+		moveKey(nodePtr, j, nodePtr, j - 1);
+
+	new ( &nodePtr->m_keys[slot] ) Comparable( std::move(v) );
+	nodePtr->count++;
+}
+
+/*!
+ * Erase key function
+ * destroys the value and shifts the next ones one place to the left
+ *
+ * @param nodePtr 	=> the node
+ * @param slot 		=> the value
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::eraseKey( Node* nodePtr, unsigned slot )
+{
+	nodePtr->key(slot).~Comparable();
+
+	for ( unsigned j = slot; j + 1 < nodePtr->count; j++ )
+		moveKey(nodePtr, j, nodePtr, j + 1);
+
+	nodePtr->count--;
+}
+
+/*!
+ * Child index function
+ *
+ * @param parentPtr => the parent
+ * @param child 	=> one of its children
+ *
+ * @return => position of the child (0 to 3)
+*/
+template <class Comparable, class Compare>
+unsigned CacheLineRedBlackTree<Comparable, Compare>::childIndex( const Node* parentPtr, uint32_t child )
+{
+	unsigned i = 0;
+
+	while ( parentPtr->child[i] != child )
+		i++;
+
+	return i;
+}
+
+/*!
+ * Split child function
+ * the full child keeps its first value, a new node takes the last one
+ * (with the two last children) and the middle value goes up to parent
+ * it throws a bad_alloc exception if no enough space (nothing changed)
+ *
+ * @param parent 	=> the parent (not full)
+ * @param i 		=> the full child
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::splitChild( uint32_t parent, unsigned i )
+{
+	uint32_t right = allocate(parent);
+
+	Node* parentPtr = node(parent);
+	Node* childPtr = node( parentPtr->child[i] );
+	Node* rightPtr = node(right);
+
+	countSplit();
+
+	moveKey(rightPtr, 0, childPtr, 2);
+	rightPtr->count = 1;
+
+	rightPtr->child[0] = childPtr->child[2];
+	rightPtr->child[1] = childPtr->child[3];
+	adopt(rightPtr->child[0], right);
+	adopt(rightPtr->child[1], right);
+	childPtr->child[2] = childPtr->child[3] = NoNode;
+
+	//! The middle value and the new node go in the parent after the child
+	for ( unsigned j = parentPtr->count; j > i; j-- )
+	{
+		moveKey(parentPtr, j, parentPtr, j - 1);
+		parentPtr->child[j + 1] = parentPtr->child[j];
+	}
+
+	moveKey(parentPtr, i, childPtr, 1);
+	parentPtr->child[i + 1] = right;
+	parentPtr->count++;
+	childPtr->count = 1;
+}
+
+/*!
+ * Fix child function
+ * a child with one value borrows one from a sibling with more (through the
+ * parent), or is merged with a sibling and the parent value between them
+ *
+ * @param parent 	=> the parent (2 values or more, or the root)
+ * @param i 		=> the child about to be entered
+ *
+ * @return => the child to enter
+*/
+template <class Comparable, class Compare>
+uint32_t CacheLineRedBlackTree<Comparable, Compare>::fixChild( uint32_t parent, unsigned i )
+{
+	Node* parentPtr = node(parent);
+	uint32_t child = parentPtr->child[i];
+
+	if ( node(child)->count > 1 )
+		return child;
+
+	if ( i > 0 && node( parentPtr->child[i - 1] )->count > 1 )
+	{
+		rotateRight(parentPtr, i - 1);
+		return child;
+	}
+
+	if ( i < parentPtr->count && node( parentPtr->child[i + 1] )->count > 1 )
+	{
+		rotateLeft(parentPtr, i);
+		return child;
+	}
+
+	//! Both siblings have one value: merge with one of them
+	if ( i < parentPtr->count )
+	{
+		merge(parent, i);
+		return child;
+	}
+
+	child = parentPtr->child[i - 1];
+	merge(parent, i - 1);
+
+	return child;
+}
+
+/*!
+ * Right rotation function
+ * the last value of child i goes up to parent, the parent value i goes
+ * down to the front of child i + 1, with the last child of child i
+ *
+ * @param parentPtr => the parent
+ * @param i 		=> the left child (2 values or more)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::rotateRight( Node* parentPtr, unsigned i )
+{
+	Node* leftPtr = node( parentPtr->child[i] );
+	Node* rightPtr = node( parentPtr->child[i + 1] );
+
+	countRightRotation();
+
+	for ( unsigned j = rightPtr->count; j > 0; j-- )
+		moveKey(rightPtr, j, rightPtr, j - 1);
+
+	for ( unsigned j = rightPtr->count + 1; j > 0; j-- )
+		rightPtr->child[j] = rightPtr->child[j - 1];
+
+	moveKey(rightPtr, 0, parentPtr, i);
+	moveKey(parentPtr, i, leftPtr, leftPtr->count - 1);
+
+	rightPtr->child[0] = leftPtr->child[ leftPtr->count ];
+	adopt( rightPtr->child[0], parentPtr->child[i + 1] );
+	leftPtr->child[ leftPtr->count ] = NoNode;
+
+	leftPtr->count--;
+	rightPtr->count++;
+}
+
+/*!
+ * Left rotation function
+ * the first value of child i + 1 goes up to parent, the parent value i goes
+ * down to the end of child i, with the first child of child i + 1
+ *
+ * @param parentPtr => the parent
+ * @param i 		=> the left child (the right one has 2 values or more)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::rotateLeft( Node* parentPtr, unsigned i )
+{
+	Node* leftPtr = node( parentPtr->child[i] );
+	Node* rightPtr = node( parentPtr->child[i + 1] );
+
+	countLeftRotation();
+
+	moveKey(leftPtr, leftPtr->count, parentPtr, i);
+	leftPtr->child[ leftPtr->count + 1 ] = rightPtr->child[0];
+	adopt( rightPtr->child[0], parentPtr->child[i] );
+	leftPtr->count++;
+
+	moveKey(parentPtr, i, rightPtr, 0);
+
+	for ( unsigned j = 0; j + 1 < rightPtr->count; j++ )
+		moveKey(rightPtr, j, rightPtr, j + 1);
+
+	for ( unsigned j = 0; j < rightPtr->count; j++ )
+		rightPtr->child[j] = rightPtr->child[j + 1];
+
+	rightPtr->child[ rightPtr->count ] = NoNode;
+	rightPtr->count--;
+}
+
+/*!
+ * Merge function
+ * child i (one value) takes the parent value i and the value and children
+ * of child i + 1 (one value), which is freed. The root left with no value
+ * is freed too, and the merged child becomes the root
+ *
+ * @param parent 	=> the parent
+ * @param i 		=> the left child
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::merge( uint32_t parent, unsigned i )
+{
+	Node* parentPtr = node(parent);
+	uint32_t left = parentPtr->child[i];
+	uint32_t right = parentPtr->child[i + 1];
+	Node* leftPtr = node(left);
+	Node* rightPtr = node(right);
+
+	assert(leftPtr->count == 1 && rightPtr->count == 1);
+
+	moveKey(leftPtr, 1, parentPtr, i);
+	moveKey(leftPtr, 2, rightPtr, 0);
+	leftPtr->child[2] = rightPtr->child[0];
+	leftPtr->child[3] = rightPtr->child[1];
+	adopt(leftPtr->child[2], left);
+	adopt(leftPtr->child[3], left);
+	leftPtr->count = 3;
+
+	rightPtr->count = 0;
+	deallocate(right);
+
+	//! The parent loses the value and the right child
+	for ( unsigned j = i; j + 1 < parentPtr->count; j++ )
+	{
+		moveKey(parentPtr, j, parentPtr, j + 1);
+		parentPtr->child[j + 1] = parentPtr->child[j + 2];
+	}
+
+	parentPtr->child[ parentPtr->count ] = NoNode;
+	parentPtr->count--;
+
+	if ( parentPtr->count == 0 )
+	{
+		parentPtr->child[0] = NoNode;
+		deallocate(parent);
+
+		leftPtr->parent = NoNode;
+		m_root = left;
+	}
+}
+
+/*!
+ * Take max function
+ * goes down the last children (each one given 2 values first) to the leaf
+ *
+ * @param l => the sub tree (its root has 2 values or more)
+ *
+ * @return => the biggest value, removed
+*/
+template <class Comparable, class Compare>
+Comparable CacheLineRedBlackTree<Comparable, Compare>::takeMax( uint32_t l )
+{
+	while ( !node(l)->leaf() )
+	{
+		countStep();
+		l = fixChild( l, node(l)->count );
+	}
+
+	Node* nodePtr = node(l);
+	Comparable v( std::move( nodePtr->key( nodePtr->count - 1 ) ) );
+
+	eraseKey( nodePtr, nodePtr->count - 1 );
+
+	return v;
+}
+
+/*!
+ * Take min function
+ * goes down the first children (each one given 2 values first) to the leaf
+ *
+ * @param l => the sub tree (its root has 2 values or more)
+ *
+ * @return => the smallest value, removed
+*/
+template <class Comparable, class Compare>
+Comparable CacheLineRedBlackTree<Comparable, Compare>::takeMin( uint32_t l )
+{
+	while ( !node(l)->leaf() )
+	{
+		countStep();
+		l = fixChild(l, 0);
+	}
+
+	Node* nodePtr = node(l);
+	Comparable v( std::move( nodePtr->key(0) ) );
+
+	eraseKey(nodePtr, 0);
+
+	return v;
+}
+
+/*!
+ * Rebuild function
+ * builds the new tree apart (fresh chunks, nodes in order) and takes it,
+ * so a bad_alloc leaves the tree unchanged
+ *
+ * @param values => sorted values (moved into the nodes)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::rebuild( vector<Comparable>& values )
+{
+	CacheLineRedBlackTree built(m_compare);
+
+	if ( !values.empty() )
+	{
+		//! The fewest levels that hold them
+		int height = 0;
+
+		while ( maxValues(height) < values.size() )
+			height++;
+
+		built.m_root = built.build(values, 0, values.size(), height, NoNode);
+		built.m_size = values.size();
+	}
+
+	swap(built);
+}
+
+/*!
+ * Build function
+ * a leaf takes the values as they are; an inner node takes as many children
+ * (4 down to 2) as still get enough values each for their height, and the
+ * values are split evenly among them
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param values 	=> sorted values
+ * @param first 	=> first value of the sub tree
+ * @param n 		=> number of values (between minValues and maxValues of height)
+ * @param height 	=> levels below the sub tree root
+ * @param parent 	=> the parent link of the sub tree root
+ *
+ * @return => the sub tree root
+*/
+template <class Comparable, class Compare>
+uint32_t CacheLineRedBlackTree<Comparable, Compare>::build( vector<Comparable>& values, size_t first, size_t n, int height, uint32_t parent )
+{
+	uint32_t l = allocate(parent);
+
+	if ( height == 0 )
+	{
+		for ( size_t j = 0; j < n; j++ )
+			insertKey( node(l), unsigned(j), std::move( values[first + j] ) );
+
+		return l;
+	}
+
+	unsigned children = 4;
+
+	while ( children > 2 && ( n - ( children - 1 ) ) / children < minValues(height - 1) )
+		children--;
+
+	size_t rest = n - ( children - 1 );
+	size_t each = rest / children, extra = rest % children;
+
+	for ( unsigned j = 0; j < children; j++ )
+	{
+		size_t part = each + ( j < extra );
+		uint32_t child = build(values, first, part, height - 1, l);
+
+		node(l)->child[j] = child;
+		first += part;
+
+		if ( j + 1 < children )
+			insertKey( node(l), j, std::move( values[first++] ) );
+	}
+
+	return l;
+}
+
+/*!
+ * Min values function
+ *
+ * @param height => levels below the sub tree root
+ *
+ * @return => values of a sub tree of 2-nodes only, 2^(height + 1) - 1
+*/
+template <class Comparable, class Compare>
+size_t CacheLineRedBlackTree<Comparable, Compare>::minValues( int height )
+{
+	return ( height + 1 >= int(sizeof(size_t) * 8) ) ? size_t(-1) : ( size_t(1) << ( height + 1 ) ) - 1;
+}
+
+/*!
+ * Max values function
+ *
+ * @param height => levels below the sub tree root
+ *
+ * @return => values of a sub tree of 4-nodes only, 4^(height + 1) - 1
+*/
+template <class Comparable, class Compare>
+size_t CacheLineRedBlackTree<Comparable, Compare>::maxValues( int height )
+{
+	return ( 2 * ( height + 1 ) >= int(sizeof(size_t) * 8) ) ? size_t(-1) : ( size_t(1) << ( 2 * ( height + 1 ) ) ) - 1;
+}
+
+/*!
+ * Print function
+ * prints the tree from the node l, the last child first (as RedBlackTree)
+ *
+ * @param l 	=> the node
+ * @param level	=> the tree's depth
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare>
+void CacheLineRedBlackTree<Comparable, Compare>::print( uint32_t l, int level ) const
+{
+	const Node* nodePtr = node(l);
+
+	if ( !nodePtr->leaf() )
+		print( nodePtr->child[ nodePtr->count ], level + 1 );
+
+	//! Print blank spaces accordingly to the depth
+	for ( int i = 0; i < level; i++ )
+	{
+		cout << "    ";
+	}
+
+	cout << "[";
+
+	for ( unsigned i = 0; i < nodePtr->count; i++ )
+		cout << ( i > 0 ? "|" : "" ) << nodePtr->key(i);
+
+	cout << "]" << endl;
+
+	if ( nodePtr->leaf() )
+		return;
+
+	for ( unsigned i = nodePtr->count; i > 0; i-- )
+		print( nodePtr->child[i - 1], level + 1 );
+}
@@ -0,0 +1,425 @@
+/*!
+    <PRE>
+        SOURCE FILE : CacheLineRedBlackTree.h
+        DESCRIPTION.: Red black tree stored as its 2-3-4 tree, one cache line per node.
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Cache line nodes, branchless in-node search, top-down insert and remove implemented.
+
+        TO COMPILE..: Use makefile.
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef CacheLineRedBlackTree_H_
+#define CacheLineRedBlackTree_H_
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <cassert>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "FrozenRedBlackTree.h"
+#include "TreeStats.h"
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// CacheLineRedBlackTree( void )                                --> Class constructor
+// CacheLineRedBlackTree( const Compare& compare )              --> Class constructor, custom order
+// CacheLineRedBlackTree( InputIterator first, InputIterator last, flags ) --> Bulk constructor, O(n)
+// CacheLineRedBlackTree( const CacheLineRedBlackTree& )        --> Copy constructor, O(n)
+// CacheLineRedBlackTree( CacheLineRedBlackTree&& )             --> Move constructor, O(1)
+// const CacheLineRedBlackTree& operator                        --> Assignment operator (copy and move)
+// ~CacheLineRedBlackTree()                                     --> Class destructor
+// void assign( InputIterator first, InputIterator last, flags ) --> Bulk replace, O(n) on sorted input
+// void clear( void )                                           --> Remove every value
+// size_t size( void ) const / bool empty( void ) const         --> Number of values
+// void swap( CacheLineRedBlackTree& other )                    --> Exchanges the contents, O(1)
+// insert( const Comparable& v ) / insert( Comparable&& v )     --> Insertion function
+// void emplace( Args&&... args )                               --> Insertion, value built from args
+// insert_batch( InputIterator first, InputIterator last )      --> Batch insertion
+// bool remove( const Comparable& v )                           --> Remove function
+// bool contains( const Key& key ) const                        --> Search function
+// const Comparable* find( const Key& key ) const               --> Search function (NULL if not found)
+// size_t count( const Key& key ) const                         --> Number of equal values
+// find_many( first, last, out )                                --> find() for every key of a range
+// begin( ) / end( ) / rbegin( ) / rend( )                      --> In-order iterators
+// lower_bound( key ) / upper_bound( key ) / equal_range( key ) --> Range scans
+// void unite / intersect / subtract( other )                   --> Set algebra, O(n + m)
+// void split_at( const Key& key, CacheLineRedBlackTree& upper ) --> Moves the values not less than key
+// size_t erase_range( const Key& lo, const Key& hi )           --> Removes the values in [lo, hi]
+// FrozenRedBlackTree<Comparable> freeze( void ) const          --> Read only, array based snapshot
+// void save( const string& path ) const                        --> Writes a binary image of the tree
+// TreeStats stats( void ) const                                --> Shape, memory, counters and latencies
+// void print( void ) const                                     --> Print function
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed.
+// std::invalid_argument thrown by assign() if the input isn't sorted and Unsorted wasn't given.
+// std::runtime_error thrown by save() (see FrozenRedBlackTree.h).
+
+/*! Red black tree kept as the 2-3-4 tree it stands for.
+ *  RedBlackTree's top-down insert already works on the 2-3-4 tree (split() breaks its 4-nodes),
+ *  but a 2-3-4 node is a black node and up to two red children, each one allocated apart, so
+ *  a search may take a cache miss per red link. Here a 2-3-4 node is one 64 byte block aligned
+ *  to a cache line: up to 3 values, 4 child links and the parent link, the links being 32 bit
+ *  indices into the chunks of the tree (so values up to 8 bytes still fit in one line; bigger
+ *  values make the node span more lines). A lookup touches one line per level, about half the
+ *  lines of the red black descent. Inside a node the child is picked by counting the values
+ *  less than the key, with no branch for arithmetic values and the default order.
+ *
+ *  Same API as RedBlackTree, but for the order statistics (the line has no room for the sub
+ *  tree sizes), open_mmap() and the thread pool arguments. The set algebra, split_at() and a
+ *  big erase_range() merge the values and rebuild the tree in O(n + m).
+ *  Equal values are kept (multiset); insertions and removals invalidate the iterators and the
+ *  pointers from find(), as the values move inside and between the nodes.
+*/
+template <class Comparable, class Compare = less<Comparable> >
+class CacheLineRedBlackTree : private TreeCounters<TreeStatsEnabled>
+{
+    /*!
+     * Private types (used by the public section)
+    */
+    private:
+
+        /*! A 2-3-4 node in one cache line. A leaf has no children (NoNode links); a free node
+         *  has no value and links the free list with child[0]
+        */
+        struct alignas(64) Node
+        {
+            typename aligned_storage< sizeof(Comparable), alignof(Comparable) >::type m_keys[3];
+
+            uint32_t    child[4];   //!< children, child[i] holds the values between key(i - 1) and key(i)
+            uint32_t    parent;     //!< NoNode for the root
+            uint8_t     count;      //!< number of values (1 to 3 in the tree)
+
+            Comparable& key( unsigned i ) { return *reinterpret_cast<Comparable*>( &m_keys[i] ); }
+            const Comparable& key( unsigned i ) const { return *reinterpret_cast<const Comparable*>( &m_keys[i] ); }
+            const Comparable* keys( void ) const { return reinterpret_cast<const Comparable*>( m_keys ); }
+            bool leaf( void ) const { return child[0] == NoNode; }
+        };
+
+        /*! No node (the links of the leaves, end() and the empty tree) */
+        static const uint32_t NoNode = ~uint32_t(0);
+
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! Bidirectional in-order iterator: a node and a value in it. It climbs the parent links,
+         *  so a step is O(1) amortized and never allocates. The values are read only
+        */
+        class const_iterator
+        {
+            public:
+
+                typedef bidirectional_iterator_tag  iterator_category;
+                typedef Comparable                  value_type;
+                typedef ptrdiff_t                   difference_type;
+                typedef const Comparable*           pointer;
+                typedef const Comparable&           reference;
+
+                const_iterator( void ) : m_node(NoNode), m_slot(0), m_tree(NULL) { /*! empty */ }
+
+                reference operator * ( void ) const { return m_tree->node(m_node)->key(m_slot); }
+                pointer operator -> ( void ) const { return &**this; }
+
+                const_iterator& operator ++ ( void );
+                const_iterator& operator -- ( void );
+                const_iterator operator ++ ( int ) { const_iterator old = *this; ++*this; return old; }
+                const_iterator operator -- ( int ) { const_iterator old = *this; --*this; return old; }
+
+                bool operator == ( const const_iterator& rhs ) const { return m_node == rhs.m_node && m_slot == rhs.m_slot; }
+                bool operator != ( const const_iterator& rhs ) const { return !( *this == rhs ); }
+
+            private:
+
+                const_iterator( uint32_t node, unsigned slot, const CacheLineRedBlackTree* tree )
+                    : m_node(node), m_slot(slot), m_tree(tree) { /*! empty */ }
+
+                uint32_t                        m_node;     //!< current node (NoNode for end())
+                unsigned                        m_slot;     //!< current value in the node
+                const CacheLineRedBlackTree*    m_tree;     //!< the tree (it resolves the links)
+
+                friend class CacheLineRedBlackTree;
+        };
+
+        /*! The values can't be changed through an iterator (it would break the order) */
+        typedef const_iterator                          iterator;
+        typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+        typedef const_reverse_iterator                  reverse_iterator;
+
+        /*! Bulk build options (combine with '|'), as RedBlackTree's */
+        enum BuildFlags
+        {
+            Sorted = 0,     //!< input already sorted (checked)
+            Unsorted = 1,   //!< sort the input first
+            Unique = 2      //!< drop the repeated values
+        };
+
+        /*! Class constructor to create an empty tree */
+        CacheLineRedBlackTree( void );
+
+        /*! Class constructor with an order object */
+        explicit CacheLineRedBlackTree( const Compare& compare );
+
+        /*! Bulk constructor: builds the tree from a range in O(n) (see assign) */
+        template <class InputIterator>
+        CacheLineRedBlackTree( InputIterator first, InputIterator last, unsigned flags = Sorted );
+
+        /*! Copy constructor: the values are copied in order and the tree is rebuilt, O(n) */
+        CacheLineRedBlackTree( const CacheLineRedBlackTree& old );
+
+        /*! Move constructor: takes the chunks of old in O(1), old is left empty */
+        CacheLineRedBlackTree( CacheLineRedBlackTree&& old );
+
+        /*! Assignment operators (the move one removes the current values, then takes rhs's) */
+        const CacheLineRedBlackTree& operator = ( const CacheLineRedBlackTree& rhs );
+        const CacheLineRedBlackTree& operator = ( CacheLineRedBlackTree&& rhs );
+
+        /*! Class destructor to release memory */
+        ~CacheLineRedBlackTree();
+
+        /*! Replaces the content with the range [first, last).
+         *  Sorted input is built bottom-up in O(n), with the nodes as full as the shape allows.
+         *  Unsorted sorts it first, Unique keeps one copy of each value
+        */
+        template <class InputIterator>
+        void assign( InputIterator first, InputIterator last, unsigned flags = Sorted );
+
+        /*! Removes every value and gives the chunks back */
+        void clear( void );
+
+        /*! Number of values */
+        size_t size( void ) const { return m_size; }
+
+        /*! Check if there is no value */
+        bool empty( void ) const { return m_size == 0; }
+
+        /*! Exchanges the values (and the chunks) of both trees in O(1) */
+        void swap( CacheLineRedBlackTree& other );
+
+        /*! Insertion function: one top-down pass that splits the full nodes met on the way down.
+         *  Could throws a bad_alloc exception if no enough space (the tree is left valid)
+        */
+        void insert( const Comparable& v ) { insert( Comparable(v) ); }
+        void insert( Comparable&& v );
+
+        /*! Inserts a value built from args */
+        template <class... Args>
+        void emplace( Args&&... args ) { insert( Comparable( std::forward<Args>(args)... ) ); }
+
+        /*! Inserts a range of values. The batch is sorted, so consecutive insertions share the top
+         *  of their paths; a batch bigger than size() / RebuildRatio is merged and rebuilt in O(n + m)
+        */
+        template <class InputIterator>
+        void insert_batch( InputIterator first, InputIterator last );
+
+        /*! Remove function: one top-down pass that fills the 2-nodes met on the way down (a value
+         *  borrowed from a sibling, or a merge). Returns false if the value isn't there
+        */
+        bool remove( const Comparable& v );
+
+        /*! Search functions. They don't allocate and accept any Key comparable with Comparable
+         *  through the order
+        */
+        template <class Key>
+        bool contains( const Key& key ) const { return find(key) != NULL; }
+
+        template <class Key>
+        const Comparable* find( const Key& key ) const;
+
+        template <class Key>
+        size_t count( const Key& key ) const;
+
+        /*! find() for every key of [first, last), written to out (a const Comparable* per key,
+         *  NULL if not found)
+        */
+        template <class InputIterator, class OutputIterator>
+        OutputIterator find_many( InputIterator first, InputIterator last, OutputIterator out ) const;
+
+        /*! In-order iterators */
+        const_iterator begin( void ) const;
+        const_iterator end( void ) const { return const_iterator(NoNode, 0, this); }
+        const_reverse_iterator rbegin( void ) const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend( void ) const { return const_reverse_iterator(begin()); }
+
+        /*! Range scans: first value not less than key, first value greater than key, and both.
+         *  O(log n) to find the start, then O(1) amortized per step
+        */
+        template <class Key>
+        const_iterator lower_bound( const Key& key ) const;
+
+        template <class Key>
+        const_iterator upper_bound( const Key& key ) const;
+
+        template <class Key>
+        pair<const_iterator, const_iterator> equal_range( const Key& key ) const
+        {
+            return make_pair( lower_bound(key), upper_bound(key) );
+        }
+
+        /*! Set algebra with other, in place, in O(n + m) (a merge, then a rebuild).
+         *  A value c1 times here and c2 times in other is kept max(c1, c2), min(c1, c2) and
+         *  c1 - min(c1, c2) times (as std::set_union and friends). A bad_alloc leaves the tree unchanged
+        */
+        void unite( const CacheLineRedBlackTree& other );
+        void intersect( const CacheLineRedBlackTree& other );
+        void subtract( const CacheLineRedBlackTree& other );
+
+        /*! Moves the values not less than key to upper (its content is replaced), O(n) */
+        template <class Key>
+        void split_at( const Key& key, CacheLineRedBlackTree& upper );
+
+        /*! Removes the values in [lo, hi]: one by one when they are few, otherwise the rest is
+         *  rebuilt in O(n). Returns how many were removed
+        */
+        template <class Key>
+        size_t erase_range( const Key& lo, const Key& hi );
+
+        /*! Immutable snapshot in one contiguous array (Eytzinger layout), O(n).
+         *  Only for the default order
+        */
+        FrozenRedBlackTree<Comparable> freeze( void ) const;
+
+        /*! Writes the tree to path as a binary image (see RedBlackTree::save) */
+        void save( const string& path ) const { freeze().save(path); }
+
+        /*! Snapshot of the tree, O(n): size, levels of 2-3-4 nodes (the height and, as each node
+         *  is one black node of the red black tree, the black height) and node memory. With
+         *  RBTREE_STATS also the comparisons, splits, values borrowed from a left (right
+         *  rotation) or right sibling (left rotation), nodes built and freed, and the depth
+         *  and latency histogram of every insert, remove and search
+        */
+        TreeStats stats( void ) const;
+
+        /*! Print function: one node per line, its values between brackets */
+        void print( void ) const;
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! Compare is the default order (the plain '<') */
+        static const bool DefaultOrder = is_same< Compare, less<Comparable> >::value;
+
+        /*! The in-node searches of Key lookups go branchless (all 3 values compared, the extra ones masked) */
+        template <class Key>
+        struct Branchless
+        {
+            static const bool value = DefaultOrder && is_arithmetic<Comparable>::value && is_arithmetic<Key>::value;
+        };
+
+        /*! Chunks of 2^ChunkBits nodes (64 KB for the one line nodes) */
+        static const unsigned ChunkBits = 10;
+        static const uint32_t ChunkSize = uint32_t(1) << ChunkBits;
+
+        /*! insert_batch() rebuilds the tree when the batch has at least size() / RebuildRatio values */
+        static const size_t RebuildRatio = 4;
+
+        /*! Index to node */
+        Node* node( uint32_t l ) const { return m_chunks[l >> ChunkBits] + ( l & ( ChunkSize - 1 ) ); }
+
+        /*! Order of the values */
+        template <class A, class B>
+        bool lessThan( const A& a, const B& b ) const { countComparison(); return lessThan( a, b, integral_constant<bool, DefaultOrder>() ); }
+
+        template <class A, class B>
+        bool lessThan( const A& a, const B& b, true_type ) const { return a < b; }
+
+        template <class A, class B>
+        bool lessThan( const A& a, const B& b, false_type ) const { return m_compare(a, b); }
+
+        /*! Values of the node less than key (lower) or not greater than key (upper): the child to enter */
+        template <class Key>
+        unsigned rankIn( const Node* nodePtr, const Key& key, bool upper ) const;
+
+        /*! Node storage: a new node (no value, no child) and a node given back (no value left).
+         *  allocate() could throws a bad_alloc exception
+        */
+        uint32_t allocate( uint32_t parent );
+        void deallocate( uint32_t l );
+        void newChunk( void );
+
+        /*! Destroys every value and frees the chunks */
+        void releaseNodes( void );
+
+        /*! Value moves inside and between nodes (the source slot is left empty) */
+        void moveKey( Node* to, unsigned toSlot, Node* from, unsigned fromSlot );
+        void insertKey( Node* nodePtr, unsigned slot, Comparable&& v );
+        void eraseKey( Node* nodePtr, unsigned slot );
+
+        /*! Sets the parent link of a child (nothing for a leaf's NoNode) */
+        void adopt( uint32_t child, uint32_t parent ) { if ( child != NoNode ) node(child)->parent = parent; }
+
+        /*! Position of the child among the parent's children */
+        static unsigned childIndex( const Node* parentPtr, uint32_t child );
+
+        /*! Breaks the full child i of parent in two, its middle value goes up to parent */
+        void splitChild( uint32_t parent, unsigned i );
+
+        /*! Gives child i of parent at least 2 values before a removal enters it.
+         *  Returns the child to enter (a merge with the left sibling moves it)
+        */
+        uint32_t fixChild( uint32_t parent, unsigned i );
+
+        /*! A value through the parent: from child i to child i + 1 (right) or back (left) */
+        void rotateRight( Node* parentPtr, unsigned i );
+        void rotateLeft( Node* parentPtr, unsigned i );
+
+        /*! Merges child i, value i and child i + 1 of parent into child i (a root left with no
+         *  value is dropped, the merged child takes its place)
+        */
+        void merge( uint32_t parent, unsigned i );
+
+        /*! Removes the biggest (smallest) value under l and returns it */
+        Comparable takeMax( uint32_t l );
+        Comparable takeMin( uint32_t l );
+
+        /*! Replaces the content with the sorted values (they are moved), O(n) */
+        void rebuild( vector<Comparable>& values );
+
+        /*! Builds a sub tree of the given height from values [first, first + n) */
+        uint32_t build( vector<Comparable>& values, size_t first, size_t n, int height, uint32_t parent );
+
+        /*! Fewest and most values of a sub tree with height levels below its root (saturated) */
+        static size_t minValues( int height );
+        static size_t maxValues( int height );
+
+        /*! Print function, from the node l at level */
+        void print( uint32_t l, int level ) const;
+
+        /*! Basic members */
+        Compare         m_compare;  //!< order of the values
+        vector<Node*>   m_chunks;   //!< node chunks, cache line aligned
+        uint32_t        m_freeList; //!< nodes given back (NoNode if none)
+        uint32_t        m_next;     //!< next fresh index
+        uint32_t        m_root;     //!< root node (NoNode if empty)
+        size_t          m_nodes;    //!< nodes in the tree
+        size_t          m_size;     //!< number of values
+
+        /*! Checks the invariants in the tests (see test/TestUtil.h) */
+        friend struct TreeValidator;
+};
+
+#include "CacheLineRedBlackTree.cpp"
+#endif // CacheLineRedBlackTree_H
+
+/* ------------------- [ End of the CacheLineRedBlackTree.h header ] ------------------ */
+/* ==================================================================================== */
@@ -0,0 +1,337 @@
+/*! \file */
+/*! \brief ConcurrentRedBlackTree.cpp.
+ *
+ *  Implements the functions from ConcurrentRedBlackTree class.
+*/
+
+#include "ConcurrentRedBlackTree.h"
+
+/*!
+ * Class constructor
+ * the reader slots get a block aligned to the cache line
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @return => void
+*/
+template <class Comparable>
+ConcurrentRedBlackTree<Comparable>::ConcurrentRedBlackTree( void )
+	: m_root(NULL), m_epoch(1), m_size(0), m_retiredCount(0), m_slots(NULL) //!< initialize the basic members
+{
+	void* block = NULL;
+
+	if ( posix_memalign(&block, alignof(ReaderSlot), MaxReaders * sizeof(ReaderSlot)) != 0 )
+		throw bad_alloc();
+
+	m_slots = static_cast<ReaderSlot*>(block);
+
+	for ( size_t i = 0; i < MaxReaders; i++ )
+	{
+		new (&m_slots[i]) ReaderSlot();
+		m_slots[i].epoch.store(0, memory_order_relaxed);
+	}
+}
+
+/*!
+ * Class destructor
+ * frees the current version and every retired node
+ *
+ * @return => void
+*/
+template <class Comparable>
+ConcurrentRedBlackTree<Comparable>::~ConcurrentRedBlackTree()
+{
+	m_engine.releaseAll( m_root.load(memory_order_relaxed) );
+
+	for ( size_t i = 0; i < m_retired.size(); i++ )
+		for ( size_t j = 0; j < m_retired[i].nodes.size(); j++ )
+			m_engine.release( m_retired[i].nodes[j] );
+
+	//! The slots hold atomic integers only (nothing to destroy)
+	free(m_slots);
+}
+
+/*!
+ * Insertion function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param v => the value to the new node
+ *
+ * @return => void
+*/
+template <class Comparable>
+void ConcurrentRedBlackTree<Comparable>::insert( const Comparable& v )
+{
+	lock_guard<mutex> lock(m_writer);
+
+	Node* oldRoot = m_root.load(memory_order_relaxed);
+	Node* newRoot;
+
+	try
+	{
+		newRoot = m_engine.insert(oldRoot, v);
+	}
+	catch ( ... )
+	{
+		m_engine.rollback();
+		throw;
+	}
+
+	publish( oldRoot, newRoot, size() + 1 );
+}
+
+/*!
+ * Batch insertion function
+ * the paths shared by several insertions are copied once and the
+ * readers see the whole batch at once
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ *
+ * @return => void
+*/
+template <class Comparable>
+template <class InputIterator>
+void ConcurrentRedBlackTree<Comparable>::insert_batch( InputIterator first, InputIterator last )
+{
+	lock_guard<mutex> lock(m_writer);
+
+	Node* oldRoot = m_root.load(memory_order_relaxed);
+	Node* newRoot = oldRoot;
+	size_t added = 0;
+
+	try
+	{
+		for ( ; first != last; ++first, ++added )
+			newRoot = m_engine.insert(newRoot, *first);
+	}
+	catch ( ... )
+	{
+		m_engine.rollback();
+		throw;
+	}
+
+	if ( added != 0 )
+		publish( oldRoot, newRoot, size() + added );
+}
+
+/*!
+ * Remove function
+ *
+ * @param key => value to be removed
+ *
+ * @return => true if a value was removed
+*/
+template <class Comparable>
+template <class Key>
+bool ConcurrentRedBlackTree<Comparable>::remove( const Key& key )
+{
+	lock_guard<mutex> lock(m_writer);
+
+	Node* oldRoot = m_root.load(memory_order_relaxed);
+	Node* newRoot;
+	bool removed = false;
+
+	try
+	{
+		newRoot = m_engine.remove(oldRoot, key, removed);
+	}
+	catch ( ... )
+	{
+		m_engine.rollback();
+		throw;
+	}
+
+	if ( removed )
+		publish( oldRoot, newRoot, size() - 1 );
+
+	return removed;
+}
+
+/*!
+ * Clear function
+ * publishes the empty tree, the old nodes are retired
+ *
+ * @return => void
+*/
+template <class Comparable>
+void ConcurrentRedBlackTree<Comparable>::clear( void )
+{
+	lock_guard<mutex> lock(m_writer);
+
+	Node* oldRoot = m_root.load(memory_order_relaxed);
+
+	if ( oldRoot != NULL )
+		publish( oldRoot, NULL, 0 );
+}
+
+/*!
+ * Contains function
+ *
+ * @param key => value to be searched
+ *
+ * @return => true if found
+*/
+template <class Comparable>
+template <class Key>
+bool ConcurrentRedBlackTree<Comparable>::contains( const Key& key ) const
+{
+	ReadGuard guard(*this);
+
+	return PathCopyTree<Comparable>::find(guard.root(), key) != NULL;
+}
+
+/*!
+ * Find function
+ *
+ * @param key 	=> value to be searched
+ * @param out 	=> receives a copy of the value found
+ *
+ * @return => true if found
+*/
+template <class Comparable>
+template <class Key>
+bool ConcurrentRedBlackTree<Comparable>::find( const Key& key, Comparable& out ) const
+{
+	ReadGuard guard(*this);
+
+	const Node* nodePtr = PathCopyTree<Comparable>::find(guard.root(), key);
+
+	if ( nodePtr == NULL )
+		return false;
+
+	out = nodePtr->value;
+
+	return true;
+}
+
+/*!
+ * Count function
+ *
+ * @param key => value to be counted
+ *
+ * @return => number of equal values
+*/
+template <class Comparable>
+template <class Key>
+size_t ConcurrentRedBlackTree<Comparable>::count( const Key& key ) const
+{
+	ReadGuard guard(*this);
+
+	return PathCopyTree<Comparable>::count(guard.root(), key);
+}
+
+/*!
+ * For each function
+ *
+ * @param fn => called with every value, in order
+ *
+ * @return => void
+*/
+template <class Comparable>
+template <class Function>
+void ConcurrentRedBlackTree<Comparable>::for_each( Function fn ) const
+{
+	ReadGuard guard(*this);
+
+	PathCopyTree<Comparable>::forEach(guard.root(), fn);
+}
+
+/*!
+ * Read guard constructor
+ * claims a free slot with the current epoch, then loads the root: a writer
+ * that retires nodes after this point sees the slot and keeps them.
+ * The search starts from the slot this thread used last time
+ *
+ * @param tree => the tree to be read
+ *
+ * @return => void
+*/
+template <class Comparable>
+ConcurrentRedBlackTree<Comparable>::ReadGuard::ReadGuard( const ConcurrentRedBlackTree& tree )
+{
+	static thread_local size_t hint = hash<thread::id>()( this_thread::get_id() ) % MaxReaders;
+
+	size_t i = hint;
+
+	for ( size_t tries = 1; ; tries++ )
+	{
+		uint64_t expected = 0;
+
+		if ( tree.m_slots[i].epoch.compare_exchange_strong( expected, tree.m_epoch.load() ) )
+			break;
+
+		i = ( i + 1 ) % MaxReaders;
+
+		//! Every slot is taken
+		if ( tries % MaxReaders == 0 )
+			this_thread::yield();
+	}
+
+	hint = i;
+	m_slot = &tree.m_slots[i];
+	m_root = tree.m_root.load();
+}
+
+/*!
+ * Publish function
+ * the commit happens before the store, so the readers only ever see
+ * shared (never changed again) nodes
+ *
+ * @param oldRoot 	=> root the update started from
+ * @param newRoot 	=> root of the new version
+ * @param newSize 	=> number of values of the new version
+ *
+ * @return => void
+*/
+template <class Comparable>
+void ConcurrentRedBlackTree<Comparable>::publish( Node* oldRoot, Node* newRoot, size_t newSize )
+{
+	Retired retired;
+
+	m_engine.commit(oldRoot, newRoot, retired.nodes);
+
+	m_root.store(newRoot);
+	m_size.store(newSize, memory_order_relaxed);
+
+	//! Readers that announce a later epoch load the new root
+	if ( !retired.nodes.empty() )
+	{
+		retired.epoch = m_epoch.fetch_add(1);
+		m_retiredCount += retired.nodes.size();
+		m_retired.push_back( std::move(retired) );
+	}
+
+	if ( m_retiredCount >= ReclaimThreshold )
+		reclaim();
+}
+
+/*!
+ * Reclaim function
+ * frees the batches retired before the oldest epoch a reader announced
+ *
+ * @return => void
+*/
+template <class Comparable>
+void ConcurrentRedBlackTree<Comparable>::reclaim( void )
+{
+	uint64_t oldest = UINT64_MAX;
+
+	for ( size_t i = 0; i < MaxReaders; i++ )
+	{
+		uint64_t e = m_slots[i].epoch.load();
+
+		if ( e != 0 && e < oldest )
+			oldest = e;
+	}
+
+	while ( !m_retired.empty() && m_retired.front().epoch < oldest )
+	{
+		vector<Node*>& nodes = m_retired.front().nodes;
+
+		for ( size_t i = 0; i < nodes.size(); i++ )
+			m_engine.release(nodes[i]);
+
+		m_retiredCount -= nodes.size();
+		m_retired.pop_front();
+	}
+}
@@ -0,0 +1,195 @@
+/*!
+    <PRE>
+        SOURCE FILE : ConcurrentRedBlackTree.h
+        DESCRIPTION.: Red black tree with lock free readers (path copying + epochs).
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Atomic root publishing and epoch based reclamation implemented.
+
+        TO COMPILE..: Use makefile (-pthread).
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef ConcurrentRedBlackTree_H_
+#define ConcurrentRedBlackTree_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <functional>
+
+#include "PathCopyTree.h"
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// ConcurrentRedBlackTree( void )                               --> Class constructor
+// ~ConcurrentRedBlackTree()                                    --> Class destructor
+// void insert( const Comparable& v )                           --> Insertion function (writer)
+// void insert_batch( InputIterator first, InputIterator last ) --> Many insertions, one publish
+// bool remove( const Key& key )                                --> Remove function (writer)
+// void clear( void )                                           --> Remove every value (writer)
+// size_t size( void ) const                                    --> Number of values
+// bool empty( void ) const                                     --> Check if there is no value
+// bool contains( const Key& key ) const                        --> Search function (reader)
+// bool find( const Key& key, Comparable& out ) const           --> Search function, copies the value
+// size_t count( const Key& key ) const                         --> Number of equal values (reader)
+// void for_each( Function fn ) const                           --> In-order visit of one version
+//
+// Every function can be called from any thread.
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed (a failed update leaves the tree as it was).
+// std::bad_alloc thrown by the constructor if the reader slots can't be allocated.
+
+/*! Red black tree for many readers and one writer at a time.
+ *  Readers never lock: they load the current root and walk an immutable version of the tree.
+ *  A writer builds the new version by copying the root-to-leaf path it changes (PathCopyTree),
+ *  publishes the new root with one atomic store and retires the nodes the new version dropped.
+ *  Writers are serialized by a mutex (they never wait for readers).
+ *
+ *  Reclamation is epoch based: a reader announces the global epoch in a slot of its own before
+ *  loading the root and clears it when done; the nodes retired at epoch e are freed once no
+ *  slot holds an epoch <= e. A reader can only delay the reclamation, never block a writer.
+ *  Up to MaxReaders threads read at the same time; more of them wait for a free slot.
+*/
+template <class Comparable>
+class ConcurrentRedBlackTree
+{
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! Concurrent readers (slots) and retired nodes that trigger a reclamation pass */
+        static const size_t MaxReaders = 128;
+        static const size_t ReclaimThreshold = 1024;
+
+        /*! Class constructor to create an empty tree. Could throws a bad_alloc exception */
+        ConcurrentRedBlackTree( void );
+
+        /*! Class destructor (no other thread may use the tree any more) */
+        ~ConcurrentRedBlackTree();
+
+        /*! Insertion function. Could throws a bad_alloc exception */
+        void insert( const Comparable& v );
+
+        /*! Inserts [first, last) in one update: readers see all of it or none of it */
+        template <class InputIterator>
+        void insert_batch( InputIterator first, InputIterator last );
+
+        /*! Removes one value equal to key. Returns false if there is none */
+        template <class Key>
+        bool remove( const Key& key );
+
+        /*! Remove every value */
+        void clear( void );
+
+        /*! Number of values (of the last published version) */
+        size_t size( void ) const { return m_size.load(memory_order_relaxed); }
+
+        /*! Check if there is no value */
+        bool empty( void ) const { return size() == 0; }
+
+        /*! Search functions (any Key comparable with Comparable through '<').
+         *  find() copies the value out: the node may be freed as soon as the reader leaves
+        */
+        template <class Key>
+        bool contains( const Key& key ) const;
+
+        template <class Key>
+        bool find( const Key& key, Comparable& out ) const;
+
+        template <class Key>
+        size_t count( const Key& key ) const;
+
+        /*! Calls fn(value) in order over one version of the tree; the version stays alive
+         *  (and the reclamation waits) until the visit ends
+        */
+        template <class Function>
+        void for_each( Function fn ) const;
+
+    /*!
+     * Private section
+    */
+    private:
+
+        typedef typename PathCopyTree<Comparable>::Node Node;
+
+        /*! Reader slot: the announced epoch (0 if free), alone in its cache line. The slots
+         *  are allocated apart (posix_memalign), as new doesn't align to 64 bytes in C++11
+        */
+        struct alignas(64) ReaderSlot
+        {
+            atomic<uint64_t>    epoch;
+        };
+
+        /*! Nodes retired by one update */
+        struct Retired
+        {
+            uint64_t        epoch;      //!< epoch the update ended in
+            vector<Node*>   nodes;      //!< nodes dropped by the update
+        };
+
+        /*! Holds a reader slot while a reader walks the tree */
+        class ReadGuard
+        {
+            public:
+
+                explicit ReadGuard( const ConcurrentRedBlackTree& tree );
+                ~ReadGuard() { m_slot->epoch.store(0, memory_order_release); }
+
+                /*! Root of the version this reader walks */
+                const Node* root( void ) const { return m_root; }
+
+            private:
+
+                ReadGuard( const ReadGuard& );
+                ReadGuard& operator = ( const ReadGuard& );
+
+                ReaderSlot*     m_slot;     //!< slot claimed by the reader
+                const Node*     m_root;     //!< root loaded after the claim
+        };
+
+        /*! Ends an update: commits it, publishes newRoot and retires the dropped nodes */
+        void publish( Node* oldRoot, Node* newRoot, size_t newSize );
+
+        /*! Frees the retired nodes no reader can reach any more */
+        void reclaim( void );
+
+        /*! The nodes can't be shared by two trees */
+        ConcurrentRedBlackTree( const ConcurrentRedBlackTree& );
+        ConcurrentRedBlackTree& operator = ( const ConcurrentRedBlackTree& );
+
+        /*! Basic members. The readers load m_root and m_epoch: the padding keeps them out of
+         *  the cache line the writers dirty (m_size, the mutex), whatever the tree's address
+        */
+        atomic<Node*>               m_root;         //!< last published version
+        atomic<uint64_t>            m_epoch;        //!< global epoch (starts at 1, 0 marks a free slot)
+        char                        m_readerPad[64];
+        atomic<size_t>              m_size;         //!< number of values of the last version
+        mutex                       m_writer;       //!< serializes the writers
+        PathCopyTree<Comparable>    m_engine;       //!< path copying (writer only)
+        deque<Retired>              m_retired;      //!< retired nodes, oldest first (writer only)
+        size_t                      m_retiredCount; //!< nodes in m_retired
+        ReaderSlot*                 m_slots;        //!< MaxReaders slots, 64 byte aligned
+
+        /*! Checks the invariants in the tests (see test/TestUtil.h) */
+        friend struct TreeValidator;
+};
+
+#include "ConcurrentRedBlackTree.cpp"
+#endif // ConcurrentRedBlackTree_H
+
+/* ------------------ [ End of the ConcurrentRedBlackTree.h header ] ------------------ */
+/* ==================================================================================== */
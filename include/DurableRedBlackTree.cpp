@@ -0,0 +1,278 @@
+/*! \file */
+/*! \brief DurableRedBlackTree.cpp.
+ *
+ *  Implements the functions from DurableRedBlackTree class.
+*/
+
+#include "DurableRedBlackTree.h"
+
+/*!
+ * Class constructor
+ * the log gives the final values sorted, so the tree is bulk built (no insert per record)
+ * it throws a runtime_error exception if the log can't be opened or isn't valid
+ *
+ * @param path 		=> the log file
+ * @param policy 	=> when the records are synced (see WriteAheadLog.h)
+ * @param interval 	=> longest time between two syncs (SyncInterval)
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+DurableRedBlackTree<Comparable, Tree>::DurableRedBlackTree( const string& path, typename Log::SyncPolicy policy, chrono::milliseconds interval )
+	: m_log(policy, interval), m_failed(false)
+{
+	vector<Comparable> values;
+
+	m_log.open(path, values);
+	m_tree.assign(values.begin(), values.end());
+}
+
+/*!
+ * Insert function
+ * it throws a bad_alloc exception if no enough space (the tree is left as it
+ * was), and a runtime_error exception if the log fails: v stays in the tree,
+ * which is failed from then on (see checkUsable)
+ *
+ * @param v => value to be inserted
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void DurableRedBlackTree<Comparable, Tree>::insert( const Comparable& v )
+{
+	uint64_t ticket;
+	vector<Comparable> snapshot;
+	bool compacting;
+
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		checkUsable();
+		m_tree.insert(v);
+
+		try
+		{
+			ticket = m_log.append(Log::Insert, v);
+			compacting = compactIfLong(snapshot);
+		}
+		catch ( ... )
+		{
+			m_failed = true;
+			throw;
+		}
+	}
+
+	//! The snapshot holds v, so its write syncs the record too
+	if ( compacting )
+		writeSnapshot(snapshot);
+
+	//! The wait for the disk is shared with the other writers
+	try
+	{
+		m_log.commit(ticket);
+	}
+	catch ( ... )
+	{
+		//! Other writers may have read or removed v since, so it can't just be taken out
+		lock_guard<mutex> lock(m_lock);
+		m_failed = true;
+		throw;
+	}
+}
+
+/*!
+ * Remove function
+ * only a remove that found its value is logged
+ * it throws a runtime_error exception if the log fails (the tree is failed
+ * from then on, see insert)
+ *
+ * @param v => value to be removed
+ *
+ * @return => true if a value was removed
+*/
+template <class Comparable, class Tree>
+bool DurableRedBlackTree<Comparable, Tree>::remove( const Comparable& v )
+{
+	uint64_t ticket;
+	vector<Comparable> snapshot;
+	bool compacting;
+
+	{
+		lock_guard<mutex> lock(m_lock);
+
+		checkUsable();
+
+		if ( !m_tree.remove(v) )
+			return false;
+
+		try
+		{
+			ticket = m_log.append(Log::Remove, v);
+			compacting = compactIfLong(snapshot);
+		}
+		catch ( ... )
+		{
+			m_failed = true;
+			throw;
+		}
+	}
+
+	if ( compacting )
+		writeSnapshot(snapshot);
+
+	try
+	{
+		m_log.commit(ticket);
+	}
+	catch ( ... )
+	{
+		lock_guard<mutex> lock(m_lock);
+		m_failed = true;
+		throw;
+	}
+
+	return true;
+}
+
+/*!
+ * For each function
+ *
+ * @param fn => called with every value, in order
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+template <class Function>
+void DurableRedBlackTree<Comparable, Tree>::for_each( Function fn ) const
+{
+	lock_guard<mutex> lock(m_lock);
+
+	checkUsable();
+
+	for ( typename Tree::const_iterator it = m_tree.begin(); it != m_tree.end(); ++it )
+		fn(*it);
+}
+
+/*!
+ * Sync function
+ * it throws a runtime_error exception if the write fails (the tree is failed
+ * from then on)
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void DurableRedBlackTree<Comparable, Tree>::sync( void )
+{
+	{
+		lock_guard<mutex> lock(m_lock);
+		checkUsable();
+	}
+
+	try
+	{
+		m_log.sync();
+	}
+	catch ( ... )
+	{
+		lock_guard<mutex> lock(m_lock);
+		m_failed = true;
+		throw;
+	}
+}
+
+/*!
+ * Compact function
+ * the values are copied under the tree lock, at the point the log starts the
+ * compaction; the write goes on without the lock (waiting first for a running
+ * compaction, without the lock too)
+ * it throws a runtime_error exception on I/O errors (the old log is kept)
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void DurableRedBlackTree<Comparable, Tree>::compact( void )
+{
+	vector<Comparable> snapshot;
+
+	while ( true )
+	{
+		{
+			lock_guard<mutex> lock(m_lock);
+
+			checkUsable();
+
+			if ( m_log.beginCompact() )
+			{
+				snapshot.assign(m_tree.begin(), m_tree.end());
+				break;
+			}
+		}
+
+		m_log.waitCompact();
+	}
+
+	m_log.finishCompact(snapshot.begin(), snapshot.end());
+}
+
+/*!
+ * Compact if long function
+ * the copy is taken under the tree lock, so no record can slip between the
+ * values it holds and the records that follow it
+ *
+ * @param snapshot => receives the values when a compaction starts
+ *
+ * @return => true if a compaction started (see writeSnapshot)
+*/
+template <class Comparable, class Tree>
+bool DurableRedBlackTree<Comparable, Tree>::compactIfLong( vector<Comparable>& snapshot )
+{
+	if ( m_log.records() < CompactRatio * m_tree.size() + MinCompact )
+		return false;
+
+	//! Copied first: nothing can throw once the compaction started
+	snapshot.assign(m_tree.begin(), m_tree.end());
+
+	if ( !m_log.beginCompact() )
+	{
+		snapshot.clear();
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * Write snapshot function
+ * an error only leaves the old log in place (it still holds every record), so
+ * it isn't reported here: if the log itself failed, the commit that follows says so
+ *
+ * @param snapshot => the values taken by compactIfLong
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void DurableRedBlackTree<Comparable, Tree>::writeSnapshot( const vector<Comparable>& snapshot )
+{
+	try
+	{
+		m_log.finishCompact(snapshot.begin(), snapshot.end());
+	}
+	catch ( const runtime_error& )
+	{
+		//! The next long log tries again
+	}
+}
+
+/*!
+ * Check usable function
+ * it throws a runtime_error exception if a write failed: the tree may hold
+ * values the log lost, only the log (reopened) says what is durable
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void DurableRedBlackTree<Comparable, Tree>::checkUsable( void ) const
+{
+	if ( m_failed )
+		throw runtime_error("DurableRedBlackTree: a write failed to reach the log, reopen the tree");
+}
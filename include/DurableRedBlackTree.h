@@ -0,0 +1,153 @@
+/*!
+    <PRE>
+        SOURCE FILE : DurableRedBlackTree.h
+        DESCRIPTION.: Red black tree whose writes go to a write-ahead log (crash safe).
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Logged writes, startup replay by bulk load and automatic compaction implemented.
+
+        TO COMPILE..: Use makefile (-pthread).
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef DurableRedBlackTree_H_
+#define DurableRedBlackTree_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+#include "RedBlackTree.h"
+#include "WriteAheadLog.h"
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// DurableRedBlackTree( path, policy, interval )                --> Opens the log and rebuilds the tree
+// void insert( const Comparable& v )                           --> Insertion function (logged)
+// bool remove( const Comparable& v )                           --> Remove function (logged)
+// size_t size( void ) const / bool empty( void ) const         --> Number of values
+// bool contains( const Key& key ) const                        --> Search function
+// size_t count( const Key& key ) const                         --> Number of equal values
+// void for_each( Function fn ) const                           --> In-order visit
+// void sync( void )                                            --> Every write so far on disk
+// void compact( void )                                         --> Replaces the log by a snapshot
+// bool failed( void ) const                                    --> Check if the log failed (the tree is unusable)
+//
+// Every function can be called from any thread.
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed.
+// std::runtime_error thrown by the constructor if the log can't be opened or replayed, and by
+// the writes, sync() and compact() on I/O errors (see WriteAheadLog.h). Once a write failed
+// the tree is failed: every function but failed() throws runtime_error (reopen it from the log).
+
+/*! Red black tree that survives a crash: every insert and remove is appended to a
+ *  write-ahead log before it returns (written, and synced under SyncAlways).
+ *  The tree is changed and the record queued under the tree lock, so the log order is the
+ *  order the writes took; the wait for the disk happens after the lock is released, so the
+ *  writers of other threads keep going and share the next sync (group commit). A value is
+ *  visible to the readers before its write returns. If the log fails, the writes that were
+ *  applied can't be taken back one by one (another thread may have read or changed the same
+ *  values since), so the whole tree fails instead: it refuses any read or write, and the
+ *  log holds exactly what reached the disk.
+ *  The constructor rebuilds the tree from the log with the sorted bulk constructor, O(n)
+ *  after sorting the records. Once the log holds CompactRatio times more records than the
+ *  tree holds values (and at least MinCompact), it is replaced by a snapshot of the tree: the
+ *  values are copied under the tree lock and written by the writer that found the log long,
+ *  after the lock is released (see WriteAheadLog::beginCompact).
+ *  Values must be trivially copyable, and the order the default one.
+*/
+template <class Comparable, class Tree = RedBlackTree<Comparable> >
+class DurableRedBlackTree
+{
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! The log */
+        typedef WriteAheadLog<Comparable> Log;
+
+        /*! Opens the log at path (created if missing) and rebuilds the tree it describes.
+         *  Throws runtime_error if the log can't be opened or isn't valid
+        */
+        explicit DurableRedBlackTree( const string& path, typename Log::SyncPolicy policy = Log::SyncAlways,
+                                      chrono::milliseconds interval = chrono::milliseconds(10) );
+
+        /*! Inserts v, returns once it is logged. Could throws a bad_alloc exception */
+        void insert( const Comparable& v );
+
+        /*! Removes a value equal to v, returns once it is logged. Returns false if there is none */
+        bool remove( const Comparable& v );
+
+        /*! Number of values */
+        size_t size( void ) const { lock_guard<mutex> lock(m_lock); checkUsable(); return m_tree.size(); }
+
+        /*! Check if there is no value */
+        bool empty( void ) const { return size() == 0; }
+
+        /*! Search functions (any Key comparable with Comparable through '<') */
+        template <class Key>
+        bool contains( const Key& key ) const { lock_guard<mutex> lock(m_lock); checkUsable(); return m_tree.contains(key); }
+
+        template <class Key>
+        size_t count( const Key& key ) const { lock_guard<mutex> lock(m_lock); checkUsable(); return m_tree.count(key); }
+
+        /*! Calls fn(value) for every value, in order (the writers wait meanwhile) */
+        template <class Function>
+        void for_each( Function fn ) const;
+
+        /*! Writes and syncs every write so far, whatever the policy */
+        void sync( void );
+
+        /*! Replaces the log by a snapshot of the tree, O(n) (only the copy of the values holds
+         *  up the other threads, the write doesn't)
+        */
+        void compact( void );
+
+        /*! Check if a write failed to reach the log (the tree then refuses everything) */
+        bool failed( void ) const { lock_guard<mutex> lock(m_lock); return m_failed; }
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! Starts a compaction once the log has grown past CompactRatio times the tree (lock
+         *  held): snapshot gets the values, to be written without the lock. False if it didn't
+        */
+        bool compactIfLong( vector<Comparable>& snapshot );
+
+        /*! Writes a snapshot taken by compactIfLong (lock not held) */
+        void writeSnapshot( const vector<Comparable>& snapshot );
+
+        /*! Throws runtime_error if the tree failed (lock held) */
+        void checkUsable( void ) const;
+
+        /*! The tree owns its log file, so it can't be copied */
+        DurableRedBlackTree( const DurableRedBlackTree& );
+        DurableRedBlackTree& operator = ( const DurableRedBlackTree& );
+
+        /*! Basic members */
+        Log             m_log;      //!< the write-ahead log
+        Tree            m_tree;     //!< the values
+        mutable mutex   m_lock;     //!< guards m_tree, m_failed and the record order
+        bool            m_failed;   //!< a write failed to reach the log
+
+        /*! The log is compacted when it has CompactRatio * size() + MinCompact records */
+        static const size_t CompactRatio = 2;
+        static const size_t MinCompact = 1 << 16;
+};
+
+#include "DurableRedBlackTree.cpp"
+#endif // DurableRedBlackTree_H
+
+/* ------------------- [ End of the DurableRedBlackTree.h header ] ------------------ */
+/* ================================================================================== */
@@ -0,0 +1,496 @@
+/*! \file */
+/*! \brief FrozenRedBlackTree.cpp.
+ *
+ *  Implements the functions from FrozenRedBlackTree class.
+*/
+
+#include "FrozenRedBlackTree.h"
+
+/*!
+ * Range constructor
+ * builds the snapshot from a sorted range in O(n)
+ * it throws an invalid_argument exception if the input isn't sorted
+ * and a bad_alloc exception if no enough space
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ *
+ * @return => void
+*/
+template <class Comparable>
+template <class InputIterator>
+FrozenRedBlackTree<Comparable>::FrozenRedBlackTree( InputIterator first, InputIterator last )
+{
+	vector<Comparable> sorted(first, last);
+
+	for ( size_t i = 1; i < sorted.size(); i++ )
+		if ( sorted[i] < sorted[i - 1] )
+			throw invalid_argument("FrozenRedBlackTree: input not sorted");
+
+	m_size = sorted.size();
+
+	Comparable* values = new Comparable[m_size + 1];
+	m_values = shared_ptr<const Comparable>( values, default_delete<Comparable[]>() );
+
+	size_t next = 0;
+	place(values, sorted, next, 1);
+}
+
+/*!
+ * Place function
+ * in-order walk of the implicit tree rooted at k, so the sorted values
+ * land in Eytzinger order (recursive function calls)
+ *
+ * @param values 	=> the Eytzinger array
+ * @param sorted 	=> sorted values
+ * @param next 		=> next value to be placed
+ * @param k 		=> array index of the sub tree root
+ *
+ * @return => void
+*/
+template <class Comparable>
+void FrozenRedBlackTree<Comparable>::place( Comparable* values, const vector<Comparable>& sorted, size_t& next, size_t k )
+{
+	if ( k > m_size )
+		return;
+
+	place(values, sorted, next, 2 * k);
+	values[k] = sorted[next++];
+	place(values, sorted, next, 2 * k + 1);
+}
+
+/*!
+ * Checksum function
+ * FNV-1a over 64 bit words (a trailing partial word is zero padded)
+ *
+ * @param data 	=> first byte
+ * @param bytes => number of bytes
+ *
+ * @return => the checksum
+*/
+template <class Comparable>
+uint64_t FrozenRedBlackTree<Comparable>::checksum( const void* data, size_t bytes )
+{
+	const unsigned char* in = static_cast<const unsigned char*>(data);
+	uint64_t hash = 14695981039346656037ULL;
+
+	for ( size_t i = 0; i < bytes; i += sizeof(uint64_t) )
+	{
+		uint64_t word = 0;
+		memcpy(&word, in + i, ( bytes - i < sizeof(word) ) ? bytes - i : sizeof(word));
+
+		hash ^= word;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash ^ bytes;
+}
+
+/*!
+ * Contains function
+ *
+ * @param key => value to be searched
+ *
+ * @return => true if found
+*/
+template <class Comparable>
+template <class Key>
+bool FrozenRedBlackTree<Comparable>::contains( const Key& key ) const
+{
+	return find(key) != NULL;
+}
+
+/*!
+ * Find function
+ *
+ * @param key => value to be searched
+ *
+ * @return => pointer to the value stored in the snapshot, NULL if not found
+*/
+template <class Comparable>
+template <class Key>
+const Comparable* FrozenRedBlackTree<Comparable>::find( const Key& key ) const
+{
+	size_t k = boundIndex(key, false);
+
+	const Comparable* values = m_values.get();
+
+	return ( k != 0 && !(key < values[k]) ) ? &values[k] : NULL;
+}
+
+/*!
+ * Count function
+ * O(log n + number of equal values)
+ *
+ * @param key => value to be counted
+ *
+ * @return => number of equal values
+*/
+template <class Comparable>
+template <class Key>
+size_t FrozenRedBlackTree<Comparable>::count( const Key& key ) const
+{
+	size_t total = 0;
+
+	for ( const_iterator it = lower_bound(key); it != end() && !(key < *it); ++it )
+		total++;
+
+	return total;
+}
+
+/*!
+ * Begin function
+ *
+ * @return => iterator to the smallest value (end() if empty)
+*/
+template <class Comparable>
+typename FrozenRedBlackTree<Comparable>::const_iterator FrozenRedBlackTree<Comparable>::begin( void ) const
+{
+	if ( m_size == 0 )
+		return end();
+
+	//! The leftmost node
+	size_t k = 1;
+
+	while ( 2 * k <= m_size )
+		k = 2 * k;
+
+	return const_iterator(k, this);
+}
+
+/*!
+ * Lower bound function
+ *
+ * @param key => value to be searched
+ *
+ * @return => iterator to the first value not less than key (end() if none)
+*/
+template <class Comparable>
+template <class Key>
+typename FrozenRedBlackTree<Comparable>::const_iterator FrozenRedBlackTree<Comparable>::lower_bound( const Key& key ) const
+{
+	return const_iterator(boundIndex(key, false), this);
+}
+
+/*!
+ * Upper bound function
+ *
+ * @param key => value to be searched
+ *
+ * @return => iterator to the first value greater than key (end() if none)
+*/
+template <class Comparable>
+template <class Key>
+typename FrozenRedBlackTree<Comparable>::const_iterator FrozenRedBlackTree<Comparable>::upper_bound( const Key& key ) const
+{
+	return const_iterator(boundIndex(key, true), this);
+}
+
+/*!
+ * Equal range function
+ *
+ * @param key => value to be searched
+ *
+ * @return => [lower_bound(key), upper_bound(key))
+*/
+template <class Comparable>
+template <class Key>
+pair<typename FrozenRedBlackTree<Comparable>::const_iterator, typename FrozenRedBlackTree<Comparable>::const_iterator>
+FrozenRedBlackTree<Comparable>::equal_range( const Key& key ) const
+{
+	return make_pair(lower_bound(key), upper_bound(key));
+}
+
+/*!
+ * Save function
+ * writes the header, a zeroed slot 0 and the array, to a temporary file that
+ * is renamed over path at the end (a reader never maps a half written image)
+ * it throws a runtime_error exception if the file can't be written
+ *
+ * @param path => the image file
+ *
+ * @return => void
+*/
+template <class Comparable>
+void FrozenRedBlackTree<Comparable>::save( const string& path ) const
+{
+	static_assert( is_trivially_copyable<Comparable>::value, "save() needs trivially copyable values" );
+	static_assert( sizeof(ImageHeader) == 64, "the image header must fill a cache line" );
+
+	const Comparable* values = m_values.get();
+	size_t bytes = m_size * sizeof(Comparable);
+
+	ImageHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "RBTFROZN", sizeof(header.magic));
+	header.version = ImageVersion;
+	header.valueSize = sizeof(Comparable);
+	header.size = m_size;
+	header.checksum = checksum(values + 1, bytes);
+
+	char zero[sizeof(Comparable)];
+	memset(zero, 0, sizeof(zero));
+
+	string temp = path + ".tmp";
+	FILE* file = fopen(temp.c_str(), "wb");
+
+	if ( file == NULL )
+		throw runtime_error("FrozenRedBlackTree::save: can't create " + temp);
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+				   fwrite(zero, sizeof(zero), 1, file) == 1 &&
+				   ( bytes == 0 || fwrite(values + 1, bytes, 1, file) == 1 );
+
+	//! fclose flushes, so it can fail too
+	written = ( fclose(file) == 0 ) && written;
+
+	if ( !written || rename(temp.c_str(), path.c_str()) != 0 )
+	{
+		remove(temp.c_str());
+		throw runtime_error("FrozenRedBlackTree::save: can't write " + path);
+	}
+}
+
+/*!
+ * Open mmap function
+ * maps the whole file read only, the array is used in place (the mapping
+ * is released with the last snapshot that shares it)
+ * it throws a runtime_error exception if the file can't be mapped or isn't a valid image
+ *
+ * @param path 		=> the image file
+ * @param verify 	=> checks the checksum of the array too (reads every page)
+ *
+ * @return => the mapped snapshot
+*/
+template <class Comparable>
+FrozenRedBlackTree<Comparable> FrozenRedBlackTree<Comparable>::open_mmap( const string& path, bool verify )
+{
+	static_assert( is_trivially_copyable<Comparable>::value, "open_mmap() needs trivially copyable values" );
+
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if ( fd < 0 )
+		throw runtime_error("FrozenRedBlackTree::open_mmap: can't open " + path);
+
+	struct stat info;
+
+	if ( fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(ImageHeader) + sizeof(Comparable) )
+	{
+		close(fd);
+		throw runtime_error("FrozenRedBlackTree::open_mmap: " + path + " is too short to be an image");
+	}
+
+	size_t length = size_t(info.st_size);
+	void* base = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+
+	//! The mapping holds its own reference to the file
+	close(fd);
+
+	if ( base == MAP_FAILED )
+		throw runtime_error("FrozenRedBlackTree::open_mmap: can't map " + path);
+
+	const ImageHeader* header = static_cast<const ImageHeader*>(base);
+	const Comparable* values = reinterpret_cast<const Comparable*>( header + 1 );
+
+	const char* error = NULL;
+
+	if ( memcmp(header->magic, "RBTFROZN", sizeof(header->magic)) != 0 )
+		error = "bad magic";
+	else if ( header->version != ImageVersion )
+		error = "unknown version";
+	else if ( header->valueSize != sizeof(Comparable) )
+		error = "value size mismatch";
+	else if ( header->size != ( length - sizeof(ImageHeader) ) / sizeof(Comparable) - 1 ||
+			  ( length - sizeof(ImageHeader) ) % sizeof(Comparable) != 0 )
+		error = "length mismatch";
+	else if ( verify && checksum(values + 1, size_t(header->size) * sizeof(Comparable)) != header->checksum )
+		error = "checksum mismatch";
+
+	if ( error != NULL )
+	{
+		munmap(base, length);
+		throw runtime_error("FrozenRedBlackTree::open_mmap: " + path + ": " + error);
+	}
+
+	FrozenRedBlackTree snapshot;
+	snapshot.m_values = shared_ptr<const Comparable>( values, [base, length]( const Comparable* ) { munmap(base, length); } );
+	snapshot.m_size = size_t(header->size);
+
+	return snapshot;
+}
+
+/*!
+ * Bound function
+ * walks down to below the array, then drops the trailing right turns and the
+ * last left turn: the node left last is the bound
+ *
+ * @param key 	=> value to be searched
+ * @param upper => first value greater than key (true) or not less than key (false)
+ *
+ * @return => index of the bound, 0 if there is none
+*/
+template <class Comparable>
+template <class Key>
+size_t FrozenRedBlackTree<Comparable>::boundIndex( const Key& key, bool upper ) const
+{
+	unsigned long long k = descend(key, upper, 1, integral_constant<bool, UseSimd<Key>::value>());
+
+	return size_t( k >> __builtin_ffsll(~k) );
+}
+
+/*!
+ * Descend function
+ * branchless walk: every level adds one bit (1 = right) to the index
+ *
+ * @param key 	=> value to be searched
+ * @param upper => go right on equal values too
+ * @param k 	=> start index
+ *
+ * @return => first index past the array on the search path
+*/
+template <class Comparable>
+template <class Key>
+size_t FrozenRedBlackTree<Comparable>::descend( const Key& key, bool upper, size_t k, false_type ) const
+{
+	const Comparable* values = m_values.get();
+
+	while ( k <= m_size )
+	{
+		//! Four levels ahead, the 16 candidates are contiguous
+		__builtin_prefetch( values + (k << PrefetchLevels) );
+
+		k = 2 * k + ( upper ? !(key < values[k]) : (values[k] < key) );
+	}
+
+	return k;
+}
+
+/*!
+ * Descend function (32 bit integral keys)
+ * four levels per step: the 15 nodes on the next four levels are compared
+ * at once and the count below the key (not above it, for upper) is the offset
+ * under 16k. The last levels go through the plain walk. Only built with AVX2
+ * (-mavx2, opt-in in the makefile): with SSE2 alone the prefetching walk was faster
+ *
+ * @param key 	=> value to be searched
+ * @param upper => go right on equal values too
+ * @param k 	=> start index
+ *
+ * @return => first index past the array on the search path
+*/
+template <class Comparable>
+template <class Key>
+size_t FrozenRedBlackTree<Comparable>::descend( const Key& key, bool upper, size_t k, true_type ) const
+{
+#if defined(__AVX2__)
+	const Comparable* values = m_values.get();
+
+	//! Unsigned keys are compared as signed with the sign bit flipped
+	const int32_t flip = is_signed<Comparable>::value ? 0 : INT32_MIN;
+	const __m256i x8 = _mm256_set1_epi32( int32_t(key) ^ flip );
+	const __m256i flip8 = _mm256_set1_epi32(flip);
+	const __m128i x4 = _mm256_castsi256_si128(x8);
+	const __m128i flip4 = _mm256_castsi256_si128(flip8);
+
+	//! While the four levels are complete
+	while ( 8 * k + 7 <= m_size )
+	{
+		//! The next step starts under 16k
+		__builtin_prefetch( values + 16 * k );
+		__builtin_prefetch( values + 32 * k );
+		__builtin_prefetch( values + 32 * k + 16 );
+
+		__m256i level3 = _mm256_xor_si256( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( values + 8 * k ) ), flip8 );
+		__m128i level2 = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( values + 4 * k ) ), flip4 );
+
+		//! The first two levels are scalar
+		if ( upper )
+		{
+			unsigned above = __builtin_popcount( _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpgt_epi32(level3, x8) ) ) )
+						   + __builtin_popcount( _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpgt_epi32(level2, x4) ) ) )
+						   + (key < values[k]) + (key < values[2 * k]) + (key < values[2 * k + 1]);
+
+			k = 16 * k + (15 - above);
+		}
+		else
+		{
+			unsigned below = __builtin_popcount( _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpgt_epi32(x8, level3) ) ) )
+						   + __builtin_popcount( _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpgt_epi32(x4, level2) ) ) )
+						   + (values[k] < key) + (values[2 * k] < key) + (values[2 * k + 1] < key);
+
+			k = 16 * k + below;
+		}
+	}
+#endif
+
+	return descend(key, upper, k, false_type());
+}
+
+/*!
+ * Iterator increment
+ * goes to the in-order successor: the leftmost node of the right sub tree,
+ * or the first ancestor reached from its left side (index 0 past the end)
+ *
+ * @return => the iterator itself
+*/
+template <class Comparable>
+typename FrozenRedBlackTree<Comparable>::const_iterator& FrozenRedBlackTree<Comparable>::const_iterator::operator ++ ( void )
+{
+	size_t n = m_tree->m_size;
+
+	if ( 2 * m_index + 1 <= n )
+	{
+		m_index = 2 * m_index + 1;
+
+		while ( 2 * m_index <= n )
+			m_index = 2 * m_index;
+	}
+	else
+	{
+		//! Climb while coming from the right
+		while ( m_index & 1 )
+			m_index >>= 1;
+
+		m_index >>= 1;
+	}
+
+	return *this;
+}
+
+/*!
+ * Iterator decrement
+ * goes to the in-order predecessor; from end() it goes to the biggest value
+ *
+ * @return => the iterator itself
+*/
+template <class Comparable>
+typename FrozenRedBlackTree<Comparable>::const_iterator& FrozenRedBlackTree<Comparable>::const_iterator::operator -- ( void )
+{
+	size_t n = m_tree->m_size;
+
+	//! From end() go to the rightmost node
+	if ( m_index == 0 )
+	{
+		m_index = 1;
+
+		while ( 2 * m_index + 1 <= n )
+			m_index = 2 * m_index + 1;
+	}
+	else if ( 2 * m_index <= n )
+	{
+		m_index = 2 * m_index;
+
+		while ( 2 * m_index + 1 <= n )
+			m_index = 2 * m_index + 1;
+	}
+	else
+	{
+		//! Climb while coming from the left
+		while ( m_index != 0 && !(m_index & 1) )
+			m_index >>= 1;
+
+		m_index >>= 1;
+	}
+
+	return *this;
+}
@@ -0,0 +1,172 @@
+/*! \file */
+/*! \brief MappedRedBlackTree.cpp.
+ *
+ *  Implements the functions from MappedRedBlackTree class.
+*/
+
+#include "MappedRedBlackTree.h"
+
+/*!
+ * Remove function
+ * an added value is removed for real, a base value gets a tombstone
+ * (as long as the base has more equal values than tombstones)
+ *
+ * @param v => value to be removed
+ *
+ * @return => true if a value was removed
+*/
+template <class Comparable, class Tree>
+bool MappedRedBlackTree<Comparable, Tree>::remove( const Comparable& v )
+{
+	if ( m_added.remove(v) )
+		return true;
+
+	if ( m_base.count(v) <= m_removed.count(v) )
+		return false;
+
+	m_removed.insert(v);
+	return true;
+}
+
+/*!
+ * Contains function
+ *
+ * @param key => value to be searched
+ *
+ * @return => true if there is a value equal to key
+*/
+template <class Comparable, class Tree>
+template <class Key>
+bool MappedRedBlackTree<Comparable, Tree>::contains( const Key& key ) const
+{
+	return find(key) != NULL;
+}
+
+/*!
+ * Find function
+ *
+ * @param key => value to be searched
+ *
+ * @return => a value equal to key, NULL if not found
+*/
+template <class Comparable, class Tree>
+template <class Key>
+const Comparable* MappedRedBlackTree<Comparable, Tree>::find( const Key& key ) const
+{
+	const Comparable* found = m_added.find(key);
+
+	if ( found != NULL )
+		return found;
+
+	found = m_base.find(key);
+
+	//! Only the tombstones of a found key are counted
+	if ( found == NULL || ( !m_removed.empty() && m_base.count(key) <= m_removed.count(key) ) )
+		return NULL;
+
+	return found;
+}
+
+/*!
+ * Count function
+ *
+ * @param key => value to be searched
+ *
+ * @return => number of values equal to key
+*/
+template <class Comparable, class Tree>
+template <class Key>
+size_t MappedRedBlackTree<Comparable, Tree>::count( const Key& key ) const
+{
+	return m_base.count(key) - m_removed.count(key) + m_added.count(key);
+}
+
+/*!
+ * Promote function
+ * the merged values are already sorted, so the tree is built in O(n)
+ *
+ * @return => a heap tree with every value
+*/
+template <class Comparable, class Tree>
+Tree MappedRedBlackTree<Comparable, Tree>::promote( void ) const
+{
+	return Tree( begin(), end() );
+}
+
+/*!
+ * Save function
+ * it throws a runtime_error exception if the file can't be written
+ *
+ * @param path => the image file
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void MappedRedBlackTree<Comparable, Tree>::save( const string& path ) const
+{
+	if ( !dirty() )
+		m_base.save(path);
+	else
+		Base( begin(), end() ).save(path);
+}
+
+/*!
+ * Iterator constructor
+ *
+ * @param tree 	=> the tree
+ * @param atEnd => end() (true) or begin() (false)
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+MappedRedBlackTree<Comparable, Tree>::const_iterator::const_iterator( const MappedRedBlackTree& tree, bool atEnd )
+	: m_base( atEnd ? tree.m_base.end() : tree.m_base.begin() ), m_baseEnd( tree.m_base.end() ),
+	  m_removed( tree.m_removed.begin() ), m_removedEnd( tree.m_removed.end() ),
+	  m_added( atEnd ? tree.m_added.end() : tree.m_added.begin() ), m_addedEnd( tree.m_added.end() ),
+	  m_fromBase(false)
+{
+	settle();
+}
+
+/*!
+ * Iterator increment
+ *
+ * @return => the iterator itself
+*/
+template <class Comparable, class Tree>
+typename MappedRedBlackTree<Comparable, Tree>::const_iterator& MappedRedBlackTree<Comparable, Tree>::const_iterator::operator ++ ( void )
+{
+	if ( m_fromBase )
+		++m_base;
+	else
+		++m_added;
+
+	settle();
+
+	return *this;
+}
+
+/*!
+ * Settle function
+ * walks the tombstones along the base (both are sorted): a base value equal
+ * to the next tombstone is skipped and uses it up. On a tie the base goes first
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void MappedRedBlackTree<Comparable, Tree>::const_iterator::settle( void )
+{
+	while ( m_base != m_baseEnd && m_removed != m_removedEnd )
+	{
+		while ( m_removed != m_removedEnd && *m_removed < *m_base )
+			++m_removed;
+
+		if ( m_removed == m_removedEnd || *m_base < *m_removed )
+			break;
+
+		++m_removed;
+		++m_base;
+	}
+
+	m_fromBase = m_base != m_baseEnd && ( m_added == m_addedEnd || !( *m_added < *m_base ) );
+}
@@ -0,0 +1,176 @@
+/*!
+    <PRE>
+        SOURCE FILE : MappedRedBlackTree.h
+        DESCRIPTION.: Red black tree served from a mapped binary image, writable through overlays.
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Mapped base, heap overlays (promote on write), merge iterator implemented.
+
+        TO COMPILE..: Use makefile.
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef MappedRedBlackTree_H_
+#define MappedRedBlackTree_H_
+
+#include <cstddef>
+#include <string>
+#include <iterator>
+
+#include "RedBlackTree.h"
+#include "FrozenRedBlackTree.h"
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// MappedRedBlackTree( void )                                   --> Empty tree
+// MappedRedBlackTree( const FrozenRedBlackTree& base )         --> Tree over a snapshot, O(1)
+// MappedRedBlackTree open_mmap( path, verify )                 --> Tree over a mapped image, O(1) (static)
+// size_t size( void ) const / bool empty( void ) const         --> Number of values
+// bool dirty( void ) const                                     --> Check if it was changed since it was opened
+// void insert( const Comparable& v )                           --> Insertion function (goes to the heap)
+// bool remove( const Comparable& v )                           --> Remove function
+// bool contains( const Key& key ) const                        --> Search function
+// const Comparable* find( const Key& key ) const               --> Search function (NULL if not found)
+// size_t count( const Key& key ) const                         --> Number of equal values
+// begin( ) / end( )                                            --> In-order iterators (forward)
+// Tree promote( void ) const                                   --> Whole tree in the heap, O(n)
+// void save( const string& path ) const                        --> Writes the binary image (compacted)
+//
+// Built by RedBlackTree::open_mmap(). Only for the default order.
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed.
+// std::runtime_error thrown by open_mmap() and save() (see FrozenRedBlackTree.h).
+
+/*! Red black tree whose values are served from a FrozenRedBlackTree, usually one mapped from
+ *  an image file (so opening it costs the same for any size: the pages load on the first touch).
+ *  The mapped base is never written. A write is promoted to the heap instead: an inserted value
+ *  goes to the added tree, and a removed base value gets a tombstone in the removed tree, so the
+ *  writes cost O(log n) on trees the size of the changes. Lookups check both sides, and the
+ *  iterators merge them in order. promote() moves everything to a plain Tree, and save() writes
+ *  the merged values back as a new image.
+*/
+template <class Comparable, class Tree = RedBlackTree<Comparable> >
+class MappedRedBlackTree
+{
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! The read only base */
+        typedef FrozenRedBlackTree<Comparable> Base;
+
+        /*! Forward in-order iterator: merges the base (skipping its tombstones) with the added values */
+        class const_iterator
+        {
+            public:
+
+                typedef forward_iterator_tag    iterator_category;
+                typedef Comparable              value_type;
+                typedef ptrdiff_t               difference_type;
+                typedef const Comparable*       pointer;
+                typedef const Comparable&       reference;
+
+                const_iterator( void ) : m_fromBase(false) { /*! empty */ }
+
+                reference operator * ( void ) const { return m_fromBase ? *m_base : *m_added; }
+                pointer operator -> ( void ) const { return &**this; }
+
+                const_iterator& operator ++ ( void );
+                const_iterator operator ++ ( int ) { const_iterator old = *this; ++*this; return old; }
+
+                bool operator == ( const const_iterator& rhs ) const { return m_base == rhs.m_base && m_added == rhs.m_added; }
+                bool operator != ( const const_iterator& rhs ) const { return !( *this == rhs ); }
+
+            private:
+
+                const_iterator( const MappedRedBlackTree& tree, bool atEnd );
+
+                /*! Skips the tombstoned base values and picks the side of the next value */
+                void settle( void );
+
+                typename Base::const_iterator   m_base, m_baseEnd;          //!< base values
+                typename Tree::const_iterator   m_removed, m_removedEnd;    //!< tombstones (in lockstep with m_base)
+                typename Tree::const_iterator   m_added, m_addedEnd;        //!< added values
+                bool                            m_fromBase;                 //!< the current value is m_base's
+
+                friend class MappedRedBlackTree;
+        };
+
+        typedef const_iterator iterator;
+
+        /*! Empty tree */
+        MappedRedBlackTree( void ) { /*! empty */ }
+
+        /*! Tree over base in O(1) (the snapshot storage is shared, not copied) */
+        explicit MappedRedBlackTree( const Base& base ) : m_base(base) { /*! empty */ }
+
+        /*! Maps the image at path (see FrozenRedBlackTree::open_mmap) */
+        static MappedRedBlackTree open_mmap( const string& path, bool verify = false )
+        {
+            return MappedRedBlackTree( Base::open_mmap(path, verify) );
+        }
+
+        /*! Number of values */
+        size_t size( void ) const { return m_base.size() - m_removed.size() + m_added.size(); }
+
+        /*! Check if there is no value */
+        bool empty( void ) const { return size() == 0; }
+
+        /*! Check if a value was inserted or removed since the base was opened */
+        bool dirty( void ) const { return !m_added.empty() || !m_removed.empty(); }
+
+        /*! Inserts v in the heap side. Could throws a bad_alloc exception */
+        void insert( const Comparable& v ) { m_added.insert(v); }
+
+        /*! Removes a value equal to v (from the heap side first). Returns false if there is none */
+        bool remove( const Comparable& v );
+
+        /*! Search functions (any Key comparable with Comparable through '<') */
+        template <class Key>
+        bool contains( const Key& key ) const;
+
+        template <class Key>
+        const Comparable* find( const Key& key ) const;
+
+        template <class Key>
+        size_t count( const Key& key ) const;
+
+        /*! In-order iterators */
+        const_iterator begin( void ) const { return const_iterator(*this, false); }
+        const_iterator end( void ) const { return const_iterator(*this, true); }
+
+        /*! Every value in a heap Tree, O(n) (sorted bulk build) */
+        Tree promote( void ) const;
+
+        /*! Writes the values as a new image (the base as is if nothing changed).
+         *  The file being mapped may be overwritten: the mapping keeps the old one.
+         *  Throws runtime_error on I/O errors
+        */
+        void save( const string& path ) const;
+
+        /*! The read only base */
+        const Base& base( void ) const { return m_base; }
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! Basic members */
+        Base    m_base;     //!< read only values (mapped)
+        Tree    m_added;    //!< values inserted since (heap)
+        Tree    m_removed;  //!< tombstones of the removed base values (heap)
+};
+
+#include "MappedRedBlackTree.cpp"
+#endif // MappedRedBlackTree_H
+
+/* ------------------- [ End of the MappedRedBlackTree.h header ] ------------------- */
+/* ================================================================================== */
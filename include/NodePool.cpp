@@ -0,0 +1,610 @@
+/*! \file */
+/*! \brief NodePool.cpp.
+ *
+ *  Implements the functions from NodePool class.
+*/
+
+#include "NodePool.h"
+
+/*!
+ * Class constructor
+ *
+ * @param firstChunk => number of nodes in the first chunk
+ * @param maxChunk	 => chunk size limit (in nodes)
+ *
+ * @return => void
+*/
+template <class Node>
+NodePool<Node>::NodePool( size_t firstChunk, size_t maxChunk )
+	: m_freeList(NULL), m_next(NULL), m_end(NULL),
+	  m_chunkSize(firstChunk ? firstChunk : 1), m_firstChunk(m_chunkSize),
+	  m_maxChunk(maxChunk < m_chunkSize ? m_chunkSize : maxChunk)
+{
+	/*! empty */
+}
+
+/*!
+ * Class destructor
+ * realeases every chunk
+ *
+ * @return => void
+*/
+template <class Node>
+NodePool<Node>::~NodePool()
+{
+	release();
+}
+
+/*!
+ * Allocation function
+ * takes a slot from the current chunk, from the free list or from a new chunk
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @return => raw storage for one node
+*/
+template <class Node>
+Node* NodePool<Node>::allocate( void )
+{
+	//! Keep the allocations contiguous while the current chunk lasts
+	if ( m_next != m_end )
+		return reinterpret_cast<Node*>( m_next++ );
+
+	//! Then reuse a released slot
+	if ( m_freeList != NULL )
+	{
+		Slot* slot = m_freeList;
+		m_freeList = slot->next;
+		return reinterpret_cast<Node*>( slot );
+	}
+
+	//! The current chunk is over, so create a new one
+	newChunk(m_chunkSize);
+
+	//! Grow geometrically up to the limit
+	if ( m_chunkSize < m_maxChunk )
+		m_chunkSize = ( m_chunkSize * 2 < m_maxChunk ) ? m_chunkSize * 2 : m_maxChunk;
+
+	return reinterpret_cast<Node*>( m_next++ );
+}
+
+/*!
+ * Deallocation function
+ * puts the slot in the free list
+ *
+ * @param nodePtr => node storage (already destroyed)
+ *
+ * @return => void
+*/
+template <class Node>
+void NodePool<Node>::deallocate( Node* nodePtr )
+{
+	Slot* slot = reinterpret_cast<Slot*>( nodePtr );
+	slot->next = m_freeList;
+	m_freeList = slot;
+}
+
+/*!
+ * Reserve function
+ * makes sure the current chunk has n untouched slots, so the next n
+ * allocations come from one contiguous block.
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param n => number of nodes
+ *
+ * @return => void
+*/
+template <class Node>
+void NodePool<Node>::reserve( size_t n )
+{
+	if ( size_t(m_end - m_next) >= n )
+		return;
+
+	//! Keep the untouched slots of the current chunk in the free list
+	Slot* next = m_next;
+	Slot* end = m_end;
+
+	newChunk( n > m_chunkSize ? n : m_chunkSize );
+
+	for ( ; next != end; next++ )
+	{
+		next->next = m_freeList;
+		m_freeList = next;
+	}
+}
+
+/*!
+ * Chunk creation function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param n => number of slots
+ *
+ * @return => void
+*/
+template <class Node>
+void NodePool<Node>::newChunk( size_t n )
+{
+	Chunk chunk = { new Slot[n], n };
+
+	try
+	{
+		m_chunks.push_back(chunk);
+	}
+	catch ( ... )
+	{
+		delete [] chunk.slots;
+		throw;
+	}
+
+	m_next = chunk.slots;
+	m_end = chunk.slots + n;
+}
+
+/*!
+ * Release function
+ * frees all the chunks at once
+ *
+ * @return => void
+*/
+template <class Node>
+void NodePool<Node>::release( void )
+{
+	for ( size_t i = 0; i < m_chunks.size(); i++ )
+		delete [] m_chunks[i].slots;
+
+	m_chunks.clear();
+	m_freeList = m_next = m_end = NULL;
+	m_chunkSize = m_firstChunk;
+}
+
+/*!
+ * Capacity function
+ *
+ * @return => number of slots in the chunks
+*/
+template <class Node>
+size_t NodePool<Node>::capacity( void ) const
+{
+	size_t total = 0;
+
+	for ( size_t i = 0; i < m_chunks.size(); i++ )
+		total += m_chunks[i].size;
+
+	return total;
+}
+
+/*!
+ * Copy function
+ * allocates a chunk for each chunk of other, copies their bytes (in
+ * parallel with workers) and moves the free list and the current chunk
+ * position to the copies.
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param other 	=> the pool to be copied
+ * @param workers 	=> copy the chunks in parallel (NULL: sequential)
+ *
+ * @return => the map from other's nodes to their copies
+*/
+template <class Node>
+typename NodePool<Node>::Relocation NodePool<Node>::copy( const NodePool& other, ThreadPool* workers )
+{
+	release();
+
+	Relocation moved;
+	moved.m_ranges.reserve( other.m_chunks.size() );
+	m_chunks.reserve( other.m_chunks.size() );
+
+	try
+	{
+		for ( size_t i = 0; i < other.m_chunks.size(); i++ )
+		{
+			const Chunk& source = other.m_chunks[i];
+			Chunk chunk = { new Slot[source.size], source.size };
+
+			m_chunks.push_back(chunk);
+
+			typename Relocation::Range range = { source.slots, source.slots + source.size, chunk.slots };
+			moved.m_ranges.push_back(range);
+		}
+	}
+	catch ( ... )
+	{
+		release();
+		throw;
+	}
+
+	//! The bytes of every chunk
+	if ( workers != NULL )
+	{
+		workers->parallelFor( m_chunks.size(), 1, [&]( size_t i )
+		{
+			memcpy( m_chunks[i].slots, other.m_chunks[i].slots, m_chunks[i].size * sizeof(Slot) );
+		} );
+	}
+	else
+	{
+		for ( size_t i = 0; i < m_chunks.size(); i++ )
+			memcpy( m_chunks[i].slots, other.m_chunks[i].slots, m_chunks[i].size * sizeof(Slot) );
+	}
+
+	//! The current chunk is the last one, its end can't be searched (it may start another chunk)
+	if ( !m_chunks.empty() )
+	{
+		m_next = m_chunks.back().slots + ( other.m_next - other.m_chunks.back().slots );
+		m_end = m_chunks.back().slots + m_chunks.back().size;
+	}
+
+	m_chunkSize = other.m_chunkSize;
+	m_firstChunk = other.m_firstChunk;
+	m_maxChunk = other.m_maxChunk;
+
+	sort( moved.m_ranges.begin(), moved.m_ranges.end() );
+
+	//! The free list links still point to other's slots
+	m_freeList = reinterpret_cast<Slot*>( moved( reinterpret_cast<Node*>( other.m_freeList ) ) );
+
+	for ( Slot* slot = m_freeList; slot != NULL; slot = slot->next )
+		slot->next = reinterpret_cast<Slot*>( moved( reinterpret_cast<Node*>( slot->next ) ) );
+
+	return moved;
+}
+
+/*!
+ * Relocation function
+ *
+ * @param l => a node of the copied pool (or NULL)
+ *
+ * @return => its copy
+*/
+template <class Node>
+Node* NodePool<Node>::Relocation::operator () ( Node* l ) const
+{
+	if ( l == NULL )
+		return NULL;
+
+	const Slot* slot = reinterpret_cast<const Slot*>( l );
+
+	//! Last chunk that starts at or before the slot
+	size_t lo = 0, hi = m_ranges.size();
+
+	while ( hi - lo > 1 )
+	{
+		size_t mid = ( lo + hi ) / 2;
+
+		if ( less<const Slot*>()( slot, m_ranges[mid].begin ) )
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	return reinterpret_cast<Node*>( m_ranges[lo].target + ( slot - m_ranges[lo].begin ) );
+}
+
+/*!
+ * Chain function
+ *
+ * @param c 		=> the chain
+ * @param nodePtr 	=> node storage (already destroyed)
+ *
+ * @return => void
+*/
+template <class Node>
+void NodePool<Node>::chain( FreeChain& c, Node* nodePtr ) const
+{
+	Slot* slot = reinterpret_cast<Slot*>( nodePtr );
+	slot->next = c.head;
+
+	if ( c.head == NULL )
+		c.tail = slot;
+
+	c.head = slot;
+}
+
+/*!
+ * Join function
+ *
+ * @param c => the chain
+ * @param o => slots appended to c
+ *
+ * @return => void
+*/
+template <class Node>
+void NodePool<Node>::join( FreeChain& c, const FreeChain& o ) const
+{
+	if ( o.head == NULL )
+		return;
+
+	if ( c.head == NULL )
+		c.head = o.head;
+	else
+		c.tail->next = o.head;
+
+	c.tail = o.tail;
+}
+
+/*!
+ * Chain deallocation function
+ * puts the whole chain in the free list
+ *
+ * @param c => the chain
+ *
+ * @return => void
+*/
+template <class Node>
+void NodePool<Node>::deallocate( const FreeChain& c )
+{
+	if ( c.head == NULL )
+		return;
+
+	c.tail->next = m_freeList;
+	m_freeList = c.head;
+}
+
+/*!
+ * Swap function
+ *
+ * @param other => the other pool
+ *
+ * @return => void
+*/
+template <class Node>
+void NodePool<Node>::swap( NodePool& other ) noexcept
+{
+	m_chunks.swap(other.m_chunks);
+	std::swap(m_freeList, other.m_freeList);
+	std::swap(m_next, other.m_next);
+	std::swap(m_end, other.m_end);
+	std::swap(m_chunkSize, other.m_chunkSize);
+	std::swap(m_firstChunk, other.m_firstChunk);
+	std::swap(m_maxChunk, other.m_maxChunk);
+}
+
+/*!
+ * Class constructor
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+IndexNodePool<Node, ChunkBits>::IndexNodePool( void )
+	: m_freeList(NoSlot), m_next(0), m_reserved(0)
+{
+	/*! empty */
+}
+
+/*!
+ * Class destructor
+ * realeases every chunk
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+IndexNodePool<Node, ChunkBits>::~IndexNodePool()
+{
+	release();
+}
+
+/*!
+ * Allocation function
+ * takes a fresh slot, a slot from the free list or a slot from a new chunk
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @return => index of the slot
+*/
+template <class Node, unsigned ChunkBits>
+typename IndexNodePool<Node, ChunkBits>::link_type IndexNodePool<Node, ChunkBits>::allocate( void )
+{
+	//! Keep the allocations in index order while the chunks last, and past them if reserved
+	if ( m_next == m_chunks.size() * ChunkSize && ( m_reserved > 0 || m_freeList == NoSlot ) )
+		newChunk();
+
+	if ( m_next < m_chunks.size() * ChunkSize )
+	{
+		if ( m_reserved > 0 )
+			m_reserved--;
+
+		return m_next++;
+	}
+
+	//! Then reuse a released slot
+	link_type l = m_freeList;
+	m_freeList = reinterpret_cast<Slot*>( node(l) )->next;
+
+	return l;
+}
+
+/*!
+ * Deallocation function
+ * puts the slot in the free list
+ *
+ * @param l => index of the slot (node already destroyed)
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+void IndexNodePool<Node, ChunkBits>::deallocate( link_type l )
+{
+	reinterpret_cast<Slot*>( node(l) )->next = m_freeList;
+	m_freeList = l;
+}
+
+/*!
+ * Reserve function
+ * the next n allocations take fresh slots, so they get consecutive indices
+ * (contiguous inside each chunk). The chunks are created as needed
+ *
+ * @param n => number of nodes
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+void IndexNodePool<Node, ChunkBits>::reserve( size_t n )
+{
+	m_reserved = n;
+}
+
+/*!
+ * Chunk creation function
+ * it throws a bad_alloc exception if no enough space (or no index left)
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+void IndexNodePool<Node, ChunkBits>::newChunk( void )
+{
+	if ( m_chunks.size() >= MaxNodes / ChunkSize )
+		throw bad_alloc();
+
+	Slot* chunk = new Slot[ChunkSize];
+
+	try
+	{
+		m_chunks.push_back(chunk);
+	}
+	catch ( ... )
+	{
+		delete [] chunk;
+		throw;
+	}
+}
+
+/*!
+ * Release function
+ * frees all the chunks at once
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+void IndexNodePool<Node, ChunkBits>::release( void )
+{
+	for ( size_t i = 0; i < m_chunks.size(); i++ )
+		delete [] m_chunks[i];
+
+	m_chunks.clear();
+	m_freeList = NoSlot;
+	m_next = 0;
+	m_reserved = 0;
+}
+
+/*!
+ * Copy function
+ * copies the bytes of every chunk (in parallel with workers). The links
+ * are indices, so nothing has to be moved afterwards.
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param other 	=> the pool to be copied
+ * @param workers 	=> copy the chunks in parallel (NULL: sequential)
+ *
+ * @return => the (identity) map from other's nodes to their copies
+*/
+template <class Node, unsigned ChunkBits>
+typename IndexNodePool<Node, ChunkBits>::Relocation IndexNodePool<Node, ChunkBits>::copy( const IndexNodePool& other, ThreadPool* workers )
+{
+	release();
+
+	try
+	{
+		m_chunks.reserve( other.m_chunks.size() );
+
+		for ( size_t i = 0; i < other.m_chunks.size(); i++ )
+			m_chunks.push_back( new Slot[ChunkSize] );
+	}
+	catch ( ... )
+	{
+		release();
+		throw;
+	}
+
+	if ( workers != NULL )
+	{
+		//! The chunks are small, a few of them per task
+		workers->parallelFor( m_chunks.size(), 16, [&]( size_t i )
+		{
+			memcpy( m_chunks[i], other.m_chunks[i], ChunkSize * sizeof(Slot) );
+		} );
+	}
+	else
+	{
+		for ( size_t i = 0; i < m_chunks.size(); i++ )
+			memcpy( m_chunks[i], other.m_chunks[i], ChunkSize * sizeof(Slot) );
+	}
+
+	m_freeList = other.m_freeList;
+	m_next = other.m_next;
+	m_reserved = other.m_reserved;
+
+	return Relocation();
+}
+
+/*!
+ * Chain function
+ *
+ * @param c => the chain
+ * @param l => index of the slot (node already destroyed)
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+void IndexNodePool<Node, ChunkBits>::chain( FreeChain& c, link_type l ) const
+{
+	reinterpret_cast<Slot*>( node(l) )->next = c.head;
+
+	if ( c.head == NoSlot )
+		c.tail = l;
+
+	c.head = l;
+}
+
+/*!
+ * Join function
+ *
+ * @param c => the chain
+ * @param o => slots appended to c
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+void IndexNodePool<Node, ChunkBits>::join( FreeChain& c, const FreeChain& o ) const
+{
+	if ( o.head == NoSlot )
+		return;
+
+	if ( c.head == NoSlot )
+		c.head = o.head;
+	else
+		reinterpret_cast<Slot*>( node(c.tail) )->next = o.head;
+
+	c.tail = o.tail;
+}
+
+/*!
+ * Chain deallocation function
+ * puts the whole chain in the free list
+ *
+ * @param c => the chain
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+void IndexNodePool<Node, ChunkBits>::deallocate( const FreeChain& c )
+{
+	if ( c.head == NoSlot )
+		return;
+
+	reinterpret_cast<Slot*>( node(c.tail) )->next = m_freeList;
+	m_freeList = c.head;
+}
+
+/*!
+ * Swap function
+ *
+ * @param other => the other pool
+ *
+ * @return => void
+*/
+template <class Node, unsigned ChunkBits>
+void IndexNodePool<Node, ChunkBits>::swap( IndexNodePool& other ) noexcept
+{
+	m_chunks.swap(other.m_chunks);
+	std::swap(m_freeList, other.m_freeList);
+	std::swap(m_next, other.m_next);
+	std::swap(m_reserved, other.m_reserved);
+}
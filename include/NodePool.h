@@ -0,0 +1,400 @@
+/*!
+    <PRE>
+        SOURCE FILE : NodePool.h
+        DESCRIPTION.: Node allocators used by the RedBlackTree class.
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Slab pool and plain heap allocator implemented.
+                      Index pool (32 bit links) implemented.
+                      Arena copies and free chains implemented.
+
+        TO COMPILE..: Use makefile.
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef NodePool_H_
+#define NodePool_H_
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+// ***********************************PUBLIC OPERATIONS**************************************
+// NodePool( size_t firstChunk, size_t maxChunk )   --> Class constructor
+// ~NodePool()                                      --> Class destructor (frees every chunk)
+// link_type allocate( void )                      --> Hands out raw storage for one node
+// void deallocate( link_type l )                   --> Puts the storage back in the free list
+// void reserve( size_t n )                         --> Next n allocations come from one block
+// void release( void )                             --> Frees all the chunks at once, O(chunks)
+// size_t chunks( void ) const                      --> Number of chunks currently held
+// size_t capacity( void ) const                    --> Number of slots in the chunks
+// Relocation copy( const Pool& other, workers )    --> Byte copy of other's chunks (pools only)
+// void chain( FreeChain& c, link_type l ) const    --> Frees a slot into a chain (any thread)
+// void join( FreeChain& c, const FreeChain& o ) const --> Appends a chain to another
+// void deallocate( const FreeChain& c )            --> Gives a whole chain back, O(1)
+// void swap( Pool& other )                         --> Exchanges the storage of two pools
+// Node* node( link_type l ) const                  --> Node a link points to
+// link_type link( const Node* nodePtr ) const      --> Link to a node
+//
+// A link is what the nodes store to reach each other: a plain pointer for NodePool and
+// HeapNodeAllocator, a 32 bit index for IndexNodePool (Node::link_type must match).
+// The nodes freed by worker threads go to a FreeChain first (only the owner thread touches
+// the pool), and the chain is given back at once. copy() takes trivially copyable nodes:
+// Relocation maps the links of other's nodes to their copies (nothing to map for indices).
+// sharesNodes is set when a node may be given back to another allocator than its own.
+
+// *****************************************ERRORS*******************************************
+// std::bad_alloc thrown if needed.
+
+/*! Slab pool: hands out nodes from contiguous chunks and recycles them through a free list.
+ *  Chunks grow geometrically (firstChunk, 2*firstChunk, ... up to maxChunk nodes), so a small
+ *  tree stays small and a big tree lives in a few large, cache friendly blocks.
+ *  The current chunk is used up before the free list, so consecutive allocations are
+ *  contiguous whenever possible; freed slots are reused before a new chunk is created.
+ *  The pool only manages storage: constructing and destroying the node is up to the caller.
+*/
+template <class Node>
+class NodePool
+{
+    private:
+
+        union Slot;
+        struct Chunk;
+
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! The node type this pool hands out */
+        typedef Node node_type;
+
+        /*! The nodes link to each other by pointer */
+        typedef Node* link_type;
+
+        /*! The whole storage can be dropped at once by release() */
+        static const bool releasesAll = true;
+
+        /*! The chunks can be copied as they are (see copy()) */
+        static const bool copiesArena = true;
+
+        /*! A node belongs to the pool that handed it out */
+        static const bool sharesNodes = false;
+
+        /*! Freed slots not yet given back to the pool */
+        struct FreeChain
+        {
+            FreeChain( void ) : head(NULL), tail(NULL) { /*! empty */ }
+
+            Slot*   head;
+            Slot*   tail;
+        };
+
+        /*! Maps a node of the copied pool to its copy (binary search on the chunk addresses) */
+        class Relocation
+        {
+            public:
+
+                /*! The copies live at other addresses */
+                static const bool moves = true;
+
+                /*! Copy of the node l points to (NULL stays NULL) */
+                Node* operator () ( Node* l ) const;
+
+            private:
+
+                /*! A copied chunk: [begin, end) went to target */
+                struct Range
+                {
+                    const Slot*     begin;
+                    const Slot*     end;
+                    Slot*           target;
+
+                    bool operator < ( const Range& rhs ) const { return less<const Slot*>()(begin, rhs.begin); }
+                };
+
+                vector<Range>   m_ranges;   //!< sorted by begin
+
+                friend class NodePool;
+        };
+
+        /*! Class constructor */
+        NodePool( size_t firstChunk = 16, size_t maxChunk = 4096 );
+
+        /*! Class destructor to release every chunk */
+        ~NodePool();
+
+        /*! Hands out raw storage for one node. Could throws a bad_alloc exception */
+        Node* allocate( void );
+
+        /*! Gives the node storage back to the pool (free list) */
+        void deallocate( Node* nodePtr );
+
+        /*! A link is the node pointer itself */
+        Node* node( Node* l ) const { return l; }
+        Node* link( const Node* nodePtr ) const { return const_cast<Node*>( nodePtr ); }
+
+        /*! The next n allocations come from one contiguous block (no deallocate in between) */
+        void reserve( size_t n );
+
+        /*! Frees all the chunks at once. Every node handed out becomes invalid */
+        void release( void );
+
+        /*! Number of chunks currently held */
+        size_t chunks( void ) const { return m_chunks.size(); }
+
+        /*! Number of slots in the chunks (used, free and untouched) */
+        size_t capacity( void ) const;
+
+        /*! Replaces the storage with a byte copy of other's chunks (every slot, same free list).
+         *  Node must be trivially copyable; the links of the copied nodes still point to other's,
+         *  the returned Relocation maps them. workers copy the chunks in parallel (NULL: here).
+         *  Could throws a bad_alloc exception (the pool is then empty)
+        */
+        Relocation copy( const NodePool& other, ThreadPool* workers = NULL );
+
+        /*! Free chains: chain() frees the slot of a destroyed node into c without touching the
+         *  pool (any thread can do it), join() appends o to c and deallocate() gives c back
+        */
+        void chain( FreeChain& c, Node* nodePtr ) const;
+        void join( FreeChain& c, const FreeChain& o ) const;
+        void deallocate( const FreeChain& c );
+
+        /*! Exchanges the storage of both pools */
+        void swap( NodePool& other ) noexcept;
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! A free slot overlaps the node storage with the free list link */
+        union Slot
+        {
+            Slot* next;
+            alignas(Node) unsigned char storage[ sizeof(Node) ];
+        };
+
+        /*! A block of slots */
+        struct Chunk
+        {
+            Slot*   slots;
+            size_t  size;
+        };
+
+        /*! Creates a chunk with n slots and makes it the current one */
+        void newChunk( size_t n );
+
+        /*! The pool owns its chunks, so it can't be copied */
+        NodePool( const NodePool& );
+        NodePool& operator = ( const NodePool& );
+
+        /*! Basic members */
+        vector<Chunk>   m_chunks;       //!< every chunk allocated so far
+        Slot*           m_freeList;     //!< recycled slots
+        Slot*           m_next;         //!< next untouched slot of the current chunk
+        Slot*           m_end;          //!< one past the last slot of the current chunk
+        size_t          m_chunkSize;    //!< size of the next chunk (in nodes)
+        size_t          m_firstChunk;   //!< size of the first chunk (in nodes)
+        size_t          m_maxChunk;     //!< chunk size limit (in nodes)
+};
+
+/*! Plain heap allocator: one new/delete per node (the behaviour before the pool).
+ *  Useful to compare against the pool or when nodes must outlive the tree's storage.
+*/
+template <class Node>
+class HeapNodeAllocator
+{
+    public:
+
+        /*! The node type this allocator hands out */
+        typedef Node node_type;
+
+        /*! The nodes link to each other by pointer */
+        typedef Node* link_type;
+
+        /*! Every node must be deallocated one by one */
+        static const bool releasesAll = false;
+
+        /*! The nodes are copied one by one */
+        static const bool copiesArena = false;
+
+        /*! Any allocator can give back a node another one handed out, so trees can take over
+         *  each other's nodes (see RedBlackTree::split_at)
+        */
+        static const bool sharesNodes = true;
+
+        /*! The heap is thread safe, so the freed nodes are given back right away */
+        struct FreeChain { /*! empty */ };
+
+        /*! No arena to copy (copiesArena is false), the type only completes the interface */
+        class Relocation
+        {
+            public:
+
+                static const bool moves = false;
+
+                Node* operator () ( Node* l ) const { return l; }
+        };
+
+        /*! Hands out raw storage for one node. Could throws a bad_alloc exception */
+        Node* allocate( void ) { return static_cast<Node*>( ::operator new( sizeof(Node) ) ); }
+
+        /*! Gives the node storage back to the heap */
+        void deallocate( Node* nodePtr ) { ::operator delete( nodePtr ); }
+
+        /*! A link is the node pointer itself */
+        Node* node( Node* l ) const { return l; }
+        Node* link( const Node* nodePtr ) const { return const_cast<Node*>( nodePtr ); }
+
+        /*! Nothing to do, every node is a separate block */
+        void reserve( size_t ) { /*! empty */ }
+
+        /*! No slot is held beyond the nodes in use */
+        size_t capacity( void ) const { return 0; }
+
+        /*! Nothing to do, the nodes were already given back */
+        void release( void ) { /*! empty */ }
+
+        /*! Free chains: the storage goes back to the heap at once */
+        void chain( FreeChain&, Node* nodePtr ) const { ::operator delete( nodePtr ); }
+        void join( FreeChain&, const FreeChain& ) const { /*! empty */ }
+        void deallocate( const FreeChain& ) { /*! empty */ }
+
+        /*! Nothing to exchange */
+        void swap( HeapNodeAllocator& ) noexcept { /*! empty */ }
+};
+
+/*! Index pool: the nodes link to each other by 32 bit indices instead of pointers, which
+ *  halves the links (see IndexedRBTreeNode). Index i lives in chunk i >> ChunkBits, at slot
+ *  i & (2^ChunkBits - 1); the chunks never move, so a node pointer stays valid while the
+ *  node lives. Resolving a link costs a chunk table lookup; the node keeps its own index
+ *  for the way back (Node::index()).
+ *  Like NodePool, fresh slots are handed out before the free list, and at most
+ *  MaxNodes nodes are available (the top index bit is left to the node).
+*/
+template <class Node, unsigned ChunkBits = 10>
+class IndexNodePool
+{
+    public:
+
+        /*! The node type this pool hands out */
+        typedef Node node_type;
+
+        /*! The nodes link to each other by index */
+        typedef uint32_t link_type;
+
+        /*! The whole storage can be dropped at once by release() */
+        static const bool releasesAll = true;
+
+        /*! The chunks can be copied as they are (see copy()) */
+        static const bool copiesArena = true;
+
+        /*! A node belongs to the pool that handed it out */
+        static const bool sharesNodes = false;
+
+        /*! Freed slots not yet given back to the pool */
+        struct FreeChain
+        {
+            FreeChain( void ) : head(~uint32_t(0)), tail(~uint32_t(0)) { /*! empty */ }
+
+            uint32_t    head;
+            uint32_t    tail;
+        };
+
+        /*! The links are indices, so a copied node links to the copies as it is */
+        class Relocation
+        {
+            public:
+
+                static const bool moves = false;
+
+                link_type operator () ( link_type l ) const { return l; }
+        };
+
+        /*! Nodes per chunk and index limit */
+        static const uint32_t ChunkSize = uint32_t(1) << ChunkBits;
+        static const uint32_t MaxNodes = uint32_t(1) << 31;
+
+        /*! Class constructor */
+        IndexNodePool( void );
+
+        /*! Class destructor to release every chunk */
+        ~IndexNodePool();
+
+        /*! Hands out raw storage for one node (its index). Could throws a bad_alloc exception */
+        link_type allocate( void );
+
+        /*! Gives the node storage back to the pool (free list) */
+        void deallocate( link_type l );
+
+        /*! The next n allocations take fresh slots, in index order (no deallocate in between) */
+        void reserve( size_t n );
+
+        /*! Frees all the chunks at once. Every node handed out becomes invalid */
+        void release( void );
+
+        /*! Number of chunks currently held */
+        size_t chunks( void ) const { return m_chunks.size(); }
+
+        /*! Number of slots in the chunks (used, free and untouched) */
+        size_t capacity( void ) const { return m_chunks.size() * ChunkSize; }
+
+        /*! Replaces the storage with a byte copy of other's chunks (see NodePool::copy()) */
+        Relocation copy( const IndexNodePool& other, ThreadPool* workers = NULL );
+
+        /*! Free chains (see NodePool) */
+        void chain( FreeChain& c, link_type l ) const;
+        void join( FreeChain& c, const FreeChain& o ) const;
+        void deallocate( const FreeChain& c );
+
+        /*! Exchanges the storage of both pools */
+        void swap( IndexNodePool& other ) noexcept;
+
+        /*! Index to node and back */
+        Node* node( link_type l ) const { return reinterpret_cast<Node*>( m_chunks[l >> ChunkBits] + (l & (ChunkSize - 1)) ); }
+        link_type link( const Node* nodePtr ) const { return nodePtr->index(); }
+
+    private:
+
+        /*! A free slot overlaps the node storage with the free list link */
+        union Slot
+        {
+            uint32_t next;
+            alignas(Node) unsigned char storage[ sizeof(Node) ];
+        };
+
+        /*! Free list end */
+        static const uint32_t NoSlot = ~uint32_t(0);
+
+        /*! Appends a chunk. Could throws a bad_alloc exception */
+        void newChunk( void );
+
+        /*! The pool owns its chunks, so it can't be copied */
+        IndexNodePool( const IndexNodePool& );
+        IndexNodePool& operator = ( const IndexNodePool& );
+
+        /*! Basic members */
+        vector<Slot*>   m_chunks;       //!< chunk table
+        uint32_t        m_freeList;     //!< recycled slots (NoSlot if empty)
+        uint32_t        m_next;         //!< next fresh index
+        size_t          m_reserved;     //!< allocations that must still take fresh slots
+};
+
+#include "NodePool.cpp"
+#endif // NodePool_H
+
+/* ----------------------- [ End of the NodePool.h header ] --------------------- */
+/* ============================================================================== */
@@ -0,0 +1,563 @@
+/*! \file */
+/*! \brief PathCopyTree.cpp.
+ *
+ *  Implements the functions from PathCopyTree class.
+ *  The algorithms follow S. Kahrs, "Red-black trees with types" (insertion
+ *  with the four case balance, deletion through balanceLeft/balanceRight
+ *  and append).
+*/
+
+#include "PathCopyTree.h"
+
+/*!
+ * Insertion function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param root 	=> root of the current version (NULL if empty)
+ * @param v 	=> the value to the new node
+ *
+ * @return => root of the new version
+*/
+template <class Comparable>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::insert( Node* root, const Comparable& v )
+{
+	return recolor( ins(root, v), Node::Black );
+}
+
+/*!
+ * Remove function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param root 		=> root of the current version (NULL if empty)
+ * @param key 		=> value to be removed
+ * @param removed 	=> set to true if a value was removed
+ *
+ * @return => root of the new version
+*/
+template <class Comparable>
+template <class Key>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::remove( Node* root, const Key& key, bool& removed )
+{
+	//! Nothing to copy if the value isn't there
+	removed = ( find(root, key) != NULL );
+
+	if ( !removed )
+		return root;
+
+	Node* nodePtr = del(root, key);
+
+	return ( nodePtr != NULL ) ? recolor( nodePtr, Node::Black ) : NULL;
+}
+
+/*!
+ * Commit function
+ * the nodes of the old version that the new one doesn't share are the ones
+ * above the shared sub trees: the children of the added nodes that weren't
+ * added themselves (or newRoot, if nothing was)
+ *
+ * @param oldRoot 	=> root of the version the update started from
+ * @param newRoot 	=> root of the new version
+ * @param dropped 	=> receives the old nodes the new version doesn't use
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PathCopyTree<Comparable>::commit( Node* oldRoot, Node* newRoot, vector<Node*>& dropped )
+{
+	vector<Node*> added;
+	vector<Node*> shared;
+
+	commit(newRoot, added);
+	sort(added.begin(), added.end());
+
+	if ( newRoot != NULL && !binary_search(added.begin(), added.end(), newRoot) )
+		shared.push_back(newRoot);
+
+	for ( size_t i = 0; i < added.size(); i++ )
+	{
+		Node* children[2] = { added[i]->left, added[i]->right };
+
+		for ( int j = 0; j < 2; j++ )
+			if ( children[j] != NULL && !binary_search(added.begin(), added.end(), children[j]) )
+				shared.push_back(children[j]);
+	}
+
+	//! Old nodes above the shared sub trees
+	sort(shared.begin(), shared.end());
+
+	vector<Node*> stack;
+
+	if ( oldRoot != NULL )
+		stack.push_back(oldRoot);
+
+	while ( !stack.empty() )
+	{
+		Node* nodePtr = stack.back();
+		stack.pop_back();
+
+		if ( binary_search(shared.begin(), shared.end(), nodePtr) )
+			continue;
+
+		dropped.push_back(nodePtr);
+
+		if ( nodePtr->left != NULL )
+			stack.push_back(nodePtr->left);
+		if ( nodePtr->right != NULL )
+			stack.push_back(nodePtr->right);
+	}
+}
+
+/*!
+ * Commit function
+ * walks the fresh part of the new version (the walk stops at the nodes it
+ * shares with older versions); the fresh nodes the walk didn't reach were
+ * only temporary and go back to the pool
+ *
+ * @param newRoot 	=> root of the new version
+ * @param added 	=> receives the fresh nodes of the new version
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PathCopyTree<Comparable>::commit( Node* newRoot, vector<Node*>& added )
+{
+	size_t first = added.size();
+
+	if ( newRoot != NULL && newRoot->state == Node::Fresh )
+	{
+		newRoot->state = Node::Shared;
+		added.push_back(newRoot);
+	}
+
+	//! added doubles as the walk queue
+	for ( size_t i = first; i < added.size(); i++ )
+	{
+		Node* children[2] = { added[i]->left, added[i]->right };
+
+		for ( int j = 0; j < 2; j++ )
+		{
+			if ( children[j] != NULL && children[j]->state == Node::Fresh )
+			{
+				children[j]->state = Node::Shared;
+				added.push_back(children[j]);
+			}
+		}
+	}
+
+	//! Temporary nodes
+	for ( size_t i = 0; i < m_fresh.size(); i++ )
+		if ( m_fresh[i]->state == Node::Fresh )
+			release(m_fresh[i]);
+
+	m_fresh.clear();
+}
+
+/*!
+ * Rollback function
+ * frees every node built by the running update (after an exception)
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PathCopyTree<Comparable>::rollback( void )
+{
+	for ( size_t i = 0; i < m_fresh.size(); i++ )
+		release(m_fresh[i]);
+
+	m_fresh.clear();
+}
+
+/*!
+ * Release function
+ * destroys the node and gives its storage back to the pool
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PathCopyTree<Comparable>::release( Node* nodePtr )
+{
+	nodePtr->~Node();
+	m_pool.deallocate(nodePtr);
+}
+
+/*!
+ * Release all function
+ * frees every node of a tree (no other version may share them)
+ *
+ * @param nodePtr 	=> the sub tree root (pointer)
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PathCopyTree<Comparable>::releaseAll( Node* nodePtr )
+{
+	vector<Node*> stack;
+
+	if ( nodePtr != NULL )
+		stack.push_back(nodePtr);
+
+	while ( !stack.empty() )
+	{
+		nodePtr = stack.back();
+		stack.pop_back();
+
+		if ( nodePtr->left != NULL )
+			stack.push_back(nodePtr->left);
+		if ( nodePtr->right != NULL )
+			stack.push_back(nodePtr->right);
+
+		release(nodePtr);
+	}
+}
+
+/*!
+ * Find function
+ *
+ * @param root 	=> root of a version
+ * @param key 	=> value to be searched
+ *
+ * @return => the first node equal to key, NULL if not found
+*/
+template <class Comparable>
+template <class Key>
+const typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::find( const Node* root, const Key& key )
+{
+	while ( root != NULL )
+	{
+		if ( key < root->value )
+			root = root->left;
+		else if ( root->value < key )
+			root = root->right;
+		else
+			break;
+	}
+
+	return root;
+}
+
+/*!
+ * Count function
+ * only the equal nodes and the search path are visited
+ *
+ * @param root 	=> root of a version
+ * @param key 	=> value to be counted
+ *
+ * @return => number of equal values
+*/
+template <class Comparable>
+template <class Key>
+size_t PathCopyTree<Comparable>::count( const Node* root, const Key& key )
+{
+	size_t total = 0;
+
+	while ( root != NULL )
+	{
+		if ( key < root->value )
+			root = root->left;
+		else if ( root->value < key )
+			root = root->right;
+		else
+		{
+			total += 1 + count(root->left, key);
+			root = root->right;
+		}
+	}
+
+	return total;
+}
+
+/*!
+ * For each function
+ * in-order visit (recursive function calls)
+ *
+ * @param root 	=> root of a version
+ * @param fn 	=> called with every value
+ *
+ * @return => void
+*/
+template <class Comparable>
+template <class Function>
+void PathCopyTree<Comparable>::forEach( const Node* root, Function& fn )
+{
+	if ( root != NULL )
+	{
+		forEach(root->left, fn);
+		fn(root->value);
+		forEach(root->right, fn);
+	}
+}
+
+/*!
+ * Node creation function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param c => node color
+ * @param l => left child 	(pointer)
+ * @param v => node value
+ * @param r => right child 	(pointer)
+ *
+ * @return => the new (fresh) node
+*/
+template <class Comparable>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::make( typename Node::NodeColor c, Node* l,
+																		  const Comparable& v, Node* r )
+{
+	//! Room in the fresh list first, so the node can't be lost
+	m_fresh.push_back(NULL);
+
+	Node* nodePtr = m_pool.allocate();
+
+	try
+	{
+		new (nodePtr) Node(v, l, r, c);
+	}
+	catch ( ... )
+	{
+		m_pool.deallocate(nodePtr);
+		m_fresh.pop_back();
+		throw;
+	}
+
+	m_fresh.back() = nodePtr;
+
+	return nodePtr;
+}
+
+/*!
+ * Recolor function
+ * a fresh node is changed in place, a shared one is copied
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param c 		=> new color
+ *
+ * @return => the node with color c
+*/
+template <class Comparable>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::recolor( Node* nodePtr, typename Node::NodeColor c )
+{
+	if ( nodePtr->color == c )
+		return nodePtr;
+
+	if ( nodePtr->state == Node::Fresh )
+	{
+		nodePtr->color = c;
+		return nodePtr;
+	}
+
+	return make(c, nodePtr->left, nodePtr->value, nodePtr->right);
+}
+
+/*!
+ * Insertion function (recursive function calls)
+ * the red nodes are copied as they are, the black ones go through balance
+ *
+ * @param nodePtr 	=> sub tree root 	(pointer)
+ * @param v 		=> the value to the new node
+ *
+ * @return => the new sub tree root (its root may be red with a red child)
+*/
+template <class Comparable>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::ins( Node* nodePtr, const Comparable& v )
+{
+	if ( nodePtr == NULL )
+		return make(Node::Red, NULL, v, NULL);
+
+	//! Equal values go to the left
+	if ( !(nodePtr->value < v) )
+	{
+		if ( nodePtr->color == Node::Black )
+			return balance( ins(nodePtr->left, v), nodePtr->value, nodePtr->right );
+
+		return make( Node::Red, ins(nodePtr->left, v), nodePtr->value, nodePtr->right );
+	}
+
+	if ( nodePtr->color == Node::Black )
+		return balance( nodePtr->left, nodePtr->value, ins(nodePtr->right, v) );
+
+	return make( Node::Red, nodePtr->left, nodePtr->value, ins(nodePtr->right, v) );
+}
+
+/*!
+ * Balance function
+ * builds a black node from l, v and r, fixing a red-red violation below it
+ *
+ * @param l => left sub tree 	(pointer)
+ * @param v => node value
+ * @param r => right sub tree 	(pointer)
+ *
+ * @return => the new sub tree root
+*/
+template <class Comparable>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::balance( Node* l, const Comparable& v, Node* r )
+{
+	//! Both red: push the red up
+	if ( isRed(l) && isRed(r) )
+		return make( Node::Red, recolor(l, Node::Black), v, recolor(r, Node::Black) );
+
+	if ( isRed(l) )
+	{
+		//! Left left case
+		if ( isRed(l->left) )
+			return make( Node::Red, recolor(l->left, Node::Black), l->value,
+						 make(Node::Black, l->right, v, r) );
+
+		//! Left right case
+		if ( isRed(l->right) )
+			return make( Node::Red, make(Node::Black, l->left, l->value, l->right->left), l->right->value,
+						 make(Node::Black, l->right->right, v, r) );
+	}
+
+	if ( isRed(r) )
+	{
+		//! Right right case
+		if ( isRed(r->right) )
+			return make( Node::Red, make(Node::Black, l, v, r->left), r->value,
+						 recolor(r->right, Node::Black) );
+
+		//! Right left case
+		if ( isRed(r->left) )
+			return make( Node::Red, make(Node::Black, l, v, r->left->left), r->left->value,
+						 make(Node::Black, r->left->right, r->value, r->right) );
+	}
+
+	return make(Node::Black, l, v, r);
+}
+
+/*!
+ * Balance left function
+ * l lost one black level (a removal below it): restore the black height
+ *
+ * @param l => left sub tree 	(pointer)
+ * @param v => node value
+ * @param r => right sub tree 	(pointer)
+ *
+ * @return => the new sub tree root
+*/
+template <class Comparable>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::balanceLeft( Node* l, const Comparable& v, Node* r )
+{
+	if ( isRed(l) )
+		return make( Node::Red, recolor(l, Node::Black), v, r );
+
+	if ( isBlack(r) )
+		return balance( l, v, recolor(r, Node::Red) );
+
+	//! r is red with a black left child
+	assert( isRed(r) && isBlack(r->left) );
+
+	Node* nearPtr = r->left;
+
+	return make( Node::Red, make(Node::Black, l, v, nearPtr->left), nearPtr->value,
+				 balance( nearPtr->right, r->value, recolor(r->right, Node::Red) ) );
+}
+
+/*!
+ * Balance right function
+ * r lost one black level (a removal below it): restore the black height
+ *
+ * @param l => left sub tree 	(pointer)
+ * @param v => node value
+ * @param r => right sub tree 	(pointer)
+ *
+ * @return => the new sub tree root
+*/
+template <class Comparable>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::balanceRight( Node* l, const Comparable& v, Node* r )
+{
+	if ( isRed(r) )
+		return make( Node::Red, l, v, recolor(r, Node::Black) );
+
+	if ( isBlack(l) )
+		return balance( recolor(l, Node::Red), v, r );
+
+	//! l is red with a black right child
+	assert( isRed(l) && isBlack(l->right) );
+
+	Node* nearPtr = l->right;
+
+	return make( Node::Red, balance( recolor(l->left, Node::Red), l->value, nearPtr->left ), nearPtr->value,
+				 make(Node::Black, nearPtr->right, v, r) );
+}
+
+/*!
+ * Append function
+ * joins the two children of a removed node (recursive function calls)
+ *
+ * @param l => left sub tree 	(pointer)
+ * @param r => right sub tree 	(pointer)
+ *
+ * @return => the joined sub tree
+*/
+template <class Comparable>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::append( Node* l, Node* r )
+{
+	if ( l == NULL )
+		return r;
+
+	if ( r == NULL )
+		return l;
+
+	if ( isRed(l) && isRed(r) )
+	{
+		Node* middle = append(l->right, r->left);
+
+		if ( isRed(middle) )
+			return make( Node::Red, make(Node::Red, l->left, l->value, middle->left), middle->value,
+						 make(Node::Red, middle->right, r->value, r->right) );
+
+		return make( Node::Red, l->left, l->value, make(Node::Red, middle, r->value, r->right) );
+	}
+
+	if ( isBlack(l) && isBlack(r) )
+	{
+		Node* middle = append(l->right, r->left);
+
+		if ( isRed(middle) )
+			return make( Node::Red, make(Node::Black, l->left, l->value, middle->left), middle->value,
+						 make(Node::Black, middle->right, r->value, r->right) );
+
+		return balanceLeft( l->left, l->value, make(Node::Black, middle, r->value, r->right) );
+	}
+
+	if ( isRed(r) )
+		return make( Node::Red, append(l, r->left), r->value, r->right );
+
+	return make( Node::Red, l->left, l->value, append(l->right, r) );
+}
+
+/*!
+ * Deletion function (recursive function calls)
+ * the key must be in the tree
+ *
+ * @param nodePtr 	=> sub tree root 	(pointer)
+ * @param key 		=> value to be removed
+ *
+ * @return => the new sub tree root
+*/
+template <class Comparable>
+template <class Key>
+typename PathCopyTree<Comparable>::Node* PathCopyTree<Comparable>::del( Node* nodePtr, const Key& key )
+{
+	if ( nodePtr == NULL )
+		return NULL;
+
+	if ( key < nodePtr->value )
+	{
+		if ( isBlack(nodePtr->left) )
+			return balanceLeft( del(nodePtr->left, key), nodePtr->value, nodePtr->right );
+
+		return make( Node::Red, del(nodePtr->left, key), nodePtr->value, nodePtr->right );
+	}
+
+	if ( nodePtr->value < key )
+	{
+		if ( isBlack(nodePtr->right) )
+			return balanceRight( nodePtr->left, nodePtr->value, del(nodePtr->right, key) );
+
+		return make( Node::Red, nodePtr->left, nodePtr->value, del(nodePtr->right, key) );
+	}
+
+	return append(nodePtr->left, nodePtr->right);
+}
@@ -0,0 +1,170 @@
+/*!
+    <PRE>
+        SOURCE FILE : PathCopyTree.h
+        DESCRIPTION.: Red black tree algorithms on immutable nodes (path copying).
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Functional insertion/removal and commit (fresh/dropped nodes) implemented.
+                      Reference count for the persistent versions.
+
+        TO COMPILE..: Use makefile.
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef PathCopyTree_H_
+#define PathCopyTree_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include "NodePool.h"
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// Node* insert( Node* root, const Comparable& v )              --> New version with v added
+// Node* remove( Node* root, const Key& key, bool& removed )    --> New version without one key
+// void commit( Node* oldRoot, Node* newRoot, vector<Node*>& dropped ) --> Ends an update
+// void commit( Node* newRoot, vector<Node*>& added )           --> Ends an update (new nodes only)
+// void rollback( void )                                        --> Frees the nodes of a failed update
+// void release( Node* nodePtr )                                --> Gives a node back to the pool
+// void releaseAll( Node* nodePtr )                             --> Frees a whole tree
+// static const Node* find( const Node* root, const Key& key )  --> Search function
+// static size_t count( const Node* root, const Key& key )      --> Number of equal values
+// static void forEach( const Node* root, Function fn )         --> In-order visit
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed.
+
+/*! Node of a path copied tree. Once it is reachable from a published root it never changes;
+ *  a new version copies the nodes on the changed paths and shares the rest.
+ *  The empty tree (and every leaf link) is NULL
+*/
+template <class Comparable>
+struct PathCopyNode
+{
+    /*! Enum to define the node color */
+    enum NodeColor {Red, Black};
+
+    /*! Created by the running update (fresh nodes can still be changed in place) */
+    enum NodeState {Shared, Fresh};
+
+    /*! Basic members */
+    Comparable      value;
+    PathCopyNode    *left;
+    PathCopyNode    *right;
+    unsigned char   color;
+    unsigned char   state;
+    uint32_t        refs;       //!< parents and version handles (only counted by PersistentRedBlackTree)
+
+    /*! Node constructor */
+    PathCopyNode( const Comparable& v, PathCopyNode *l, PathCopyNode *r, NodeColor c )
+        : value(v), left(l), right(r), color(c), state(Fresh), refs(0) //!< initialize the basic members
+    {
+        /*! empty */
+    }
+};
+
+/*! Functional red black tree (Kahrs' insertion and deletion): an update never writes to a node
+ *  of an older version, it builds the changed paths from new nodes and returns the new root.
+ *  An update may run several insert()/remove() calls in a row; commit() then tells the nodes of
+ *  the old version the new one dropped (the owner frees them when no reader can see them any
+ *  more) and frees the nodes built along the way that didn't make it into the new version.
+ *  Not thread safe: the owner serializes the updates, the static lookups can run anywhere.
+*/
+template <class Comparable>
+class PathCopyTree
+{
+    /*!
+     * Public section
+    */
+    public:
+
+        typedef PathCopyNode<Comparable> Node;
+
+        /*! Class constructor */
+        PathCopyTree( void ) { /*! empty */ }
+
+        /*! New version with v added (equal values go to the left, like RedBlackTree) */
+        Node* insert( Node* root, const Comparable& v );
+
+        /*! New version without one value equal to key (root itself if there is none) */
+        template <class Key>
+        Node* remove( Node* root, const Key& key, bool& removed );
+
+        /*! Ends an update: fills dropped with the nodes of oldRoot that newRoot doesn't share,
+         *  frees the unused fresh nodes and marks the rest of them as shared
+        */
+        void commit( Node* oldRoot, Node* newRoot, vector<Node*>& dropped );
+
+        /*! Ends an update without looking at the old version: fills added with the fresh nodes
+         *  newRoot uses (they become shared) and frees the other fresh nodes
+        */
+        void commit( Node* newRoot, vector<Node*>& added );
+
+        /*! Frees every node built since the last commit (after an exception the old root is still valid) */
+        void rollback( void );
+
+        /*! Gives a node back to the pool */
+        void release( Node* nodePtr );
+
+        /*! Frees every node of the tree rooted at nodePtr */
+        void releaseAll( Node* nodePtr );
+
+        /*! Search functions (any Key comparable with Comparable through '<') */
+        template <class Key>
+        static const Node* find( const Node* root, const Key& key );
+
+        template <class Key>
+        static size_t count( const Node* root, const Key& key );
+
+        /*! Calls fn(value) for every value, in order */
+        template <class Function>
+        static void forEach( const Node* root, Function& fn );
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! Builds a fresh node */
+        Node* make( typename Node::NodeColor c, Node* l, const Comparable& v, Node* r );
+
+        /*! Color tests (the NULL leaf is black, but it isn't a black node) */
+        static bool isRed( const Node* nodePtr ) { return nodePtr != NULL && nodePtr->color == Node::Red; }
+        static bool isBlack( const Node* nodePtr ) { return nodePtr != NULL && nodePtr->color == Node::Black; }
+
+        /*! The same node with the given color (changed in place if fresh) */
+        Node* recolor( Node* nodePtr, typename Node::NodeColor c );
+
+        /*! Kahrs' algorithms */
+        Node* ins( Node* nodePtr, const Comparable& v );
+        Node* balance( Node* l, const Comparable& v, Node* r );
+        Node* balanceLeft( Node* l, const Comparable& v, Node* r );
+        Node* balanceRight( Node* l, const Comparable& v, Node* r );
+        Node* append( Node* l, Node* r );
+
+        template <class Key>
+        Node* del( Node* nodePtr, const Key& key );
+
+        /*! The pool owns the nodes, so it can't be copied */
+        PathCopyTree( const PathCopyTree& );
+        PathCopyTree& operator = ( const PathCopyTree& );
+
+        /*! Basic members */
+        NodePool<Node>  m_pool;     //!< node storage
+        vector<Node*>   m_fresh;    //!< nodes built by the running update
+};
+
+#include "PathCopyTree.cpp"
+#endif // PathCopyTree_H
+
+/* ---------------------- [ End of the PathCopyTree.h header ] ---------------------- */
+/* ================================================================================== */
@@ -0,0 +1,258 @@
+/*! \file */
+/*! \brief PersistentRedBlackTree.cpp.
+ *
+ *  Implements the functions from PersistentRedBlackTree class.
+*/
+
+#include "PersistentRedBlackTree.h"
+
+/*!
+ * Class constructor
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @return => void
+*/
+template <class Comparable>
+PersistentRedBlackTree<Comparable>::PersistentRedBlackTree( void )
+{
+	m_version.m_store = make_shared<Store>();
+}
+
+/*!
+ * Assignment operator
+ * this tree drops its version and shares the other one
+ *
+ * @param other => the tree to be shared
+ *
+ * @return => the tree itself
+*/
+template <class Comparable>
+PersistentRedBlackTree<Comparable>& PersistentRedBlackTree<Comparable>::operator = ( const PersistentRedBlackTree& other )
+{
+	m_version = other.m_version;
+
+	return *this;
+}
+
+/*!
+ * Insertion function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param v => the value to the new node
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PersistentRedBlackTree<Comparable>::insert( const Comparable& v )
+{
+	Store& store = *m_version.m_store;
+	lock_guard<mutex> lock(store.lock);
+
+	Node* newRoot;
+
+	try
+	{
+		newRoot = store.engine.insert(m_version.m_root, v);
+	}
+	catch ( ... )
+	{
+		store.engine.rollback();
+		throw;
+	}
+
+	publish( newRoot, m_version.m_size + 1 );
+}
+
+/*!
+ * Remove function
+ *
+ * @param key => value to be removed
+ *
+ * @return => true if a value was removed
+*/
+template <class Comparable>
+template <class Key>
+bool PersistentRedBlackTree<Comparable>::remove( const Key& key )
+{
+	Store& store = *m_version.m_store;
+	lock_guard<mutex> lock(store.lock);
+
+	Node* newRoot;
+	bool removed = false;
+
+	try
+	{
+		newRoot = store.engine.remove(m_version.m_root, key, removed);
+	}
+	catch ( ... )
+	{
+		store.engine.rollback();
+		throw;
+	}
+
+	if ( removed )
+		publish( newRoot, m_version.m_size - 1 );
+
+	return removed;
+}
+
+/*!
+ * Clear function
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PersistentRedBlackTree<Comparable>::clear( void )
+{
+	lock_guard<mutex> lock(m_version.m_store->lock);
+
+	publish(NULL, 0);
+}
+
+/*!
+ * Find function
+ *
+ * @param key => value to be searched
+ *
+ * @return => pointer to the value stored in the tree, NULL if not found
+*/
+template <class Comparable>
+template <class Key>
+const Comparable* PersistentRedBlackTree<Comparable>::find( const Key& key ) const
+{
+	const Node* nodePtr = PathCopyTree<Comparable>::find(m_version.m_root, key);
+
+	return ( nodePtr != NULL ) ? &nodePtr->value : NULL;
+}
+
+/*!
+ * Find function (snapshot)
+ *
+ * @param key => value to be searched
+ *
+ * @return => pointer to the value (valid while the snapshot lives), NULL if not found
+*/
+template <class Comparable>
+template <class Key>
+const Comparable* PersistentRedBlackTree<Comparable>::Snapshot::find( const Key& key ) const
+{
+	const Node* nodePtr = PathCopyTree<Comparable>::find(m_version.m_root, key);
+
+	return ( nodePtr != NULL ) ? &nodePtr->value : NULL;
+}
+
+/*!
+ * Publish function
+ * the new nodes reference their children and the tree references the new
+ * root before the old root is dropped, so the shared nodes never reach 0
+ *
+ * @param newRoot 	=> root of the new version
+ * @param newSize 	=> number of values of the new version
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PersistentRedBlackTree<Comparable>::publish( Node* newRoot, size_t newSize )
+{
+	Store& store = *m_version.m_store;
+	vector<Node*> added;
+
+	store.engine.commit(newRoot, added);
+	store.adopt(added);
+	store.retain(newRoot);
+	store.drop(m_version.m_root);
+
+	m_version.m_root = newRoot;
+	m_version.m_size = newSize;
+}
+
+/*!
+ * Drop function
+ * releases one reference; a node that loses the last one is freed and
+ * releases its children (recursive function calls, at most the tree height)
+ *
+ * @param nodePtr => the node itself (pointer)
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PersistentRedBlackTree<Comparable>::Store::drop( Node* nodePtr )
+{
+	if ( nodePtr == NULL || --nodePtr->refs != 0 )
+		return;
+
+	drop(nodePtr->left);
+	drop(nodePtr->right);
+
+	engine.release(nodePtr);
+}
+
+/*!
+ * Adopt function
+ *
+ * @param added => fresh nodes of the committed update
+ *
+ * @return => void
+*/
+template <class Comparable>
+void PersistentRedBlackTree<Comparable>::Store::adopt( const vector<Node*>& added )
+{
+	for ( size_t i = 0; i < added.size(); i++ )
+	{
+		retain(added[i]->left);
+		retain(added[i]->right);
+	}
+}
+
+/*!
+ * Version copy constructor
+ *
+ * @param other => the version to be shared
+ *
+ * @return => void
+*/
+template <class Comparable>
+PersistentRedBlackTree<Comparable>::Version::Version( const Version& other )
+	: m_root(other.m_root), m_size(other.m_size), m_store(other.m_store) //!< initialize the basic members
+{
+	if ( m_root != NULL )
+	{
+		lock_guard<mutex> lock(m_store->lock);
+		m_store->retain(m_root);
+	}
+}
+
+/*!
+ * Version assignment operator
+ *
+ * @param other => the version to be shared
+ *
+ * @return => the version itself
+*/
+template <class Comparable>
+typename PersistentRedBlackTree<Comparable>::Version& PersistentRedBlackTree<Comparable>::Version::operator = ( const Version& other )
+{
+	//! The copy holds other's root, the old one goes with it
+	Version copy(other);
+
+	swap(m_root, copy.m_root);
+	swap(m_size, copy.m_size);
+	swap(m_store, copy.m_store);
+
+	return *this;
+}
+
+/*!
+ * Version destructor
+ *
+ * @return => void
+*/
+template <class Comparable>
+PersistentRedBlackTree<Comparable>::Version::~Version()
+{
+	if ( m_root != NULL )
+	{
+		lock_guard<mutex> lock(m_store->lock);
+		m_store->drop(m_root);
+	}
+}
@@ -0,0 +1,197 @@
+/*!
+    <PRE>
+        SOURCE FILE : PersistentRedBlackTree.h
+        DESCRIPTION.: Red black tree with O(1) snapshots (structural sharing).
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Versions by path copying, snapshots and reference counted nodes implemented.
+
+        TO COMPILE..: Use makefile.
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef PersistentRedBlackTree_H_
+#define PersistentRedBlackTree_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "PathCopyTree.h"
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// PersistentRedBlackTree( void )                               --> Class constructor
+// PersistentRedBlackTree( const PersistentRedBlackTree& )      --> Copy constructor, O(1)
+// const PersistentRedBlackTree& operator                       --> Assignment operator, O(1)
+// ~PersistentRedBlackTree()                                    --> Class destructor
+// void insert( const Comparable& v )                           --> Insertion function, O(log n) copies
+// bool remove( const Key& key )                                --> Remove function, O(log n) copies
+// void clear( void )                                           --> Remove every value
+// Snapshot snapshot( void ) const                              --> Read only handle to this version, O(1)
+// size_t size( void ) const / bool empty( void ) const         --> Number of values
+// bool contains( const Key& key ) const                        --> Search function
+// const Comparable* find( const Key& key ) const               --> Search function (NULL if not found)
+// size_t count( const Key& key ) const                         --> Number of equal values
+// void for_each( Function fn ) const                           --> In-order visit
+//
+// Snapshot: size, empty, contains, find, count and for_each, as above.
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed (a failed update leaves the tree as it was).
+
+/*! Red black tree whose versions share structure.
+ *  Every insert()/remove() builds a new version by copying the O(log n) nodes on the changed path
+ *  (PathCopyTree) and shares the rest with the previous version. snapshot() and the copy
+ *  constructor are O(1): they just keep a reference to the current root, and that version stays
+ *  valid and unchanged whatever happens to the tree afterwards.
+ *
+ *  A node counts its references (parents and version handles); it is freed, with whatever
+ *  only it kept alive, when the last one goes. Trees and snapshots copied from each other
+ *  share one node store, whose mutex serializes the updates and the reference changes, so a
+ *  snapshot can be read and dropped in any thread while the tree keeps changing.
+ *  A single tree (or snapshot) object isn't thread safe.
+*/
+template <class Comparable>
+class PersistentRedBlackTree
+{
+    /*!
+     * Private types (used by the public section)
+    */
+    private:
+
+        typedef typename PathCopyTree<Comparable>::Node Node;
+
+        /*! Node store shared by a tree, its copies and its snapshots */
+        struct Store
+        {
+            PathCopyTree<Comparable>    engine;     //!< path copying and node storage
+            mutex                       lock;       //!< updates and reference counts
+
+            /*! Reference changes (under lock). drop() frees what only nodePtr kept alive */
+            void retain( Node* nodePtr ) { if ( nodePtr != NULL ) nodePtr->refs++; }
+            void drop( Node* nodePtr );
+
+            /*! Takes the fresh nodes of a committed update: they reference their children */
+            void adopt( const vector<Node*>& added );
+        };
+
+        /*! A version: a counted reference to its root */
+        struct Version
+        {
+            Version( void ) : m_root(NULL), m_size(0) { /*! empty */ }
+            Version( const Version& other );
+            Version& operator = ( const Version& other );
+            ~Version();
+
+            Node*               m_root;     //!< root of the version (NULL if empty)
+            size_t              m_size;     //!< number of values
+            shared_ptr<Store>   m_store;    //!< where the nodes live (NULL for an empty snapshot)
+        };
+
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! Read only handle to one version of the tree */
+        class Snapshot
+        {
+            public:
+
+                /*! Empty snapshot */
+                Snapshot( void ) { /*! empty */ }
+
+                size_t size( void ) const { return m_version.m_size; }
+                bool empty( void ) const { return m_version.m_size == 0; }
+
+                template <class Key>
+                bool contains( const Key& key ) const { return find(key) != NULL; }
+
+                template <class Key>
+                const Comparable* find( const Key& key ) const;
+
+                template <class Key>
+                size_t count( const Key& key ) const { return PathCopyTree<Comparable>::count(m_version.m_root, key); }
+
+                template <class Function>
+                void for_each( Function fn ) const { PathCopyTree<Comparable>::forEach(m_version.m_root, fn); }
+
+            private:
+
+                explicit Snapshot( const Version& version ) : m_version(version) { /*! empty */ }
+
+                Version     m_version;  //!< the version kept alive
+
+                friend class PersistentRedBlackTree;
+        };
+
+        /*! Class constructor to create an empty tree */
+        PersistentRedBlackTree( void );
+
+        /*! Copy constructor and assignment: both trees share the nodes from now on, O(1) */
+        PersistentRedBlackTree( const PersistentRedBlackTree& other ) : m_version(other.m_version) { /*! empty */ }
+        PersistentRedBlackTree& operator = ( const PersistentRedBlackTree& other );
+
+        /*! Class destructor (the snapshots stay valid) */
+        ~PersistentRedBlackTree() { /*! empty */ }
+
+        /*! Insertion function (equal values go to the left). Could throws a bad_alloc exception */
+        void insert( const Comparable& v );
+
+        /*! Removes one value equal to key. Returns false if there is none */
+        template <class Key>
+        bool remove( const Key& key );
+
+        /*! Remove every value (the nodes still used by snapshots stay) */
+        void clear( void );
+
+        /*! O(1) read only handle to the current version */
+        Snapshot snapshot( void ) const { return Snapshot(m_version); }
+
+        /*! Number of values */
+        size_t size( void ) const { return m_version.m_size; }
+
+        /*! Check if there is no value */
+        bool empty( void ) const { return m_version.m_size == 0; }
+
+        /*! Search functions (any Key comparable with Comparable through '<') */
+        template <class Key>
+        bool contains( const Key& key ) const { return find(key) != NULL; }
+
+        template <class Key>
+        const Comparable* find( const Key& key ) const;
+
+        template <class Key>
+        size_t count( const Key& key ) const { return PathCopyTree<Comparable>::count(m_version.m_root, key); }
+
+        /*! Calls fn(value) for every value, in order */
+        template <class Function>
+        void for_each( Function fn ) const { PathCopyTree<Comparable>::forEach(m_version.m_root, fn); }
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! Ends an update: the new version replaces the current one (store lock held) */
+        void publish( Node* newRoot, size_t newSize );
+
+        /*! Basic members */
+        Version     m_version;  //!< current version
+
+        /*! Checks the invariants in the tests (see test/TestUtil.h) */
+        friend struct TreeValidator;
+};
+
+#include "PersistentRedBlackTree.cpp"
+#endif // PersistentRedBlackTree_H
+
+/* ------------------ [ End of the PersistentRedBlackTree.h header ] ------------------ */
+/* ==================================================================================== */
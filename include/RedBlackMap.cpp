@@ -0,0 +1,260 @@
+/*! \file */
+/*! \brief RedBlackMap.cpp.
+ *
+ *  Implements the functions from RedBlackMap class.
+*/
+
+#include "RedBlackMap.h"
+
+/*!
+ * Move constructor
+ * takes the keys and values of old (old is left empty)
+ *
+ * @param old => the map to be moved
+ *
+ * @return => void
+*/
+template <class Key, class Value, class Allocator>
+RedBlackMap<Key, Value, Allocator>::RedBlackMap( RedBlackMap&& old ) noexcept
+	: m_tree( std::move(old.m_tree) ) //!< takes the tree of keys
+{
+	m_values.swap(old.m_values);
+}
+
+/*!
+ * Move assignment operator
+ *
+ * @param rhs => the map to be moved (left empty)
+ *
+ * @return => current map object
+*/
+template <class Key, class Value, class Allocator>
+const RedBlackMap<Key, Value, Allocator>& RedBlackMap<Key, Value, Allocator>::operator=( RedBlackMap&& rhs ) noexcept
+{
+	//! Check if the reference pointer it's a self assignment
+	if ( this != &rhs )
+	{
+		//! The current keys go first, so rhs gets an empty map back
+		clear();
+		swap(rhs);
+	}
+
+	return *this; // return current map object
+}
+
+/*!
+ * Class destructor
+ * destroys the values, the pools release their chunks
+ *
+ * @return => void
+*/
+template <class Key, class Value, class Allocator>
+RedBlackMap<Key, Value, Allocator>::~RedBlackMap()
+{
+	destroyValues();
+}
+
+/*!
+ * Swap function
+ *
+ * @param other => the other map
+ *
+ * @return => void
+*/
+template <class Key, class Value, class Allocator>
+void RedBlackMap<Key, Value, Allocator>::swap( RedBlackMap& other ) noexcept
+{
+	m_tree.swap(other.m_tree);
+	m_values.swap(other.m_values);
+}
+
+/*!
+ * Try emplace function
+ * the value is built in its slot first, then the key goes in the tree
+ * (which searches again, the path is still in cache by then)
+ * it throws a bad_alloc exception if no enough space (nothing is changed)
+ *
+ * @param key 	=> the key
+ * @param args 	=> the value constructor arguments
+ *
+ * @return => the value of key and true if it was inserted
+*/
+template <class Key, class Value, class Allocator>
+template <class K, class... Args>
+pair<Value*, bool> RedBlackMap<Key, Value, Allocator>::try_emplace( K&& key, Args&&... args )
+{
+	//! Already there: the arguments aren't touched
+	const Entry* found = m_tree.find(key);
+
+	if ( found != NULL )
+		return pair<Value*, bool>( valueAt(found->slot), false );
+
+	uint32_t slot = m_values.allocate();
+	Value* valuePtr = valueAt(slot);
+
+	try
+	{
+		new (valuePtr) Value( std::forward<Args>(args)... );
+	}
+	catch ( ... )
+	{
+		m_values.deallocate(slot);
+		throw;
+	}
+
+	try
+	{
+		m_tree.emplace( std::forward<K>(key), slot );
+	}
+	catch ( ... )
+	{
+		valuePtr->~Value();
+		m_values.deallocate(slot);
+		throw;
+	}
+
+	return pair<Value*, bool>( valuePtr, true );
+}
+
+/*!
+ * Insert or assign function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param key 	=> the key
+ * @param v 	=> the value (copied or moved)
+ *
+ * @return => the value of key and true if it was inserted
+*/
+template <class Key, class Value, class Allocator>
+template <class K, class M>
+pair<Value*, bool> RedBlackMap<Key, Value, Allocator>::insert_or_assign( K&& key, M&& v )
+{
+	Value* valuePtr = find(key);
+
+	if ( valuePtr != NULL )
+	{
+		*valuePtr = std::forward<M>(v);
+		return pair<Value*, bool>( valuePtr, false );
+	}
+
+	return try_emplace( std::forward<K>(key), std::forward<M>(v) );
+}
+
+/*!
+ * Erase function
+ *
+ * @param key => the key to be removed
+ *
+ * @return => true if the key was removed
+*/
+template <class Key, class Value, class Allocator>
+template <class K>
+bool RedBlackMap<Key, Value, Allocator>::erase( const K& key )
+{
+	const Entry* found = m_tree.find(key);
+
+	if ( found == NULL )
+		return false;
+
+	uint32_t slot = found->slot;
+
+	//! The tree only compares with the entry before it moves any value, so it can be passed as is
+	m_tree.remove(*found);
+
+	valueAt(slot)->~Value();
+	m_values.deallocate(slot);
+
+	return true;
+}
+
+/*!
+ * Clear function
+ * removes every key, the value slots are dropped at once
+ *
+ * @return => void
+*/
+template <class Key, class Value, class Allocator>
+void RedBlackMap<Key, Value, Allocator>::clear( void )
+{
+	destroyValues();
+	m_values.release();
+	m_tree.clear();
+}
+
+/*!
+ * Find function
+ *
+ * @param key => the key to be found
+ *
+ * @return => the value of key, NULL if not found
+*/
+template <class Key, class Value, class Allocator>
+template <class K>
+Value* RedBlackMap<Key, Value, Allocator>::find( const K& key )
+{
+	const Entry* found = m_tree.find(key);
+
+	return ( found != NULL ) ? valueAt(found->slot) : NULL;
+}
+
+/*!
+ * Find function
+ *
+ * @param key => the key to be found
+ *
+ * @return => the value of key, NULL if not found
+*/
+template <class Key, class Value, class Allocator>
+template <class K>
+const Value* RedBlackMap<Key, Value, Allocator>::find( const K& key ) const
+{
+	const Entry* found = m_tree.find(key);
+
+	return ( found != NULL ) ? valueAt(found->slot) : NULL;
+}
+
+/*!
+ * For each function
+ *
+ * @param fn => called with (const Key&, Value&) in key order
+ *
+ * @return => void
+*/
+template <class Key, class Value, class Allocator>
+template <class Function>
+void RedBlackMap<Key, Value, Allocator>::for_each( Function fn )
+{
+	for ( typename Tree::const_iterator it = m_tree.begin(); it != m_tree.end(); ++it )
+		fn( it->key, *valueAt(it->slot) );
+}
+
+/*!
+ * For each function
+ *
+ * @param fn => called with (const Key&, const Value&) in key order
+ *
+ * @return => void
+*/
+template <class Key, class Value, class Allocator>
+template <class Function>
+void RedBlackMap<Key, Value, Allocator>::for_each( Function fn ) const
+{
+	for ( typename Tree::const_iterator it = m_tree.begin(); it != m_tree.end(); ++it )
+		fn( it->key, static_cast<const Value&>( *valueAt(it->slot) ) );
+}
+
+/*!
+ * Destroy values function
+ * calls the destructor of every value (nothing to do for trivial ones)
+ *
+ * @return => void
+*/
+template <class Key, class Value, class Allocator>
+void RedBlackMap<Key, Value, Allocator>::destroyValues( void )
+{
+	if ( is_trivially_destructible<Value>::value )
+		return;
+
+	for ( typename Tree::const_iterator it = m_tree.begin(); it != m_tree.end(); ++it )
+		valueAt(it->slot)->~Value();
+}
@@ -0,0 +1,186 @@
+/*!
+    <PRE>
+        SOURCE FILE : RedBlackMap.h
+        DESCRIPTION.: Red black tree map, keys in the tree nodes and values in a separate pool.
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Hot/cold split, try_emplace, insert_or_assign and operator[] implemented.
+
+        TO COMPILE..: Use makefile.
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef RedBlackMap_H_
+#define RedBlackMap_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "RedBlackTree.h"
+#include "NodePool.h"
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// RedBlackMap( void )                                          --> Class constructor
+// RedBlackMap( RedBlackMap&& ) / operator = ( RedBlackMap&& )  --> Move, O(1)
+// ~RedBlackMap()                                               --> Class destructor
+// void swap( RedBlackMap& other )                              --> Exchanges the contents, O(1)
+// pair<Value*, bool> try_emplace( key, args... )               --> Inserts if the key is missing
+// pair<Value*, bool> insert_or_assign( key, v )                --> Inserts or overwrites
+// Value& operator []( key )                                    --> Value of key (default built if missing)
+// bool erase( const K& key )                                   --> Remove function
+// void clear( void )                                           --> Remove every key
+// size_t size( void ) const / bool empty( void ) const         --> Number of keys
+// bool contains( const K& key ) const                          --> Search function
+// Value* find( const K& key )                                  --> Search function (NULL if not found)
+// void for_each( Function fn )                                 --> fn(key, value) in key order
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed.
+
+/*! Entry of the map's tree: the key and the slot of its value. It is ordered by the key
+ *  alone, and compares with anything the key compares with (heterogeneous lookups)
+*/
+template <class Key>
+class RBMapEntry
+{
+    public:
+
+        /*! Entry constructors */
+        RBMapEntry( void ) : key(), slot(0) { /*! empty */ }
+
+        template <class K>
+        RBMapEntry( K&& k, uint32_t s ) : key(std::forward<K>(k)), slot(s) { /*! empty */ }
+
+        /*! Order by key */
+        bool operator < ( const RBMapEntry& rhs ) const { return key < rhs.key; }
+
+        Key         key;    //!< the key
+        uint32_t    slot;   //!< index of the value in the map's value pool
+};
+
+template <class Key, class K>
+bool operator < ( const RBMapEntry<Key>& e, const K& k ) { return e.key < k; }
+
+template <class Key, class K>
+bool operator < ( const K& k, const RBMapEntry<Key>& e ) { return k < e.key; }
+
+/*! Ordered map on the RedBlackTree engine, with a hot/cold split.
+ *  The tree nodes (hot, walked by every descent) hold only the key and a 32 bit slot index;
+ *  the values (cold, touched once the key is found) live in an IndexNodePool of their own.
+ *  So the descent path stays the size of the keys, however large the values are, and a
+ *  value never moves while its key is in the map. Keys are unique.
+ *  Allocator is the allocator of the tree nodes (see RedBlackTree).
+*/
+template <class Key, class Value, class Allocator = NodePool< RBTreeNode< RBMapEntry<Key> > > >
+class RedBlackMap
+{
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! The tree of keys */
+        typedef RBMapEntry<Key> Entry;
+        typedef RedBlackTree< Entry, less<Entry>, Allocator > Tree;
+
+        /*! Class constructor to create an empty map */
+        RedBlackMap( void ) { /*! empty */ }
+
+        /*! Move constructor: takes the keys and values of old in O(1), old is left empty */
+        RedBlackMap( RedBlackMap&& old ) noexcept;
+
+        /*! Move assignment operator: the current keys are removed, rhs is left empty */
+        const RedBlackMap& operator = ( RedBlackMap&& rhs ) noexcept;
+
+        /*! Class destructor to release memory */
+        ~RedBlackMap();
+
+        /*! Exchanges the keys and values of both maps in O(1) */
+        void swap( RedBlackMap& other ) noexcept;
+
+        /*! Inserts key with a value built from args, if key is missing (args are left untouched
+         *  otherwise). Returns the value of key and whether it was inserted.
+         *  Could throws a bad_alloc exception
+        */
+        template <class K, class... Args>
+        pair<Value*, bool> try_emplace( K&& key, Args&&... args );
+
+        /*! Inserts key with v, or assigns v to the value key already has.
+         *  Returns the value of key and whether it was inserted
+        */
+        template <class K, class M>
+        pair<Value*, bool> insert_or_assign( K&& key, M&& v );
+
+        /*! Value of key, a default built one is inserted if key is missing */
+        template <class K>
+        Value& operator [] ( K&& key ) { return *try_emplace( std::forward<K>(key) ).first; }
+
+        /*! Removes key and its value. Returns false if key isn't there */
+        template <class K>
+        bool erase( const K& key );
+
+        /*! Removes every key */
+        void clear( void );
+
+        /*! Number of keys */
+        size_t size( void ) const { return m_tree.size(); }
+
+        /*! Check if there is no key */
+        bool empty( void ) const { return m_tree.empty(); }
+
+        /*! Search functions (any K comparable with Key through '<').
+         *  find() returns the value of key, NULL if not found
+        */
+        template <class K>
+        bool contains( const K& key ) const { return m_tree.contains(key); }
+
+        template <class K>
+        Value* find( const K& key );
+
+        template <class K>
+        const Value* find( const K& key ) const;
+
+        /*! Calls fn(key, value) for every key, in order */
+        template <class Function>
+        void for_each( Function fn );
+
+        template <class Function>
+        void for_each( Function fn ) const;
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! Value pool: chunked slots with a free list, resolved by index */
+        typedef IndexNodePool<Value> ValuePool;
+
+        /*! Value in slot */
+        Value* valueAt( uint32_t slot ) const { return m_values.node(slot); }
+
+        /*! Destroys every value (the slots are left to the caller) */
+        void destroyValues( void );
+
+        /*! The values belong to the pool, so the map can't be copied */
+        RedBlackMap( const RedBlackMap& );
+        RedBlackMap& operator = ( const RedBlackMap& );
+
+        /*! Basic members */
+        Tree            m_tree;     //!< keys and value slots (hot)
+        ValuePool       m_values;   //!< values (cold)
+};
+
+#include "RedBlackMap.cpp"
+#endif // RedBlackMap_H
+
+/* ----------------------- [ End of the RedBlackMap.h header ] ------------------ */
+/* ============================================================================== */
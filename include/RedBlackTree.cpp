@@ -6,26 +6,121 @@
 
 #include "RedBlackTree.h"
 
-/*! Constants*/
-const int MinValue = -999999;
-
 /*!
  * Class constructor
  * Initialize the red black tree
  *
  * @return => void
 */
-template <class Comparable>
-RedBlackTree<Comparable>::RedBlackTree( void )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+RedBlackTree<Comparable, Compare, Allocator, Inline>::RedBlackTree( void )
+{
+	initialize();
+}
+
+/*!
+ * Class constructor
+ * Initialize the red black tree with an order object
+ *
+ * @param compare => order of the values
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+RedBlackTree<Comparable, Compare, Allocator, Inline>::RedBlackTree( const Compare& compare )
+	: m_compare(compare) //!< initialize the order
+{
+	initialize();
+}
+
+/*!
+ * Initialize function
+ * an empty tree starts in the inline form, with nothing allocated; a tree
+ * with no inline storage gets the leaf and the pseudo root with its first value
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::initialize( void )
+{
+	theLeaf = m_root = NULL;
+	m_size = 0;
+}
+
+/*!
+ * Create sentinels function
+ * it throws a bad_alloc exception if no enough space (nothing is kept)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::createSentinels( void )
+{
+	//! Both are black and hold a default built value (no copy of it)
+	theLeaf = createLeaf( integral_constant<bool, Allocator::sharesNodes>() ); // create a new leaf
+
+	try
+	{
+		m_root = constructNode(); // pseudo root
+	}
+	catch ( ... )
+	{
+		destroyLeaf();
+		theLeaf = NULL;
+		throw;
+	}
+
+	setLeftChild(m_root, theLeaf);
+	setRightChild(m_root, theLeaf);
+	updateSize(m_root);
+}
+
+/*!
+ * Create leaf function (allocators that share their nodes)
+ * the same leaf for every tree, so a sub tree keeps its leaf links when
+ * another tree takes it over. It is built once, black, and never written
+ * again (the links to it don't set its parent), so trees used by different
+ * threads can share it. It is never destroyed: a tree in static storage may
+ * still reach it at exit.
+ *
+ * @return => the shared leaf
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::createLeaf( true_type )
+{
+	static typename aligned_storage< sizeof(Node), alignof(Node) >::type storage;
+	static Node* leafPtr = new (&storage) Node( reinterpret_cast<Node*>( &storage ) );
+
+	return leafPtr;
+}
+
+/*!
+ * Destroy leaf function
+ * gives theLeaf back, unless it is the leaf shared by the trees (see createLeaf)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::destroyLeaf( void )
+{
+	if ( !Allocator::sharesNodes )
+		destroyNode(theLeaf);
+}
+
+/*!
+ * Blacken roots function
+ * the pseudo root and the real root turn black, the leaf (an empty tree's
+ * real root) already is and is not written
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::blackenRoots( void )
 {
-	theLeaf = new RBTreeNode<Comparable>; // create a new leaf
-	theLeaf->lChildPtr = theLeaf->rChildPtr = NULL;
-	theLeaf->color = RBTreeNode<Comparable>::Black;
+	m_root->setColor(Node::Black);
 
-	m_root = new RBTreeNode<Comparable>(); // pseudo root
-	m_root->lChildPtr = m_root->rChildPtr = theLeaf;
-	m_root->color = RBTreeNode<Comparable>::Black;
-	m_root->value = MinValue; // initialize
+	if ( rightOf(m_root) != theLeaf )
+		rightOf(m_root)->setColor(Node::Black);
 }
 
 /*!
@@ -38,29 +133,31 @@ RedBlackTree<Comparable>::RedBlackTree( void )
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::swapColor( RBTreeNode<Comparable>*& nodePtr, RBTreeNode<Comparable>*& parentPtr, RBTreeNode<Comparable>*& grandPtr )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::swapColor( Node*& nodePtr, Node*& parentPtr, Node*& grandPtr )
 {
+	countColorSwap();
+
 	/*! Node is black*/
-	if ( nodePtr->color == RBTreeNode<Comparable>::Black )
-		nodePtr->color = RBTreeNode<Comparable>::Red;
+	if ( nodePtr->color() == Node::Black )
+		nodePtr->setColor(Node::Red);
 	/*! Node is red*/
-	else if ( nodePtr->color == RBTreeNode<Comparable>::Red )
-		nodePtr->color = RBTreeNode<Comparable>::Black;
+	else if ( nodePtr->color() == Node::Red )
+		nodePtr->setColor(Node::Black);
 
 	/*! Parent node is black*/
-	if ( parentPtr->color == RBTreeNode<Comparable>::Black )
-		parentPtr->color = RBTreeNode<Comparable>::Red;
+	if ( parentPtr->color() == Node::Black )
+		parentPtr->setColor(Node::Red);
 	/*! Parent node is red*/
-	else if ( parentPtr->color == RBTreeNode<Comparable>::Red )
-		parentPtr->color = RBTreeNode<Comparable>::Black;
+	else if ( parentPtr->color() == Node::Red )
+		parentPtr->setColor(Node::Black);
 
 	/*! Grandpa node is black*/
-	if ( grandPtr->color == RBTreeNode<Comparable>::Black )
-		grandPtr->color = RBTreeNode<Comparable>::Red;
+	if ( grandPtr->color() == Node::Black )
+		grandPtr->setColor(Node::Red);
 	/*! Grandpa node is red*/
-	else if ( grandPtr->color == RBTreeNode<Comparable>::Red )
-		grandPtr->color = RBTreeNode<Comparable>::Black;
+	else if ( grandPtr->color() == Node::Red )
+		grandPtr->setColor(Node::Black);
 }
 
 /*!
@@ -71,17 +168,33 @@ void RedBlackTree<Comparable>::swapColor( RBTreeNode<Comparable>*& nodePtr, RBTr
  *
  * @return => void
 */
-template <class Comparable>
-RedBlackTree<Comparable>::RedBlackTree( const RedBlackTree<Comparable>& old )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+RedBlackTree<Comparable, Compare, Allocator, Inline>::RedBlackTree( const RedBlackTree<Comparable, Compare, Allocator, Inline>& old )
+	: m_compare(old.m_compare) //!< same order as old
 {
-	nil = new RBTreeNode<Comparable>; // new node for the leaf
-	nil->lChildPtr = nil->rChildPtr = nil;
+	initialize();
 
-	m_root = new RBTreeNode<Comparable>; // create the new node
-	m_root->lChildPtr = m_root->rChildPtr = nil;
 	*this = old; // set the new node to our old parameter
 }
 
+/*!
+ * Copy constructor
+ * Initialize the red black tree, the copy is split among the pool
+ *
+ * @param old 	=> old tree pointer
+ * @param pool 	=> the worker threads (NULL: sequential)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+RedBlackTree<Comparable, Compare, Allocator, Inline>::RedBlackTree( const RedBlackTree<Comparable, Compare, Allocator, Inline>& old, ThreadPool* pool )
+	: m_compare(old.m_compare) //!< same order as old
+{
+	initialize();
+
+	assign(old, pool);
+}
+
 /*!
  * Assignment operator
  *
@@ -89,401 +202,3397 @@ RedBlackTree<Comparable>::RedBlackTree( const RedBlackTree<Comparable>& old )
  *
  * @return => void
 */
-template <class Comparable>
-const RedBlackTree<Comparable>& RedBlackTree<Comparable>::operator=( const RedBlackTree<Comparable> & rhs )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+const RedBlackTree<Comparable, Compare, Allocator, Inline>& RedBlackTree<Comparable, Compare, Allocator, Inline>::operator=( const RedBlackTree<Comparable, Compare, Allocator, Inline> & rhs )
 {
 	//! Check if the reference pointer it's a self assignment
 	if ( this != &rhs )
 	{
-		//! Clear the memory
-		reclaimMemory(m_root->rChildPtr);
-		m_root->rChildPtr = theLeaf;
-
 		//! Deep copy
-		m_root->rChildPtr = clone(rhs.m_root->rChildPtr);
+		assign(rhs);
 	}
 
 	return *this; // return current tree object
 }
 
 /*!
- * Class destructor
- * realeases the allocated memory block
+ * Move constructor
+ * takes the nodes of old, which is left empty with nothing allocated
+ *
+ * @param old => the tree to be moved
  *
  * @return => void
 */
-template <class Comparable>
-RedBlackTree<Comparable>::~RedBlackTree()
+template <class Comparable, class Compare, class Allocator, bool Inline>
+RedBlackTree<Comparable, Compare, Allocator, Inline>::RedBlackTree( RedBlackTree<Comparable, Compare, Allocator, Inline>&& old ) noexcept
+	: m_compare(old.m_compare) //!< same order as old
 {
-	//! Delete the tree itself
-	reclaimMemory(m_root);
+	initialize();
 
-	//! Delete the leaf node
-	delete theLeaf;
+	swap(old); // old gets the empty tree
+}
 
-	//! Dele the root node
-	delete m_root;
+/*!
+ * Move assignment operator
+ *
+ * @param rhs => the tree to be moved (left empty)
+ *
+ * @return => current tree object
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+const RedBlackTree<Comparable, Compare, Allocator, Inline>& RedBlackTree<Comparable, Compare, Allocator, Inline>::operator=( RedBlackTree<Comparable, Compare, Allocator, Inline>&& rhs ) noexcept
+{
+	//! Check if the reference pointer it's a self assignment
+	if ( this != &rhs )
+	{
+		//! The current values go first, so rhs gets an empty tree back
+		clear();
+		swap(rhs);
+	}
+
+	return *this; // return current tree object
 }
 
 /*!
- * Insertion function
- * inserts a new node in the red black tree
- * it throws a bad_alloc exception if no enough space
+ * Swap function
+ * exchanges the allocators, the sentinels, the inline values and the sizes
  *
- * @param newNode => the value to the new node
+ * @param other => the other tree
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::insert( Comparable newNode )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::swap( RedBlackTree& other ) noexcept
 {
-	//! References the root
-	RBTreeNode<Comparable>* nodePtr = m_root->rChildPtr;
+	std::swap(m_compare, other.m_compare);
+	m_pool.swap(other.m_pool);
+	std::swap(theLeaf, other.theLeaf);
+	std::swap(m_root, other.m_root);
+	std::swap(m_size, other.m_size);
+	swapInline(other);
+}
 
-	//! References the pseudo root
-	RBTreeNode<Comparable>* parentPtr = m_root;
-	RBTreeNode<Comparable>* grandPtr = m_root;
-	RBTreeNode<Comparable>* greatPtr = m_root;
+/*!
+ * Bulk constructor
+ * builds the red black tree from a range (see assign)
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ * @param flags => BuildFlags
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class InputIterator>
+RedBlackTree<Comparable, Compare, Allocator, Inline>::RedBlackTree( InputIterator first, InputIterator last, unsigned flags )
+{
+	initialize();
 
-	//! Check if the referee node is different from the leaf
-	while ( nodePtr != theLeaf )
+	assign(first, last, flags);
+}
+
+/*!
+ * Class destructor
+ * realeases the allocated memory block
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+RedBlackTree<Comparable, Compare, Allocator, Inline>::~RedBlackTree()
+{
+	//! The inline form has no node (and its values no destructor)
+	if ( isInline() )
+		return;
+
+	//! The pool drops every node at once, unless the values need their destructor
+	if ( Allocator::releasesAll && is_trivially_destructible<Comparable>::value )
 	{
-		//! Check if both children are red
-		if ( (nodePtr->lChildPtr->color == RBTreeNode<Comparable>::Red) && (nodePtr->rChildPtr->color == RBTreeNode<Comparable>::Red) )
-		{
-			//! Split the sub tree
-			split(nodePtr, parentPtr, grandPtr, greatPtr);
+		m_pool.release();
+		return;
+	}
 
-			//! Change the pseudo root color
-			m_root->color = RBTreeNode<Comparable>::Black;
+	//! Delete the tree itself
+	reclaimMemory(rightOf(m_root));
 
-			//! Change the real root color
-			m_root->rChildPtr->color = RBTreeNode<Comparable>::Black;
+	//! Delete the leaf node
+	destroyLeaf();
 
-			//! Change the leaf color
-			theLeaf->color = RBTreeNode<Comparable>::Black;
-		}
+	//! Dele the root node
+	destroyNode(m_root);
 
-		//! Proceed a deep copy to the local pointers
-		greatPtr = grandPtr;
-		grandPtr = parentPtr;
-		parentPtr = nodePtr;
+	//! Free the remaining storage
+	m_pool.release();
+}
 
-		//! Check the new node value
-		if ( newNode <= parentPtr->value )
-			nodePtr = nodePtr->lChildPtr; //! LEFT
-		else
-			nodePtr = nodePtr->rChildPtr; // RIGHT
-	}
+/*!
+ * Assign function
+ * replaces the content with the range [first, last) in O(n) for sorted input.
+ * The shape is perfectly balanced, so every leaf link lies on the last two
+ * levels: the nodes on the deepest level are red and the others black, which
+ * gives the same black height on every path.
+ * it throws an invalid_argument exception if the input isn't sorted (unless
+ * Unsorted is given) and a bad_alloc exception if no enough space
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ * @param flags => BuildFlags
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class InputIterator>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::assign( InputIterator first, InputIterator last, unsigned flags )
+{
+	vector<Comparable> values(first, last);
 
-	//! Check the new node value
-	if ( newNode <= parentPtr->value )
+	//! Sort the input if asked, otherwise make sure it is sorted
+	if ( flags & Unsorted )
+		sort(values.begin(), values.end(), m_compare);
+	else
 	{
-		//! It's smaller, so place in the left
-		parentPtr->lChildPtr = new RBTreeNode<Comparable>(newNode, theLeaf, theLeaf, RBTreeNode<Comparable>::Black);
-		nodePtr = parentPtr->lChildPtr;
+		for ( size_t i = 1; i < values.size(); i++ )
+			if ( lessThan(values[i], values[i - 1]) )
+				throw invalid_argument("RedBlackTree::assign: input not sorted");
 	}
-	else
+
+	//! Drop the repeated values
+	if ( flags & Unique )
 	{
-		//! It's bigger, so place in the right
-		parentPtr->rChildPtr = new RBTreeNode<Comparable>(newNode, theLeaf, theLeaf, RBTreeNode<Comparable>::Black);
-		nodePtr = parentPtr->rChildPtr;
+		size_t kept = 0;
+
+		for ( size_t i = 0; i < values.size(); i++ )
+			if ( kept == 0 || lessThan(values[kept - 1], values[i]) )
+				values[kept++] = values[i];
+
+		values.resize(kept);
 	}
 
-	//! Split the node
-	split(nodePtr, parentPtr, grandPtr, greatPtr);
+	rebuild(values);
+}
 
-	//! Change the pseudo root color
-	m_root->color = RBTreeNode<Comparable>::Black;
+/*!
+ * Rebuild function
+ * replaces the content with the sorted values in O(n)
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param values => sorted values
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::rebuild( const vector<Comparable>& values )
+{
+	//! Few values are kept inline
+	if ( values.size() <= inlineCapacity )
+	{
+		clear();
+		if ( inlineCapacity > 0 )
+			copy(values.begin(), values.end(), inlineValues());
+		m_size = values.size();
+		return;
+	}
 
-	//! Change the real root color
-	m_root->rChildPtr->color = RBTreeNode<Comparable>::Black;
+	//! Remove the current content
+	clearNodes();
 
-	//! Change the leaf color
-	theLeaf->color = RBTreeNode<Comparable>::Black;
+	buildNodes(values);
 }
 
 /*!
- * Remove function
- * removes a new node in the red black tree
+ * Build nodes function
+ * it throws a bad_alloc exception if no enough space
  *
- * @param node => node's value to be removed
+ * @param values => sorted values
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::remove( Comparable node )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::buildNodes( const vector<Comparable>& values )
 {
-	//! Temp node
-	RBTreeNode<Comparable>* temp = new RBTreeNode<Comparable>;
+	if ( values.empty() )
+		return;
 
-    //! References the root (left)
-	RBTreeNode<Comparable>* nodePtr = m_root->lChildPtr;
+	//! Depth of the deepest level: floor(log2(n))
+	int redDepth = 0;
 
-	//! References the pseudo root
-	RBTreeNode<Comparable>* parentPtr = m_root;
-	RBTreeNode<Comparable>* grandPtr = m_root;
-	RBTreeNode<Comparable>* greatPtr = m_root;
+	for ( size_t n = values.size(); n > 1; n >>= 1 )
+		redDepth++;
+
+	//! Every node in one block
+	m_pool.reserve(values.size());
+
+	setRightChild(m_root, build(values, 0, values.size(), 0, redDepth));
+	m_size = values.size();
+
+	//! Change the real root color
+	blackenRoots();
 }
 
 /*!
- * Search function
- * search a new node in the red black tree
+ * Assign function (copy)
+ * replaces the content with a deep copy of other
+ * it throws a bad_alloc exception if no enough space
  *
- * @param node => node's value to be removed
+ * @param other => the tree to be copied
+ * @param pool 	=> the worker threads (NULL: sequential)
  *
  * @return => void
 */
-template <class Comparable>
-const Comparable RedBlackTree<Comparable>::search( Comparable node )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::assign( const RedBlackTree& other, ThreadPool* pool )
 {
-	//! Set the nil node as the search parameter
-	nil = new RBTreeNode<Comparable>; // new node for the leaf
-	nil->value = node;
+	if ( this == &other )
+		return;
 
-    //! References the root
-	RBTreeNode<Comparable>* nodePtr = m_root->rChildPtr;
+	m_compare = other.m_compare;
 
-	//! Check if the referee node is different from the leaf
-	while ( nodePtr != theLeaf )
+	//! An inline tree is copied as it is
+	if ( other.isInline() )
 	{
-		//! Searched node is smaller than current node
-        if ( node < nodePtr->value )
-        {
-            nodePtr = nodePtr->lChildPtr;
-        }
-        //! Searched node is bigger than current node
-        else if ( nodePtr->value < node )
-        {
-            nodePtr = nodePtr->rChildPtr;
-        }
-        //! Current node is different from the searched
-        else if ( nodePtr != nil )
-        {
-            return nodePtr->value;
-        }
-        //! Not found
-        else
-        {
-            return ITEM_NOT_FOUND;
-        }
-    }
-
-    return ITEM_NOT_FOUND;
+		clear(pool);
+		if ( inlineCapacity > 0 )
+			copy(other.inlineValues(), other.inlineValues() + other.m_size, inlineValues());
+		m_size = other.m_size;
+		return;
+	}
+
+	copyTree( other, pool, integral_constant<bool, Allocator::copiesArena && is_trivially_copyable<Node>::value>() );
 }
 
 /*!
- * Print trigger function
+ * Clear function
+ * removes every value. A tree with an inline form goes back to it and gives
+ * the node storage back, the others keep the pseudo root and theLeaf (if they
+ * have them already). Never throws
+ *
+ * @param pool => the worker threads (NULL: sequential)
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::print( void ) const
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::clear( ThreadPool* pool )
 {
-	//! Call the print function (encapsulation)
-	print(m_root->rChildPtr, 0);
+	if ( isInline() )
+		m_size = 0;
+	else if ( inlineCapacity == 0 )
+		clearNodes(pool);
+	else
+		dropNodes(pool);
 }
 
 /*!
- * Right rotation function
- * rotates the node around its left child
+ * Clear nodes function
+ * removes every value, the pseudo root and theLeaf are kept (an inline or a
+ * new tree gets them)
+ * it throws a bad_alloc exception if no enough space (inline and new trees only)
  *
- * @param nodePtr 	=> the node itself (pointer)
- * @param parentPtr => the parent node (pointer)
+ * @param pool => the worker threads (NULL: sequential)
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::rightRotate( RBTreeNode<Comparable>*& nodePtr, RBTreeNode<Comparable>*& parentPtr )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::clearNodes( ThreadPool* pool )
 {
-	//! Temporaly variable to keep the left child
-	RBTreeNode<Comparable>* temp = nodePtr->lChildPtr;
+	if ( isInline() )
+	{
+		createSentinels();
+		m_size = 0;
+		return;
+	}
 
-	//! Change the left child for the right's one
-	nodePtr->lChildPtr = temp->rChildPtr;
+	SubTree t = wholeTree();
 
-	//! Check if it's the right child
-	if ( parentPtr->rChildPtr == nodePtr )
+	if ( pool != NULL && t.height >= ForkHeight )
 	{
-		//! The temporaly variable receive the right child
-		parentPtr->rChildPtr = temp;
+		//! The tasks free the storage into chains, the pool gets it back at once
+		typename Allocator::FreeChain chain;
+
+		reclaimTree(t.root, t.height, chain, pool);
+		m_pool.deallocate(chain);
 	}
 	else
-	{
-		//! The temporaly variable receive the left child
-		parentPtr->lChildPtr = temp;
-	}
+		reclaimMemory(t.root);
 
-	//! Finalize the rotation
-	temp->rChildPtr = nodePtr;
+	setRightChild(m_root, theLeaf);
+	m_size = 0;
 }
 
 /*!
- * Left rotation function
- * rotates the node around its right child
+ * Drop nodes function
+ * destroys every node, the sentinels included, and empties the allocator:
+ * the tree is left empty in the inline form
  *
- * @param nodePtr 	=> the node itself (pointer)
- * @param parentPtr => the parent node (pointer)
+ * @param pool => the worker threads (NULL: sequential)
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::leftRotate( RBTreeNode<Comparable>*& nodePtr, RBTreeNode<Comparable>*& parentPtr )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::dropNodes( ThreadPool* pool )
 {
-	//! Temporaly variable to keep the right child
-	RBTreeNode<Comparable>* temp = nodePtr->rChildPtr;
-
-	//! Change the right child for the left's one
-	nodePtr->rChildPtr = temp->lChildPtr;
-
-	//! Check if it's the right child
-	if ( parentPtr->rChildPtr == nodePtr )
-	{
-		//! The temporaly variable receive the right child
-		parentPtr->rChildPtr = temp;
-	}
-	else // if were dealing with the left child
+	//! The pool drops every node at once, unless the values need their destructor
+	if ( Allocator::releasesAll && is_trivially_destructible<Comparable>::value )
+		countReleases(m_size + 2);
+	else
 	{
-		//! The temporaly variable receive the left child
-		parentPtr->lChildPtr = temp;
+		clearNodes(pool);
+		destroyLeaf();
+		destroyNode(m_root);
 	}
 
-	//! Finalize the rotation
-	temp->lChildPtr = nodePtr;
+	m_pool.release();
+	theLeaf = m_root = NULL;
+	m_size = 0;
 }
 
 /*!
- * Split function
- * splits a 4_node
- *
- * @param nodePtr 	=> the node itself 	(pointer)
- * @param parentPtr => the parent node 	(pointer)
- * @param grandPtr => the grandpa node 	(pointer)
- * @param greatPtr => the great node 	(pointer)
+ * Grow to nodes function
+ * moves the inline values to a balanced tree of nodes (nothing if the tree
+ * is already made of nodes)
+ * it throws a bad_alloc exception if no enough space (the values stay inline)
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::split ( RBTreeNode<Comparable>* nodePtr, RBTreeNode<Comparable>* parentPtr,
- 									   RBTreeNode<Comparable>* grandPtr, RBTreeNode<Comparable>* greatPtr )
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::growToNodes( void )
 {
-	//! Change the color to black
-	nodePtr->rChildPtr->color = RBTreeNode<Comparable>::Black;
-	nodePtr->lChildPtr->color = RBTreeNode<Comparable>::Black;
+	if ( !isInline() )
+		return;
+
+	//! A tree without inline storage is empty here: nothing to carry over
+	vector<Comparable> values;
+	if ( inlineCapacity > 0 )
+		values.assign(inlineValues(), inlineValues() + m_size);
 
-	//! Check if it's a 2_node
-	if ( parentPtr->color == RBTreeNode<Comparable>::Black )
+	//! The sentinels and the nodes in one block
+	m_pool.reserve(m_size + 2);
+	createSentinels();
+	m_size = 0;
+
+	try
 	{
-		//! Change the color to red
-		nodePtr->color = RBTreeNode<Comparable>::Red;
+		buildNodes(values);
 	}
-	else
+	catch ( ... )
 	{
-		//! Check if the colors are different
-		if ( parentPtr->lChildPtr->color != parentPtr->rChildPtr->color )
-		{
-			// Change the color to red
-			nodePtr->color = RBTreeNode<Comparable>::Red;
-		}
-		//! If nodePtr is left child of its parent and parentPtr is left child of its parent
-		else if ( (parentPtr->lChildPtr == nodePtr) && (grandPtr->lChildPtr == parentPtr) ) 
-		{
-			rightRotate(grandPtr, greatPtr); // rotate
+		//! The inline array was left untouched
+		dropNodes(NULL);
+		m_size = values.size();
+		throw;
+	}
+}
 
-			swapColor(nodePtr, parentPtr, grandPtr); // swap the colors of nodePtr, parentPtr, and grandPtr
-		}
-		else if ( (parentPtr->lChildPtr == nodePtr) && (grandPtr->rChildPtr == parentPtr) )
-		{
-			rightRotate(parentPtr, grandPtr); // rotate
-			leftRotate(grandPtr, greatPtr);
+/*!
+ * Shrink to inline function
+ * a tree left with no more than half of inlineCapacity values copies them
+ * back inline and gives its node storage back. The gap between this limit and
+ * the full array keeps a tree that hovers around one of them from moving back
+ * and forth
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::shrinkToInline( void )
+{
+	if ( inlineCapacity == 0 || isInline() || m_size > inlineCapacity / 2 )
+		return;
 
-			swapColor(nodePtr, parentPtr, grandPtr); // swap the colors of nodePtr, parentPtr, and grandPtr
-		}
-		else if ( (parentPtr->rChildPtr == nodePtr) && (grandPtr->lChildPtr == parentPtr) )
-		{
-			leftRotate(parentPtr, grandPtr); // rotate
-			rightRotate(grandPtr, greatPtr);
+	Comparable* values = inlineValues();
+	size_t n = 0;
 
-			swapColor(nodePtr, parentPtr, grandPtr); // swap the colors of nodePtr, parentPtr, and grandPtr
-		}
-		else if ( (parentPtr->rChildPtr == nodePtr) && (grandPtr->rChildPtr == parentPtr) )
-		{
-			leftRotate(grandPtr, greatPtr); // rotate
+	for ( const_iterator it = begin(); it != end(); ++it )
+		values[n++] = *it;
 
-			swapColor(nodePtr, parentPtr, grandPtr); // swap the colors of nodePtr, parentPtr, and grandPtr
-		}
-	}
+	dropNodes(NULL);
+	m_size = n;
 }
 
 /*!
- * Clone function
+ * Insertion function
+ * inserts a copy of v in the red black tree
+ * it throws a bad_alloc exception if no enough space
  *
- * @param nodePtr 	=> the node itself 	(pointer)
+ * @param v => the value to the new node
  *
  * @return => void
 */
-template <class Comparable>
-RBTreeNode<Comparable> * RedBlackTree<Comparable>::clone( RBTreeNode<Comparable> * nodePtr ) const
-{ 
-	//! If points to special leaf node
-	if ( nodePtr == nodePtr->lChildPtr )
-		return theLeaf;
-	else
-		return new RBTreeNode<Comparable>( nodePtr->value, clone( nodePtr->lChildPtr ), clone( nodePtr->rChildPtr ), nodePtr->color); // recursive function calls
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::insert( const Comparable& v )
+{
+	//! The inline array takes it, unless it is full
+	if ( isInline() && insertInline(v) )
+		return;
+
+	insertNode( constructNode(v) );
 }
 
 /*!
- * Function to release the allocated memory
+ * Insertion function
+ * moves v into the red black tree
+ * it throws a bad_alloc exception if no enough space
  *
- * @param nodePtr 	=> the node itself 	(pointer)
+ * @param v => the value to the new node
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::reclaimMemory( RBTreeNode<Comparable> *nodePtr ) const
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::insert( Comparable&& v )
 {
-	//! Check if it's the leaf node
-	if ( nodePtr != theLeaf )
-	{
-		//! Realease the left subtree memory
-		reclaimMemory(nodePtr->lChildPtr);
-
-		//! Realease the right subtree memory
-		reclaimMemory(nodePtr->rChildPtr);
+	if ( isInline() && insertInline(v) )
+		return;
 
-		//! Delete the node
-		delete nodePtr;
-	}
+	insertNode( constructNode( std::move(v) ) );
 }
 
 /*!
- * Print function
- * prints the tree from nodePtr
+ * Emplace function
+ * inserts a value built from args right in the new node
+ * it throws a bad_alloc exception if no enough space
  *
- * @param nodePtr 	=> the node itself 	(pointer)
- * @param level		=> the tree's depth
+ * @param args => the value constructor arguments
  *
  * @return => void
 */
-template <class Comparable>
-void RedBlackTree<Comparable>::print( RBTreeNode<Comparable> *nodePtr, int level ) const
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class... Args>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::emplace( Args&&... args )
 {
-	//! Check if the node is not the leaf
-	if ( nodePtr != theLeaf )
+	//! An inline value is copied anyway (trivially)
+	if ( isInline() && inlineCapacity > 0 )
 	{
-		//! Call the print function recursively
-		print( nodePtr->rChildPtr, (level + 1) );
+		insert( Comparable( std::forward<Args>(args)... ) );
+		return;
+	}
 
-		//! Print blank spaces accordingly to the depth
-		for ( int i = 0; i < level; i++ )
-		{
-			cout << "    ";
-		}
+	//! The first value of a tree with no inline form brings the sentinels
+	growToNodes();
+
+	insertNode( constructNode( std::forward<Args>(args)... ) );
+}
+
+/*!
+ * Insert inline function
+ * the values greater than v are shifted one slot up (v goes after its equal
+ * values). A full array moves to nodes instead
+ * it throws a bad_alloc exception if no enough space (moving to nodes)
+ *
+ * @param v => the value
+ *
+ * @return => true if inserted, false if the tree moved to nodes (v is still to be inserted)
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+bool RedBlackTree<Comparable, Compare, Allocator, Inline>::insertInline( const Comparable& v )
+{
+	if ( m_size == inlineCapacity )
+	{
+		growToNodes();
+		return false;
+	}
+
+	OperationTimer timer(*this, TreeStats::Insert);
+
+	//! v may be one of the values shifted
+	Comparable value = v;
+	Comparable* values = inlineValues();
+	size_t slot = inlineBound(value, true);
+
+	move_backward( values + slot, values + m_size, values + m_size + 1 );
+	values[slot] = value;
+	m_size++;
+
+	return true;
+}
+
+/*!
+ * Remove inline function
+ *
+ * @param v => the value
+ *
+ * @return => true if a value was removed
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+bool RedBlackTree<Comparable, Compare, Allocator, Inline>::removeInline( const Comparable& v )
+{
+	OperationTimer timer(*this, TreeStats::Remove);
+
+	Comparable* values = inlineValues();
+	size_t slot = inlineBound(v, false);
+
+	if ( slot == m_size || lessThan(v, values[slot]) )
+		return false;
+
+	m_size--;
+	std::move( values + slot + 1, values + m_size + 1, values + slot );
+
+	return true;
+}
+
+/*!
+ * Inline bound function
+ * arithmetic values are counted with no branch (a loop the compiler turns into
+ * SIMD compares), the others are found by binary search
+ *
+ * @param key 	=> value to be searched
+ * @param upper => first value greater than key (true) or not less than key (false)
+ *
+ * @return => position in the inline array (size() if none)
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+size_t RedBlackTree<Comparable, Compare, Allocator, Inline>::inlineBound( const Key& key, bool upper ) const
+{
+	const Comparable* values = inlineValues();
+
+	if ( Branchless<Key>::value )
+	{
+		size_t below = 0;
+
+		if ( upper )
+		{
+			for ( size_t i = 0; i < m_size; i++ )
+				below += !( key < values[i] );
+		}
+		else
+		{
+			for ( size_t i = 0; i < m_size; i++ )
+				below += ( values[i] < key );
+		}
+
+		return below;
+	}
+
+	size_t lo = 0, hi = m_size;
+
+	while ( lo < hi )
+	{
+		size_t mid = ( lo + hi ) / 2;
+
+		if ( upper ? !lessThan(key, values[mid]) : lessThan(values[mid], key) )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*!
+ * Find inline function
+ *
+ * @param key => value to be searched
+ *
+ * @return => pointer to the inline value, NULL if not found
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+const Comparable* RedBlackTree<Comparable, Compare, Allocator, Inline>::findInline( const Key& key ) const
+{
+	OperationTimer timer(*this, TreeStats::Search);
+
+	const Comparable* values = inlineValues();
+	size_t slot = inlineBound(key, false);
+
+	return ( slot < m_size && !lessThan(key, values[slot]) ) ? values + slot : NULL;
+}
+
+/*!
+ * Insert node function
+ * places the new node in the red black tree (top-down, splitting the
+ * 4_nodes met on the way down). The node is built before the descent,
+ * so the descent compares with the value already in it
+ *
+ * @param newPtr => the new node, from constructNode (pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::insertNode( Node *newPtr )
+{
+	OperationTimer timer(*this, TreeStats::Insert);
+
+	const Comparable& newNode = newPtr->value;
+
+	//! The new node is a leaf
+	setLeftChild(newPtr, theLeaf);
+	setRightChild(newPtr, theLeaf);
+	updateSize(newPtr);
+
+	//! References the root
+	Node* nodePtr = rightOf(m_root);
+
+	//! References the pseudo root
+	Node* parentPtr = m_root;
+	Node* grandPtr = m_root;
+	Node* greatPtr = m_root;
+
+	//! Check if the referee node is different from the leaf
+	while ( nodePtr != theLeaf )
+	{
+		countStep();
+
+		//! Check if both children are red
+		if ( (leftOf(nodePtr)->color() == Node::Red) && (rightOf(nodePtr)->color() == Node::Red) )
+		{
+			//! Split the sub tree
+			split(nodePtr, parentPtr, grandPtr, greatPtr);
+
+			//! Change the pseudo root and the real root colors
+			blackenRoots();
+		}
+
+		//! Proceed a deep copy to the local pointers
+		greatPtr = grandPtr;
+		grandPtr = parentPtr;
+		parentPtr = nodePtr;
+
+		//! The new node will be below it
+		adjustSize(parentPtr, 1);
+
+		//! Check the new node value: left if not bigger (picked by index, no branch)
+		nodePtr = childAt( nodePtr, lessThan(parentPtr->value, newNode) );
+	}
+
+	//! Check the new node value (the first node always goes to the pseudo root's right)
+	if ( parentPtr != m_root && !lessThan(parentPtr->value, newNode) )
+	{
+		//! It's smaller, so place in the left
+		setLeftChild(parentPtr, newPtr);
+		nodePtr = newPtr;
+	}
+	else
+	{
+		//! It's bigger, so place in the right
+		setRightChild(parentPtr, newPtr);
+		nodePtr = newPtr;
+	}
+
+	m_size++;
+
+	//! Split the node
+	split(nodePtr, parentPtr, grandPtr, greatPtr);
+
+	//! Change the pseudo root and the real root colors
+	blackenRoots();
+}
+
+/*!
+ * Batch insertion function
+ * inserts a range of values. The batch is sorted first, so consecutive
+ * insertions share the top of their paths: the path of the last insertion
+ * is kept (with the upper bound of each sub tree) and the next descent
+ * restarts from the deepest node whose sub tree holds the new value, as
+ * long as no 4_node lies above it (a fresh descent would split it).
+ * A batch large compared to the tree is merged with the tree's values and
+ * the tree is rebuilt in O(n + m) instead.
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class InputIterator>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::insert_batch( InputIterator first, InputIterator last )
+{
+	vector<Comparable> batch(first, last);
+
+	if ( batch.empty() )
+		return;
+
+	sort(batch.begin(), batch.end(), m_compare);
+
+	//! It all fits inline
+	if ( isInline() && m_size + batch.size() <= inlineCapacity )
+	{
+		for ( size_t i = 0; i < batch.size(); i++ )
+			insertInline(batch[i]);
+
+		return;
+	}
+
+	//! Big batch: merge and rebuild
+	if ( batch.size() * RebuildRatio >= m_size )
+	{
+		vector<Comparable> values;
+		values.reserve(m_size + batch.size());
+
+		if ( !isInline() )
+			collect(rightOf(m_root), values);
+		else if ( inlineCapacity > 0 )
+			values.assign(inlineValues(), inlineValues() + m_size);
+
+		vector<Comparable> merged(values.size() + batch.size());
+		merge(values.begin(), values.end(), batch.begin(), batch.end(), merged.begin(), m_compare);
+
+		rebuild(merged);
+		return;
+	}
+
+	growToNodes();
+	m_pool.reserve(batch.size());
+
+	//! path[d] is the node at depth d of the last insertion (path[0] is the pseudo root),
+	//! upper[d] the upper bound of its sub tree (NULL when there is none)
+	vector< Node* > path(1, m_root);
+	vector< const Comparable* > upper(1, (const Comparable*) NULL);
+
+	for ( size_t i = 0; i < batch.size(); i++ )
+	{
+		const Comparable& newNode = batch[i];
+
+		//! Deepest node of the last path whose sub tree holds newNode (the batch is sorted,
+		//! so only the upper bounds need to be checked)
+		size_t depth = 1;
+
+		if ( path.size() > 1 )
+		{
+			size_t lo = 1, hi = path.size() - 1;
+
+			while ( lo < hi )
+			{
+				size_t mid = (lo + hi + 1) / 2;
+
+				if ( upper[mid] == NULL || !lessThan(*upper[mid], newNode) )
+					lo = mid;
+				else
+					hi = mid - 1;
+			}
+
+			depth = lo;
+
+			//! A fresh descent would split the first 4_node above, so restart from there
+			for ( size_t d = 1; d < depth; d++ )
+			{
+				if ( (leftOf(path[d])->color() == Node::Red) && (rightOf(path[d])->color() == Node::Red) )
+				{
+					depth = d;
+					break;
+				}
+			}
+
+			//! The skipped nodes get the new node below them
+			if ( Node::ranked )
+				for ( size_t d = 1; d < depth; d++ )
+					adjustSize(path[d], 1);
+		}
+
+		//! Restore the top-down pointers at the restart node
+		Node* nodePtr = ( depth < path.size() ) ? path[depth] : rightOf(m_root);
+		Node* parentPtr = path[depth - 1];
+		Node* grandPtr = ( depth >= 2 ) ? path[depth - 2] : m_root;
+		Node* greatPtr = ( depth >= 3 ) ? path[depth - 3] : m_root;
+		const Comparable* bound = upper[depth - 1];
+
+		if ( depth < upper.size() )
+			bound = upper[depth];
+
+		//! Same descent as insert(), recording the path
+		while ( nodePtr != theLeaf )
+		{
+			path.resize(depth + 1);
+			upper.resize(depth + 1);
+			path[depth] = nodePtr;
+			upper[depth] = bound;
+
+			//! Check if both children are red
+			if ( (leftOf(nodePtr)->color() == Node::Red) && (rightOf(nodePtr)->color() == Node::Red) )
+			{
+				//! Split the sub tree. After a rotation the new sub tree root sits two levels up
+				if ( split(nodePtr, parentPtr, grandPtr, greatPtr) )
+				{
+					depth -= 2;
+					path[depth] = nodePtr;
+					bound = upper[depth];
+				}
+
+				blackenRoots();
+			}
+
+			greatPtr = grandPtr;
+			grandPtr = parentPtr;
+			parentPtr = nodePtr;
+			adjustSize(parentPtr, 1);
+
+			if ( !lessThan(parentPtr->value, newNode) )
+			{
+				bound = &parentPtr->value;
+				nodePtr = leftOf(nodePtr); //! LEFT
+			}
+			else
+				nodePtr = rightOf(nodePtr); // RIGHT
+
+			depth++;
+		}
+
+		//! Place the new node
+		nodePtr = createNode(newNode, theLeaf, theLeaf, Node::Black);
+
+		if ( parentPtr != m_root && !lessThan(parentPtr->value, newNode) )
+			setLeftChild(parentPtr, nodePtr);
+		else
+			setRightChild(parentPtr, nodePtr);
+
+		m_size++;
+
+		path.resize(depth + 1);
+		upper.resize(depth + 1);
+		path[depth] = nodePtr;
+		upper[depth] = bound;
+
+		//! Split the node
+		if ( split(nodePtr, parentPtr, grandPtr, greatPtr) )
+		{
+			depth -= 2;
+			path[depth] = nodePtr;
+			path.resize(depth + 1);
+			upper.resize(depth + 1);
+		}
+
+		blackenRoots();
+	}
+}
+
+/*!
+ * Remove function
+ * removes a node from the red black tree in a single top-down pass.
+ * On the way down a red is pushed ahead of the current node (color flips
+ * and rotations), so the node finally unlinked is red and no fix-up pass
+ * is needed. The value found is replaced by its in-order predecessor and
+ * the predecessor node goes back to the pool.
+ *
+ * @param node => node's value to be removed
+ *
+ * @return => true if a node was removed
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+bool RedBlackTree<Comparable, Compare, Allocator, Inline>::remove( const Comparable& node )
+{
+	if ( isInline() )
+		return removeInline(node);
+
+	OperationTimer timer(*this, TreeStats::Remove);
+
+	//! References the pseudo root
+	Node* nodePtr = m_root;
+	Node* parentPtr = m_root;
+	Node* grandPtr = m_root;
+
+	//! Node holding the value to be removed
+	Node* foundPtr = NULL;
+
+	//! Direction to follow (the real root is the pseudo root's right child)
+	bool goRight = true;
+
+	//! Ranked nodes are shrunk on the way down, so the value must be there
+	if ( Node::ranked && !contains(node) )
+		return false;
+
+	//! Check if the next node is different from the leaf
+	while ( (goRight ? rightOf(nodePtr) : leftOf(nodePtr)) != theLeaf )
+	{
+		countStep();
+
+		//! Side of the parent where nodePtr lies
+		bool lastRight = goRight;
+
+		//! Walk one level down
+		grandPtr = parentPtr;
+		parentPtr = nodePtr;
+		nodePtr = goRight ? rightOf(nodePtr) : leftOf(nodePtr);
+
+		//! The removed node is below parentPtr
+		adjustSize(parentPtr, -1);
+
+		//! Equal values keep going left, so the last one found is the closest to the leaves
+		goRight = lessThan(nodePtr->value, node);
+
+		if ( !goRight && !lessThan(node, nodePtr->value) )
+			foundPtr = nodePtr;
+
+		Node* nextPtr = goRight ? rightOf(nodePtr) : leftOf(nodePtr);
+		Node* otherPtr = goRight ? leftOf(nodePtr) : rightOf(nodePtr);
+
+		//! Nothing to do if nodePtr or the next node is already red
+		if ( nodePtr->color() == Node::Red || nextPtr->color() == Node::Red )
+			continue;
+
+		//! The other child is red: rotate it up, so nodePtr gets a red parent
+		if ( otherPtr->color() == Node::Red )
+		{
+			if ( goRight )
+				rightRotate(nodePtr, parentPtr);
+			else
+				leftRotate(nodePtr, parentPtr);
+
+			nodePtr->setColor(Node::Red);
+			otherPtr->setColor(Node::Black);
+			parentPtr = otherPtr;
+			adjustSize(parentPtr, -1);
+			continue;
+		}
+
+		//! Both children are black: borrow the red from the sibling side
+		Node* siblingPtr = lastRight ? leftOf(parentPtr) : rightOf(parentPtr);
+
+		if ( siblingPtr == theLeaf )
+			continue;
+
+		Node* nearPtr = lastRight ? rightOf(siblingPtr) : leftOf(siblingPtr);
+		Node* farPtr = lastRight ? leftOf(siblingPtr) : rightOf(siblingPtr);
+
+		if ( nearPtr->color() == Node::Black && farPtr->color() == Node::Black )
+		{
+			//! Merge parent, nodePtr and sibling into a 4_node (color flip)
+			parentPtr->setColor(Node::Black);
+			siblingPtr->setColor(Node::Red);
+			nodePtr->setColor(Node::Red);
+			continue;
+		}
+
+		//! New root of the parent's sub tree
+		Node* topPtr;
+
+		if ( nearPtr->color() == Node::Red )
+		{
+			//! Double rotation: the sibling's near child goes up
+			if ( lastRight )
+				leftRotate(siblingPtr, parentPtr);
+			else
+				rightRotate(siblingPtr, parentPtr);
+
+			topPtr = nearPtr;
+		}
+		else
+		{
+			//! Single rotation: the sibling goes up
+			topPtr = siblingPtr;
+		}
+
+		if ( lastRight )
+			rightRotate(parentPtr, grandPtr);
+		else
+			leftRotate(parentPtr, grandPtr);
+
+		//! The rotation recounted both from their children, the removed node is still below them
+		adjustSize(parentPtr, -1);
+		adjustSize(topPtr, -1);
+
+		//! Ensure correct coloring
+		nodePtr->setColor(Node::Red);
+		topPtr->setColor(Node::Red);
+		leftOf(topPtr)->setColor(Node::Black);
+		rightOf(topPtr)->setColor(Node::Black);
+	}
+
+	//! Replace and remove if found
+	if ( foundPtr != NULL )
+	{
+		foundPtr->value = std::move(nodePtr->value);
+
+		//! nodePtr has at most one child (the other side is the leaf)
+		Node* childPtr = ( leftOf(nodePtr) == theLeaf ) ? rightOf(nodePtr) : leftOf(nodePtr);
+
+		if ( rightOf(parentPtr) == nodePtr )
+			setRightChild(parentPtr, childPtr);
+		else
+			setLeftChild(parentPtr, childPtr);
+
+		//! Give the node back to the pool
+		destroyNode(nodePtr);
+		m_size--;
+	}
+
+	//! Change the pseudo root and the real root colors
+	blackenRoots();
+
+	if ( foundPtr == NULL )
+		return false;
+
+	//! Few values left: back inline
+	shrinkToInline();
+
+	return true;
+}
+
+/*!
+ * Contains function
+ * checks if a value is in the red black tree.
+ * Key can be any type comparable with Comparable through '<' (both ways),
+ * so no temporary Comparable has to be built
+ *
+ * @param key => value to be searched
+ *
+ * @return => true if found
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+bool RedBlackTree<Comparable, Compare, Allocator, Inline>::contains( const Key& key ) const
+{
+	if ( isInline() )
+		return findInline(key) != NULL;
+
+	return findNode(key) != theLeaf;
+}
+
+/*!
+ * Find function
+ * search a value in the red black tree
+ *
+ * @param key => value to be searched
+ *
+ * @return => pointer to the value stored in the tree, NULL if not found
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+const Comparable* RedBlackTree<Comparable, Compare, Allocator, Inline>::find( const Key& key ) const
+{
+	if ( isInline() )
+		return findInline(key);
+
+	Node* nodePtr = findNode(key);
+
+	return ( nodePtr != theLeaf ) ? &nodePtr->value : NULL;
+}
+
+/*!
+ * Find many function
+ * runs find() for a sequence of keys, group of them at a time. Each round
+ * moves every unfinished lookup of the group one level down and prefetches
+ * the node it goes to, so the cache misses of the group overlap instead of
+ * being paid one after the other
+ *
+ * @param first => keys begin
+ * @param last 	=> keys end
+ * @param out 	=> receives one const Comparable* per key (NULL if not found)
+ * @param group => lookups in lockstep (1 is a plain loop of find())
+ *
+ * @return => out past the last result
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class InputIterator, class OutputIterator>
+OutputIterator RedBlackTree<Comparable, Compare, Allocator, Inline>::find_many( InputIterator first, InputIterator last, OutputIterator out,
+															   size_t group ) const
+{
+	typedef typename iterator_traits<InputIterator>::value_type Key;
+
+	//! Nothing to overlap in the inline form
+	if ( isInline() )
+	{
+		for ( ; first != last; ++first )
+			*out++ = findInline(*first);
+
+		return out;
+	}
+
+	if ( group == 0 )
+		group = 1;
+
+	vector<Key> keys;
+	vector<Node*> nodes(group);
+	vector<const Comparable*> found(group);
+	keys.reserve(group);
+
+	while ( first != last )
+	{
+		//! Next group of keys, all starting at the root
+		keys.clear();
+
+		for ( ; first != last && keys.size() < group; ++first )
+			keys.push_back(*first);
+
+		size_t active = keys.size();
+
+		for ( size_t i = 0; i < keys.size(); i++ )
+		{
+			nodes[i] = rightOf(m_root);
+			found[i] = NULL;
+
+			if ( nodes[i] == theLeaf )
+				active--;
+		}
+
+		//! One level per lookup per round
+		while ( active > 0 )
+		{
+			for ( size_t i = 0; i < keys.size(); i++ )
+			{
+				Node* nodePtr = nodes[i];
+
+				if ( nodePtr == theLeaf )
+					continue;
+
+				if ( lessThan(keys[i], nodePtr->value) )
+					nodePtr = leftOf(nodePtr);
+				else if ( lessThan(nodePtr->value, keys[i]) )
+					nodePtr = rightOf(nodePtr);
+				else
+				{
+					found[i] = &nodePtr->value;
+					nodePtr = theLeaf;
+				}
+
+				if ( nodePtr == theLeaf )
+					active--;
+				else
+					__builtin_prefetch(nodePtr);
+
+				nodes[i] = nodePtr;
+			}
+		}
+
+		for ( size_t i = 0; i < keys.size(); i++ )
+			*out++ = found[i];
+	}
+
+	return out;
+}
+
+/*!
+ * Count function
+ * counts how many times a value is in the red black tree
+ *
+ * @param key => value to be counted
+ *
+ * @return => number of equal values
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+size_t RedBlackTree<Comparable, Compare, Allocator, Inline>::count( const Key& key ) const
+{
+	OperationTimer timer(*this, TreeStats::Search);
+
+	if ( isInline() )
+		return inlineBound(key, true) - inlineBound(key, false);
+
+	return count(rightOf(m_root), key);
+}
+
+/*!
+ * Search function
+ * descends from the root to the first node equal to key. Arithmetic keys
+ * go down to the leaf with no branch: the child is picked by index and
+ * the last node not less than key is kept (a conditional move), then
+ * that node is checked once
+ *
+ * @param key => value to be searched
+ *
+ * @return => the node found, theLeaf if not found
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::findNode( const Key& key ) const
+{
+	OperationTimer timer(*this, TreeStats::Search);
+
+	//! References the root
+	Node* nodePtr = rightOf(m_root);
+
+	if ( Branchless<Key>::value )
+	{
+		Node* boundPtr = theLeaf;
+
+		while ( nodePtr != theLeaf )
+		{
+			countStep();
+			countComparison();
+
+			bool right = nodePtr->value < key;
+
+			boundPtr = right ? boundPtr : nodePtr;
+			nodePtr = childAt(nodePtr, right);
+		}
+
+		return ( boundPtr != theLeaf && !(key < boundPtr->value) ) ? boundPtr : theLeaf;
+	}
+
+	//! Check if the referee node is different from the leaf
+	while ( nodePtr != theLeaf )
+	{
+		countStep();
+
+		//! Searched node is smaller than current node
+		if ( lessThan(key, nodePtr->value) )
+			nodePtr = leftOf(nodePtr);
+		//! Searched node is bigger than current node
+		else if ( lessThan(nodePtr->value, key) )
+			nodePtr = rightOf(nodePtr);
+		//! Found
+		else
+			break;
+	}
+
+	return nodePtr;
+}
+
+/*!
+ * Count function
+ * counts the nodes equal to key in the tree rooted at nodePtr.
+ * Only the equal nodes and the search path are visited
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param key		=> value to be counted
+ *
+ * @return => number of equal values
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+size_t RedBlackTree<Comparable, Compare, Allocator, Inline>::count( Node *nodePtr, const Key& key ) const
+{
+	size_t total = 0;
+
+	//! Equal values may lie on both sides, the rest of the path is a plain search
+	while ( nodePtr != theLeaf )
+	{
+		countStep();
+
+		if ( lessThan(key, nodePtr->value) )
+			nodePtr = leftOf(nodePtr);
+		else if ( lessThan(nodePtr->value, key) )
+			nodePtr = rightOf(nodePtr);
+		else
+		{
+			total += 1 + count(leftOf(nodePtr), key);
+			nodePtr = rightOf(nodePtr);
+		}
+	}
+
+	return total;
+}
+
+/*!
+ * Begin function
+ *
+ * @return => iterator to the smallest value (end() if empty)
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator RedBlackTree<Comparable, Compare, Allocator, Inline>::begin( void ) const
+{
+	if ( isInline() )
+		return const_iterator(size_t(0), this);
+
+	Node* nodePtr = rightOf(m_root);
+
+	if ( nodePtr == theLeaf )
+		return end();
+
+	//! The leftmost node
+	while ( leftOf(nodePtr) != theLeaf )
+		nodePtr = leftOf(nodePtr);
+
+	return const_iterator(nodePtr, this);
+}
+
+/*!
+ * Lower bound function
+ *
+ * @param key => value to be searched
+ *
+ * @return => iterator to the first value not less than key (end() if none)
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator RedBlackTree<Comparable, Compare, Allocator, Inline>::lower_bound( const Key& key ) const
+{
+	if ( isInline() )
+		return const_iterator(inlineBound(key, false), this);
+
+	Node* nodePtr = rightOf(m_root);
+	Node* resultPtr = m_root;
+
+	while ( nodePtr != theLeaf )
+	{
+		//! Candidate found, look for a smaller one on the left (picked by index, no branch)
+		bool right = lessThan(nodePtr->value, key);
+
+		resultPtr = right ? resultPtr : nodePtr;
+		nodePtr = childAt(nodePtr, right);
+	}
+
+	return const_iterator(resultPtr, this);
+}
+
+/*!
+ * Upper bound function
+ *
+ * @param key => value to be searched
+ *
+ * @return => iterator to the first value greater than key (end() if none)
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator RedBlackTree<Comparable, Compare, Allocator, Inline>::upper_bound( const Key& key ) const
+{
+	if ( isInline() )
+		return const_iterator(inlineBound(key, true), this);
+
+	Node* nodePtr = rightOf(m_root);
+	Node* resultPtr = m_root;
+
+	while ( nodePtr != theLeaf )
+	{
+		//! Candidate found, look for a smaller one on the left (picked by index, no branch)
+		bool right = !lessThan(key, nodePtr->value);
+
+		resultPtr = right ? resultPtr : nodePtr;
+		nodePtr = childAt(nodePtr, right);
+	}
+
+	return const_iterator(resultPtr, this);
+}
+
+/*!
+ * Equal range function
+ *
+ * @param key => value to be searched
+ *
+ * @return => [lower_bound(key), upper_bound(key))
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+pair<typename RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator, typename RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator>
+RedBlackTree<Comparable, Compare, Allocator, Inline>::equal_range( const Key& key ) const
+{
+	return make_pair(lower_bound(key), upper_bound(key));
+}
+
+/*!
+ * Rank function
+ * O(log n), only for ranked nodes
+ *
+ * @param key => value to be ranked
+ *
+ * @return => number of values less than key
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+size_t RedBlackTree<Comparable, Compare, Allocator, Inline>::rank( const Key& key ) const
+{
+	static_assert(Node::ranked, "rank() needs ranked nodes (RankedRedBlackTree)");
+
+	return countBelow(key, true);
+}
+
+/*!
+ * Select function
+ * O(log n), only for ranked nodes
+ *
+ * @param k => position (0 based) in the sorted order
+ *
+ * @return => iterator to the k-th smallest value (end() if k >= size())
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator RedBlackTree<Comparable, Compare, Allocator, Inline>::select( size_t k ) const
+{
+	static_assert(Node::ranked, "select() needs ranked nodes (RankedRedBlackTree)");
+
+	if ( isInline() )
+		return const_iterator(min(k, m_size), this);
+
+	Node* nodePtr = rightOf(m_root);
+
+	while ( nodePtr != theLeaf )
+	{
+		size_t leftSize = subtreeSize(leftOf(nodePtr));
+
+		if ( k < leftSize )
+			nodePtr = leftOf(nodePtr);
+		else if ( k == leftSize )
+			return const_iterator(nodePtr, this);
+		else
+		{
+			k -= leftSize + 1;
+			nodePtr = rightOf(nodePtr);
+		}
+	}
+
+	return end();
+}
+
+/*!
+ * Count range function
+ * O(log n), only for ranked nodes
+ *
+ * @param lo => lower bound (inclusive)
+ * @param hi => upper bound (inclusive)
+ *
+ * @return => number of values in [lo, hi]
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+size_t RedBlackTree<Comparable, Compare, Allocator, Inline>::count_range( const Key& lo, const Key& hi ) const
+{
+	static_assert(Node::ranked, "count_range() needs ranked nodes (RankedRedBlackTree)");
+
+	if ( lessThan(hi, lo) )
+		return 0;
+
+	return countBelow(hi, false) - countBelow(lo, true);
+}
+
+/*!
+ * Count below function
+ * sums the left sub tree sizes along the search path
+ *
+ * @param key 	 => value to be compared
+ * @param strict => count the values less than key (true) or not greater than key (false)
+ *
+ * @return => number of values
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+size_t RedBlackTree<Comparable, Compare, Allocator, Inline>::countBelow( const Key& key, bool strict ) const
+{
+	if ( isInline() )
+		return inlineBound(key, !strict);
+
+	Node* nodePtr = rightOf(m_root);
+	size_t total = 0;
+
+	while ( nodePtr != theLeaf )
+	{
+		//! The node and its left sub tree are below key
+		if ( strict ? lessThan(nodePtr->value, key) : !lessThan(key, nodePtr->value) )
+		{
+			total += subtreeSize(leftOf(nodePtr)) + 1;
+			nodePtr = rightOf(nodePtr);
+		}
+		else
+			nodePtr = leftOf(nodePtr);
+	}
+
+	return total;
+}
+
+/*!
+ * Unite function
+ * adds the values of other. other is copied into this tree's storage, then
+ * both trees are cut around the root of the copy, the halves are united
+ * (recursive function calls, in parallel with a pool) and joined back.
+ * it throws a bad_alloc exception if no enough space (before any change)
+ *
+ * @param other => the values to be added
+ * @param pool 	=> runs the halves in parallel (NULL: sequential)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::unite( const RedBlackTree& other, ThreadPool* pool )
+{
+	//! max(c, c) == c
+	if ( &other == this || other.empty() )
+		return;
+
+	//! The joins work on nodes: an inline other is copied to nodes first
+	if ( other.isInline() )
+	{
+		RedBlackTree copy(other);
+		copy.growToNodes();
+		unite(copy, pool);
+		return;
+	}
+
+	growToNodes();
+
+	Node* copyPtr = clone(other.rightOf(other.m_root), other);
+	SubTree copy = { copyPtr, blackHeight(copyPtr) };
+	NodeList dropped = emptyList();
+
+	setTree( uniteTrees(wholeTree(), copy, dropped, pool).root );
+	m_size = m_size + other.m_size - dropped.count;
+
+	//! The repeated values of the copy
+	destroyList(dropped);
+}
+
+/*!
+ * Intersect function
+ * keeps the values that other contains too
+ *
+ * @param other => the values to be kept
+ * @param pool 	=> runs the halves in parallel (NULL: sequential)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::intersect( const RedBlackTree& other, ThreadPool* pool )
+{
+	//! min(c, c) == c
+	if ( &other != this )
+		filter(other, true, pool);
+}
+
+/*!
+ * Subtract function
+ * removes the values that other contains
+ *
+ * @param other => the values to be removed
+ * @param pool 	=> runs the halves in parallel (NULL: sequential)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::subtract( const RedBlackTree& other, ThreadPool* pool )
+{
+	if ( &other == this )
+		clear();
+	else
+		filter(other, false, pool);
+}
+
+/*!
+ * Split at function
+ * cuts the tree at key in O(log n) and moves the upper part to upper: as it
+ * is if the allocator shares its nodes (plain nodes are counted, up to the
+ * smaller part), as a copy in upper's storage otherwise.
+ * it throws a bad_alloc exception if no enough space (the tree is put back
+ * together, upper is left empty)
+ *
+ * @param key 	=> first value to be moved
+ * @param upper => receives the values not less than key (another tree)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::split_at( const Key& key, RedBlackTree& upper )
+{
+	//! Inline: the values from the cut on are copied to upper
+	if ( isInline() )
+	{
+		size_t cut = inlineBound(key, false);
+
+		if ( inlineCapacity > 0 )
+			upper.rebuild( vector<Comparable>( inlineValues() + cut, inlineValues() + m_size ) );
+		else
+			upper.clear();
+		m_size = cut;
+		return;
+	}
+
+	//! Nodes any tree can take over: upper gets the cut part as it is
+	if ( Allocator::sharesNodes )
+	{
+		//! Its sentinels first, the only allocation (nothing is changed if it fails)
+		upper.clear();
+		upper.growToNodes();
+
+		SubTree lower, higher;
+		NodeList equal = emptyList();
+
+		splitTree(wholeTree(), key, lower, equal, higher);
+
+		SubTree none = { theLeaf, 0 };
+		higher = joinEqual(none, equal, higher);
+
+		size_t moved = countFirst(higher.root, lower.root, m_size);
+
+		setTree(lower.root);
+		upper.setTree(higher.root);
+		upper.m_size = moved;
+		m_size -= moved;
+
+		shrinkToInline();
+		upper.shrinkToInline();
+		return;
+	}
+
+	SubTree lower, higher;
+	NodeList equal = emptyList();
+
+	splitTree(wholeTree(), key, lower, equal, higher);
+
+	SubTree none = { theLeaf, 0 };
+	higher = joinEqual(none, equal, higher);
+
+	upper.clearNodes();
+
+	try
+	{
+		upper.setTree( upper.clone(higher.root, *this) );
+	}
+	catch ( ... )
+	{
+		setTree( join2(lower, higher).root );
+		throw;
+	}
+
+	//! The copied part leaves this tree
+	NodeList moved = emptyList();
+	listTree(higher.root, moved);
+
+	setTree(lower.root);
+	upper.m_size = moved.count;
+	m_size -= moved.count;
+
+	destroyList(moved);
+
+	shrinkToInline();
+	upper.shrinkToInline();
+}
+
+/*!
+ * Erase range function
+ * cuts the tree at lo and hi, drops the middle part and joins the rest
+ *
+ * @param lo => lower bound (inclusive)
+ * @param hi => upper bound (inclusive)
+ *
+ * @return => number of values removed
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+size_t RedBlackTree<Comparable, Compare, Allocator, Inline>::erase_range( const Key& lo, const Key& hi )
+{
+	if ( lessThan(hi, lo) )
+		return 0;
+
+	if ( isInline() )
+	{
+		Comparable* values = inlineValues();
+		size_t from = inlineBound(lo, false), to = inlineBound(hi, true);
+
+		std::move( values + to, values + m_size, values + from );
+		m_size -= to - from;
+
+		return to - from;
+	}
+
+	SubTree below, rest, middle, above;
+	NodeList removed = emptyList();
+
+	//! The values equal to lo or hi go to removed with the middle part
+	splitTree(wholeTree(), lo, below, removed, rest);
+	splitTree(rest, hi, middle, removed, above);
+	listTree(middle.root, removed);
+
+	setTree( join2(below, above).root );
+	m_size -= removed.count;
+
+	size_t total = removed.count;
+	destroyList(removed);
+
+	shrinkToInline();
+
+	return total;
+}
+
+/*!
+ * Freeze function
+ * copies the values, in order, to a read only snapshot
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @return => the snapshot
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+FrozenRedBlackTree<Comparable> RedBlackTree<Comparable, Compare, Allocator, Inline>::freeze( void ) const
+{
+	//! The snapshot searches with '<'
+	static_assert(DefaultOrder, "freeze() needs the default order");
+
+	return FrozenRedBlackTree<Comparable>(begin(), end());
+}
+
+/*!
+ * Open mmap function
+ * it throws a runtime_error exception if the file can't be mapped or isn't a valid image
+ *
+ * @param path 		=> the image file (see save)
+ * @param verify 	=> checks the checksum of the values too (reads them all)
+ *
+ * @return => the tree served from the mapping
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+MappedRedBlackTree<Comparable, RedBlackTree<Comparable, Compare, Allocator, Inline> >
+RedBlackTree<Comparable, Compare, Allocator, Inline>::open_mmap( const string& path, bool verify )
+{
+	//! The mapped snapshot searches with '<'
+	static_assert(DefaultOrder, "open_mmap() needs the default order");
+
+	return MappedRedBlackTree<Comparable, RedBlackTree>::open_mmap(path, verify);
+}
+
+/*!
+ * Iterator increment
+ * goes to the in-order successor: the leftmost node of the right sub tree,
+ * or the first ancestor reached from its left side
+ *
+ * @return => the iterator itself
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator& RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator::operator ++ ( void )
+{
+	//! Inline form: the next slot
+	if ( m_node == NULL )
+	{
+		m_slot++;
+		return *this;
+	}
+
+	if ( m_tree->rightOf(m_node) != m_tree->theLeaf )
+	{
+		m_node = m_tree->rightOf(m_node);
+
+		while ( m_tree->leftOf(m_node) != m_tree->theLeaf )
+			m_node = m_tree->leftOf(m_node);
+	}
+	else
+	{
+		Node* parentPtr = m_tree->parentOf(m_node);
+
+		//! Climb while coming from the right. Past the biggest value it stops at the pseudo root (end)
+		while ( parentPtr != m_tree->m_root && m_tree->rightOf(parentPtr) == m_node )
+		{
+			m_node = parentPtr;
+			parentPtr = m_tree->parentOf(parentPtr);
+		}
+
+		m_node = parentPtr;
+	}
+
+	return *this;
+}
+
+/*!
+ * Iterator decrement
+ * goes to the in-order predecessor; from end() it goes to the biggest value
+ *
+ * @return => the iterator itself
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator& RedBlackTree<Comparable, Compare, Allocator, Inline>::const_iterator::operator -- ( void )
+{
+	if ( m_node == NULL )
+	{
+		m_slot--;
+		return *this;
+	}
+
+	//! From end() (the pseudo root) go to the rightmost node
+	if ( m_node == m_tree->m_root )
+	{
+		m_node = m_tree->rightOf(m_node);
+
+		while ( m_tree->rightOf(m_node) != m_tree->theLeaf )
+			m_node = m_tree->rightOf(m_node);
+	}
+	else if ( m_tree->leftOf(m_node) != m_tree->theLeaf )
+	{
+		m_node = m_tree->leftOf(m_node);
+
+		while ( m_tree->rightOf(m_node) != m_tree->theLeaf )
+			m_node = m_tree->rightOf(m_node);
+	}
+	else
+	{
+		Node* parentPtr = m_tree->parentOf(m_node);
+
+		//! Climb while coming from the left
+		while ( m_tree->leftOf(parentPtr) == m_node )
+		{
+			m_node = parentPtr;
+			parentPtr = m_tree->parentOf(parentPtr);
+		}
+
+		m_node = parentPtr;
+	}
+
+	return *this;
+}
+
+/*!
+ * Stats function
+ * the shape is measured now, the counters are the ones kept since construction
+ *
+ * @return => the snapshot
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+TreeStats RedBlackTree<Comparable, Compare, Allocator, Inline>::stats( void ) const
+{
+	TreeStats snapshot;
+
+	snapshot.size = m_size;
+	snapshot.inlined = inlineCapacity > 0 && isInline();
+
+	//! The inline form has no node
+	if ( isInline() )
+	{
+		snapshot.height = snapshot.blackHeight = 0;
+		snapshot.nodeBytes = snapshot.reservedBytes = 0;
+	}
+	else
+	{
+		snapshot.height = height(rightOf(m_root));
+		snapshot.blackHeight = blackHeight(rightOf(m_root));
+
+		//! The leaf and the pseudo root are nodes too
+		snapshot.nodeBytes = ( m_size + 2 ) * sizeof(Node);
+		snapshot.reservedBytes = max( m_pool.capacity() * sizeof(Node), snapshot.nodeBytes );
+	}
+
+	fillStats(snapshot);
+
+	return snapshot;
+}
+
+/*!
+ * Print trigger function
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::print( void ) const
+{
+	//! The inline values, biggest first (as the tree is printed)
+	if ( isInline() )
+	{
+		for ( size_t i = m_size; i > 0; i-- )
+			cout << "[" << inlineValues()[i - 1] << "]" << endl;
+
+		return;
+	}
+
+	//! Call the print function (encapsulation)
+	print(rightOf(m_root), 0);
+}
+
+/*!
+ * Right rotation function
+ * rotates the node around its left child
+ *
+ * @param nodePtr 	=> the node itself (pointer)
+ * @param parentPtr => the parent node (pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::rightRotate( Node*& nodePtr, Node*& parentPtr )
+{
+	countRightRotation();
+
+	//! Temporaly variable to keep the left child
+	Node* temp = leftOf(nodePtr);
+
+	//! Change the left child for the right's one
+	setLeftChild(nodePtr, rightOf(temp));
+
+	//! Check if it's the right child
+	if ( rightOf(parentPtr) == nodePtr )
+	{
+		//! The temporaly variable receive the right child
+		setRightChild(parentPtr, temp);
+	}
+	else
+	{
+		//! The temporaly variable receive the left child
+		setLeftChild(parentPtr, temp);
+	}
+
+	//! Finalize the rotation
+	setRightChild(temp, nodePtr);
+
+	//! Recount the sub trees, the lower node first
+	updateSize(nodePtr);
+	updateSize(temp);
+}
+
+/*!
+ * Left rotation function
+ * rotates the node around its right child
+ *
+ * @param nodePtr 	=> the node itself (pointer)
+ * @param parentPtr => the parent node (pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::leftRotate( Node*& nodePtr, Node*& parentPtr )
+{
+	countLeftRotation();
+
+	//! Temporaly variable to keep the right child
+	Node* temp = rightOf(nodePtr);
+
+	//! Change the right child for the left's one
+	setRightChild(nodePtr, leftOf(temp));
+
+	//! Check if it's the right child
+	if ( rightOf(parentPtr) == nodePtr )
+	{
+		//! The temporaly variable receive the right child
+		setRightChild(parentPtr, temp);
+	}
+	else // if were dealing with the left child
+	{
+		//! The temporaly variable receive the left child
+		setLeftChild(parentPtr, temp);
+	}
+
+	//! Finalize the rotation
+	setLeftChild(temp, nodePtr);
+
+	//! Recount the sub trees, the lower node first
+	updateSize(nodePtr);
+	updateSize(temp);
+}
+
+/*!
+ * Split function
+ * splits a 4_node: the node goes up (red) and its children become black.
+ * If the parent is red too, one or two rotations fix the red-red violation.
+ * In this case nodePtr comes back pointing to the new sub tree root (black)
+ * and parentPtr to its parent; grandPtr and greatPtr are stale until the
+ * caller walks two levels down.
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param parentPtr => the parent node 	(pointer)
+ * @param grandPtr => the grandpa node 	(pointer)
+ * @param greatPtr => the great node 	(pointer)
+ *
+ * @return => true if the sub tree was rotated
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+bool RedBlackTree<Comparable, Compare, Allocator, Inline>::split ( Node*& nodePtr, Node*& parentPtr,
+ 									   Node*& grandPtr, Node*& greatPtr )
+{
+	countSplit();
+
+	//! Change the color to black (a new node's children are the leaf, black and left alone)
+	if ( rightOf(nodePtr) != theLeaf )
+		rightOf(nodePtr)->setColor(Node::Black);
+	if ( leftOf(nodePtr) != theLeaf )
+		leftOf(nodePtr)->setColor(Node::Black);
+
+	//! Check if it's a 2_node or a 3_node with the right orientation
+	if ( parentPtr->color() == Node::Black )
+	{
+		//! Change the color to red
+		nodePtr->setColor(Node::Red);
+		return false;
+	}
+
+	//! New sub tree root after the rotations
+	Node* topPtr;
+
+	//! If nodePtr is left child of its parent and parentPtr is left child of its parent
+	if ( (leftOf(parentPtr) == nodePtr) && (leftOf(grandPtr) == parentPtr) )
+	{
+		rightRotate(grandPtr, greatPtr); // rotate
+
+		swapColor(nodePtr, parentPtr, grandPtr); // swap the colors of nodePtr, parentPtr, and grandPtr
+		topPtr = parentPtr;
+	}
+	else if ( (leftOf(parentPtr) == nodePtr) && (rightOf(grandPtr) == parentPtr) )
+	{
+		rightRotate(parentPtr, grandPtr); // rotate
+		leftRotate(grandPtr, greatPtr);
+
+		grandPtr->setColor(Node::Red); // nodePtr stays black on top, parentPtr stays red
+		topPtr = nodePtr;
+	}
+	else if ( (rightOf(parentPtr) == nodePtr) && (leftOf(grandPtr) == parentPtr) )
+	{
+		leftRotate(parentPtr, grandPtr); // rotate
+		rightRotate(grandPtr, greatPtr);
+
+		grandPtr->setColor(Node::Red); // nodePtr stays black on top, parentPtr stays red
+		topPtr = nodePtr;
+	}
+	else
+	{
+		leftRotate(grandPtr, greatPtr); // rotate
+
+		swapColor(nodePtr, parentPtr, grandPtr); // swap the colors of nodePtr, parentPtr, and grandPtr
+		topPtr = parentPtr;
+	}
+
+	//! Go on from the new sub tree root. It's black, so the next split
+	//! below it can't rotate before grandPtr and greatPtr are walked again
+	nodePtr = topPtr;
+	parentPtr = greatPtr;
+	grandPtr = greatPtr = m_root;
+
+	return true;
+}
+
+/*!
+ * Node creation function
+ * builds a node in the allocator storage
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param v 	=> node value
+ * @param l 	=> left child 	(pointer)
+ * @param r 	=> right child 	(pointer)
+ * @param c 	=> node color
+ *
+ * @return => the new node
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::createNode( const Comparable& v, Node *l,
+																		 Node *r,
+																		 typename Node::NodeColor c )
+{
+	Node* nodePtr = constructNode(v);
+
+	nodePtr->setColor(c);
+
+	//! The leaf is built with NULL children, so it keeps its links to itself
+	if ( l != NULL )
+		setLeftChild(nodePtr, l);
+	if ( r != NULL )
+		setRightChild(nodePtr, r);
+
+	if ( l != NULL && r != NULL )
+		updateSize(nodePtr);
+
+	return nodePtr;
+}
+
+/*!
+ * Construct node function
+ * builds a black node in the allocator storage, linked to itself
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param args => the value constructor arguments
+ *
+ * @return => the new node
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class... Args>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::constructNode( Args&&... args )
+{
+	typename Allocator::link_type self = m_pool.allocate();
+	Node* nodePtr = m_pool.node(self);
+
+	try
+	{
+		new (nodePtr) Node( self, std::forward<Args>(args)... );
+	}
+	catch ( ... )
+	{
+		//! The value construction failed, give the storage back
+		m_pool.deallocate(self);
+		throw;
+	}
+
+	countAllocations(1);
+
+	return nodePtr;
+}
+
+/*!
+ * Node destruction function
+ * destroys the node and gives its storage back to the allocator
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::destroyNode( Node *nodePtr )
+{
+	typename Allocator::link_type self = m_pool.link(nodePtr);
+
+	nodePtr->~Node();
+	m_pool.deallocate(self);
+
+	countReleases(1);
+}
+
+/*!
+ * Release node function
+ * destroys the node and frees its storage into a chain. Nothing of the
+ * tree or of the allocator is changed, so any thread can call it
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param chain 	=> receives the storage
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::releaseNode( Node *nodePtr, typename Allocator::FreeChain& chain ) const
+{
+	typename Allocator::link_type self = m_pool.link(nodePtr);
+
+	nodePtr->~Node();
+	m_pool.chain(chain, self);
+
+	countReleases(1);
+}
+
+/*!
+ * Update size function
+ * recounts the sub tree size from the children (nothing for plain nodes)
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::updateSize( Node *nodePtr ) const
+{
+	if ( Node::ranked )
+		nodePtr->setSubtreeSize( 1 + subtreeSize(leftOf(nodePtr)) + subtreeSize(rightOf(nodePtr)) );
+}
+
+/*!
+ * Adjust size function
+ * adds delta to the sub tree size (nothing for plain nodes)
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param delta 	=> size change
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::adjustSize( Node *nodePtr, int delta ) const
+{
+	if ( Node::ranked )
+		nodePtr->setSubtreeSize( nodePtr->subtreeSize() + delta );
+}
+
+/*!
+ * Left child function
+ * links childPtr as the left child of nodePtr (and nodePtr as its parent)
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param childPtr 	=> the new child 	(pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::setLeftChild( Node *nodePtr, Node *childPtr )
+{
+	nodePtr->setLeft( m_pool.link(childPtr) );
+
+	//! The leaf is shared, so it has no parent
+	if ( childPtr != theLeaf )
+		childPtr->setParent( m_pool.link(nodePtr) );
+}
+
+/*!
+ * Right child function
+ * links childPtr as the right child of nodePtr (and nodePtr as its parent)
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param childPtr 	=> the new child 	(pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::setRightChild( Node *nodePtr, Node *childPtr )
+{
+	nodePtr->setRight( m_pool.link(childPtr) );
+
+	//! The leaf is shared, so it has no parent
+	if ( childPtr != theLeaf )
+		childPtr->setParent( m_pool.link(nodePtr) );
+}
+
+/*!
+ * Clone function
+ * walks both trees in lockstep, with no recursion: a child is copied when
+ * it is first reached, and both walks climb back by their parent links
+ * it throws a bad_alloc exception if no enough space (nothing is kept)
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param other 	=> the tree that owns nodePtr (it resolves the links)
+ *
+ * @return => the copied sub tree
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::clone( const Node * nodePtr, const RedBlackTree& other )
+{ 
+	//! If points to special leaf node
+	if ( nodePtr == other.theLeaf )
+		return theLeaf;
+
+	Node* rootPtr = createNode( nodePtr->value, theLeaf, theLeaf, nodePtr->color() );
+	const Node* sourcePtr = nodePtr;
+	Node* copyPtr = rootPtr;
+
+	try
+	{
+		while ( true )
+		{
+			const Node* leftPtr = other.leftOf(sourcePtr);
+			const Node* rightPtr = other.rightOf(sourcePtr);
+
+			//! The left child first, then the right one
+			if ( leftPtr != other.theLeaf && leftOf(copyPtr) == theLeaf )
+			{
+				setLeftChild( copyPtr, createNode( leftPtr->value, theLeaf, theLeaf, leftPtr->color() ) );
+				sourcePtr = leftPtr;
+				copyPtr = leftOf(copyPtr);
+			}
+			else if ( rightPtr != other.theLeaf && rightOf(copyPtr) == theLeaf )
+			{
+				setRightChild( copyPtr, createNode( rightPtr->value, theLeaf, theLeaf, rightPtr->color() ) );
+				sourcePtr = rightPtr;
+				copyPtr = rightOf(copyPtr);
+			}
+			else
+			{
+				//! Both sub trees are done
+				updateSize(copyPtr);
+
+				if ( sourcePtr == nodePtr )
+					break;
+
+				sourcePtr = other.parentOf(sourcePtr);
+				copyPtr = parentOf(copyPtr);
+			}
+		}
+	}
+	catch ( ... )
+	{
+		reclaimMemory(rootPtr);
+		throw;
+	}
+
+	return rootPtr;
+}
+
+/*!
+ * Copy tree function (arena copy)
+ * the allocator copies other's chunks into a new storage, then the links of
+ * the copied nodes are moved to the copies. The new storage replaces the
+ * current one only when the copy is complete. A sparse arena (more than half
+ * of it free) is copied node by node instead.
+ * it throws a bad_alloc exception if no enough space (nothing is changed)
+ *
+ * @param other => the tree to be copied
+ * @param pool 	=> the worker threads (NULL: sequential)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::copyTree( const RedBlackTree& other, ThreadPool* pool, true_type )
+{
+	if ( other.m_pool.capacity() > 2 * ( other.m_size + 2 ) )
+	{
+		copyTree(other, pool, false_type());
+		return;
+	}
+
+	Allocator arena;
+	typename Allocator::Relocation moved = arena.copy(other.m_pool, pool);
+	typename Allocator::link_type otherLeaf = other.m_pool.link(other.theLeaf);
+	int height = other.wholeTree().height;
+
+	//! The old nodes go with arena (trivially destructible, as they are trivially copyable)
+	countReleases( isInline() ? 0 : m_size + 2 );
+	countAllocations(other.m_size + 2);
+
+	m_pool.swap(arena);
+	theLeaf = m_pool.node( moved(otherLeaf) );
+	m_root = m_pool.node( moved(other.m_pool.link(other.m_root)) );
+	m_size = other.m_size;
+
+	if ( !Allocator::Relocation::moves )
+		return;
+
+	//! The leaf and the pseudo root link to themselves
+	theLeaf->setLeft( m_pool.link(theLeaf) );
+	theLeaf->setRight( m_pool.link(theLeaf) );
+	theLeaf->setParent( m_pool.link(theLeaf) );
+	m_root->setParent( m_pool.link(m_root) );
+
+	relocateNode(m_root, moved, otherLeaf);
+
+	relocateTree(rightOf(m_root), height, moved, otherLeaf, pool);
+}
+
+/*!
+ * Copy tree function (node by node)
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param other => the tree to be copied
+ * @param pool 	=> clears the current content (NULL: sequential)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::copyTree( const RedBlackTree& other, ThreadPool* pool, false_type )
+{
+	//! A tree that had no value gets the copy in one block (otherwise the freed slots are reused)
+	bool fresh = empty();
+
+	clearNodes(pool);
+
+	if ( fresh )
+		m_pool.reserve(other.m_size);
+
+	setRightChild(m_root, clone(other.rightOf(other.m_root), other));
+	m_size = other.m_size;
+}
+
+/*!
+ * Relocate node function
+ *
+ * @param nodePtr 	=> a copied node (pointer)
+ * @param moved 	=> the map from the copied nodes to the copies
+ * @param otherLeaf => leaf of the copied tree (it becomes theLeaf)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::relocateNode( Node *nodePtr, const typename Allocator::Relocation& moved,
+													   typename Allocator::link_type otherLeaf )
+{
+	typename Allocator::link_type l = nodePtr->left();
+	typename Allocator::link_type r = nodePtr->right();
+
+	setLeftChild( nodePtr, ( l == otherLeaf ) ? theLeaf : m_pool.node( moved(l) ) );
+	setRightChild( nodePtr, ( r == otherLeaf ) ? theLeaf : m_pool.node( moved(r) ) );
+}
+
+/*!
+ * Relocate tree function
+ * the top sub trees are run as pool tasks, each one walks its sub tree
+ * with no recursion: a node is relocated when it is reached, so its
+ * children and their parent links are right when the walk goes down
+ *
+ * @param nodePtr 	=> sub tree root, parent link already relocated (pointer)
+ * @param height 	=> its black height
+ * @param moved 	=> the map from the copied nodes to the copies
+ * @param otherLeaf => leaf of the copied tree
+ * @param pool 		=> the worker threads (NULL: sequential)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::relocateTree( Node *nodePtr, int height, const typename Allocator::Relocation& moved,
+													   typename Allocator::link_type otherLeaf, ThreadPool* pool )
+{
+	if ( nodePtr == theLeaf )
+		return;
+
+	relocateNode(nodePtr, moved, otherLeaf);
+
+	if ( pool != NULL && height >= ForkHeight )
+	{
+		int childHeight = height - ( nodePtr->color() == Node::Black ? 1 : 0 );
+		Node* leftPtr = leftOf(nodePtr);
+		Node* rightPtr = rightOf(nodePtr);
+
+		forkJoin( pool, true,
+				  [&]() { relocateTree(leftPtr, childHeight, moved, otherLeaf, pool); },
+				  [&]() { relocateTree(rightPtr, childHeight, moved, otherLeaf, pool); } );
+		return;
+	}
+
+	Node* topPtr = nodePtr;
+
+	while ( true )
+	{
+		//! Down: the left child first, then the right one
+		Node* nextPtr = leftOf(nodePtr);
+
+		if ( nextPtr == theLeaf )
+			nextPtr = rightOf(nodePtr);
+
+		//! Up: to the first ancestor whose right sub tree is still to be done
+		while ( nextPtr == theLeaf && nodePtr != topPtr )
+		{
+			Node* parentPtr = parentOf(nodePtr);
+
+			if ( leftOf(parentPtr) == nodePtr )
+				nextPtr = rightOf(parentPtr);
+
+			nodePtr = parentPtr;
+		}
+
+		if ( nextPtr == theLeaf )
+			return;
+
+		relocateNode(nextPtr, moved, otherLeaf);
+		nodePtr = nextPtr;
+	}
+}
+
+/*!
+ * Build function
+ * builds a perfectly balanced tree from values[lo, hi), the middle value
+ * goes to the root (recursive function calls)
+ *
+ * @param values 	=> sorted values
+ * @param lo 		=> first index
+ * @param hi 		=> one past the last index
+ * @param depth 	=> depth of the sub tree root
+ * @param redDepth 	=> depth of the red nodes
+ *
+ * @return => the sub tree root
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::build( const vector<Comparable>& values, size_t lo, size_t hi,
+																	  int depth, int redDepth )
+{
+	//! Empty range
+	if ( lo >= hi )
+		return theLeaf;
+
+	size_t mid = lo + (hi - lo) / 2;
+
+	Node* leftPtr = build(values, lo, mid, depth + 1, redDepth);
+	Node* nodePtr;
+
+	try
+	{
+		nodePtr = createNode( values[mid], leftPtr, theLeaf,
+							  ( depth == redDepth ) ? Node::Red : Node::Black );
+	}
+	catch ( ... )
+	{
+		reclaimMemory(leftPtr);
+		throw;
+	}
+
+	try
+	{
+		setRightChild(nodePtr, build(values, mid + 1, hi, depth + 1, redDepth));
+		updateSize(nodePtr);
+	}
+	catch ( ... )
+	{
+		reclaimMemory(nodePtr);
+		throw;
+	}
+
+	return nodePtr;
+}
+
+/*!
+ * Collect function
+ * appends the values of the tree rooted at nodePtr in order
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param values 	=> output vector
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::collect( Node *nodePtr, vector<Comparable>& values ) const
+{
+	//! Check if the node is not the leaf
+	if ( nodePtr != theLeaf )
+	{
+		collect(leftOf(nodePtr), values);
+		values.push_back(nodePtr->value);
+		collect(rightOf(nodePtr), values);
+	}
+}
+
+/*!
+ * Black height function
+ * counts the black nodes on the leftmost path (the same on every path)
+ *
+ * @param nodePtr 	=> the sub tree root (pointer)
+ *
+ * @return => black height (0 for the leaf)
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+int RedBlackTree<Comparable, Compare, Allocator, Inline>::blackHeight( const Node *nodePtr ) const
+{
+	int height = 0;
+
+	for ( ; nodePtr != theLeaf; nodePtr = leftOf(nodePtr) )
+		if ( nodePtr->color() == Node::Black )
+			height++;
+
+	return height;
+}
+
+/*!
+ * Height function
+ * walks the sub tree with an explicit stack (depth first)
+ *
+ * @param nodePtr => the sub tree root (pointer)
+ *
+ * @return => nodes on the longest path down, 0 for the leaf
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+int RedBlackTree<Comparable, Compare, Allocator, Inline>::height( const Node *nodePtr ) const
+{
+	if ( nodePtr == theLeaf )
+		return 0;
+
+	vector< pair<const Node*, int> > pending( 1, make_pair(nodePtr, 1) );
+	int deepest = 0;
+
+	while ( !pending.empty() )
+	{
+		const Node* currentPtr = pending.back().first;
+		int depth = pending.back().second;
+		pending.pop_back();
+
+		deepest = max(deepest, depth);
+
+		if ( leftOf(currentPtr) != theLeaf )
+			pending.push_back( make_pair( leftOf(currentPtr), depth + 1 ) );
+
+		if ( rightOf(currentPtr) != theLeaf )
+			pending.push_back( make_pair( rightOf(currentPtr), depth + 1 ) );
+	}
+
+	return deepest;
+}
+
+/*!
+ * Whole tree function
+ *
+ * @return => the real root and its black height
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::SubTree RedBlackTree<Comparable, Compare, Allocator, Inline>::wholeTree( void ) const
+{
+	SubTree t = { rightOf(m_root), blackHeight(rightOf(m_root)) };
+
+	return t;
+}
+
+/*!
+ * Set tree function
+ * places rootPtr under the pseudo root, as the (black) real root
+ *
+ * @param rootPtr 	=> the new real root (pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::setTree( Node *rootPtr )
+{
+	setRightChild(m_root, rootPtr);
+
+	if ( rootPtr != theLeaf )
+		rootPtr->setColor(Node::Black);
+}
+
+/*!
+ * Next node function
+ * pre-order step inside the sub tree of topPtr: the left child first, then
+ * the right one, then up by the parent links (never above topPtr)
+ *
+ * @param nodePtr 	=> the current node, moved to the next one (pointer)
+ * @param topPtr 	=> root of the sub tree walked (pointer)
+ *
+ * @return => false if nodePtr was the last node of the sub tree
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+bool RedBlackTree<Comparable, Compare, Allocator, Inline>::nextNode( Node*& nodePtr, const Node *topPtr ) const
+{
+	Node* nextPtr = leftOf(nodePtr);
+
+	if ( nextPtr == theLeaf )
+		nextPtr = rightOf(nodePtr);
+
+	while ( nextPtr == theLeaf && nodePtr != topPtr )
+	{
+		Node* parentPtr = parentOf(nodePtr);
+
+		if ( leftOf(parentPtr) == nodePtr )
+			nextPtr = rightOf(parentPtr);
+
+		nodePtr = parentPtr;
+	}
+
+	if ( nextPtr == theLeaf )
+		return false;
+
+	nodePtr = nextPtr;
+
+	return true;
+}
+
+/*!
+ * Count first function
+ * nodes under aPtr: read from the ranks, or counted by walking both sub
+ * trees one node at a time until the smaller one is done
+ *
+ * @param aPtr 	=> root of the sub tree counted (pointer)
+ * @param bPtr 	=> root of the other sub tree (pointer)
+ * @param total => nodes in both
+ *
+ * @return => number of nodes under aPtr
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+size_t RedBlackTree<Comparable, Compare, Allocator, Inline>::countFirst( Node *aPtr, Node *bPtr, size_t total ) const
+{
+	if ( Node::ranked )
+		return subtreeSize(aPtr);
+
+	const Node* aTop = aPtr;
+	const Node* bTop = bPtr;
+	bool aLeft = ( aPtr != theLeaf ), bLeft = ( bPtr != theLeaf );
+	size_t count = 0;
+
+	while ( aLeft && bLeft )
+	{
+		count++;
+		aLeft = nextNode(aPtr, aTop);
+		bLeft = nextNode(bPtr, bTop);
+	}
+
+	//! b done first: the rest is a
+	return aLeft ? total - count : count;
+}
+
+/*!
+ * Child function
+ *
+ * @param t 		=> the sub tree
+ * @param childPtr 	=> a child of its root (pointer)
+ *
+ * @return => the child sub tree
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::SubTree RedBlackTree<Comparable, Compare, Allocator, Inline>::childOf( const SubTree& t, Node *childPtr ) const
+{
+	SubTree child = { childPtr, t.height - ( t.root->color() == Node::Black ? 1 : 0 ) };
+
+	return child;
+}
+
+/*!
+ * Join function
+ * both roots are made black first (a red root turned black is one more
+ * black level), then the lower tree hangs from the spine of the higher one
+ * at the first black node of the same black height, under k (red). A
+ * red-red pair left on the way back is fixed with a rotation.
+ *
+ * @param l => values not greater than k
+ * @param k => the middle node (detached)
+ * @param r => values not less than k
+ *
+ * @return => the joined sub tree
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::SubTree RedBlackTree<Comparable, Compare, Allocator, Inline>::join( SubTree l, Node *k, SubTree r )
+{
+	if ( l.root != theLeaf && l.root->color() == Node::Red )
+	{
+		l.root->setColor(Node::Black);
+		l.height++;
+	}
+
+	if ( r.root != theLeaf && r.root->color() == Node::Red )
+	{
+		r.root->setColor(Node::Black);
+		r.height++;
+	}
+
+	SubTree t;
+
+	if ( l.height > r.height )
+	{
+		t.root = joinRight(l.root, l.height, k, r);
+		t.height = l.height;
+	}
+	else if ( l.height < r.height )
+	{
+		t.root = joinLeft(l, k, r.root, r.height);
+		t.height = r.height;
+	}
+	else
+	{
+		//! Same height: k on top
+		k->setColor(Node::Red);
+		setLeftChild(k, l.root);
+		setRightChild(k, r.root);
+		updateSize(k);
+
+		t.root = k;
+		t.height = l.height;
+	}
+
+	return t;
+}
+
+/*!
+ * Join right function
+ * walks the right spine of t down to the first black node of r's height
+ * and puts k (red) in its place, with that node and r as children
+ * (recursive function calls, one per level walked)
+ *
+ * @param t 		=> sub tree root (pointer)
+ * @param height 	=> black height of t
+ * @param k 		=> the middle node (detached)
+ * @param r 		=> the lower sub tree, black root
+ *
+ * @return => the new sub tree root
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::joinRight( Node *t, int height, Node *k, const SubTree& r )
+{
+	//! The leaf is black with height 0, so the walk always ends
+	if ( t->color() == Node::Black && height == r.height )
+	{
+		k->setColor(Node::Red);
+		setLeftChild(k, t);
+		setRightChild(k, r.root);
+		updateSize(k);
+
+		return k;
+	}
+
+	Node* childPtr = joinRight(rightOf(t), height - ( t->color() == Node::Black ? 1 : 0 ), k, r);
+	setRightChild(t, childPtr);
+
+	//! Red child with a red right child: rotate the child up, its right child turns black
+	if ( t->color() == Node::Black && childPtr->color() == Node::Red && rightOf(childPtr)->color() == Node::Red )
+	{
+		rightOf(childPtr)->setColor(Node::Black);
+		setRightChild(t, leftOf(childPtr));
+		setLeftChild(childPtr, t);
+
+		updateSize(t);
+		updateSize(childPtr);
+
+		return childPtr;
+	}
+
+	updateSize(t);
+
+	return t;
+}
+
+/*!
+ * Join left function
+ * mirror of joinRight: walks the left spine of t
+ *
+ * @param l 		=> the lower sub tree, black root
+ * @param k 		=> the middle node (detached)
+ * @param t 		=> sub tree root (pointer)
+ * @param height 	=> black height of t
+ *
+ * @return => the new sub tree root
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::joinLeft( const SubTree& l, Node *k, Node *t, int height )
+{
+	if ( t->color() == Node::Black && height == l.height )
+	{
+		k->setColor(Node::Red);
+		setLeftChild(k, l.root);
+		setRightChild(k, t);
+		updateSize(k);
+
+		return k;
+	}
+
+	Node* childPtr = joinLeft(l, k, leftOf(t), height - ( t->color() == Node::Black ? 1 : 0 ));
+	setLeftChild(t, childPtr);
+
+	if ( t->color() == Node::Black && childPtr->color() == Node::Red && leftOf(childPtr)->color() == Node::Red )
+	{
+		leftOf(childPtr)->setColor(Node::Black);
+		setLeftChild(t, rightOf(childPtr));
+		setRightChild(childPtr, t);
+
+		updateSize(t);
+		updateSize(childPtr);
+
+		return childPtr;
+	}
+
+	updateSize(t);
+
+	return t;
+}
+
+/*!
+ * Join without a middle node function
+ * the smallest node of r becomes the middle node
+ *
+ * @param l => values not greater than the ones of r
+ * @param r => the other values
+ *
+ * @return => the joined sub tree
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::SubTree RedBlackTree<Comparable, Compare, Allocator, Inline>::join2( const SubTree& l, const SubTree& r )
+{
+	if ( r.root == theLeaf )
+		return l;
+
+	if ( l.root == theLeaf )
+		return r;
+
+	SubTree rest;
+	Node* firstPtr = splitFirst(r, rest);
+
+	return join(l, firstPtr, rest);
+}
+
+/*!
+ * Split first function
+ * takes the leftmost node out and joins back the sub trees on the way up
+ * (recursive function calls)
+ *
+ * @param t 	=> the sub tree (not empty)
+ * @param rest 	=> receives the sub tree without its smallest node
+ *
+ * @return => the smallest node (detached)
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node* RedBlackTree<Comparable, Compare, Allocator, Inline>::splitFirst( const SubTree& t, SubTree& rest )
+{
+	SubTree right = childOf(t, rightOf(t.root));
+
+	if ( leftOf(t.root) == theLeaf )
+	{
+		rest = right;
+		return t.root;
+	}
+
+	SubTree leftRest;
+	Node* firstPtr = splitFirst(childOf(t, leftOf(t.root)), leftRest);
+
+	rest = join(leftRest, t.root, right);
+
+	return firstPtr;
+}
+
+/*!
+ * Split function
+ * follows the search path of key: the nodes on it and their sub trees
+ * are joined into the lower or the upper part as the recursion returns,
+ * so the joins cost O(log n) in total. Equal values may lie on both sides
+ * of an equal node, so both are split.
+ *
+ * @param t 	=> the sub tree
+ * @param key 	=> where to split
+ * @param lower => receives the values less than key
+ * @param equal => receives the nodes equal to key (pushed to the list)
+ * @param upper => receives the values greater than key
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Key>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::splitTree( const SubTree& t, const Key& key, SubTree& lower, NodeList& equal, SubTree& upper )
+{
+	if ( t.root == theLeaf )
+	{
+		lower = upper = t;
+		return;
+	}
+
+	Node* nodePtr = t.root;
+	SubTree left = childOf(t, leftOf(nodePtr));
+	SubTree right = childOf(t, rightOf(nodePtr));
+
+	if ( lessThan(key, nodePtr->value) )
+	{
+		splitTree(left, key, lower, equal, upper);
+		upper = join(upper, nodePtr, right);
+	}
+	else if ( lessThan(nodePtr->value, key) )
+	{
+		splitTree(right, key, lower, equal, upper);
+		lower = join(left, nodePtr, lower);
+	}
+	else
+	{
+		//! Nothing on the left is greater than key, nothing on the right is less
+		SubTree none;
+
+		splitTree(left, key, lower, equal, none);
+		splitTree(right, key, none, equal, upper);
+		listPush(equal, nodePtr);
+	}
+}
+
+/*!
+ * Join equal function
+ *
+ * @param l 	=> values not greater than the equal ones
+ * @param equal => equal nodes (the list is emptied)
+ * @param r 	=> values not less than the equal ones
+ *
+ * @return => the joined sub tree
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::SubTree RedBlackTree<Comparable, Compare, Allocator, Inline>::joinEqual( const SubTree& l, NodeList& equal, const SubTree& r )
+{
+	if ( equal.count == 0 )
+		return join2(l, r);
+
+	SubTree none = { theLeaf, 0 };
+	SubTree t = r;
+	Node* nodePtr = ( equal.count > 1 ) ? leftOf(equal.head) : NULL;
+
+	//! The first node joins l, the others are joined one by one on r (join overwrites the chain link)
+	for ( size_t i = 1; i < equal.count; i++ )
+	{
+		Node* nextPtr = ( i + 1 < equal.count ) ? leftOf(nodePtr) : NULL;
+
+		t = join(none, nodePtr, t);
+		nodePtr = nextPtr;
+	}
+
+	t = join(l, equal.head, t);
+	equal = emptyList();
+
+	return t;
+}
+
+/*!
+ * Unite trees function
+ * both trees are cut around the root of b; the values equal to it stay
+ * max(c1, c2) times (a's first), the lower and the upper halves are united
+ * (recursive function calls, in parallel for big sub trees) and joined
+ *
+ * @param a 		=> the tree's own values
+ * @param b 		=> the copy of the other tree
+ * @param dropped 	=> receives the repeated nodes of b
+ * @param pool 		=> runs the halves in parallel (NULL: sequential)
+ *
+ * @return => the united sub tree
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::SubTree RedBlackTree<Comparable, Compare, Allocator, Inline>::uniteTrees( const SubTree& a, const SubTree& b,
+																				NodeList& dropped, ThreadPool* pool )
+{
+	if ( a.root == theLeaf )
+		return b;
+
+	if ( b.root == theLeaf )
+		return a;
+
+	//! The pivot stays in place until both splits are done
+	const Comparable& key = b.root->value;
+
+	SubTree aLower, aUpper, bLower, bUpper;
+	NodeList aEqual = emptyList(), bEqual = emptyList();
+
+	splitTree(a, key, aLower, aEqual, aUpper);
+	splitTree(b, key, bLower, bEqual, bUpper);
+
+	listMove(bEqual, min(aEqual.count, bEqual.count), dropped);
+	listAppend(aEqual, bEqual);
+
+	SubTree lower, upper;
+	NodeList lowerDropped = emptyList();
+
+	forkJoin( pool, max(a.height, b.height) >= ForkHeight,
+			  [&]() { lower = uniteTrees(aLower, bLower, lowerDropped, pool); },
+			  [&]() { upper = uniteTrees(aUpper, bUpper, dropped, pool); } );
+
+	listAppend(dropped, lowerDropped);
+
+	return joinEqual(lower, aEqual, upper);
+}
+
+/*!
+ * Filter trees function
+ * a is cut around a node of the other tree; of the values equal to it
+ * min(c1, c2) (common) or c1 - min(c1, c2) (!common) stay, and the lower
+ * and the upper halves are filtered with the node's children (recursive
+ * function calls, in parallel for big sub trees). Nothing is left of a
+ * below a leaf of other when common.
+ *
+ * @param a 			=> the tree's own values
+ * @param otherPtr 		=> a node of other (pointer)
+ * @param otherHeight 	=> its black height
+ * @param other 		=> the other tree (it resolves the links)
+ * @param common 		=> keep the values in other (true) or the ones not in it (false)
+ * @param dropped 		=> receives the nodes taken out
+ * @param pool 			=> runs the halves in parallel (NULL: sequential)
+ *
+ * @return => the filtered sub tree
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+typename RedBlackTree<Comparable, Compare, Allocator, Inline>::SubTree RedBlackTree<Comparable, Compare, Allocator, Inline>::filterTrees( const SubTree& a, Node *otherPtr,
+																				 int otherHeight, const RedBlackTree& other,
+																				 bool common, NodeList& dropped,
+																				 ThreadPool* pool )
+{
+	if ( a.root == theLeaf )
+		return a;
+
+	if ( otherPtr == other.theLeaf )
+	{
+		if ( !common )
+			return a;
+
+		listTree(a.root, dropped);
+
+		SubTree none = { theLeaf, 0 };
+		return none;
+	}
+
+	const Comparable& key = otherPtr->value;
+
+	SubTree below, above;
+	NodeList equal = emptyList();
+
+	splitTree(a, key, below, equal, above);
+
+	//! The other sub tree holds every copy of key below this point
+	size_t shared = ( equal.count > 0 ) ? min(equal.count, other.count(otherPtr, key)) : 0;
+
+	listMove(equal, common ? equal.count - shared : shared, dropped);
+
+	int childHeight = otherHeight - ( otherPtr->color() == Node::Black ? 1 : 0 );
+	SubTree lower, upper;
+	NodeList lowerDropped = emptyList();
+
+	forkJoin( pool, max(a.height, otherHeight) >= ForkHeight,
+			  [&]() { lower = filterTrees(below, other.leftOf(otherPtr), childHeight, other, common, lowerDropped, pool); },
+			  [&]() { upper = filterTrees(above, other.rightOf(otherPtr), childHeight, other, common, dropped, pool); } );
+
+	listAppend(dropped, lowerDropped);
+
+	return joinEqual(lower, equal, upper);
+}
+
+/*!
+ * Filter function
+ *
+ * @param other 	=> the other tree
+ * @param common 	=> keep the values in other (true) or the ones not in it (false)
+ * @param pool 		=> runs the halves in parallel (NULL: sequential)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::filter( const RedBlackTree& other, bool common, ThreadPool* pool )
+{
+	if ( empty() )
+		return;
+
+	//! The joins work on nodes (see unite)
+	if ( other.isInline() )
+	{
+		RedBlackTree copy(other);
+		copy.growToNodes();
+		filter(copy, common, pool);
+		return;
+	}
+
+	growToNodes();
+
+	Node* otherRoot = other.rightOf(other.m_root);
+	NodeList dropped = emptyList();
+
+	setTree( filterTrees(wholeTree(), otherRoot, other.blackHeight(otherRoot), other, common, dropped, pool).root );
+	m_size -= dropped.count;
+
+	destroyList(dropped);
+
+	shrinkToInline();
+}
+
+/*!
+ * Fork join function
+ * left runs as a task of the pool while the calling thread runs right.
+ * If the task can't be queued (no memory), left runs here afterwards
+ *
+ * @param pool 	=> the pool (NULL: sequential)
+ * @param fork 	=> worth a task
+ * @param left 	=> first function
+ * @param right => second function
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+template <class Left, class Right>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::forkJoin( ThreadPool* pool, bool fork, Left left, Right right )
+{
+	if ( pool == NULL || !fork )
+	{
+		left();
+		right();
+		return;
+	}
+
+	ThreadPool::TaskGroup group(*pool);
+	bool queued = true;
+
+	try
+	{
+		group.run(left);
+	}
+	catch ( ... )
+	{
+		queued = false;
+	}
+
+	right();
+
+	if ( queued )
+		group.wait();
+	else
+		left();
+}
+
+/*!
+ * List push function
+ *
+ * @param list 		=> the list
+ * @param nodePtr 	=> the node (detached), it goes first
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::listPush( NodeList& list, Node *nodePtr )
+{
+	if ( list.count == 0 )
+		list.tail = nodePtr;
+	else
+		nodePtr->setLeft( m_pool.link(list.head) );
+
+	list.head = nodePtr;
+	list.count++;
+}
+
+/*!
+ * List move function
+ *
+ * @param from 	=> the source list
+ * @param n 	=> number of nodes moved (the first ones)
+ * @param to 	=> the destination list
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::listMove( NodeList& from, size_t n, NodeList& to )
+{
+	for ( size_t i = 0; i < n; i++ )
+	{
+		Node* nodePtr = from.head;
+
+		if ( --from.count > 0 )
+			from.head = leftOf(nodePtr);
+
+		listPush(to, nodePtr);
+	}
+
+	if ( from.count == 0 )
+		from = emptyList();
+}
+
+/*!
+ * List append function
+ *
+ * @param list 	=> the list
+ * @param other => nodes added to the end of list
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::listAppend( NodeList& list, const NodeList& other )
+{
+	if ( other.count == 0 )
+		return;
+
+	if ( list.count == 0 )
+	{
+		list = other;
+		return;
+	}
+
+	list.tail->setLeft( m_pool.link(other.head) );
+	list.tail = other.tail;
+	list.count += other.count;
+}
+
+/*!
+ * List tree function
+ * pushes every node of the sub tree (the same walk as reclaimMemory)
+ *
+ * @param nodePtr 	=> the sub tree root (pointer)
+ * @param list 		=> the list
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::listTree( Node *nodePtr, NodeList& list )
+{
+	while ( nodePtr != theLeaf )
+	{
+		Node* leftPtr = leftOf(nodePtr);
+
+		if ( leftPtr != theLeaf )
+		{
+			nodePtr->setLeft( leftPtr->right() );
+			leftPtr->setRight( m_pool.link(nodePtr) );
+			nodePtr = leftPtr;
+		}
+		else
+		{
+			Node* rightPtr = rightOf(nodePtr);
+
+			listPush(list, nodePtr);
+			nodePtr = rightPtr;
+		}
+	}
+}
+
+/*!
+ * Destroy list function
+ *
+ * @param list 	=> the nodes to be destroyed (the list is emptied)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::destroyList( NodeList& list )
+{
+	Node* nodePtr = list.head;
+
+	for ( size_t i = 0; i < list.count; i++ )
+	{
+		Node* nextPtr = ( i + 1 < list.count ) ? leftOf(nodePtr) : NULL;
+
+		destroyNode(nodePtr);
+		nodePtr = nextPtr;
+	}
+
+	list = emptyList();
+}
+
+/*!
+ * Function to release the allocated memory
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::reclaimMemory( Node *nodePtr )
+{
+	//! No recursion: a left child is rotated up until the node has none, then the
+	//! node is destroyed and the walk goes on with its right child
+	while ( nodePtr != theLeaf )
+	{
+		Node* leftPtr = leftOf(nodePtr);
+
+		if ( leftPtr != theLeaf )
+		{
+			nodePtr->setLeft( leftPtr->right() );
+			leftPtr->setRight( m_pool.link(nodePtr) );
+			nodePtr = leftPtr;
+		}
+		else
+		{
+			Node* rightPtr = rightOf(nodePtr);
+
+			//! Give the node back to the pool
+			destroyNode(nodePtr);
+			nodePtr = rightPtr;
+		}
+	}
+}
+
+/*!
+ * Reclaim tree function
+ * the sub trees at least ForkHeight high are split into two pool tasks,
+ * the smaller ones are walked as in reclaimMemory
+ *
+ * @param nodePtr 	=> the sub tree root (pointer)
+ * @param height 	=> its black height
+ * @param chain 	=> receives the storage
+ * @param pool 		=> the worker threads
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::reclaimTree( Node *nodePtr, int height, typename Allocator::FreeChain& chain,
+													  ThreadPool* pool )
+{
+	if ( height >= ForkHeight )
+	{
+		int childHeight = height - ( nodePtr->color() == Node::Black ? 1 : 0 );
+		Node* leftPtr = leftOf(nodePtr);
+		Node* rightPtr = rightOf(nodePtr);
+		typename Allocator::FreeChain leftChain;
+
+		forkJoin( pool, true,
+				  [&]() { reclaimTree(leftPtr, childHeight, leftChain, pool); },
+				  [&]() { reclaimTree(rightPtr, childHeight, chain, pool); } );
+
+		m_pool.join(chain, leftChain);
+		releaseNode(nodePtr, chain);
+		return;
+	}
+
+	while ( nodePtr != theLeaf )
+	{
+		Node* leftPtr = leftOf(nodePtr);
+
+		if ( leftPtr != theLeaf )
+		{
+			nodePtr->setLeft( leftPtr->right() );
+			leftPtr->setRight( m_pool.link(nodePtr) );
+			nodePtr = leftPtr;
+		}
+		else
+		{
+			Node* rightPtr = rightOf(nodePtr);
+
+			releaseNode(nodePtr, chain);
+			nodePtr = rightPtr;
+		}
+	}
+}
+
+/*!
+ * Print function
+ * prints the tree from nodePtr
+ *
+ * @param nodePtr 	=> the node itself 	(pointer)
+ * @param level		=> the tree's depth
+ *
+ * @return => void
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+void RedBlackTree<Comparable, Compare, Allocator, Inline>::print( Node *nodePtr, int level ) const
+{
+	//! Check if the node is not the leaf
+	if ( nodePtr == theLeaf )
+		return;
+
+	//! Reverse in-order walk by the parent links: the right sub tree first
+	Node* topPtr = nodePtr;
+
+	for ( ; rightOf(nodePtr) != theLeaf; level++ )
+		nodePtr = rightOf(nodePtr);
+
+	while ( true )
+	{
+		//! Print blank spaces accordingly to the depth
+		for ( int i = 0; i < level; i++ )
+		{
+			cout << "    ";
+		}
 
 		//! Print the node
-		cout << ((nodePtr->color==RBTreeNode<Comparable>::Black) ? "b[" : "r[") << nodePtr->value << "]" << endl;
+		cout << ((nodePtr->color()==Node::Black) ? "b[" : "r[") << nodePtr->value << "]" << endl;
+
+		//! Next: the rightmost node of the left sub tree...
+		if ( leftOf(nodePtr) != theLeaf )
+		{
+			nodePtr = leftOf(nodePtr);
+			level++;
+
+			for ( ; rightOf(nodePtr) != theLeaf; level++ )
+				nodePtr = rightOf(nodePtr);
+
+			continue;
+		}
+
+		//! ... or the first ancestor reached from its right side
+		while ( nodePtr != topPtr && leftOf(parentOf(nodePtr)) == nodePtr )
+		{
+			nodePtr = parentOf(nodePtr);
+			level--;
+		}
+
+		if ( nodePtr == topPtr )
+			return;
 
-		//! Call the print function recursively
-		print( nodePtr->lChildPtr, level+1 );
+		nodePtr = parentOf(nodePtr);
+		level--;
 	}
 }
\ No newline at end of file
@@ -28,6 +28,19 @@
 #include <cmath>
 #include <stdexcept>
 #include <cassert>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <functional>
+#include <cstdint>
+
+#include "NodePool.h"
+#include "FrozenRedBlackTree.h"
+#include "ThreadPool.h"
+#include "TreeStats.h"
 
 using namespace std;
 
@@ -35,75 +48,541 @@ using namespace std;
 // RBTreeNode( )        --> Class constructor
 // *********************************************************
 
-/*! Class prototype */
-template <class Comparable>
+/*! Class prototypes */
+template <class Comparable, bool Ranked = false>
+class RBTreeNode;
+
+template <class Comparable, class Compare = less<Comparable>, class Allocator = NodePool< RBTreeNode<Comparable> >, bool Inline = false>
 class RedBlackTree;
 
-/*! The node is a class with a constructor and overloads '<' operator */
+template <class Comparable, class Tree>
+class MappedRedBlackTree;
+
+/*! Node colors, shared by every node layout */
+class RBTreeColor
+{
+    protected:
+
+        /*! Enum to define the node color */
+        enum NodeColor {Red, Black};
+};
+
+/*! Sub tree size kept by the ranked nodes (order statistics).
+ *  The plain nodes inherit the empty version, so they don't pay for it
+*/
+template <bool Ranked>
+class RBTreeRank
+{
+    protected:
+
+        size_t subtreeSize( void ) const { return 0; }
+        void setSubtreeSize( size_t ) { /*! empty */ }
+};
+
+template <>
+class RBTreeRank<true>
+{
+    protected:
+
+        size_t subtreeSize( void ) const { return m_subtreeSize; }
+        void setSubtreeSize( size_t n ) { m_subtreeSize = n; }
+
+    private:
+
+        size_t m_subtreeSize;   //!< number of nodes in the sub tree rooted here
+};
+
+/*! Inline storage of the small trees: up to inlineCapacity values kept sorted in the tree
+ *  object itself (see SmallRedBlackTree). Only for trivially copyable values up to 16 bytes;
+ *  the trees without it inherit the empty version and take no room
+*/
+template <class Comparable, bool Inline>
+class RBTreeInline
+{
+    protected:
+
+        static const size_t inlineCapacity = 0;
+
+        Comparable* inlineValues( void ) { return NULL; }
+        const Comparable* inlineValues( void ) const { return NULL; }
+        void swapInline( RBTreeInline& ) noexcept { /*! empty */ }
+};
+
 template <class Comparable>
-class RBTreeNode
+class RBTreeInline<Comparable, true>
 {
-    /*! Enum to define the node color */
-    enum NodeColor {Red, Black};
+    static_assert(is_trivially_copyable<Comparable>::value && sizeof(Comparable) <= 16,
+                  "the inline form needs trivially copyable values up to 16 bytes");
+
+    protected:
+
+        /*! 128 bytes of values: 32 ints, 16 doubles */
+        static const size_t inlineCapacity = 128 / sizeof(Comparable);
+
+        Comparable* inlineValues( void ) { return reinterpret_cast<Comparable*>( &m_inline ); }
+        const Comparable* inlineValues( void ) const { return reinterpret_cast<const Comparable*>( &m_inline ); }
+        void swapInline( RBTreeInline& other ) noexcept { std::swap(m_inline, other.m_inline); }
+
+    private:
+
+        typename aligned_storage< inlineCapacity * sizeof(Comparable), alignof(Comparable) >::type m_inline;
+};
+
+/*! The node is a class with a constructor and overloads '<' operator.
+ *  Ranked nodes also keep their sub tree size (see RankedRedBlackTree).
+ *  The tree reaches the links and the color only through the accessors below,
+ *  so the compact layouts (PackedRBTreeNode, IndexedRBTreeNode) can store them
+ *  differently. A link is what the allocator resolves into a node (a pointer here);
+ *  a new node links to itself until it is placed in the tree. The children are kept
+ *  in an array, so a descent can pick one by index (child(right)) instead of a branch
+*/
+template <class Comparable, bool Ranked>
+class RBTreeNode : public RBTreeColor, public RBTreeRank<Ranked>
+{
+    /*! Link to another node */
+    typedef RBTreeNode* link_type;
+
+    /*! Order statistics support */
+    static const bool ranked = Ranked;
 
     /*! Basic members */
     Comparable  value;
-    RBTreeNode  *lChildPtr;
-    RBTreeNode  *rChildPtr;
-    NodeColor   color;
+    RBTreeNode  *childPtr[2];   //!< left, right
+    RBTreeNode  *parentPtr;     //!< meaningless for the pseudo root and the shared leaf
+    NodeColor   m_color;
+
+    /*! Node constructor, the value is built from args */
+    template <class... Args>
+    RBTreeNode( link_type self, Args&&... args )
+        : value(std::forward<Args>(args)...), parentPtr(self), m_color(Black) //!< initialize the basic members
+    {
+        childPtr[0] = childPtr[1] = self;
+    }
 
-    /*! Node constructor */
-    RBTreeNode( Comparable v = Comparable(), RBTreeNode *l = NULL, RBTreeNode *r = NULL, NodeColor c = Black )
-        : value(v), color(c), lChildPtr(l), rChildPtr(r) //!< initialize the basic members
+    /*! Links and color */
+    link_type left( void ) const { return childPtr[0]; }
+    link_type right( void ) const { return childPtr[1]; }
+    link_type child( bool right ) const { return childPtr[right]; }
+    link_type parent( void ) const { return parentPtr; }
+    void setLeft( link_type l ) { childPtr[0] = l; }
+    void setRight( link_type r ) { childPtr[1] = r; }
+    void setParent( link_type p ) { parentPtr = p; }
+    NodeColor color( void ) const { return m_color; }
+    void setColor( NodeColor c ) { m_color = c; }
+
+    template <class T, class C, class A, bool I>
+    friend class RedBlackTree;
+    friend struct TreeValidator;
+};
+
+/*! Node with the color in the lowest bit of the parent link (the node alignment keeps it
+ *  free), so it saves the color field and its padding. The child links are left untouched:
+ *  searches follow them on every step, while the parent link is only climbed by iterators
+*/
+template <class Comparable, bool Ranked = false>
+class PackedRBTreeNode : public RBTreeColor, public RBTreeRank<Ranked>
+{
+    /*! Link to another node */
+    typedef PackedRBTreeNode* link_type;
+
+    /*! Order statistics support */
+    static const bool ranked = Ranked;
+
+    /*! Basic members */
+    Comparable          value;
+    PackedRBTreeNode    *childPtr[2];   //!< left, right
+    uintptr_t           m_parentColor;  //!< parent link | color bit
+
+    /*! Node constructor, the value is built from args */
+    template <class... Args>
+    PackedRBTreeNode( link_type self, Args&&... args )
+        : value(std::forward<Args>(args)...), m_parentColor(reinterpret_cast<uintptr_t>(self) | Black)
     {
-        /*! empty */
+        childPtr[0] = childPtr[1] = self;
+        static_assert(alignof(PackedRBTreeNode) >= 2, "PackedRBTreeNode needs a free low bit");
     }
 
-    friend class RedBlackTree<Comparable>;
+    /*! Links and color */
+    link_type left( void ) const { return childPtr[0]; }
+    link_type right( void ) const { return childPtr[1]; }
+    link_type child( bool right ) const { return childPtr[right]; }
+    link_type parent( void ) const { return reinterpret_cast<link_type>( m_parentColor & ~uintptr_t(1) ); }
+    void setLeft( link_type l ) { childPtr[0] = l; }
+    void setRight( link_type r ) { childPtr[1] = r; }
+    void setParent( link_type p ) { m_parentColor = reinterpret_cast<uintptr_t>(p) | (m_parentColor & 1); }
+    NodeColor color( void ) const { return NodeColor( m_parentColor & 1 ); }
+    void setColor( NodeColor c ) { m_parentColor = (m_parentColor & ~uintptr_t(1)) | c; }
+
+    template <class T, class C, class A, bool I>
+    friend class RedBlackTree;
+    friend struct TreeValidator;
 };
 
+/*! Node linked by 32 bit indices into the chunks of an IndexNodePool. It also keeps its own
+ *  index (the allocator needs it to turn a node back into a link), and the color takes the
+ *  top bit of it. For an int it is 20 bytes instead of 40, at most 2^31 - 1 nodes per tree
+*/
+template <class Comparable, bool Ranked = false>
+class IndexedRBTreeNode : public RBTreeColor, public RBTreeRank<Ranked>
+{
+    /*! Link to another node */
+    typedef uint32_t link_type;
+
+    /*! Order statistics support */
+    static const bool ranked = Ranked;
+
+    /*! Top bit of m_selfColor */
+    static const uint32_t ColorBit = uint32_t(1) << 31;
+
+    /*! Basic members */
+    Comparable  value;
+    uint32_t    m_child[2];     //!< left, right
+    uint32_t    m_parent;
+    uint32_t    m_selfColor;    //!< own index | color bit
+
+    /*! Node constructor, the value is built from args */
+    template <class... Args>
+    IndexedRBTreeNode( link_type self, Args&&... args )
+        : value(std::forward<Args>(args)...), m_parent(self), m_selfColor(self | ColorBit)
+    {
+        m_child[0] = m_child[1] = self;
+    }
+
+    /*! Own index */
+    link_type index( void ) const { return m_selfColor & ~ColorBit; }
+
+    /*! Links and color */
+    link_type left( void ) const { return m_child[0]; }
+    link_type right( void ) const { return m_child[1]; }
+    link_type child( bool right ) const { return m_child[right]; }
+    link_type parent( void ) const { return m_parent; }
+    void setLeft( link_type l ) { m_child[0] = l; }
+    void setRight( link_type r ) { m_child[1] = r; }
+    void setParent( link_type p ) { m_parent = p; }
+    NodeColor color( void ) const { return ( m_selfColor & ColorBit ) ? Black : Red; }
+    void setColor( NodeColor c ) { m_selfColor = ( c == Black ) ? ( m_selfColor | ColorBit ) : ( m_selfColor & ~ColorBit ); }
+
+    template <class T, class C, class A, bool I>
+    friend class RedBlackTree;
+    friend struct TreeValidator;
+
+    template <class N, unsigned B>
+    friend class IndexNodePool;
+};
+
+/*! Red-black tree with order statistics: rank, select and count_range in O(log n) */
+template <class Comparable>
+using RankedRedBlackTree = RedBlackTree< Comparable, less<Comparable>, NodePool< RBTreeNode<Comparable, true> > >;
+
+/*! Red-black tree with the color packed in the parent link (8 bytes less per node) */
+template <class Comparable>
+using PackedRedBlackTree = RedBlackTree< Comparable, less<Comparable>, NodePool< PackedRBTreeNode<Comparable> > >;
+
+/*! Red-black tree with 32 bit links into chunked node arrays (about half the node size) */
+template <class Comparable>
+using CompactRedBlackTree = RedBlackTree< Comparable, less<Comparable>, IndexNodePool< IndexedRBTreeNode<Comparable> > >;
+
+/*! Red-black tree that keeps up to 128 bytes of values in the tree object, with no node
+ *  (trivially copyable values up to 16 bytes). The values then move on every change
+*/
+template <class Comparable, class Compare = less<Comparable> >
+using SmallRedBlackTree = RedBlackTree< Comparable, Compare, NodePool< RBTreeNode<Comparable> >, true >;
+
 // ************************************PUBLIC OPERATIONS***************************************
 // RedBlackTree( void )                                         --> Class constructor
+// RedBlackTree( const Compare& compare )                       --> Class constructor, custom order
 // RedBlackTree( const RedBlackTree<Comparable>& )              --> Copy constructor
-// const RedBlackTree<Comparable>& operator                     --> Assignment operator
+// RedBlackTree( const RedBlackTree<Comparable>&, pool )        --> Copy constructor (parallel)
+// RedBlackTree( RedBlackTree<Comparable>&& )                   --> Move constructor, O(1)
+// const RedBlackTree<Comparable>& operator                     --> Assignment operator (copy and move)
+// RedBlackTree( InputIterator first, InputIterator last, flags ) --> Bulk constructor, O(n) on sorted input
 // ~RedBlackTree()                                              --> Class destructor
-// insert( Comparable newNode )                                 --> Insertion function
-// void remove( Comparable node );                              --> Remove function
-// const RedBlackTree<Comparable>& search( Comparable node );   --> Search function
+// void assign( InputIterator first, InputIterator last, flags ) --> Bulk replace, O(n) on sorted input
+// void assign( const RedBlackTree& other, pool )               --> Deep copy (arena copy when pooled)
+// void clear( pool )                                           --> Remove every value
+// size_t size( void ) const                                    --> Number of values
+// bool empty( void ) const                                     --> Check if there is no value
+// void swap( RedBlackTree& other )                             --> Exchanges the contents, O(1)
+// insert( const Comparable& v ) / insert( Comparable&& v )     --> Insertion function
+// void emplace( Args&&... args )                               --> Insertion, value built in the node
+// insert_batch( InputIterator first, InputIterator last )      --> Sorted batch insertion
+// bool remove( const Comparable& node );                       --> Remove function
+// bool contains( const Key& key ) const                        --> Search function
+// const Comparable* find( const Key& key ) const               --> Search function (NULL if not found)
+// size_t count( const Key& key ) const                         --> Number of equal values
+// find_many( first, last, out, group )                         --> Many lookups in lockstep (prefetching)
+// begin( ) / end( ) / rbegin( ) / rend( )                      --> In-order iterators
+// lower_bound( key ) / upper_bound( key ) / equal_range( key ) --> Range scans
+// size_t rank( key ) const                                     --> Values less than key (ranked trees)
+// const_iterator select( size_t k ) const                      --> k-th smallest value (ranked trees)
+// size_t count_range( lo, hi ) const                           --> Values in [lo, hi] (ranked trees)
+// void unite / intersect / subtract( other, pool )             --> Set algebra (join based, parallel)
+// void split_at( const Key& key, RedBlackTree& upper )         --> Moves the values not less than key
+// size_t erase_range( const Key& lo, const Key& hi )           --> Removes the values in [lo, hi]
+// FrozenRedBlackTree<Comparable> freeze( void ) const          --> Read only, array based snapshot
+// void save( const string& path ) const                        --> Writes a binary image of the tree
+// MappedRedBlackTree open_mmap( path, verify )                 --> Serves an image from a mapping, O(1) (static)
+// TreeStats stats( void ) const                                --> Shape, memory, counters and latencies
 // void print( void ) const                                     --> Print function
 
 // *****************************************ERRORS**********************************************
 // std::bad_alloc thrown if needed.
-
-/*! The red black tree class itself */
-template <class Comparable>
-class RedBlackTree
+// std::invalid_argument thrown by assign() if the input isn't sorted and Unsorted wasn't given.
+// std::runtime_error thrown by save() and open_mmap() (see FrozenRedBlackTree.h).
+
+/*! The red black tree class itself
+ *  Compare orders the values (std::less by default, which uses '<' as is, so the lookups
+ *  accept any Key comparable with Comparable; a custom Compare must take the Key types used).
+ *  It comes right after Comparable, as in std::set, so RedBlackTree<int, greater<int> > works.
+ *  Allocator hands out the node storage (see NodePool.h). The default one is a slab pool, so
+ *  nodes live in contiguous chunks, removed nodes are recycled and the destructor drops the
+ *  whole tree in O(chunks) when the values don't need a destructor call.
+ *  With the default order and arithmetic values the descents pick the child by index
+ *  from the comparison result, with no branch to mispredict on random keys.
+ *  Built with RBTREE_STATS, the tree counts what it does (see TreeStats.h); otherwise the
+ *  counters base is empty and its hooks compile to nothing.
+ *  With Inline (see SmallRedBlackTree), small trees of trivially copyable values (up to 16
+ *  bytes) keep them in a sorted array inside the tree object (see RBTreeInline): no node is
+ *  allocated, not even the sentinels, and a lookup is a short scan. The tree moves to nodes
+ *  when the array is full and back when it's down to half of it. In the inline form the
+ *  values move on every change, so an insertion invalidates the iterators and the pointers
+ *  from find() too. Without it (the default) they stay valid until their value is removed.
+*/
+template <class Comparable, class Compare, class Allocator, bool Inline>
+class RedBlackTree : private TreeCounters<TreeStatsEnabled>, private RBTreeInline<Comparable, Inline>
 {
     /*!
      * Public section
     */
     public:
 
+        /*! Node type, chosen by the allocator */
+        typedef typename Allocator::node_type Node;
+
+        /*! Bidirectional in-order iterator. It climbs the parent links, so a step is O(1)
+         *  amortized and never allocates; end() is the pseudo root. The values are read only
+        */
+        class const_iterator
+        {
+            public:
+
+                typedef bidirectional_iterator_tag  iterator_category;
+                typedef Comparable                  value_type;
+                typedef ptrdiff_t                   difference_type;
+                typedef const Comparable*           pointer;
+                typedef const Comparable&           reference;
+
+                const_iterator( void ) : m_node(NULL), m_slot(0), m_tree(NULL) { /*! empty */ }
+
+                reference operator * ( void ) const { return ( m_node != NULL ) ? m_node->value : m_tree->inlineValues()[m_slot]; }
+                pointer operator -> ( void ) const { return &**this; }
+
+                const_iterator& operator ++ ( void );
+                const_iterator& operator -- ( void );
+                const_iterator operator ++ ( int ) { const_iterator old = *this; ++*this; return old; }
+                const_iterator operator -- ( int ) { const_iterator old = *this; --*this; return old; }
+
+                bool operator == ( const const_iterator& rhs ) const { return m_node == rhs.m_node && m_slot == rhs.m_slot; }
+                bool operator != ( const const_iterator& rhs ) const { return !( *this == rhs ); }
+
+            private:
+
+                const_iterator( Node* node, const RedBlackTree* tree ) : m_node(node), m_slot(0), m_tree(tree) { /*! empty */ }
+                const_iterator( size_t slot, const RedBlackTree* tree ) : m_node(NULL), m_slot(slot), m_tree(tree) { /*! empty */ }
+
+                Node*               m_node;     //!< current node (the pseudo root for end(), NULL in the inline form)
+                size_t              m_slot;     //!< current inline value (size() for end())
+                const RedBlackTree* m_tree;     //!< the tree (it resolves the links)
+
+                friend class RedBlackTree;
+        };
+
+        /*! The values can't be changed through an iterator (it would break the order) */
+        typedef const_iterator                          iterator;
+        typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+        typedef const_reverse_iterator                  reverse_iterator;
+
+        /*! Bulk build options (combine with '|') */
+        enum BuildFlags
+        {
+            Sorted = 0,     //!< input already sorted (checked)
+            Unsorted = 1,   //!< sort the input first
+            Unique = 2      //!< drop the repeated values
+        };
+
         /*! Class constructor to create an empty red-black tree */
         RedBlackTree( void );
 
+        /*! Class constructor with an order object */
+        explicit RedBlackTree( const Compare& compare );
+
+        /*! Bulk constructor: builds the tree from a range in O(n) (see assign) */
+        template <class InputIterator>
+        RedBlackTree( InputIterator first, InputIterator last, unsigned flags = Sorted );
+
         /*! Copy constructor (deep copy) */
-        RedBlackTree( const RedBlackTree<Comparable>& old );
+        RedBlackTree( const RedBlackTree<Comparable, Compare, Allocator, Inline>& old );
+
+        /*! Copy constructor, the work split among the pool (see assign) */
+        RedBlackTree( const RedBlackTree<Comparable, Compare, Allocator, Inline>& old, ThreadPool* pool );
+
+        /*! Move constructor: takes the nodes of old in O(1), old is left empty (nothing allocated) */
+        RedBlackTree( RedBlackTree<Comparable, Compare, Allocator, Inline>&& old ) noexcept;
 
         /*! Assignment operator */
-        const RedBlackTree<Comparable>& operator = ( const RedBlackTree<Comparable>& rhs );
+        const RedBlackTree<Comparable, Compare, Allocator, Inline>& operator = ( const RedBlackTree<Comparable, Compare, Allocator, Inline>& rhs );
+
+        /*! Move assignment operator: the current values are removed, then the nodes of rhs
+         *  are taken in O(1) and rhs is left empty
+        */
+        const RedBlackTree<Comparable, Compare, Allocator, Inline>& operator = ( RedBlackTree<Comparable, Compare, Allocator, Inline>&& rhs ) noexcept;
 
         /*! Class destructor to release memory */
         ~RedBlackTree();
 
-        /*! Red-black tree's insertion function. Could throws a bad_alloc exception if no enough space */
-        void insert( Comparable newNode );
+        /*! Replaces the content with the range [first, last).
+         *  Sorted input is built in O(n) as a perfectly balanced tree, with every node in one block.
+         *  Unsorted sorts it first, Unique keeps one copy of each value.
+        */
+        template <class InputIterator>
+        void assign( InputIterator first, InputIterator last, unsigned flags = Sorted );
 
-        /*! Red-black tree's remove function. */
-        void remove( Comparable node );
+        /*! Replaces the content with a deep copy of other. With a pooled allocator and trivially
+         *  copyable values the node chunks are copied byte by byte and the links relocated
+         *  (nothing to relocate for index links); otherwise the nodes are copied one by one.
+         *  With a pool, the chunks and the sub trees are split among the threads
+        */
+        void assign( const RedBlackTree& other, ThreadPool* pool = NULL );
+
+        /*! Removes every value (the node storage is given back when the tree has an inline form).
+         *  With a pool, big sub trees are destroyed by separate tasks
+        */
+        void clear( ThreadPool* pool = NULL );
+
+        /*! Number of values */
+        size_t size( void ) const { return m_size; }
+
+        /*! Check if there is no value */
+        bool empty( void ) const { return m_size == 0; }
+
+        /*! Exchanges the values (and the node storage) of both trees in O(1).
+         *  The iterators of both trees are invalidated
+        */
+        void swap( RedBlackTree& other ) noexcept;
+
+        /*! Red-black tree's insertion function. Could throws a bad_alloc exception if no enough space.
+         *  The value is copied (or moved) once, into the new node
+        */
+        void insert( const Comparable& v );
+        void insert( Comparable&& v );
+
+        /*! Inserts a value built from args right in the new node (no temporary value) */
+        template <class... Args>
+        void emplace( Args&&... args );
+
+        /*! Inserts a range of values. The batch is sorted and consecutive insertions reuse the shared
+         *  top of their paths; a batch bigger than size() / RebuildRatio is merged and rebuilt in O(n + m)
+        */
+        template <class InputIterator>
+        void insert_batch( InputIterator first, InputIterator last );
 
-        /*! Red-black tree's search function. */
-        const Comparable search( Comparable node );
+        /*! Red-black tree's remove function (single top-down pass). Returns false if the value isn't there */
+        bool remove( const Comparable& node );
+
+        /*! Red-black tree's search functions. They don't allocate and accept any Key
+         *  comparable with Comparable through '<' (e.g. a string_view for strings)
+        */
+        template <class Key>
+        bool contains( const Key& key ) const;
+
+        template <class Key>
+        const Comparable* find( const Key& key ) const;
+
+        template <class Key>
+        size_t count( const Key& key ) const;
+
+        /*! find() for every key of [first, last), written to out (a const Comparable* per key, NULL if
+         *  not found). group lookups advance in lockstep, one level each per round, and the next node
+         *  of each is prefetched, so up to group cache misses are in flight instead of one
+        */
+        template <class InputIterator, class OutputIterator>
+        OutputIterator find_many( InputIterator first, InputIterator last, OutputIterator out,
+                                  size_t group = FindGroup ) const;
+
+        /*! In-order iterators */
+        const_iterator begin( void ) const;
+        const_iterator end( void ) const { return isInline() ? const_iterator(m_size, this) : const_iterator(m_root, this); }
+        const_reverse_iterator rbegin( void ) const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend( void ) const { return const_reverse_iterator(begin()); }
+
+        /*! Range scans: first value not less than key, first value greater than key, and both.
+         *  O(log n) to find the start, then O(1) amortized per step
+        */
+        template <class Key>
+        const_iterator lower_bound( const Key& key ) const;
+
+        template <class Key>
+        const_iterator upper_bound( const Key& key ) const;
+
+        template <class Key>
+        pair<const_iterator, const_iterator> equal_range( const Key& key ) const;
+
+        /*! Order statistics, O(log n). Only for ranked nodes (see RankedRedBlackTree)
+         *  rank: number of values less than key; select: the k-th smallest value (0 based,
+         *  end() if k >= size()); count_range: number of values in [lo, hi]
+        */
+        template <class Key>
+        size_t rank( const Key& key ) const;
+
+        const_iterator select( size_t k ) const;
+
+        template <class Key>
+        size_t count_range( const Key& lo, const Key& hi ) const;
+
+        /*! Set algebra with other, in place: O(m log(n/m + 1)) work for m = other.size() <= n,
+         *  plus one step per value dropped.
+         *  A value c1 times here and c2 times in other is kept max(c1, c2), min(c1, c2) and
+         *  c1 - min(c1, c2) times (as std::set_union and friends). With a pool, both halves
+         *  of each step run as separate tasks. unite() copies other first (a bad_alloc leaves
+         *  the tree unchanged), nothing else allocates
+        */
+        void unite( const RedBlackTree& other, ThreadPool* pool = NULL );
+        void intersect( const RedBlackTree& other, ThreadPool* pool = NULL );
+        void subtract( const RedBlackTree& other, ThreadPool* pool = NULL );
+
+        /*! Moves the values not less than key to upper (its content is replaced). The tree is cut
+         *  in O(log n). With an allocator that shares its nodes (HeapNodeAllocator) upper takes
+         *  the cut part as it is, O(log n) with ranked nodes (plain ones are counted, up to the
+         *  smaller part); otherwise the part is copied to upper's storage (each tree owns its nodes)
+        */
+        template <class Key>
+        void split_at( const Key& key, RedBlackTree& upper );
+
+        /*! Removes the values in [lo, hi] in O(log n + removed). Returns how many were removed */
+        template <class Key>
+        size_t erase_range( const Key& lo, const Key& hi );
+
+        /*! Immutable snapshot in one contiguous array (Eytzinger layout), O(n).
+         *  Same lookup API, but branchless and with no pointer chasing (see FrozenRedBlackTree.h).
+         *  Only for the default order
+        */
+        FrozenRedBlackTree<Comparable> freeze( void ) const;
+
+        /*! Writes the tree to path as a versioned, checksummed binary image (the frozen array,
+         *  children are implicit offsets). Only for the default order and trivially copyable values
+        */
+        void save( const string& path ) const { freeze().save(path); }
+
+        /*! Maps an image written by save() and serves it in place: nothing is deserialized, so it
+         *  takes the same time for any size. The writes are promoted to the heap (see MappedRedBlackTree.h)
+        */
+        static MappedRedBlackTree<Comparable, RedBlackTree> open_mmap( const string& path, bool verify = false );
+
+        /*! Snapshot of the tree: size, height, black height and node memory, O(n). With
+         *  RBTREE_STATS also the comparisons, splits, rotations, color swaps, nodes built
+         *  and destroyed, and the depth and latency histogram of every insert, remove and search
+        */
+        TreeStats stats( void ) const;
 
         /*! Print all the tree's nodes */
         void print( void ) const;
@@ -113,54 +592,321 @@ class RedBlackTree
     */
     private:
 
+        /*! A detached sub tree and its black height (black nodes on a path down, the root included) */
+        struct SubTree
+        {
+            Node*   root;
+            int     height;
+        };
+
+        /*! Nodes taken out of the tree, chained through their left links */
+        struct NodeList
+        {
+            Node*   head;
+            Node*   tail;
+            size_t  count;
+        };
+
+        /*! Inline form (see RBTreeInline): the values are in the tree object, there is no node
+         *  at all and m_root is NULL. With no inline storage it's the empty tree that has not
+         *  got its sentinels yet (new or moved from), so it costs no allocation
+        */
+        bool isInline( void ) const { return m_root == NULL; }
+
+        /*! Empty tree in the inline form, nothing allocated */
+        void initialize( void );
+
+        /*! Builds theLeaf and the pseudo root. Could throws a bad_alloc exception (nothing is kept) */
+        void createSentinels( void );
+
+        /*! The leaf: one for all the trees whose allocator shares its nodes (so they can take
+         *  over each other's sub trees), never written once built; a node of its own otherwise
+        */
+        static Node* createLeaf( true_type );
+        Node* createLeaf( false_type ) { return constructNode(); }
+
+        /*! Destroys theLeaf, unless it is the shared one */
+        void destroyLeaf( void );
+
+        /*! Makes the pseudo root and the real root black (the leaf is left alone) */
+        void blackenRoots( void );
+
+        /*! Moves the inline values to nodes (nothing if they are already there) */
+        void growToNodes( void );
+
+        /*! Moves the values back inline if no more than half of inlineCapacity are left. Never throws */
+        void shrinkToInline( void );
+
+        /*! Destroys every node, the sentinels too, and gives the storage back (empty, inline) */
+        void dropNodes( ThreadPool* pool );
+
+        /*! Removes every value, the node form is kept (or built) */
+        void clearNodes( ThreadPool* pool = NULL );
+
+        /*! Inline insertion, false if the array is full (the tree has then moved to nodes) */
+        bool insertInline( const Comparable& v );
+
+        /*! Inline removal */
+        bool removeInline( const Comparable& v );
+
+        /*! Position of the first inline value not less than key (upper: greater than key) */
+        template <class Key>
+        size_t inlineBound( const Key& key, bool upper ) const;
+
+        /*! Inline search, NULL if not found */
+        template <class Key>
+        const Comparable* findInline( const Key& key ) const;
+
         /*! Swaps the node color (applied in the split method) */
-        void swapColor( RBTreeNode<Comparable>*& nodePtr, RBTreeNode<Comparable>*& parentPtr, RBTreeNode<Comparable>*& grandPtr );
+        void swapColor( Node*& nodePtr, Node*& parentPtr, Node*& grandPtr );
 
         /*! Perform a right rotation
          *  rotate the nodePtr around its left child
          *  parentPtr points to the parent of nodePtr
         */
-        void rightRotate( RBTreeNode<Comparable>*& nodePtr, RBTreeNode<Comparable>*& parentPtr );
+        void rightRotate( Node*& nodePtr, Node*& parentPtr );
 
         /*! Perform a left rotation
          *  rotate the nodePtr around its right child
          *  parentPtr points to the parent of nodePtr 
         */
-        void leftRotate( RBTreeNode<Comparable>*& nodePtr, RBTreeNode<Comparable>*& parentPtr );
+        void leftRotate( Node*& nodePtr, Node*& parentPtr );
 
         /*! split a 4-node: nodePtr
          *  parentPtr points to the parent of nodePtr
          *  grandPtr points to the parent of parentPtr
          *  greatPtr points to the parent of grandPtr
         */
-        void split( RBTreeNode<Comparable>* nodePtr, RBTreeNode<Comparable>* parentPtr, RBTreeNode<Comparable>* grandPtr,
-                     RBTreeNode<Comparable>* greatPtr );
+        bool split( Node*& nodePtr, Node*& parentPtr, Node*& grandPtr,
+                     Node*& greatPtr );
+
+        /*! Builds a node in the allocator storage (a NULL child is left unlinked) */
+        Node* createNode( const Comparable& v, Node *l, Node *r,
+                                            typename Node::NodeColor c );
+
+        /*! Builds a black node from args, linked to itself. Could throws a bad_alloc exception */
+        template <class... Args>
+        Node* constructNode( Args&&... args );
+
+        /*! Places a node from constructNode in the tree (the insertion itself) */
+        void insertNode( Node *newPtr );
+
+        /*! Nodes the links of nodePtr point to (the allocator resolves them) */
+        Node* leftOf( const Node *nodePtr ) const { return m_pool.node( nodePtr->left() ); }
+        Node* rightOf( const Node *nodePtr ) const { return m_pool.node( nodePtr->right() ); }
+        Node* parentOf( const Node *nodePtr ) const { return m_pool.node( nodePtr->parent() ); }
+
+        /*! Child of nodePtr picked by index: the right one if right, the left one otherwise */
+        Node* childAt( const Node *nodePtr, bool right ) const { return m_pool.node( nodePtr->child(right) ); }
+
+        /*! Order of the values (and keys): '<' itself for the default order, Compare otherwise */
+        template <class A, class B>
+        bool lessThan( const A& a, const B& b ) const { countComparison(); return lessThan( a, b, integral_constant<bool, DefaultOrder>() ); }
+
+        template <class A, class B>
+        bool lessThan( const A& a, const B& b, true_type ) const { return a < b; }
+
+        template <class A, class B>
+        bool lessThan( const A& a, const B& b, false_type ) const { return m_compare(a, b); }
+
+        /*! Destroys a node and gives its storage back to the allocator */
+        void destroyNode( Node *nodePtr );
+
+        /*! Destroys a node and frees its storage into chain (any thread) */
+        void releaseNode( Node *nodePtr, typename Allocator::FreeChain& chain ) const;
+
+        /*! Sub tree size of a ranked node (0 for the leaf) */
+        size_t subtreeSize( Node *nodePtr ) const { return ( nodePtr == theLeaf ) ? 0 : nodePtr->subtreeSize(); }
+
+        /*! Recomputes the sub tree size from the children (nothing for plain nodes) */
+        void updateSize( Node *nodePtr ) const;
+
+        /*! Adds delta to the sub tree size (nothing for plain nodes) */
+        void adjustSize( Node *nodePtr, int delta ) const;
+
+        /*! Number of values less than key (strict) or not greater than key (!strict) */
+        template <class Key>
+        size_t countBelow( const Key& key, bool strict ) const;
+
+        /*! Link childPtr as a child of nodePtr (and nodePtr as its parent) */
+        void setLeftChild( Node *nodePtr, Node *childPtr );
+        void setRightChild( Node *nodePtr, Node *childPtr );
+
+        /*! Clone constructor (deep copy)
+         *  other is the tree that owns nodePtr
+        */
+        Node * clone( const Node * nodePtr, const RedBlackTree& other );
+
+        /*! assign() by arena copy (true_type) or node by node (false_type) */
+        void copyTree( const RedBlackTree& other, ThreadPool* pool, true_type );
+        void copyTree( const RedBlackTree& other, ThreadPool* pool, false_type );
+
+        /*! Moves the child links of a copied node to the copies (and links them back to it).
+         *  otherLeaf is the leaf of the copied tree
+        */
+        void relocateNode( Node *nodePtr, const typename Allocator::Relocation& moved,
+                           typename Allocator::link_type otherLeaf );
+
+        /*! relocateNode() for the sub tree rooted at nodePtr (height is its black height) */
+        void relocateTree( Node *nodePtr, int height, const typename Allocator::Relocation& moved,
+                           typename Allocator::link_type otherLeaf, ThreadPool* pool );
+
+        /*! Replaces the content with the sorted values in O(n) */
+        void rebuild( const vector<Comparable>& values );
+
+        /*! Builds the sorted values as the tree, which must be in node form and empty */
+        void buildNodes( const vector<Comparable>& values );
+
+        /*! Appends the values of the tree rooted at nodePtr in order */
+        void collect( Node *nodePtr, vector<Comparable>& values ) const;
+
+        /*! Builds a perfectly balanced tree from values[lo, hi).
+         *  depth is the depth of the sub tree root; the nodes at redDepth are red
+        */
+        Node * build( const vector<Comparable>& values, size_t lo, size_t hi, int depth, int redDepth );
+
+        /*! Join based primitives. They work on detached sub trees, never allocate and
+         *  only touch the nodes of their arguments, so disjoint calls can run in parallel
+        */
+
+        /*! Black height of the sub tree rooted at nodePtr */
+        int blackHeight( const Node *nodePtr ) const;
+
+        /*! Nodes on the longest path down from nodePtr (0 for the leaf), O(n) */
+        int height( const Node *nodePtr ) const;
+
+        /*! The whole tree (detached) and the real root placed back under the pseudo root */
+        SubTree wholeTree( void ) const;
+        void setTree( Node *rootPtr );
+
+        /*! Steps nodePtr to the next node (pre-order) of the sub tree rooted at topPtr, by the
+         *  parent links. Returns false once the sub tree is done
+        */
+        bool nextNode( Node*& nodePtr, const Node *topPtr ) const;
+
+        /*! Number of nodes under aPtr, where aPtr and bPtr together hold total nodes. Ranked
+         *  nodes know it; otherwise both are walked in lockstep, O(smaller sub tree)
+        */
+        size_t countFirst( Node *aPtr, Node *bPtr, size_t total ) const;
+
+        /*! Child of the root of t, with its black height */
+        SubTree childOf( const SubTree& t, Node *childPtr ) const;
+
+        /*! Joins l, the node k and r (every value of l <= k <= every value of r), O(|height difference| + 1) */
+        SubTree join( SubTree l, Node *k, SubTree r );
+
+        /*! Joins k and r into the right spine of t (r is lower), and the mirror one */
+        Node* joinRight( Node *t, int height, Node *k, const SubTree& r );
+        Node* joinLeft( const SubTree& l, Node *k, Node *t, int height );
 
-        /*! Clone constructor (deep copy) */
-        RBTreeNode<Comparable> * clone( RBTreeNode<Comparable> * nodePtr ) const;
+        /*! Joins l and r without a middle node, O(log n) */
+        SubTree join2( const SubTree& l, const SubTree& r );
+
+        /*! Takes the smallest node out of t, rest gets the remaining sub tree */
+        Node* splitFirst( const SubTree& t, SubTree& rest );
+
+        /*! Splits t into the values less than key, the ones equal to it (chained in equal)
+         *  and the greater ones, O(log n + equal values)
+        */
+        template <class Key>
+        void splitTree( const SubTree& t, const Key& key, SubTree& lower, NodeList& equal, SubTree& upper );
+
+        /*! Joins l, the equal nodes and r (join2 if there is none) */
+        SubTree joinEqual( const SubTree& l, NodeList& equal, const SubTree& r );
+
+        /*! Union of two detached trees of this tree (b is a copy of the other tree) */
+        SubTree uniteTrees( const SubTree& a, const SubTree& b, NodeList& dropped, ThreadPool* pool );
+
+        /*! Values of a also in other (common) or not in it (!common). otherPtr is a node of other */
+        SubTree filterTrees( const SubTree& a, Node *otherPtr, int otherHeight, const RedBlackTree& other,
+                             bool common, NodeList& dropped, ThreadPool* pool );
+
+        /*! intersect() (common) and subtract() (!common) */
+        void filter( const RedBlackTree& other, bool common, ThreadPool* pool );
+
+        /*! Runs left and right, left as a pool task if fork is set */
+        template <class Left, class Right>
+        static void forkJoin( ThreadPool* pool, bool fork, Left left, Right right );
+
+        /*! Node list functions: an empty list, push a node, move the first n nodes of from,
+         *  append a whole list, push every node of a sub tree and destroy the nodes
+        */
+        static NodeList emptyList( void ) { NodeList list = { NULL, NULL, 0 }; return list; }
+        void listPush( NodeList& list, Node *nodePtr );
+        void listMove( NodeList& from, size_t n, NodeList& to );
+        void listAppend( NodeList& list, const NodeList& other );
+        void listTree( Node *nodePtr, NodeList& list );
+        void destroyList( NodeList& list );
 
         /*! release memory of the tree, but don't release pseudo root and theLeaf */
-        void reclaimMemory( RBTreeNode<Comparable> *nodePtr ) const;
+        void reclaimMemory( Node *nodePtr );
+
+        /*! reclaimMemory() with big sub trees run as pool tasks, the storage freed into chain */
+        void reclaimTree( Node *nodePtr, int height, typename Allocator::FreeChain& chain, ThreadPool* pool );
+
+        /*! Search the node equal to key, theLeaf if not found */
+        template <class Key>
+        Node* findNode( const Key& key ) const;
+
+        /*! Count the nodes equal to key in the tree rooted at nodePtr */
+        template <class Key>
+        size_t count( Node *nodePtr, const Key& key ) const;
 
         /*! Print the tree rooted at nodePtr
          *  The parameter level specifies the level of the nodePtr in the tree.
          *  You need to use this parameter to adjust indentation.
         */
-        void print( RBTreeNode<Comparable> *nodePtr, int level ) const;
+        void print( Node *nodePtr, int level ) const;
 
     /*!
      * Private section
     */
     private:
 
+            /*! The allocator resolves the links the nodes store */
+            static_assert(is_same<typename Allocator::link_type, typename Node::link_type>::value,
+                          "the allocator and the node must use the same link type");
+
+            /*! Compare is the default order (the plain '<') */
+            static const bool DefaultOrder = is_same< Compare, less<Comparable> >::value;
+
+            /*! The descents of Key lookups go branchless (the child picked by index) */
+            template <class Key>
+            struct Branchless
+            {
+                static const bool value = DefaultOrder && is_arithmetic<Comparable>::value && is_arithmetic<Key>::value;
+            };
+
+            /*! The inline storage (a dependent base, so its names are brought in) */
+            typedef RBTreeInline<Comparable, Inline> InlineStorage;
+            using InlineStorage::inlineCapacity;
+            using InlineStorage::inlineValues;
+            using InlineStorage::swapInline;
+
             /*! Basic members */
-            RBTreeNode<Comparable>* theLeaf;    //!< actual leaf node
-            RBTreeNode<Comparable>* m_root;     //!< pointer to pseudo root
-            RBTreeNode<Comparable>* nil;
-            const Comparable ITEM_NOT_FOUND = 0;
+            Compare                 m_compare;  //!< order of the values
+            Allocator               m_pool;     //!< node storage
+            Node* theLeaf;    //!< actual leaf node
+            Node* m_root;     //!< pointer to pseudo root
+            size_t                  m_size;     //!< number of values
+
+            /*! insert_batch() rebuilds the tree when the batch has at least size() / RebuildRatio values */
+            static const size_t RebuildRatio = 4;
+
+            /*! Default number of lookups find_many() runs in lockstep */
+            static const size_t FindGroup = 16;
+
+            /*! The set algebra, the copy and clear() fork a task for sub trees at least this
+             *  black height (2^8 - 1 values)
+            */
+            static const int ForkHeight = 8;
+
+            /*! Checks the invariants in the tests (see test/TestUtil.h) */
+            friend struct TreeValidator;
 };
 
 #include "RedBlackTree.cpp"
+#include "MappedRedBlackTree.h"
 #endif // RedBlackTree_H
 
 /* --------------------- [ End of the RedBlackTree.h header ] ------------------- */
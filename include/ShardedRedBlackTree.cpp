@@ -0,0 +1,703 @@
+/*! \file */
+/*! \brief ShardedRedBlackTree.cpp.
+ *
+ *  Implements the functions from ShardedRedBlackTree class.
+*/
+
+#include "ShardedRedBlackTree.h"
+
+/*!
+ * Class constructor
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param shards 	=> number of shards (at least one)
+ * @param threads 	=> worker threads of the pool
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+ShardedRedBlackTree<Comparable, Tree>::ShardedRedBlackTree( size_t shards, size_t threads )
+	: m_generation(0), m_used(1), m_pool(threads) //!< initialize the basic members
+{
+	publishBounds( Bounds() );
+
+	for ( size_t i = 0; i < max<size_t>(shards, 1); i++ )
+		m_shards.push_back( unique_ptr<Shard>( new Shard ) );
+}
+
+/*!
+ * Class constructor
+ * it throws an invalid_argument exception if the bounds aren't sorted
+ * and a bad_alloc exception if no enough space
+ *
+ * @param bounds 	=> first value of the shards 1, 2, ...
+ * @param threads 	=> worker threads of the pool
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+ShardedRedBlackTree<Comparable, Tree>::ShardedRedBlackTree( const vector<Comparable>& bounds, size_t threads )
+	: m_generation(0), m_used(1), m_pool(threads) //!< initialize the basic members
+{
+	for ( size_t i = 1; i < bounds.size(); i++ )
+		if ( bounds[i] < bounds[i - 1] )
+			throw invalid_argument("ShardedRedBlackTree: bounds not sorted");
+
+	for ( size_t i = 0; i <= bounds.size(); i++ )
+		m_shards.push_back( unique_ptr<Shard>( new Shard ) );
+
+	setBounds(bounds);
+}
+
+/*!
+ * Insertion function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param v => the value to the new node
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void ShardedRedBlackTree<Comparable, Tree>::insert( const Comparable& v )
+{
+	unique_lock<mutex> lock;
+	size_t i = lockShard(v, lock);
+	Shard& shard = *m_shards[i];
+
+	shard.tree.insert(v);
+	shard.size = shard.tree.size();
+
+	//! The other shard sizes are only read once in a while (they are other cores' cache lines)
+	bool check = ( shard.tree.size() % CheckInterval == 0 );
+	lock.unlock();
+
+	if ( check )
+		checkHot(i);
+}
+
+/*!
+ * Batch insertion function
+ * the sorted batch is cut at the bounds and every piece goes to its shard
+ * in a task of its own; the values a concurrent rebalance moved out of a
+ * shard meanwhile are inserted one by one at the end
+ *
+ * @param first => range begin
+ * @param last 	=> range end
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+template <class InputIterator>
+void ShardedRedBlackTree<Comparable, Tree>::insert_batch( InputIterator first, InputIterator last )
+{
+	vector<Comparable> batch(first, last);
+
+	if ( batch.empty() )
+		return;
+
+	sort(batch.begin(), batch.end());
+
+	Bounds layout = bounds();
+	size_t used = layout.size() + 1;
+	vector< vector<Comparable> > leftovers(used);
+
+	{
+		ThreadPool::TaskGroup group(m_pool);
+		typename vector<Comparable>::const_iterator start = batch.begin();
+
+		for ( size_t i = 0; i < used; i++ )
+		{
+			typename vector<Comparable>::const_iterator stop =
+				( i + 1 < used ) ? std::lower_bound(start, batch.cend(), layout[i]) : batch.cend();
+
+			if ( start == stop )
+				continue;
+
+			group.run( [this, i, start, stop, &leftovers]()
+			{
+				Shard& shard = *m_shards[i];
+				lock_guard<mutex> lock(shard.lock);
+
+				//! The piece is sorted: if both ends are in range, all of it is
+				if ( shard.holds(*start) && shard.holds(*(stop - 1)) )
+					shard.tree.insert_batch(start, stop);
+				else
+				{
+					vector<Comparable> mine;
+
+					for ( typename vector<Comparable>::const_iterator it = start; it != stop; ++it )
+						( shard.holds(*it) ? mine : leftovers[i] ).push_back(*it);
+
+					shard.tree.insert_batch(mine.begin(), mine.end());
+				}
+
+				shard.size = shard.tree.size();
+			} );
+
+			start = stop;
+		}
+
+		group.wait();
+	}
+
+	for ( size_t i = 0; i < used; i++ )
+		for ( size_t j = 0; j < leftovers[i].size(); j++ )
+			insert( leftovers[i][j] );
+
+	//! The biggest shard is the one that could be hot
+	size_t biggest = 0;
+
+	for ( size_t i = 1; i < m_shards.size(); i++ )
+		if ( shardSize(i) > shardSize(biggest) )
+			biggest = i;
+
+	checkHot(biggest);
+}
+
+/*!
+ * Remove function
+ *
+ * @param key => value to be removed
+ *
+ * @return => true if a value was removed
+*/
+template <class Comparable, class Tree>
+template <class Key>
+bool ShardedRedBlackTree<Comparable, Tree>::remove( const Key& key )
+{
+	unique_lock<mutex> lock;
+	Shard& shard = *m_shards[ lockShard(key, lock) ];
+
+	bool removed = shard.tree.remove(key);
+	shard.size = shard.tree.size();
+
+	return removed;
+}
+
+/*!
+ * Clear function
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void ShardedRedBlackTree<Comparable, Tree>::clear( void )
+{
+	for ( size_t i = 0; i < m_shards.size(); i++ )
+	{
+		lock_guard<mutex> lock(m_shards[i]->lock);
+		m_shards[i]->tree.clear();
+		m_shards[i]->size = 0;
+	}
+}
+
+/*!
+ * Size function
+ *
+ * @return => number of values
+*/
+template <class Comparable, class Tree>
+size_t ShardedRedBlackTree<Comparable, Tree>::size( void ) const
+{
+	size_t total = 0;
+
+	for ( size_t i = 0; i < m_shards.size(); i++ )
+		total += shardSize(i);
+
+	return total;
+}
+
+/*!
+ * Contains function
+ *
+ * @param key => value to be searched
+ *
+ * @return => true if found
+*/
+template <class Comparable, class Tree>
+template <class Key>
+bool ShardedRedBlackTree<Comparable, Tree>::contains( const Key& key ) const
+{
+	unique_lock<mutex> lock;
+
+	return m_shards[ lockShard(key, lock) ]->tree.contains(key);
+}
+
+/*!
+ * Find function
+ *
+ * @param key 	=> value to be searched
+ * @param out 	=> receives a copy of the value found
+ *
+ * @return => true if found
+*/
+template <class Comparable, class Tree>
+template <class Key>
+bool ShardedRedBlackTree<Comparable, Tree>::find( const Key& key, Comparable& out ) const
+{
+	unique_lock<mutex> lock;
+	const Comparable* value = m_shards[ lockShard(key, lock) ]->tree.find(key);
+
+	if ( value == NULL )
+		return false;
+
+	out = *value;
+
+	return true;
+}
+
+/*!
+ * Count function
+ * the equal values are all in the same shard
+ *
+ * @param key => value to be counted
+ *
+ * @return => number of equal values
+*/
+template <class Comparable, class Tree>
+template <class Key>
+size_t ShardedRedBlackTree<Comparable, Tree>::count( const Key& key ) const
+{
+	unique_lock<mutex> lock;
+
+	return m_shards[ lockShard(key, lock) ]->tree.count(key);
+}
+
+/*!
+ * Find many function
+ * the keys are grouped by shard (counting sort on the shard index) and
+ * every group is looked up by a task holding that shard's lock
+ *
+ * @param first => first key
+ * @param last 	=> one past the last key
+ * @param out 	=> receives a bool per key (true if found)
+ *
+ * @return => out past the last value written
+*/
+template <class Comparable, class Tree>
+template <class InputIterator, class OutputIterator>
+OutputIterator ShardedRedBlackTree<Comparable, Tree>::find_many( InputIterator first, InputIterator last,
+																  OutputIterator out ) const
+{
+	typedef typename iterator_traits<InputIterator>::value_type Key;
+
+	vector<Key> keys(first, last);
+	Bounds layout = bounds();
+	size_t used = layout.size() + 1;
+
+	//! order lists the key positions shard by shard, shard i from offset[i] to offset[i + 1]
+	vector<size_t> shardOf( keys.size() );
+	vector<size_t> offset( used + 1, 0 );
+
+	for ( size_t k = 0; k < keys.size(); k++ )
+	{
+		shardOf[k] = route(layout, keys[k]);
+		offset[ shardOf[k] + 1 ]++;
+	}
+
+	for ( size_t i = 0; i < used; i++ )
+		offset[i + 1] += offset[i];
+
+	vector<size_t> order( keys.size() );
+	vector<size_t> next( offset.begin(), offset.end() - 1 );
+
+	for ( size_t k = 0; k < keys.size(); k++ )
+		order[ next[ shardOf[k] ]++ ] = k;
+
+	//! bool vectors pack bits, so the tasks write chars
+	vector<char> found( keys.size(), 0 );
+	vector<char> moved( keys.size(), 0 );
+
+	{
+		ThreadPool::TaskGroup group(m_pool);
+
+		for ( size_t i = 0; i < used; i++ )
+		{
+			if ( offset[i] == offset[i + 1] )
+				continue;
+
+			group.run( [this, i, &keys, &offset, &order, &found, &moved]()
+			{
+				const Shard& shard = *m_shards[i];
+				lock_guard<mutex> lock(shard.lock);
+
+				vector<Key> mine;
+				vector<size_t> position;
+
+				for ( size_t j = offset[i]; j < offset[i + 1]; j++ )
+				{
+					if ( shard.holds( keys[ order[j] ] ) )
+					{
+						mine.push_back( keys[ order[j] ] );
+						position.push_back( order[j] );
+					}
+					else
+						moved[ order[j] ] = 1;
+				}
+
+				vector<const Comparable*> result( mine.size() );
+				shard.tree.find_many(mine.begin(), mine.end(), result.begin());
+
+				for ( size_t j = 0; j < result.size(); j++ )
+					found[ position[j] ] = ( result[j] != NULL );
+			} );
+		}
+
+		group.wait();
+	}
+
+	//! Keys a concurrent rebalance moved to another shard
+	for ( size_t k = 0; k < keys.size(); k++ )
+		if ( moved[k] )
+			found[k] = contains(keys[k]);
+
+	for ( size_t k = 0; k < keys.size(); k++ )
+		*out++ = ( found[k] != 0 );
+
+	return out;
+}
+
+/*!
+ * For each function
+ * no rebalance runs meanwhile, so every value is visited once
+ *
+ * @param fn => called with every value, in order
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+template <class Function>
+void ShardedRedBlackTree<Comparable, Tree>::for_each( Function fn ) const
+{
+	lock_guard<mutex> guard(m_rebalance);
+
+	for ( size_t i = 0; i < m_shards.size(); i++ )
+	{
+		const Shard& shard = *m_shards[i];
+		lock_guard<mutex> lock(shard.lock);
+
+		for ( typename Tree::const_iterator it = shard.tree.begin(); it != shard.tree.end(); ++it )
+			fn(*it);
+	}
+}
+
+/*!
+ * Rebalance function
+ * collects every value in order and rebuilds each shard with an equal
+ * share, O(n); the bounds are the first value of each share
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void ShardedRedBlackTree<Comparable, Tree>::rebalance( void )
+{
+	lock_guard<mutex> guard(m_rebalance);
+	vector< unique_lock<mutex> > locks;
+
+	for ( size_t i = 0; i < m_shards.size(); i++ )
+		locks.push_back( unique_lock<mutex>(m_shards[i]->lock) );
+
+	vector<Comparable> values;
+	values.reserve( size() );
+
+	for ( size_t i = 0; i < m_shards.size(); i++ )
+		values.insert( values.end(), m_shards[i]->tree.begin(), m_shards[i]->tree.end() );
+
+	if ( values.empty() )
+		return;
+
+	size_t n = m_shards.size();
+	Bounds layout;
+
+	for ( size_t i = 1; i < n; i++ )
+		layout.push_back( values[ i * values.size() / n ] );
+
+	//! Rebuilt here and not in the pool: a thread that waits on a group runs other tasks
+	//! meanwhile, and one of them could need a shard lock this thread holds
+	typename vector<Comparable>::const_iterator start = values.cbegin();
+
+	for ( size_t i = 0; i < n; i++ )
+	{
+		typename vector<Comparable>::const_iterator stop = ( i + 1 == n ) ? values.cend()
+			: std::lower_bound(start, values.cend(), layout[i]);
+
+		m_shards[i]->tree.assign(start, stop);
+		m_shards[i]->size = m_shards[i]->tree.size();
+		start = stop;
+	}
+
+	setBounds(layout);
+}
+
+/*!
+ * Route function
+ *
+ * @param bounds 	=> first value of the shards 1, 2, ...
+ * @param key 		=> value to be placed
+ *
+ * @return => index of the shard whose range holds key
+*/
+template <class Comparable, class Tree>
+template <class Key>
+size_t ShardedRedBlackTree<Comparable, Tree>::route( const Bounds& bounds, const Key& key )
+{
+	return std::upper_bound(bounds.begin(), bounds.end(), key) - bounds.begin();
+}
+
+/*!
+ * Lock shard function
+ * routes with the current bounds and checks the range under the lock
+ * (a rebalance may have moved it in between)
+ *
+ * @param key 	=> value to be placed
+ * @param lock 	=> receives the shard lock
+ *
+ * @return => index of the locked shard
+*/
+template <class Comparable, class Tree>
+template <class Key>
+size_t ShardedRedBlackTree<Comparable, Tree>::lockShard( const Key& key, unique_lock<mutex>& lock ) const
+{
+	for ( bool force = false; ; force = true )
+	{
+		size_t i = route(routeBounds(force), key);
+		unique_lock<mutex> shardLock(m_shards[i]->lock);
+
+		if ( m_shards[i]->holds(key) )
+		{
+			lock = std::move(shardLock);
+			return i;
+		}
+	}
+}
+
+/*!
+ * Route bounds function
+ * the copy is per thread and per tree type; the generation numbers are
+ * unique among all the trees, so a copy never passes for another tree's
+ *
+ * @param force => refresh the copy even if it looks up to date
+ *
+ * @return => the bounds of the calling thread
+*/
+template <class Comparable, class Tree>
+const typename ShardedRedBlackTree<Comparable, Tree>::Bounds& ShardedRedBlackTree<Comparable, Tree>::routeBounds( bool force ) const
+{
+	static thread_local RouteCache cache;
+
+	if ( force || cache.generation != m_generation.load(memory_order_acquire) )
+	{
+		lock_guard<mutex> lock(m_boundsLock);
+
+		cache.bounds = m_bounds;
+		cache.generation = m_generation.load(memory_order_relaxed);
+	}
+
+	return cache.bounds;
+}
+
+/*!
+ * Set bounds function
+ * the shards past the bounds hold nothing until a rebalance
+ *
+ * @param layout => first value of the shards 1, 2, ...
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void ShardedRedBlackTree<Comparable, Tree>::setBounds( const Bounds& layout )
+{
+	for ( size_t i = 0; i < m_shards.size(); i++ )
+	{
+		Shard& shard = *m_shards[i];
+
+		shard.hasLo = ( i > 0 && i <= layout.size() );
+		shard.hasHi = ( i < layout.size() );
+
+		if ( shard.hasLo )
+			shard.lo = layout[i - 1];
+		if ( shard.hasHi )
+			shard.hi = layout[i];
+	}
+
+	publishBounds(layout);
+}
+
+/*!
+ * Publish bounds function
+ *
+ * @param layout => first value of the shards 1, 2, ...
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void ShardedRedBlackTree<Comparable, Tree>::publishBounds( const Bounds& layout )
+{
+	static atomic<uint64_t> generations(0);
+
+	lock_guard<mutex> lock(m_boundsLock);
+
+	m_bounds = layout;
+	m_used = layout.size() + 1;
+	m_generation.store( ++generations, memory_order_release );
+}
+
+/*!
+ * Check hot function
+ * skipped if another thread is already rebalancing
+ *
+ * @param i => index of the shard that grew
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void ShardedRedBlackTree<Comparable, Tree>::checkHot( size_t i )
+{
+	size_t total = size();
+
+	if ( total < MinRebalance )
+		return;
+
+	size_t used = m_used;
+
+	//! The bounds aren't known yet
+	if ( used < m_shards.size() )
+	{
+		rebalance();
+		return;
+	}
+
+	if ( shardSize(i) <= HotRatio * total / used )
+		return;
+
+	unique_lock<mutex> guard(m_rebalance, try_to_lock);
+
+	if ( !guard.owns_lock() )
+		return;
+
+	//! The smaller neighbor takes half the difference
+	size_t j;
+
+	if ( i == 0 )
+		j = 1;
+	else if ( i + 1 == used )
+		j = i - 1;
+	else
+		j = ( shardSize(i - 1) < shardSize(i + 1) ) ? i - 1 : i + 1;
+
+	lock_guard<mutex> first( m_shards[ min(i, j) ]->lock );
+	lock_guard<mutex> second( m_shards[ max(i, j) ]->lock );
+
+	moveHalf(i, j);
+}
+
+/*!
+ * Move half function
+ * the values move across the bound between i and j, so only those two
+ * shards and that bound change. The big shard is cut with split_at and the
+ * part joins the neighbor with unite (the ranges don't overlap, so nothing
+ * is dropped): no value is removed or inserted one by one, the walk to the
+ * bound only follows k links
+ *
+ * @param i => index of the big shard
+ * @param j => index of its neighbor (i - 1 or i + 1)
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+void ShardedRedBlackTree<Comparable, Tree>::moveHalf( size_t i, size_t j )
+{
+	Shard& from = *m_shards[i];
+	Shard& to = *m_shards[j];
+
+	if ( from.tree.size() <= to.tree.size() + 1 )
+		return;
+
+	size_t k = ( from.tree.size() - to.tree.size() ) / 2;
+	typename Tree::const_iterator it;
+
+	if ( j == i + 1 )
+	{
+		//! The k biggest values (and the ones equal to the first of them) move right
+		it = from.tree.end();
+
+		for ( size_t step = 0; step < k; step++ )
+			--it;
+	}
+	else
+	{
+		//! The values below the k-th smallest move left
+		it = from.tree.begin();
+
+		for ( size_t step = 0; step < k; step++ )
+			++it;
+	}
+
+	Comparable bound = *it;
+
+	//! All the values are equal to bound: they can't be parted
+	if ( from.tree.lower_bound(bound) == from.tree.begin() )
+		return;
+
+	//! The values not less than bound are cut off
+	Tree upper;
+	from.tree.split_at(bound, upper);
+
+	if ( j == i + 1 )
+	{
+		to.tree.unite(upper);
+	}
+	else
+	{
+		to.tree.unite(from.tree);
+		from.tree.swap(upper);
+	}
+
+	from.size = from.tree.size();
+	to.size = to.tree.size();
+
+	//! New bound between the two shards
+	Bounds layout = bounds();
+	layout[ min(i, j) ] = bound;
+
+	if ( j == i + 1 )
+		from.hi = to.lo = bound;
+	else
+		from.lo = to.hi = bound;
+
+	publishBounds(layout);
+}
+
+/*!
+ * Iterator constructor
+ *
+ * @param tree 	=> the sharded tree
+ * @param shard => first shard to look at
+ *
+ * @return => void
+*/
+template <class Comparable, class Tree>
+ShardedRedBlackTree<Comparable, Tree>::const_iterator::const_iterator( const ShardedRedBlackTree* tree, size_t shard )
+	: m_tree(tree), m_shard(shard) //!< initialize the basic members
+{
+	while ( m_shard < m_tree->m_shards.size() && m_tree->m_shards[m_shard]->tree.empty() )
+		m_shard++;
+
+	if ( m_shard < m_tree->m_shards.size() )
+		m_inner = m_tree->m_shards[m_shard]->tree.begin();
+}
+
+/*!
+ * Iterator increment
+ * at the end of a shard it goes to the next one with values
+ *
+ * @return => the iterator itself
+*/
+template <class Comparable, class Tree>
+typename ShardedRedBlackTree<Comparable, Tree>::const_iterator&
+ShardedRedBlackTree<Comparable, Tree>::const_iterator::operator ++ ( void )
+{
+	if ( ++m_inner == m_tree->m_shards[m_shard]->tree.end() )
+		*this = const_iterator(m_tree, m_shard + 1);
+
+	return *this;
+}
@@ -0,0 +1,267 @@
+/*!
+    <PRE>
+        SOURCE FILE : ShardedRedBlackTree.h
+        DESCRIPTION.: Range sharded red black tree (one lock per shard, parallel batches).
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Range shards, parallel batches, ordered iteration and rebalancing implemented.
+
+        TO COMPILE..: Use makefile (-pthread).
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef ShardedRedBlackTree_H_
+#define ShardedRedBlackTree_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+
+#include "RedBlackTree.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// ShardedRedBlackTree( size_t shards, size_t threads )         --> Class constructor
+// ShardedRedBlackTree( const vector<Comparable>& bounds, threads ) --> Shards split at bounds
+// void insert( const Comparable& v )                           --> Insertion function
+// void insert_batch( InputIterator first, InputIterator last ) --> Parallel batch insertion
+// bool remove( const Key& key )                                --> Remove function
+// void clear( void )                                           --> Remove every value
+// size_t size( void ) const / bool empty( void ) const         --> Number of values
+// bool contains( const Key& key ) const                        --> Search function
+// bool find( const Key& key, Comparable& out ) const           --> Search function, copies the value
+// size_t count( const Key& key ) const                         --> Number of equal values
+// find_many( first, last, out ) const                          --> Parallel lookups (a bool per key)
+// void for_each( Function fn ) const                           --> In-order visit, shard by shard
+// begin( ) / end( )                                            --> In-order iterators (no writer running)
+// void rebalance( void )                                       --> Even out every shard, O(n)
+// size_t shards( void ) const / size_t shardSize( size_t i ) const --> Shard layout
+//
+// Every function but the iterators can be called from any thread.
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed.
+// std::invalid_argument thrown by the constructor if the bounds aren't sorted.
+
+/*! Red black tree split by key range into independent trees, each with its own lock.
+ *  Shard i holds the values in [bound i - 1, bound i), so writers on different ranges never
+ *  meet, equal values always share a shard and the shards in order are the values in order.
+ *  insert_batch() and find_many() split their keys by shard and run one task per shard on a
+ *  thread pool (the calling thread works too).
+ *
+ *  Every thread routes with its own copy of the bounds, refreshed when their generation number
+ *  changes, so routing only reads one shared atomic. The key is then checked against the range
+ *  the shard holds under its lock, and routed again if a rebalance moved it meanwhile. When a
+ *  shard grows past HotRatio times the average, half the difference moves to its smaller
+ *  neighbor with split_at() and unite() (only those two shards are locked). Until the bounds are known (given to the constructor, or set by a rebalance() when
+ *  the tree first reaches MinRebalance values) every value goes to the first shard.
+*/
+template <class Comparable, class Tree = RedBlackTree<Comparable> >
+class ShardedRedBlackTree
+{
+    /*!
+     * Private types (used by the public section)
+    */
+    private:
+
+        /*! One range of the key space */
+        struct Shard
+        {
+            Shard( void ) : hasLo(false), hasHi(false), size(0) { /*! empty */ }
+
+            /*! Check if the key belongs to [lo, hi) (under lock) */
+            template <class Key>
+            bool holds( const Key& key ) const { return ( !hasLo || !(key < lo) ) && ( !hasHi || key < hi ); }
+
+            mutable mutex       lock;       //!< guards everything below
+            Tree                tree;       //!< the values
+            Comparable          lo;         //!< first value of the range (if hasLo)
+            Comparable          hi;         //!< first value past the range (if hasHi)
+            bool                hasLo;      //!< false for the first shard
+            bool                hasHi;      //!< false for the last shard in use
+            atomic<size_t>      size;       //!< tree.size(), readable without the lock
+        };
+
+        typedef vector<Comparable> Bounds;
+
+        /*! Copy of the bounds kept by each thread, refreshed when the generation changes */
+        struct RouteCache
+        {
+            RouteCache( void ) : generation(0) { /*! empty */ }
+
+            uint64_t    generation;     //!< generation of the copy (unique among all the trees)
+            Bounds      bounds;         //!< the copy
+        };
+
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! Forward in-order iterator: the shards one after the other */
+        class const_iterator
+        {
+            public:
+
+                typedef forward_iterator_tag    iterator_category;
+                typedef Comparable              value_type;
+                typedef ptrdiff_t               difference_type;
+                typedef const Comparable*       pointer;
+                typedef const Comparable&       reference;
+
+                const_iterator( void ) : m_tree(NULL), m_shard(0) { /*! empty */ }
+
+                reference operator * ( void ) const { return *m_inner; }
+                pointer operator -> ( void ) const { return &*m_inner; }
+
+                const_iterator& operator ++ ( void );
+                const_iterator operator ++ ( int ) { const_iterator old = *this; ++*this; return old; }
+
+                bool operator == ( const const_iterator& rhs ) const { return m_shard == rhs.m_shard && m_inner == rhs.m_inner; }
+                bool operator != ( const const_iterator& rhs ) const { return !( *this == rhs ); }
+
+            private:
+
+                /*! Points to the first value of shard, or the next shard with values */
+                const_iterator( const ShardedRedBlackTree* tree, size_t shard );
+
+                const ShardedRedBlackTree*          m_tree;     //!< the sharded tree
+                size_t                              m_shard;    //!< current shard (shards() for end())
+                typename Tree::const_iterator       m_inner;    //!< position in the shard
+
+                friend class ShardedRedBlackTree;
+        };
+
+        typedef const_iterator iterator;
+
+        /*! A shard grows past HotRatio times the average: it is split with a neighbor.
+         *  Trees smaller than MinRebalance values aren't rebalanced, and insert() checks
+         *  once every CheckInterval values a shard reaches
+        */
+        static const size_t HotRatio = 2;
+        static const size_t MinRebalance = 4096;
+        static const size_t CheckInterval = 256;
+
+        /*! Class constructor: shards trees, threads workers in the pool */
+        explicit ShardedRedBlackTree( size_t shards = ThreadPool::defaultThreads() + 1,
+                                      size_t threads = ThreadPool::defaultThreads() );
+
+        /*! One shard more than bounds, split at the (sorted) bounds */
+        explicit ShardedRedBlackTree( const vector<Comparable>& bounds,
+                                      size_t threads = ThreadPool::defaultThreads() );
+
+        /*! Insertion function. Could throws a bad_alloc exception */
+        void insert( const Comparable& v );
+
+        /*! Inserts [first, last), one task per shard */
+        template <class InputIterator>
+        void insert_batch( InputIterator first, InputIterator last );
+
+        /*! Removes one value equal to key. Returns false if there is none */
+        template <class Key>
+        bool remove( const Key& key );
+
+        /*! Remove every value (the bounds are kept) */
+        void clear( void );
+
+        /*! Number of values (a sum of the shard sizes, not atomic as a whole) */
+        size_t size( void ) const;
+
+        /*! Check if there is no value */
+        bool empty( void ) const { return size() == 0; }
+
+        /*! Search functions (any Key comparable with Comparable through '<').
+         *  find() copies the value out: other threads may remove or move it right after
+        */
+        template <class Key>
+        bool contains( const Key& key ) const;
+
+        template <class Key>
+        bool find( const Key& key, Comparable& out ) const;
+
+        template <class Key>
+        size_t count( const Key& key ) const;
+
+        /*! contains() for every key of [first, last), written to out (a bool per key),
+         *  one task per shard, each running the shard's find_many()
+        */
+        template <class InputIterator, class OutputIterator>
+        OutputIterator find_many( InputIterator first, InputIterator last, OutputIterator out ) const;
+
+        /*! Calls fn(value) in order, holding one shard lock at a time */
+        template <class Function>
+        void for_each( Function fn ) const;
+
+        /*! In-order iterators. Not to be used while a writer is running */
+        const_iterator begin( void ) const { return const_iterator(this, 0); }
+        const_iterator end( void ) const { return const_iterator(this, m_shards.size()); }
+
+        /*! Moves the values so that every shard gets the same share, O(n). Locks every shard */
+        void rebalance( void );
+
+        /*! Shard layout: number of shards and values in shard i */
+        size_t shards( void ) const { return m_shards.size(); }
+        size_t shardSize( size_t i ) const { return m_shards[i]->size.load(memory_order_relaxed); }
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! Shard of key according to bounds */
+        template <class Key>
+        static size_t route( const Bounds& bounds, const Key& key );
+
+        /*! Copy of the current bounds */
+        Bounds bounds( void ) const { lock_guard<mutex> lock(m_boundsLock); return m_bounds; }
+
+        /*! Bounds of the calling thread (refreshed if force or if they are out of date) */
+        const Bounds& routeBounds( bool force ) const;
+
+        /*! Locks the shard that holds key and returns its index */
+        template <class Key>
+        size_t lockShard( const Key& key, unique_lock<mutex>& lock ) const;
+
+        /*! Sets the ranges of the shards and publishes bounds (every shard locked) */
+        void setBounds( const Bounds& bounds );
+
+        /*! Publishes new bounds (the shards they change are locked) */
+        void publishBounds( const Bounds& bounds );
+
+        /*! Splits shard i with its smaller neighbor if it got too big */
+        void checkHot( size_t i );
+
+        /*! Moves half the difference between shards i and j (neighbors, both locked) */
+        void moveHalf( size_t i, size_t j );
+
+        /*! The locks belong to the shards, so the tree can't be copied */
+        ShardedRedBlackTree( const ShardedRedBlackTree& );
+        ShardedRedBlackTree& operator = ( const ShardedRedBlackTree& );
+
+        /*! Basic members */
+        vector< unique_ptr<Shard> >     m_shards;       //!< the ranges, in key order
+        Bounds                          m_bounds;       //!< first value of shards 1, 2, ...
+        mutable mutex                   m_boundsLock;   //!< guards m_bounds
+        atomic<uint64_t>                m_generation;   //!< changes with m_bounds
+        atomic<size_t>                  m_used;         //!< shards in use (m_bounds.size() + 1)
+        mutable mutex                   m_rebalance;    //!< one rebalance at a time (for_each holds it too)
+        mutable ThreadPool              m_pool;         //!< runs the per shard tasks
+};
+
+#include "ShardedRedBlackTree.cpp"
+#endif // ShardedRedBlackTree_H
+
+/* ------------------- [ End of the ShardedRedBlackTree.h header ] ------------------- */
+/* =================================================================================== */
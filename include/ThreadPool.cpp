@@ -0,0 +1,298 @@
+/*! \file */
+/*! \brief ThreadPool.cpp.
+ *
+ *  Implements the functions from ThreadPool class.
+ *  The class isn't a template, so its functions are inline (the file is included by the header).
+*/
+
+#include "ThreadPool.h"
+
+/*! Pool and index of the current worker thread */
+struct ThreadPoolWorker
+{
+	const ThreadPool*   pool;
+	size_t              index;
+};
+
+inline ThreadPoolWorker& currentThreadPoolWorker( void )
+{
+	static thread_local ThreadPoolWorker worker = { NULL, 0 };
+
+	return worker;
+}
+
+/*!
+ * Class constructor
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param threads => number of worker threads
+ *
+ * @return => void
+*/
+inline ThreadPool::ThreadPool( size_t threads )
+	: m_queued(0), m_stop(false) //!< initialize the basic members
+{
+	for ( size_t i = 0; i <= threads; i++ )
+		m_queues.push_back( unique_ptr<Queue>( new Queue ) );
+
+	for ( size_t i = 0; i < threads; i++ )
+		m_workers.push_back( thread( &ThreadPool::work, this, i ) );
+}
+
+/*!
+ * Class destructor
+ * @return => void
+*/
+inline ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_sleepLock);
+		m_stop = true;
+	}
+
+	m_wake.notify_all();
+
+	for ( size_t i = 0; i < m_workers.size(); i++ )
+		m_workers[i].join();
+}
+
+/*!
+ * Default threads function
+ *
+ * @return => number of cores minus one (0 if unknown)
+*/
+inline size_t ThreadPool::defaultThreads( void )
+{
+	size_t cores = thread::hardware_concurrency();
+
+	return ( cores > 1 ) ? cores - 1 : 0;
+}
+
+/*!
+ * Parallel for function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param n 	=> number of indices
+ * @param grain => indices per task
+ * @param fn 	=> called with each index (copied to every task)
+ *
+ * @return => void
+*/
+template <class Function>
+void ThreadPool::parallelFor( size_t n, size_t grain, Function fn )
+{
+	TaskGroup group(*this);
+
+	if ( grain == 0 )
+		grain = 1;
+
+	for ( size_t first = 0; first < n; first += grain )
+	{
+		size_t last = ( n - first > grain ) ? first + grain : n;
+
+		group.run( [first, last, fn]() mutable
+		{
+			for ( size_t i = first; i < last; i++ )
+				fn(i);
+		} );
+	}
+
+	group.wait();
+}
+
+/*!
+ * Self function
+ *
+ * @return => index of the calling worker, NoWorker if it isn't one of this pool
+*/
+inline size_t ThreadPool::self( void ) const
+{
+	const ThreadPoolWorker& worker = currentThreadPoolWorker();
+
+	return ( worker.pool == this ) ? worker.index : NoWorker;
+}
+
+/*!
+ * Push function
+ *
+ * @param task => the task to be queued
+ *
+ * @return => void
+*/
+inline void ThreadPool::push( function<void()> task )
+{
+	size_t index = self();
+	Queue& queue = *m_queues[ ( index == NoWorker ) ? m_workers.size() : index ];
+
+	{
+		lock_guard<mutex> lock(queue.lock);
+		queue.tasks.push_back( std::move(task) );
+		m_queued++;
+	}
+
+	//! An idle worker checks m_queued under m_sleepLock, so the wake up can't be lost
+	{
+		lock_guard<mutex> lock(m_sleepLock);
+	}
+
+	m_wake.notify_one();
+}
+
+/*!
+ * Run one function
+ * the own deque from the back, then the shared queue and the other
+ * deques from the front
+ *
+ * @param index => index of the calling worker (NoWorker for other threads)
+ *
+ * @return => true if a task was run
+*/
+inline bool ThreadPool::runOne( size_t index )
+{
+	size_t queues = m_queues.size();
+	function<void()> task;
+
+	if ( index != NoWorker )
+	{
+		Queue& own = *m_queues[index];
+		lock_guard<mutex> lock(own.lock);
+
+		if ( !own.tasks.empty() )
+		{
+			task = std::move( own.tasks.back() );
+			own.tasks.pop_back();
+			m_queued--;
+		}
+	}
+
+	//! The shared queue first, then the next workers
+	size_t start = ( index == NoWorker ) ? queues - 1 : index + 1;
+
+	for ( size_t i = 0; !task && i < queues; i++ )
+	{
+		size_t victim = ( start + i ) % queues;
+
+		if ( victim == index )
+			continue;
+
+		Queue& queue = *m_queues[victim];
+		lock_guard<mutex> lock(queue.lock);
+
+		if ( !queue.tasks.empty() )
+		{
+			task = std::move( queue.tasks.front() );
+			queue.tasks.pop_front();
+			m_queued--;
+		}
+	}
+
+	if ( !task )
+		return false;
+
+	task();
+
+	return true;
+}
+
+/*!
+ * Work function
+ * runs tasks until the pool stops, sleeping while there is none
+ *
+ * @param index => index of the worker
+ *
+ * @return => void
+*/
+inline void ThreadPool::work( size_t index )
+{
+	ThreadPoolWorker& worker = currentThreadPoolWorker();
+	worker.pool = this;
+	worker.index = index;
+
+	while ( !m_stop )
+	{
+		if ( runOne(index) )
+			continue;
+
+		unique_lock<mutex> lock(m_sleepLock);
+		m_wake.wait( lock, [this]() { return m_stop || m_queued > 0; } );
+	}
+}
+
+/*!
+ * Task group destructor
+ * @return => void
+*/
+inline ThreadPool::TaskGroup::~TaskGroup()
+{
+	try
+	{
+		wait();
+	}
+	catch ( ... )
+	{
+		//! Nothing to do, the group is being destroyed
+	}
+}
+
+/*!
+ * Run function
+ * it throws a bad_alloc exception if no enough space
+ *
+ * @param fn => the task (copied)
+ *
+ * @return => void
+*/
+template <class Function>
+void ThreadPool::TaskGroup::run( Function fn )
+{
+	m_pending++;
+
+	try
+	{
+		m_pool.push( [this, fn]() mutable
+		{
+			try
+			{
+				fn();
+			}
+			catch ( ... )
+			{
+				lock_guard<mutex> lock(m_errorLock);
+
+				if ( !m_error )
+					m_error = current_exception();
+			}
+
+			m_pending--;
+		} );
+	}
+	catch ( ... )
+	{
+		m_pending--;
+		throw;
+	}
+}
+
+/*!
+ * Wait function
+ * the waiting thread runs tasks (of any group) meanwhile
+ *
+ * @return => void
+*/
+inline void ThreadPool::TaskGroup::wait( void )
+{
+	size_t index = m_pool.self();
+
+	while ( m_pending > 0 )
+		if ( !m_pool.runOne(index) )
+			this_thread::yield();
+
+	lock_guard<mutex> lock(m_errorLock);
+
+	if ( m_error )
+	{
+		exception_ptr error = m_error;
+		m_error = exception_ptr();
+		rethrow_exception(error);
+	}
+}
@@ -0,0 +1,157 @@
+/*!
+    <PRE>
+        SOURCE FILE : ThreadPool.h
+        DESCRIPTION.: Work stealing thread pool used by the parallel tree operations.
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Worker deques, stealing, task groups and parallelFor implemented.
+
+        TO COMPILE..: Use makefile (-pthread).
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef ThreadPool_H_
+#define ThreadPool_H_
+
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <exception>
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// ThreadPool( size_t threads )                                 --> Starts the worker threads
+// ~ThreadPool()                                                --> Stops and joins the workers
+// size_t size( void ) const                                    --> Number of worker threads
+// static size_t defaultThreads( void )                         --> One worker per extra core
+// TaskGroup( ThreadPool& pool )                                --> Set of tasks waited together
+// void TaskGroup::run( Function fn )                           --> Queues fn()
+// void TaskGroup::wait( void )                                 --> Runs tasks until the group is done
+// void parallelFor( size_t n, size_t grain, Function fn )      --> fn(i) for every i of [0, n)
+//
+// A task can run more tasks (fork/join): wait() runs queued tasks instead of blocking, so the
+// nested groups never deadlock, even with no worker thread at all.
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed.
+// The first exception thrown by a task of a group is rethrown by its wait().
+
+/*! Thread pool with one deque per worker.
+ *  A worker pushes the tasks it spawns to the back of its own deque and takes them back
+ *  from there (the newest task is the one whose data is still in cache); an idle worker
+ *  steals from the front of the others (the oldest task, usually the biggest piece of work).
+ *  Tasks from threads outside the pool go to a shared queue. The thread that waits on a group
+ *  helps with the tasks, so the caller is one more worker.
+*/
+class ThreadPool
+{
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! Tasks that are waited together */
+        class TaskGroup
+        {
+            public:
+
+                /*! Empty group */
+                explicit TaskGroup( ThreadPool& pool ) : m_pool(pool), m_pending(0) { /*! empty */ }
+
+                /*! Waits for the tasks still running (their exceptions are lost) */
+                ~TaskGroup();
+
+                /*! Queues fn() (fn is copied). Could throws a bad_alloc exception */
+                template <class Function>
+                void run( Function fn );
+
+                /*! Runs queued tasks until every task of the group is done.
+                 *  Rethrows the first exception a task threw
+                */
+                void wait( void );
+
+            private:
+
+                TaskGroup( const TaskGroup& );
+                TaskGroup& operator = ( const TaskGroup& );
+
+                ThreadPool&         m_pool;     //!< where the tasks run
+                atomic<size_t>      m_pending;  //!< tasks not finished yet
+                mutex               m_errorLock;
+                exception_ptr       m_error;    //!< first exception thrown by a task
+        };
+
+        /*! Starts the worker threads (0 is fine: the tasks run in wait()) */
+        explicit ThreadPool( size_t threads = defaultThreads() );
+
+        /*! Stops and joins the workers (the groups must be done) */
+        ~ThreadPool();
+
+        /*! Number of worker threads */
+        size_t size( void ) const { return m_workers.size(); }
+
+        /*! One worker per core, besides the thread that waits */
+        static size_t defaultThreads( void );
+
+        /*! Runs fn(i) for every i of [0, n), one task per grain indices (the calling thread
+         *  helps). Rethrows the first exception fn threw
+        */
+        template <class Function>
+        void parallelFor( size_t n, size_t grain, Function fn );
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! A deque of tasks */
+        struct Queue
+        {
+            mutex                           lock;
+            deque< function<void()> >       tasks;
+        };
+
+        /*! Index of the calling worker in this pool (NoWorker for other threads) */
+        size_t self( void ) const;
+
+        /*! Queues a task (the own deque of a worker, the shared queue otherwise) */
+        void push( function<void()> task );
+
+        /*! Runs one task (own deque, shared queue, then stealing). False if there was none */
+        bool runOne( size_t index );
+
+        /*! Worker thread body */
+        void work( size_t index );
+
+        /*! Workers and other threads */
+        static const size_t NoWorker = ~size_t(0);
+
+        /*! The workers know their pool, so it can't be copied */
+        ThreadPool( const ThreadPool& );
+        ThreadPool& operator = ( const ThreadPool& );
+
+        /*! Basic members */
+        vector< unique_ptr<Queue> >     m_queues;   //!< one per worker, the last one is shared
+        vector<thread>                  m_workers;  //!< worker threads
+        atomic<size_t>                  m_queued;   //!< tasks waiting in the queues
+        atomic<bool>                    m_stop;     //!< set by the destructor
+        mutex                           m_sleepLock;
+        condition_variable              m_wake;     //!< idle workers wait here
+};
+
+#include "ThreadPool.cpp"
+#endif // ThreadPool_H
+
+/* ------------------------- [ End of the ThreadPool.h header ] ------------------------- */
+/* ====================================================================================== */
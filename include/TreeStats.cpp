@@ -0,0 +1,169 @@
+/*! \file */
+/*! \brief TreeStats.cpp.
+ *
+ *  Implements the functions from TreeStats classes.
+ *  Only TreeCounters is a template, so the other functions are inline (the file is included by the header).
+*/
+
+#include "TreeStats.h"
+
+/*!
+ * Record function
+ *
+ * @param sample => the sample
+ *
+ * @return => void
+*/
+inline void LatencyHistogram::record( uint64_t sample )
+{
+	m_buckets[ bucketOf(sample) ].add(1);
+	m_count.add(1);
+	m_sum.add(sample);
+	m_max.raise(sample);
+}
+
+/*!
+ * Percentile function
+ * walks the buckets up to the one holding the sample of rank p% of the count
+ *
+ * @param p => percent (0 to 100)
+ *
+ * @return => top of the bucket of that sample (capped at max()), 0 if there is none
+*/
+inline uint64_t LatencyHistogram::percentile( double p ) const
+{
+	uint64_t total = count();
+
+	if ( total == 0 )
+		return 0;
+
+	//! Rank of the sample, 1 based
+	uint64_t rank = uint64_t( p / 100.0 * double(total) + 0.5 );
+	rank = ( rank < 1 ) ? 1 : ( rank > total ) ? total : rank;
+
+	uint64_t seen = 0;
+
+	for ( size_t b = 0; b < Buckets; b++ )
+	{
+		seen += m_buckets[b].value();
+
+		if ( seen >= rank )
+			return ( bucketTop(b) < max() ) ? bucketTop(b) : max();
+	}
+
+	return max();
+}
+
+/*!
+ * Bucket of function
+ * the position of the top bit picks the power of two, the next SubBits bits the bucket in it
+ *
+ * @param sample => the sample
+ *
+ * @return => its bucket
+*/
+inline size_t LatencyHistogram::bucketOf( uint64_t sample )
+{
+	if ( sample < ( 1u << SubBits ) )
+		return size_t(sample);
+
+	unsigned top = 63 - unsigned( __builtin_clzll(sample) );
+	unsigned shift = top - SubBits;
+
+	return ( size_t( top - SubBits + 1 ) << SubBits ) + size_t( ( sample >> shift ) & ( ( 1u << SubBits ) - 1 ) );
+}
+
+/*!
+ * Bucket top function
+ *
+ * @param bucket => a bucket
+ *
+ * @return => the largest sample it holds
+*/
+inline uint64_t LatencyHistogram::bucketTop( size_t bucket )
+{
+	if ( bucket < ( 1u << SubBits ) )
+		return uint64_t(bucket);
+
+	unsigned shift = unsigned( bucket >> SubBits ) - 1;
+	uint64_t low = ( uint64_t( ( 1u << SubBits ) | ( bucket & ( ( 1u << SubBits ) - 1 ) ) ) ) << shift;
+
+	return low + ( ( uint64_t(1) << shift ) - 1 );
+}
+
+/*!
+ * Print function
+ *
+ * @param out => the stream
+ *
+ * @return => void
+*/
+inline void TreeStats::print( ostream& out ) const
+{
+	static const char* names[] = { "insert", "remove", "search" };
+
+	out << "size " << size << ( inlined ? " (inline)" : "" ) << ", height " << height << ", black height " << blackHeight
+		<< ", node bytes " << nodeBytes << " (" << reservedBytes << " reserved)" << endl;
+
+	if ( !enabled )
+	{
+		out << "counters off (build with -DRBTREE_STATS)" << endl;
+		return;
+	}
+
+	out << "comparisons " << comparisons.value() << ", splits " << splits.value()
+		<< ", rotations " << leftRotations.value() << " left / " << rightRotations.value() << " right"
+		<< ", color swaps " << colorSwaps.value() << endl;
+	out << "nodes allocated " << nodesAllocated.value() << ", freed " << nodesFreed.value() << endl;
+
+	for ( int op = 0; op < OperationCount; op++ )
+	{
+		const OperationStats& o = operations[op];
+
+		out << names[op] << ": " << o.latency.count() << " ops, depth " << o.meanDepth()
+			<< " avg / " << o.depthMax.value() << " max, ns p50 " << o.latency.percentile(50)
+			<< " p99 " << o.latency.percentile(99) << " p99.9 " << o.latency.percentile(99.9)
+			<< " max " << o.latency.max() << endl;
+	}
+}
+
+/*!
+ * Operation timer destructor
+ * records the latency and the nodes visited since construction
+ *
+ * @return => void
+*/
+template <bool Enabled>
+TreeCounters<Enabled>::OperationTimer::~OperationTimer()
+{
+	uint64_t ns = uint64_t( chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now() - m_start ).count() );
+	uint64_t depth = m_counters.m_depth.value() - m_depth;
+
+	OperationStats& o = m_counters.m_stats.operations[m_op];
+	o.latency.record(ns);
+	o.depthSum.add(depth);
+	o.depthMax.raise(depth);
+}
+
+/*!
+ * Fill stats function
+ *
+ * @param stats => receives the counters (the shape fields are left alone)
+ *
+ * @return => void
+*/
+template <bool Enabled>
+void TreeCounters<Enabled>::fillStats( TreeStats& stats ) const
+{
+	stats.enabled = true;
+	stats.comparisons = m_stats.comparisons;
+	stats.splits = m_stats.splits;
+	stats.leftRotations = m_stats.leftRotations;
+	stats.rightRotations = m_stats.rightRotations;
+	stats.colorSwaps = m_stats.colorSwaps;
+	stats.nodesAllocated = m_stats.nodesAllocated;
+	stats.nodesFreed = m_stats.nodesFreed;
+
+	for ( int op = 0; op < TreeStats::OperationCount; op++ )
+		stats.operations[op] = m_stats.operations[op];
+}
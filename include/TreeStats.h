@@ -0,0 +1,220 @@
+/*!
+    <PRE>
+        SOURCE FILE : TreeStats.h
+        DESCRIPTION.: Operation counters and latency histograms of the RedBlackTree class.
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Counters, descent depths, log bucketed histograms and stats() snapshot implemented.
+
+        TO COMPILE..: Use makefile (add -DRBTREE_STATS to enable the counters).
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef TreeStats_H_
+#define TreeStats_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// LatencyHistogram::record( uint64_t ns )                      --> Adds a sample
+// uint64_t count( ) / mean( ) / max( ) const                   --> Samples, average and largest one
+// uint64_t percentile( double p ) const                        --> Sample at p (0 to 100), ~12% error
+// TreeStats::print( ostream& out ) const                       --> Human readable report
+//
+// RedBlackTree::stats() fills a TreeStats. The counters and histograms are only kept when
+// RBTREE_STATS is defined (e.g. -DRBTREE_STATS); otherwise TreeCounters is empty, every hook
+// is an empty inline function and stats() only reports the shape and the memory of the tree.
+
+// *****************************************ERRORS**********************************************
+// None.
+
+/*! RBTREE_STATS turns the counters on */
+#if defined(RBTREE_STATS)
+static const bool TreeStatsEnabled = true;
+#else
+static const bool TreeStatsEnabled = false;
+#endif
+
+/*! Counter bumped from const functions. The increment is a relaxed load and store, not a
+ *  locked add: free of data races, but concurrent readers of a tree may lose a few counts
+*/
+class StatCounter
+{
+    public:
+
+        StatCounter( void ) : m_value(0) { /*! empty */ }
+        StatCounter( const StatCounter& other ) : m_value( other.value() ) { /*! empty */ }
+        StatCounter& operator = ( const StatCounter& rhs ) { m_value.store( rhs.value(), memory_order_relaxed ); return *this; }
+
+        void add( uint64_t n ) { m_value.store( value() + n, memory_order_relaxed ); }
+        void raise( uint64_t n ) { if ( n > value() ) m_value.store( n, memory_order_relaxed ); }
+        uint64_t value( void ) const { return m_value.load(memory_order_relaxed); }
+
+    private:
+
+        atomic<uint64_t> m_value;
+};
+
+/*! Log bucketed histogram (HDR style): the samples below 8 have a bucket each, then every
+ *  power of two is split in 8 buckets, so any sample up to 2^64 falls in one of 496 buckets
+ *  and a bucket is at most 12.5% wide. Percentiles report the top of their bucket
+*/
+class LatencyHistogram
+{
+    public:
+
+        /*! Adds a sample (nanoseconds, or anything else) */
+        void record( uint64_t sample );
+
+        /*! Number of samples */
+        uint64_t count( void ) const { return m_count.value(); }
+
+        /*! Average sample (0 if there is none) */
+        uint64_t mean( void ) const { return count() ? m_sum.value() / count() : 0; }
+
+        /*! Largest sample */
+        uint64_t max( void ) const { return m_max.value(); }
+
+        /*! Sample below which p percent of the samples lie (0 if there is none) */
+        uint64_t percentile( double p ) const;
+
+    private:
+
+        /*! Bucket of a sample, and the largest sample of a bucket */
+        static size_t bucketOf( uint64_t sample );
+        static uint64_t bucketTop( size_t bucket );
+
+        /*! 3 bits below the top one pick the bucket inside a power of two */
+        static const unsigned SubBits = 3;
+        static const size_t Buckets = ( 64 - SubBits + 1 ) << SubBits;
+
+        StatCounter m_buckets[Buckets];     //!< samples per bucket
+        StatCounter m_count;                //!< samples
+        StatCounter m_sum;                  //!< sum of the samples
+        StatCounter m_max;                  //!< largest sample
+};
+
+/*! Counters of one kind of operation */
+struct OperationStats
+{
+    StatCounter         depthSum;   //!< nodes visited on the way down, all operations
+    StatCounter         depthMax;   //!< nodes visited on the way down, deepest operation
+    LatencyHistogram    latency;    //!< nanoseconds per operation
+
+    /*! Average nodes visited per operation */
+    double meanDepth( void ) const { return latency.count() ? double( depthSum.value() ) / double( latency.count() ) : 0; }
+};
+
+/*! Snapshot of a tree: its shape, its memory and (with RBTREE_STATS) what it did so far */
+struct TreeStats
+{
+    /*! Operation kinds */
+    enum Operation { Insert, Remove, Search, OperationCount };
+
+    bool            enabled;            //!< counters kept (RBTREE_STATS)
+
+    size_t          size;               //!< number of values
+    bool            inlined;            //!< values kept in the tree object (no node, see RBTreeInline)
+    int             height;             //!< nodes on the longest path down
+    int             blackHeight;        //!< black nodes on any path down
+    size_t          nodeBytes;          //!< bytes of the nodes in use (the leaf and pseudo root included)
+    size_t          reservedBytes;      //!< bytes the allocator holds for nodes
+
+    StatCounter     comparisons;        //!< value comparisons
+    StatCounter     splits;             //!< split() calls (4-nodes broken by insertions)
+    StatCounter     leftRotations;      //!< leftRotate() calls
+    StatCounter     rightRotations;     //!< rightRotate() calls
+    StatCounter     colorSwaps;         //!< swapColor() calls
+    StatCounter     nodesAllocated;     //!< nodes built
+    StatCounter     nodesFreed;         //!< nodes destroyed
+
+    OperationStats  operations[OperationCount]; //!< descents and latencies per kind
+
+    /*! Writes the snapshot in human readable form */
+    void print( ostream& out ) const;
+};
+
+/*! Counters of a tree (see RedBlackTree): the hooks the tree calls. When Enabled is false the
+ *  class is empty (the tree inherits it, so it takes no room) and every hook does nothing
+*/
+template <bool Enabled>
+class TreeCounters
+{
+    protected:
+
+        /*! Times an operation and records how deep it went (from construction to destruction) */
+        class OperationTimer
+        {
+            public:
+
+                OperationTimer( const TreeCounters& counters, TreeStats::Operation op )
+                    : m_counters(counters), m_op(op), m_depth( counters.m_depth.value() ),
+                      m_start( chrono::steady_clock::now() ) { /*! empty */ }
+
+                ~OperationTimer();
+
+            private:
+
+                const TreeCounters&                 m_counters;
+                TreeStats::Operation                m_op;
+                uint64_t                            m_depth;
+                chrono::steady_clock::time_point    m_start;
+        };
+
+        void countComparison( void ) const { m_stats.comparisons.add(1); }
+        void countSplit( void ) const { m_stats.splits.add(1); }
+        void countLeftRotation( void ) const { m_stats.leftRotations.add(1); }
+        void countRightRotation( void ) const { m_stats.rightRotations.add(1); }
+        void countColorSwap( void ) const { m_stats.colorSwaps.add(1); }
+        void countAllocations( size_t n ) const { m_stats.nodesAllocated.add(n); }
+        void countReleases( size_t n ) const { m_stats.nodesFreed.add(n); }
+        void countStep( void ) const { m_depth.add(1); }
+
+        /*! Copies the counters into stats */
+        void fillStats( TreeStats& stats ) const;
+
+    private:
+
+        mutable TreeStats   m_stats;    //!< counters (the shape fields are unused)
+        mutable StatCounter m_depth;    //!< nodes visited on the way down, ever
+};
+
+template <>
+class TreeCounters<false>
+{
+    protected:
+
+        class OperationTimer
+        {
+            public:
+
+                OperationTimer( const TreeCounters&, TreeStats::Operation ) { /*! empty */ }
+        };
+
+        void countComparison( void ) const { /*! empty */ }
+        void countSplit( void ) const { /*! empty */ }
+        void countLeftRotation( void ) const { /*! empty */ }
+        void countRightRotation( void ) const { /*! empty */ }
+        void countColorSwap( void ) const { /*! empty */ }
+        void countAllocations( size_t ) const { /*! empty */ }
+        void countReleases( size_t ) const { /*! empty */ }
+        void countStep( void ) const { /*! empty */ }
+
+        void fillStats( TreeStats& stats ) const { stats.enabled = false; }
+};
+
+#include "TreeStats.cpp"
+#endif // TreeStats_H
+
+/* ------------------------- [ End of the TreeStats.h header ] ---------------------- */
+/* ================================================================================== */
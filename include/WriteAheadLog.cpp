@@ -0,0 +1,681 @@
+/*! \file */
+/*! \brief WriteAheadLog.cpp.
+ *
+ *  Implements the functions from WriteAheadLog class.
+*/
+
+#include "WriteAheadLog.h"
+
+/*!
+ * Class constructor
+ *
+ * @param policy 	=> when the records are synced
+ * @param interval 	=> longest time between two syncs (SyncInterval)
+ *
+ * @return => void
+*/
+template <class Comparable>
+WriteAheadLog<Comparable>::WriteAheadLog( SyncPolicy policy, chrono::milliseconds interval )
+	: m_fd(-1), m_policy(policy), m_interval(interval), m_flushing(false), m_failed(false),
+	  m_appended(0), m_written(0), m_synced(0), m_records(0), m_fileSize(0), m_compacting(false),
+	  m_oldRecords(0), m_lastSync( chrono::steady_clock::now() ), m_closing(false)
+{
+	static_assert( is_trivially_copyable<Comparable>::value, "the log needs trivially copyable values" );
+	static_assert( sizeof(LogHeader) == 64, "the log header must fill a cache line" );
+}
+
+/*!
+ * Class destructor
+ * stops the SyncInterval thread, then the records still queued are written and
+ * synced (errors can't be reported here)
+ *
+ * @return => void
+*/
+template <class Comparable>
+WriteAheadLog<Comparable>::~WriteAheadLog()
+{
+	if ( m_syncer.joinable() )
+	{
+		{
+			lock_guard<mutex> lock(m_lock);
+			m_closing = true;
+		}
+
+		m_syncerWake.notify_all();
+		m_syncer.join();
+	}
+
+	if ( m_fd < 0 )
+		return;
+
+	try
+	{
+		sync();
+	}
+	catch ( ... )
+	{
+		//! Nothing to do, the records up to the last commit are safe anyway
+	}
+
+	::close(m_fd);
+}
+
+/*!
+ * Open function
+ * reads the snapshot and the records through a read only mapping, cuts off a
+ * torn tail, then reopens the file for writing at its end (and starts the SyncInterval thread)
+ * it throws a runtime_error exception if the file can't be opened or isn't a valid log
+ *
+ * @param path 		=> the log file
+ * @param values 	=> receives the logged values, sorted
+ *
+ * @return => void
+*/
+template <class Comparable>
+void WriteAheadLog<Comparable>::open( const string& path, vector<Comparable>& values )
+{
+	if ( m_fd >= 0 )
+		throw runtime_error("WriteAheadLog::open: the log is already open");
+
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+	if ( fd < 0 )
+		throw runtime_error("WriteAheadLog::open: can't open " + path);
+
+	struct stat info;
+
+	if ( fstat(fd, &info) != 0 )
+	{
+		::close(fd);
+		throw runtime_error("WriteAheadLog::open: can't read " + path);
+	}
+
+	size_t length = size_t(info.st_size);
+	size_t records = 0;
+
+	values.clear();
+
+	if ( length == 0 )
+	{
+		//! New log: an empty snapshot
+		LogHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "RBTWALOG", sizeof(header.magic));
+		header.version = LogVersion;
+		header.valueSize = sizeof(Comparable);
+		header.snapshotChecksum = checksum(NULL, 0);
+
+		if ( !writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header)) || fdatasync(fd) != 0 )
+		{
+			::close(fd);
+			throw runtime_error("WriteAheadLog::open: can't write " + path);
+		}
+
+		syncDirectory(path);
+	}
+	else
+	{
+		void* base = ( length >= sizeof(LogHeader) ) ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+
+		if ( base == MAP_FAILED )
+		{
+			::close(fd);
+			throw runtime_error("WriteAheadLog::open: can't map " + path + " (or it is too short)");
+		}
+
+		const LogHeader* header = static_cast<const LogHeader*>(base);
+		const char* bytes = static_cast<const char*>(base);
+		size_t offset = sizeof(LogHeader) + size_t(header->snapshotSize) * sizeof(Comparable);
+
+		const char* error = NULL;
+
+		if ( memcmp(header->magic, "RBTWALOG", sizeof(header->magic)) != 0 )
+			error = "bad magic";
+		else if ( header->version != LogVersion )
+			error = "unknown version";
+		else if ( header->valueSize != sizeof(Comparable) )
+			error = "value size mismatch";
+		else if ( header->snapshotSize > ( length - sizeof(LogHeader) ) / sizeof(Comparable) )
+			error = "snapshot cut short";
+		else if ( checksum(bytes + sizeof(LogHeader), offset - sizeof(LogHeader)) != header->snapshotChecksum )
+			error = "snapshot checksum mismatch";
+
+		if ( error != NULL )
+		{
+			munmap(base, length);
+			::close(fd);
+			throw runtime_error("WriteAheadLog::open: " + path + ": " + error);
+		}
+
+		const Comparable* snapshot = reinterpret_cast<const Comparable*>( bytes + sizeof(LogHeader) );
+		values.assign(snapshot, snapshot + header->snapshotSize);
+
+		//! The records up to the first torn or corrupt one
+		vector<Comparable> inserted, removed;
+
+		for ( ; offset + RecordSize <= length; offset += RecordSize, records++ )
+		{
+			const char* record = bytes + offset;
+			uint32_t stored;
+			memcpy(&stored, record + 1 + sizeof(Comparable), sizeof(stored));
+
+			if ( ( record[0] != Insert && record[0] != Remove ) ||
+				 uint32_t( checksum(record, 1 + sizeof(Comparable)) ) != stored )
+				break;
+
+			Comparable v;
+			memcpy(&v, record + 1, sizeof(Comparable));
+
+			if ( record[0] == Insert )
+				inserted.push_back(v);
+			else
+				removed.push_back(v);
+		}
+
+		munmap(base, length);
+
+		//! The next record goes right after the last good one
+		if ( offset < length && ( ftruncate(fd, off_t(offset)) != 0 || fdatasync(fd) != 0 ) )
+		{
+			::close(fd);
+			throw runtime_error("WriteAheadLog::open: can't cut the torn tail of " + path);
+		}
+
+		mergeRecords(values, inserted, removed);
+	}
+
+	::close(fd);
+
+	//! Not O_APPEND: a failed write is cut off with ftruncate and the next one goes at the cut
+	fd = ::open(path.c_str(), O_WRONLY);
+	off_t end = ( fd >= 0 ) ? lseek(fd, 0, SEEK_END) : -1;
+
+	if ( end < 0 )
+	{
+		if ( fd >= 0 )
+			::close(fd);
+
+		throw runtime_error("WriteAheadLog::open: can't reopen " + path);
+	}
+
+	lock_guard<mutex> lock(m_lock);
+
+	m_path = path;
+	m_fd = fd;
+	m_fileSize = end;
+	m_records = records;
+	m_lastSync = chrono::steady_clock::now();
+
+	if ( m_policy == SyncInterval )
+		m_syncer = thread(&WriteAheadLog::syncLoop, this);
+}
+
+/*!
+ * Append function
+ * encodes the record at the end of the queue
+ * it throws a runtime_error exception if the log isn't open or failed before
+ *
+ * @param op 	=> Insert or Remove
+ * @param v 	=> the value
+ *
+ * @return => the ticket of the record (see commit)
+*/
+template <class Comparable>
+uint64_t WriteAheadLog<Comparable>::append( Operation op, const Comparable& v )
+{
+	lock_guard<mutex> lock(m_lock);
+
+	if ( m_fd < 0 || m_failed )
+		throw runtime_error("WriteAheadLog::append: the log isn't open for writing");
+
+	size_t at = m_pending.size();
+	m_pending.resize(at + RecordSize);
+
+	char* record = &m_pending[at];
+	record[0] = char(op);
+	memcpy(record + 1, &v, sizeof(Comparable));
+
+	uint32_t sum = uint32_t( checksum(record, 1 + sizeof(Comparable)) );
+	memcpy(record + 1 + sizeof(Comparable), &sum, sizeof(sum));
+
+	//! A running compaction carries it over to the new log
+	if ( m_compacting )
+		m_sinceCut.insert(m_sinceCut.end(), record, record + RecordSize);
+
+	m_records++;
+
+	return ++m_appended;
+}
+
+/*!
+ * Sync function
+ * it throws a runtime_error exception if the write fails
+ *
+ * @return => void
+*/
+template <class Comparable>
+void WriteAheadLog<Comparable>::sync( void )
+{
+	uint64_t ticket;
+
+	{
+		lock_guard<mutex> lock(m_lock);
+		ticket = m_appended;
+	}
+
+	flush(ticket, true);
+}
+
+/*!
+ * Compact function
+ * waits for a running compaction, then runs one (see beginCompact and finishCompact)
+ * it throws a runtime_error exception on I/O errors (the old log is kept)
+ *
+ * @param first => sorted values begin
+ * @param last 	=> sorted values end
+ *
+ * @return => void
+*/
+template <class Comparable>
+template <class InputIterator>
+void WriteAheadLog<Comparable>::compact( InputIterator first, InputIterator last )
+{
+	while ( !beginCompact() )
+		waitCompact();
+
+	finishCompact(first, last);
+}
+
+/*!
+ * Begin compact function
+ * from here on every appended record is also kept for the new log
+ * it throws a runtime_error exception if the log isn't open or failed
+ *
+ * @return => false if a compaction is running already
+*/
+template <class Comparable>
+bool WriteAheadLog<Comparable>::beginCompact( void )
+{
+	lock_guard<mutex> lock(m_lock);
+
+	if ( m_fd < 0 || m_failed )
+		throw runtime_error("WriteAheadLog::compact: the log isn't open for writing");
+
+	if ( m_compacting )
+		return false;
+
+	m_compacting = true;
+	m_sinceCut.clear();
+	m_oldRecords = m_records;
+	m_records = 0;
+
+	return true;
+}
+
+/*!
+ * Finish compact function
+ * writes the header (last, once the snapshot checksum is known) and the values to a
+ * temporary file and syncs it, all without the lock. The records appended since
+ * beginCompact follow: the big batches without the lock, the last ones with it, once
+ * the running write to the old file is done. Then the file is renamed over the log and
+ * the queued records are dropped, the new log already holds them
+ * it throws a runtime_error exception on I/O errors (the old log is kept)
+ *
+ * @param first => sorted values begin
+ * @param last 	=> sorted values end
+ *
+ * @return => void
+*/
+template <class Comparable>
+template <class InputIterator>
+void WriteAheadLog<Comparable>::finishCompact( InputIterator first, InputIterator last )
+{
+	string temp = m_path + ".tmp";
+	int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if ( fd < 0 )
+	{
+		abortCompact(temp);
+		throw runtime_error("WriteAheadLog::compact: can't create " + temp);
+	}
+
+	LogHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "RBTWALOG", sizeof(header.magic));
+	header.version = LogVersion;
+	header.valueSize = sizeof(Comparable);
+	header.snapshotChecksum = checksum(NULL, 0);
+
+	//! The values go out in 1 MB blocks
+	vector<char> block;
+	block.reserve(1 << 20);
+	block.resize(sizeof(header));
+
+	bool written = true;
+
+	for ( ; first != last && written; ++first )
+	{
+		const Comparable& v = *first;
+		const char* bytes = reinterpret_cast<const char*>(&v);
+
+		block.insert(block.end(), bytes, bytes + sizeof(Comparable));
+		header.snapshotChecksum = checksum(bytes, sizeof(Comparable), header.snapshotChecksum);
+		header.snapshotSize++;
+
+		if ( block.size() >= ( 1 << 20 ) )
+		{
+			written = writeAll(fd, block.data(), block.size());
+			block.clear();
+		}
+	}
+
+	written = written && writeAll(fd, block.data(), block.size()) &&
+			  pwrite(fd, &header, sizeof(header), 0) == ssize_t( sizeof(header) ) &&
+			  fdatasync(fd) == 0;
+
+	off_t size = off_t( sizeof(header) + header.snapshotSize * sizeof(Comparable) );
+
+	unique_lock<mutex> lock(m_lock);
+
+	while ( written && !m_failed && m_sinceCut.size() > TailBytes )
+	{
+		vector<char> tail;
+		tail.swap(m_sinceCut);
+
+		lock.unlock();
+
+		written = writeAll(fd, tail.data(), tail.size()) && fdatasync(fd) == 0;
+		size += off_t( tail.size() );
+
+		lock.lock();
+	}
+
+	while ( m_flushing )
+		m_flushed.wait(lock);
+
+	written = written && !m_failed &&
+			  ( m_sinceCut.empty() || ( writeAll(fd, m_sinceCut.data(), m_sinceCut.size()) && fdatasync(fd) == 0 ) ) &&
+			  rename(temp.c_str(), m_path.c_str()) == 0;
+
+	if ( !written )
+	{
+		bool failed = m_failed;
+
+		lock.unlock();
+
+		::close(fd);
+		abortCompact(temp);
+
+		throw runtime_error( failed ? "WriteAheadLog::compact: the log failed to write " + m_path
+									: "WriteAheadLog::compact: can't write " + temp );
+	}
+
+	syncDirectory(m_path);
+
+	//! The old file is gone, the records go on in the new one (fd is at its end)
+	::close(m_fd);
+	m_fd = fd;
+	m_fileSize = size + off_t( m_sinceCut.size() );
+
+	m_pending.clear();
+	m_written = m_synced = m_appended;
+	m_lastSync = chrono::steady_clock::now();
+
+	m_compacting = false;
+	m_sinceCut.clear();
+
+	m_flushed.notify_all();
+}
+
+/*!
+ * Wait compact function
+ *
+ * @return => void
+*/
+template <class Comparable>
+void WriteAheadLog<Comparable>::waitCompact( void )
+{
+	unique_lock<mutex> lock(m_lock);
+
+	while ( m_compacting )
+		m_flushed.wait(lock);
+}
+
+/*!
+ * Abort compact function
+ * the records since beginCompact are in the old log already, they only count again
+ *
+ * @param temp => the temporary file
+ *
+ * @return => void
+*/
+template <class Comparable>
+void WriteAheadLog<Comparable>::abortCompact( const string& temp )
+{
+	unlink(temp.c_str());
+
+	lock_guard<mutex> lock(m_lock);
+
+	m_compacting = false;
+	m_sinceCut.clear();
+	m_records += m_oldRecords;
+
+	m_flushed.notify_all();
+}
+
+/*!
+ * Checksum function
+ * FNV-1a over the bytes
+ *
+ * @param data 	=> first byte
+ * @param bytes => number of bytes
+ * @param hash 	=> checksum of the bytes before (the offset basis for a new range)
+ *
+ * @return => the checksum
+*/
+template <class Comparable>
+uint64_t WriteAheadLog<Comparable>::checksum( const void* data, size_t bytes, uint64_t hash )
+{
+	const unsigned char* in = static_cast<const unsigned char*>(data);
+
+	for ( size_t i = 0; i < bytes; i++ )
+	{
+		hash ^= in[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/*!
+ * Flush function
+ * the first thread to find no write running becomes the leader: it takes the
+ * whole queue, writes it (and syncs) without the lock, then wakes the others,
+ * who either find their ticket done or lead the next write
+ * it throws a runtime_error exception if the write fails
+ *
+ * @param ticket 	=> last record to be written
+ * @param durable 	=> it must be synced too
+ *
+ * @return => void
+*/
+template <class Comparable>
+void WriteAheadLog<Comparable>::flush( uint64_t ticket, bool durable )
+{
+	unique_lock<mutex> lock(m_lock);
+
+	while ( ( durable ? m_synced : m_written ) < ticket )
+	{
+		if ( m_failed || m_fd < 0 )
+			throw runtime_error("WriteAheadLog::commit: the log failed to write " + m_path);
+
+		if ( m_flushing )
+		{
+			m_flushed.wait(lock);
+			continue;
+		}
+
+		//! Leader: takes every queued record
+		m_flushing = true;
+		m_writing.swap(m_pending);
+
+		uint64_t last = m_appended;
+		off_t good = m_fileSize;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		bool syncing = durable || m_policy == SyncAlways ||
+					   ( m_policy == SyncInterval && now - m_lastSync >= m_interval );
+
+		lock.unlock();
+
+		bool written = writeAll(m_fd, m_writing.data(), m_writing.size()) && ( !syncing || fdatasync(m_fd) == 0 );
+
+		//! The file may end with part of the batch: cut it back to the last whole record
+		if ( !written && ftruncate(m_fd, good) == 0 )
+			lseek(m_fd, good, SEEK_SET);
+
+		lock.lock();
+
+		m_fileSize = written ? good + off_t( m_writing.size() ) : good;
+		m_writing.clear();
+		m_flushing = false;
+		m_flushed.notify_all();
+
+		if ( !written )
+		{
+			//! The records of the batch were applied by the caller and are lost: nothing can follow them
+			m_failed = true;
+			continue;
+		}
+
+		m_written = last;
+
+		if ( syncing )
+		{
+			m_synced = last;
+			m_lastSync = now;
+		}
+	}
+}
+
+/*!
+ * Sync loop function
+ * sleeps until an interval has passed since the last sync, then syncs the records
+ * written meanwhile (as any committer would, see flush). The commits alone only
+ * sync when they come after the interval, so the last ones of a burst would wait
+ * for the next commit
+ *
+ * @return => void
+*/
+template <class Comparable>
+void WriteAheadLog<Comparable>::syncLoop( void )
+{
+	unique_lock<mutex> lock(m_lock);
+
+	while ( !m_closing )
+	{
+		chrono::steady_clock::time_point due = m_lastSync + m_interval;
+
+		if ( m_written > m_synced && !m_failed && chrono::steady_clock::now() >= due )
+		{
+			uint64_t ticket = m_written;
+			lock.unlock();
+
+			try
+			{
+				flush(ticket, true);
+			}
+			catch ( ... )
+			{
+				//! The log is marked failed, the next commit reports it
+			}
+
+			lock.lock();
+			continue;
+		}
+
+		//! Nothing unsynced: check again an interval from now
+		if ( m_written <= m_synced || m_failed )
+			due = chrono::steady_clock::now() + m_interval;
+
+		m_syncerWake.wait_until(lock, due);
+	}
+}
+
+/*!
+ * Write all function
+ *
+ * @param fd 	=> the file
+ * @param data 	=> first byte
+ * @param bytes => number of bytes
+ *
+ * @return => false if a write failed
+*/
+template <class Comparable>
+bool WriteAheadLog<Comparable>::writeAll( int fd, const char* data, size_t bytes )
+{
+	while ( bytes > 0 )
+	{
+		ssize_t done = write(fd, data, bytes);
+
+		if ( done < 0 && errno == EINTR )
+			continue;
+
+		if ( done <= 0 )
+			return false;
+
+		data += done;
+		bytes -= size_t(done);
+	}
+
+	return true;
+}
+
+/*!
+ * Sync directory function
+ *
+ * @param path => a file in the directory
+ *
+ * @return => void
+*/
+template <class Comparable>
+void WriteAheadLog<Comparable>::syncDirectory( const string& path )
+{
+	size_t slash = path.rfind('/');
+	string directory = ( slash == string::npos ) ? "." : ( slash == 0 ) ? "/" : path.substr(0, slash);
+
+	int fd = ::open(directory.c_str(), O_RDONLY);
+
+	if ( fd >= 0 )
+	{
+		fsync(fd);
+		::close(fd);
+	}
+}
+
+/*!
+ * Merge records function
+ * the log only holds removes that found their value, so the final values are the
+ * snapshot plus the inserted ones, less one equal value per remove (sorted merges)
+ *
+ * @param values 	=> the snapshot values (sorted), replaced by the final ones
+ * @param inserted 	=> inserted values, in log order
+ * @param removed 	=> removed values, in log order
+ *
+ * @return => void
+*/
+template <class Comparable>
+void WriteAheadLog<Comparable>::mergeRecords( vector<Comparable>& values, vector<Comparable>& inserted, vector<Comparable>& removed )
+{
+	if ( inserted.empty() && removed.empty() )
+		return;
+
+	sort(inserted.begin(), inserted.end());
+	sort(removed.begin(), removed.end());
+
+	vector<Comparable> merged;
+	merged.reserve(values.size() + inserted.size());
+	merge(values.begin(), values.end(), inserted.begin(), inserted.end(), back_inserter(merged));
+
+	values.clear();
+	set_difference(merged.begin(), merged.end(), removed.begin(), removed.end(), back_inserter(values));
+}
@@ -0,0 +1,231 @@
+/*!
+    <PRE>
+        SOURCE FILE : WriteAheadLog.h
+        DESCRIPTION.: Write-ahead log of tree mutations (group commit, sync policies, compaction).
+        AUTHORS.....: agent
+        CONTRIBUTORS: agent
+        SATARTED ON.: OCT/2026
+        CHANGES.....: Binary records, group commit, sync policies, compaction and replay implemented.
+
+        TO COMPILE..: Use makefile (-pthread).
+        OBS.........: Part of the EDB2 Project.
+
+        LAST UPDATE.: Oct 18th, 2026.
+    </PRE>
+*/
+
+#ifndef WriteAheadLog_H_
+#define WriteAheadLog_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// ************************************PUBLIC OPERATIONS***************************************
+// WriteAheadLog( SyncPolicy policy, milliseconds interval )    --> Class constructor (closed log)
+// ~WriteAheadLog()                                             --> Writes what is pending, closes the file
+//                                                                  (and stops the SyncInterval thread)
+// void open( const string& path, vector<Comparable>& values )  --> Opens (or creates) and replays the log
+// uint64_t append( Operation op, const Comparable& v )         --> Queues a record, returns its ticket
+// void commit( uint64_t ticket )                               --> Waits for the record (group commit)
+// void sync( void )                                            --> Writes and syncs everything queued
+// void compact( InputIterator first, InputIterator last )      --> Replaces the log by a snapshot
+// bool beginCompact( void )                                    --> Marks where the next snapshot is taken
+// void finishCompact( InputIterator first, InputIterator last ) --> Writes it (appends go on meanwhile)
+// void waitCompact( void )                                     --> Waits for the running compaction
+// size_t records( void ) const                                 --> Records since the last snapshot
+//
+// Not tied to a tree: see DurableRedBlackTree.h for the tree that logs its writes.
+
+// *****************************************ERRORS**********************************************
+// std::bad_alloc thrown if needed.
+// std::runtime_error thrown by open() if the file can't be opened or isn't a valid log (a torn
+// last record is not an error: it is cut off), and by commit(), sync() and the compactions on
+// I/O errors (a log that failed to write is cut back to its last whole record and refuses any
+// further record; a compaction that fails keeps the old log).
+
+/*! Write-ahead log of inserts and removes of trivially copyable values.
+ *  The file is a 64 byte header, a snapshot (the sorted values at the last compaction) and
+ *  the records appended since, each one an operation byte, the value bytes and a 32 bit
+ *  checksum. append() only queues a record in memory and hands out a ticket; commit(ticket)
+ *  returns once the record is written (and synced, per the policy). The first committer to
+ *  find no write running becomes the leader: it takes every queued record and writes them
+ *  with a single write() and a single fdatasync() while the others wait, so concurrent
+ *  writers share the sync cost (group commit).
+ *  SyncAlways syncs before commit() returns; SyncInterval writes at every commit and a
+ *  background thread syncs what was written once an interval has passed since the last sync,
+ *  even if no other commit comes (a crash of the machine can lose about the last interval
+ *  of commits, a crash of the process can't); SyncNever leaves it to the system.
+ *  A compaction writes a new snapshot to a temporary file and renames it over the log, so a
+ *  crash leaves either the old log or the new one. It runs in two steps so the O(n) write
+ *  doesn't hold up the writers: beginCompact() marks the point the snapshot is taken at
+ *  (with the caller's lock held), and finishCompact() writes it without any lock while the
+ *  records go on to the old file; the records appended since the mark follow the snapshot
+ *  in the new file. open() replays without any tree insert:
+ *  the inserts and removes are sorted and merged into the snapshot, giving the final values
+ *  sorted, ready for the tree's bulk constructor. Equal values are taken as interchangeable.
+*/
+template <class Comparable>
+class WriteAheadLog
+{
+    /*!
+     * Public section
+    */
+    public:
+
+        /*! Logged operations */
+        enum Operation { Insert = 1, Remove = 2 };
+
+        /*! When the records reach the disk */
+        enum SyncPolicy { SyncAlways, SyncInterval, SyncNever };
+
+        /*! Closed log (see open) */
+        WriteAheadLog( SyncPolicy policy = SyncAlways, chrono::milliseconds interval = chrono::milliseconds(10) );
+
+        /*! Writes and syncs the pending records, then closes the file */
+        ~WriteAheadLog();
+
+        /*! Opens the log at path (created if missing) and gives its values, sorted.
+         *  A torn or corrupt tail (a crash in the middle of a write) is cut off.
+         *  Throws runtime_error if the file can't be opened or isn't a valid log
+        */
+        void open( const string& path, vector<Comparable>& values );
+
+        /*! Queues a record. The records reach the file in ticket order */
+        uint64_t append( Operation op, const Comparable& v );
+
+        /*! Returns once the record of ticket (and all before it) is written, and synced if the
+         *  policy is SyncAlways. Throws runtime_error if the write fails
+        */
+        void commit( uint64_t ticket ) { flush( ticket, m_policy == SyncAlways ); }
+
+        /*! Writes and syncs every queued record, whatever the policy */
+        void sync( void );
+
+        /*! Replaces the log by a snapshot of the sorted range (the values the records led to).
+         *  Same as beginCompact() and finishCompact(). Throws runtime_error on I/O errors
+        */
+        template <class InputIterator>
+        void compact( InputIterator first, InputIterator last );
+
+        /*! Starts a compaction: the snapshot must hold the values the records appended so far
+         *  led to (the caller takes it at the same point, under the lock that orders its
+         *  appends). Returns false if a compaction is running already.
+         *  Throws runtime_error if the log isn't open or failed
+        */
+        bool beginCompact( void );
+
+        /*! Writes the snapshot (the sorted range) and the records appended since beginCompact()
+         *  to a new log and renames it over the old one. Appends and commits go on meanwhile.
+         *  Throws runtime_error on I/O errors (the old log is kept)
+        */
+        template <class InputIterator>
+        void finishCompact( InputIterator first, InputIterator last );
+
+        /*! Returns once no compaction is running */
+        void waitCompact( void );
+
+        /*! Number of records since the last snapshot */
+        size_t records( void ) const { lock_guard<mutex> lock(m_lock); return m_records; }
+
+    /*!
+     * Private section
+    */
+    private:
+
+        /*! Header of the log file (64 bytes) */
+        struct LogHeader
+        {
+            char        magic[8];           //!< "RBTWALOG"
+            uint32_t    version;            //!< LogVersion
+            uint32_t    valueSize;          //!< sizeof(Comparable)
+            uint64_t    snapshotSize;       //!< number of values in the snapshot
+            uint64_t    snapshotChecksum;   //!< checksum of the snapshot values
+            char        reserved[32];       //!< zeroed
+        };
+
+        /*! Bytes of a record: operation, value, checksum */
+        static const size_t RecordSize = 1 + sizeof(Comparable) + sizeof(uint32_t);
+
+        /*! Checksum of a byte range (FNV-1a), hash carries on from a previous range */
+        static uint64_t checksum( const void* data, size_t bytes, uint64_t hash = 14695981039346656037ULL );
+
+        /*! Writes the queued records up to ticket (synced if durable), as the leader or by waiting for one */
+        void flush( uint64_t ticket, bool durable );
+
+        /*! Drops the running compaction (its temporary file is removed) */
+        void abortCompact( const string& temp );
+
+        /*! SyncInterval thread: syncs the written records an interval after the last sync */
+        void syncLoop( void );
+
+        /*! write() until every byte is out. Returns false on an error */
+        static bool writeAll( int fd, const char* data, size_t bytes );
+
+        /*! Syncs the directory of path, so a created or renamed file survives a crash */
+        static void syncDirectory( const string& path );
+
+        /*! Merges the replayed records into the snapshot values */
+        static void mergeRecords( vector<Comparable>& values, vector<Comparable>& inserted, vector<Comparable>& removed );
+
+        /*! The log can't be copied */
+        WriteAheadLog( const WriteAheadLog& );
+        WriteAheadLog& operator = ( const WriteAheadLog& );
+
+        /*! Basic members */
+        string                          m_path;         //!< the log file
+        int                             m_fd;           //!< open for appending (-1 when closed)
+        SyncPolicy                      m_policy;       //!< when the records are synced
+        chrono::milliseconds            m_interval;     //!< SyncInterval period
+
+        mutable mutex                   m_lock;         //!< guards everything below
+        condition_variable              m_flushed;      //!< a leader finished a write
+        vector<char>                    m_pending;      //!< queued records
+        vector<char>                    m_writing;      //!< records the leader is writing
+        bool                            m_flushing;     //!< a leader is writing
+        bool                            m_failed;       //!< a write failed, the log is unusable
+        uint64_t                        m_appended;     //!< last ticket handed out
+        uint64_t                        m_written;      //!< last ticket written
+        uint64_t                        m_synced;       //!< last ticket synced
+        size_t                          m_records;      //!< records since the last snapshot
+        off_t                           m_fileSize;     //!< bytes of whole records in the file
+        bool                            m_compacting;   //!< a compaction is running
+        vector<char>                    m_sinceCut;     //!< records appended since it began
+        size_t                          m_oldRecords;   //!< records of the old log when it began
+        chrono::steady_clock::time_point m_lastSync;    //!< time of the last sync
+        condition_variable              m_syncerWake;   //!< wakes the SyncInterval thread to stop
+        bool                            m_closing;      //!< the SyncInterval thread must stop
+        thread                          m_syncer;       //!< SyncInterval thread (started by open)
+
+        /*! Version of the log format */
+        static const uint32_t LogVersion = 1;
+
+        /*! The records appended during a compaction are written without the lock while they
+         *  are more than this many bytes, the rest with it (just before the switch)
+        */
+        static const size_t TailBytes = 1 << 16;
+};
+
+#include "WriteAheadLog.cpp"
+#endif // WriteAheadLog_H
+
+/* ---------------------- [ End of the WriteAheadLog.h header ] --------------------- */
+/* ================================================================================== */
@@ -1,10 +1,30 @@
-/*! \file */ 
+/*! \file */
 /*! \brief main.cpp.
  *
  *  Starts the program.
+ *  Interactive menu by default; "red_black_tree --replay trace|-" replays a trace of
+ *  commands (file or stdin) as fast as it can and prints the throughput and latencies.
+ *
+ *  Text trace: one command per line, "i 42" (insert), "s 42" (search) or "r 42" (remove);
+ *  the whole words work too, and '#' starts a comment.
+ *  Binary trace: the 8 bytes "RBTTRACE", then 5 byte records: the command letter ('i', 's'
+ *  or 'r') and the value as a 32 bit little endian integer.
 */
 #include <iostream>
+#include <iomanip>
 #include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "RedBlackTree.h"
 
@@ -13,17 +33,16 @@ using namespace std;
 //! Tree instance
 RedBlackTree<int> myTree;
 
-//! Functions prototypes
-void return_to_menu();
-void displayMainMenu();
-
 /**
- * Get the user choice
+ * Get the user choice (quit at the end of the input)
 */
 int getInput()
 {
     int choice;
-    cin >> choice;
+
+    if ( !( cin >> choice ) )
+        return 5;
+
     return choice;
 }
 
@@ -46,9 +65,7 @@ void insertItem()
             myTree.insert(itemValue);
         }
     }
-    while ( getchar() != 'q' );
-
-    displayMainMenu();
+    while ( getchar() != 'q' && !feof(stdin) );
 }
 
 /**
@@ -58,7 +75,6 @@ void searchtItem()
 {
     /*! Variables to receive the commands parameter */
     int itemValue;
-    int result = 0;
 
     do
     {
@@ -67,11 +83,8 @@ void searchtItem()
 
         if ( scanf("%i", &itemValue) == 1 )
         {
-            //! Call the class search method
-            result = myTree.search(itemValue);
-
-            //! Check the result
-            if ( result != 0 )
+            //! Call the class search method and check the result
+            if ( myTree.contains(itemValue) )
             {
                 cout << " [ Item found! ]";
             }
@@ -83,9 +96,7 @@ void searchtItem()
             cout << endl;
         }
     }
-    while ( getchar() != 'q' );
-
-    displayMainMenu();
+    while ( getchar() != 'q' && !feof(stdin) );
 }
 
 /**
@@ -103,19 +114,38 @@ void deleteItem()
 
         if ( scanf("%i", &itemValue) == 1 )
         {
-            //! Call the class insertion method
-            //myTree.delete(itemValue);
+            //! Call the class remove method
+            if ( myTree.remove(itemValue) )
+            {
+                cout << " [ Item removed! ]";
+            }
+            else
+            {
+                cout << " [ Item not found! ]";
+            }
+
+            cout << endl;
         }
     }
-    while ( getchar() != 'q' );
+    while ( getchar() != 'q' && !feof(stdin) );
+}
+
+/**
+ * Function to return to menu (false to quit)
+*/
+bool return_to_menu()
+{
+    char opt = 'n';
+    cout << endl << "Would you like to return to main menu? (y or n): ";
+    cin >> opt;
 
-    displayMainMenu();
+    return opt == 'y' || opt == 'Y';
 }
 
 /**
- * Print the red-black tree
+ * Print the red-black tree (false to quit)
 */
-void printTree()
+bool printTree()
 {
     cout << endl << "================================================================" << endl;
     cout << "*** Red-Black Tree visualization" << endl;
@@ -127,53 +157,50 @@ void printTree()
     cout << endl << "================================================================" << endl << endl;
 
     //! Check if the user wants to return to main menu
-    return_to_menu();
+    return return_to_menu();
 }
 
 /**
- * Handle the user input choice
+ * Handle the user input choice (false to quit)
 */
-void inputHandler( int choice_ )
+bool inputHandler( int choice_ )
 {
     switch( choice_ )
     {
         /*! Insert itens in red-black tree */
         case 1:
             insertItem();
-            break;
+            return true;
 
         /*! Search item */
         case 2:
             searchtItem();
-            break;
+            return true;
 
         /*! Remove item */
         case 3:
             deleteItem();
-            break;
+            return true;
 
         /*! Print red-black tree */
         case 4:
-            printTree();
-            break;
+            return printTree();
 
         /*! Exit */
         case 5:
-            exit(0);
-            break;
+            return false;
 
         default:
-            displayMainMenu();
-            break;
+            return true;
     }
 }
 
 /**
- * Display the menu
+ * Display the menu (the screen is cleared with an escape sequence, no shell is started)
 */
 void displayMainMenu()
 {
-    system("clear");
+    cout << "\033[2J\033[H";
 
     cout << endl << "================================================================" << endl;
     cout << "*** Red-Black Tree generator v0.25 ***" << endl;
@@ -186,38 +213,283 @@ void displayMainMenu()
     cout << "5 - Quit\n";
     cout << endl << "================================================================" << endl << endl;
     cout << "Choose an option: ";
+}
 
-    inputHandler(getInput());
+/**
+ * Menu loop: every command returns here, so the stack doesn't grow
+*/
+void runMenu()
+{
+    do
+    {
+        displayMainMenu();
+    }
+    while ( inputHandler(getInput()) );
 }
 
 /**
- * Function to return to menu
+ * One command of a trace
 */
-void return_to_menu()
+struct TraceCommand
 {
-    char opt;
-    cout << endl << "Would you like to return to main menu? (y or n): ";
-    cin >> opt;
+    char    op;     //!< 'i', 's' or 'r'
+    int     value;  //!< the value
+};
 
-    if ( opt == 'y' || opt == 'Y' )
-        displayMainMenu();
-    else
-        exit(0);
+/**
+ * Buffered reader of a trace: reads 1 MB blocks and parses them in place,
+ * text or binary (told by the first bytes)
+*/
+class TraceReader
+{
+    public:
+
+        /*! Opens path ("-" is stdin) */
+        explicit TraceReader( const char* path )
+            : m_fd( strcmp(path, "-") == 0 ? 0 : open(path, O_RDONLY) ), m_buffer(1 << 20),
+              m_begin(0), m_end(0), m_eof(false), m_binary(false), m_line(0)
+        {
+            if ( m_fd < 0 )
+                return;
+
+            fill();
+
+            //! Binary traces start with the magic
+            if ( m_end - m_begin >= 8 && memcmp(&m_buffer[m_begin], "RBTTRACE", 8) == 0 )
+            {
+                m_binary = true;
+                m_begin += 8;
+            }
+        }
+
+        ~TraceReader() { if ( m_fd > 0 ) close(m_fd); }
+
+        /*! Check if the trace could be opened */
+        bool good( void ) const { return m_fd >= 0; }
+
+        /*! Line of the last text command (0 for binary traces) */
+        size_t line( void ) const { return m_line; }
+
+        /*! Next command. Returns 0 at the end, -1 on a malformed command */
+        int next( TraceCommand& command )
+        {
+            return m_binary ? nextRecord(command) : nextLine(command);
+        }
+
+    private:
+
+        /*! Keeps the unread bytes and reads more behind them. Returns false at the end */
+        bool fill( void )
+        {
+            if ( m_eof )
+                return false;
+
+            memmove(&m_buffer[0], &m_buffer[m_begin], m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+
+            ssize_t n = read(m_fd, &m_buffer[m_end], m_buffer.size() - m_end);
+
+            if ( n <= 0 )
+                m_eof = true;
+            else
+                m_end += size_t(n);
+
+            return n > 0;
+        }
+
+        /*! Binary record */
+        int nextRecord( TraceCommand& command )
+        {
+            while ( m_end - m_begin < 5 )
+                if ( !fill() )
+                    return ( m_end == m_begin ) ? 0 : -1;
+
+            const unsigned char* record = reinterpret_cast<const unsigned char*>(&m_buffer[m_begin]);
+
+            command.op = char( record[0] );
+            command.value = int( uint32_t(record[1]) | ( uint32_t(record[2]) << 8 ) |
+                                 ( uint32_t(record[3]) << 16 ) | ( uint32_t(record[4]) << 24 ) );
+            m_begin += 5;
+
+            return ( command.op == 'i' || command.op == 's' || command.op == 'r' ) ? 1 : -1;
+        }
+
+        /*! Text line (the blank and comment lines are skipped) */
+        int nextLine( TraceCommand& command )
+        {
+            while ( true )
+            {
+                //! A whole line in the buffer (or the last one)
+                char* first = &m_buffer[0] + m_begin;
+                char* newline = static_cast<char*>( memchr(first, '\n', m_end - m_begin) );
+
+                if ( newline == NULL && !m_eof && m_end - m_begin < m_buffer.size() && fill() )
+                    continue;
+
+                if ( m_begin == m_end )
+                    return 0;
+
+                char* last = ( newline != NULL ) ? newline : &m_buffer[0] + m_end;
+                m_begin = ( newline != NULL ) ? size_t( newline + 1 - &m_buffer[0] ) : m_end;
+                m_line++;
+
+                while ( first < last && isspace(*first) )
+                    first++;
+
+                if ( first == last || *first == '#' )
+                    continue;
+
+                command.op = char( tolower(*first) );
+
+                //! The command word, then the value
+                while ( first < last && isalpha(*first) )
+                    first++;
+
+                while ( first < last && ( *first == ' ' || *first == '\t' ) )
+                    first++;
+
+                while ( last > first && isspace(last[-1]) )
+                    last--;
+
+                //! strtol needs a terminated string: the value is copied (an int has 11 chars at most)
+                char digits[16];
+                size_t length = size_t( last - first );
+
+                if ( length == 0 || length >= sizeof(digits) || !( isdigit(*first) || *first == '-' ) )
+                    return -1;
+
+                memcpy(digits, first, length);
+                digits[length] = '\0';
+
+                //! The whole value must be read (no "42abc") and fit in an int
+                char* end;
+                errno = 0;
+                long value = strtol(digits, &end, 10);
+
+                if ( errno != 0 || end != digits + length || value < INT_MIN || value > INT_MAX )
+                    return -1;
+
+                command.value = int(value);
+
+                return ( command.op == 'i' || command.op == 's' || command.op == 'r' ) ? 1 : -1;
+            }
+        }
+
+        int             m_fd;       //!< the trace (0 for stdin)
+        vector<char>    m_buffer;   //!< read block
+        size_t          m_begin;    //!< first unread byte
+        size_t          m_end;      //!< past the last byte read
+        bool            m_eof;      //!< nothing left to read
+        bool            m_binary;   //!< binary records
+        size_t          m_line;     //!< text lines read
+};
+
+/**
+ * Replays a trace on the tree and prints the throughput and the latencies
+*/
+int replayTrace( const char* path )
+{
+    TraceReader reader(path);
+
+    if ( !reader.good() )
+    {
+        cerr << "replay: can't open " << path << endl;
+        return 1;
+    }
+
+    LatencyHistogram latency[3];    //!< insert, search, remove
+    size_t found = 0, removed = 0, commands = 0;
+
+    TraceCommand command;
+    int status;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    while ( ( status = reader.next(command) ) > 0 )
+    {
+        chrono::steady_clock::time_point before = chrono::steady_clock::now();
+        int kind;
+
+        if ( command.op == 'i' )
+        {
+            myTree.insert(command.value);
+            kind = 0;
+        }
+        else if ( command.op == 's' )
+        {
+            found += myTree.contains(command.value);
+            kind = 1;
+        }
+        else
+        {
+            removed += myTree.remove(command.value);
+            kind = 2;
+        }
+
+        latency[kind].record( uint64_t( chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now() - before ).count() ) );
+        commands++;
+    }
+
+    double ms = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+
+    if ( status < 0 )
+    {
+        cerr << "replay: malformed command";
+
+        if ( reader.line() > 0 )
+            cerr << " at line " << reader.line();
+
+        cerr << " (after " << commands << " commands)" << endl;
+        return 1;
+    }
+
+    static const char* names[] = { "insert", "search", "remove" };
+
+    cout << "replayed " << commands << " commands in " << fixed << setprecision(1) << ms << " ms ("
+         << setprecision(2) << ( ms > 0 ? double(commands) / ms / 1000.0 : 0.0 ) << " Mops/s)" << endl;
+
+    for ( int k = 0; k < 3; k++ )
+    {
+        cout << "  " << names[k] << setw(12) << latency[k].count() << " ops"
+             << "   ns p50 " << latency[k].percentile(50) << "  p99 " << latency[k].percentile(99)
+             << "  p99.9 " << latency[k].percentile(99.9) << "  max " << latency[k].max();
+
+        if ( k == 1 )
+            cout << "  (" << found << " found)";
+        else if ( k == 2 )
+            cout << "  (" << removed << " removed)";
+
+        cout << endl;
+    }
+
+    TreeStats stats = myTree.stats();
+    cout << "tree: " << stats.size << " values, height " << stats.height << endl;
+
+    return 0;
 }
 
 /********************************************//**
 * Main
 ***********************************************/
-int main( void )
+int main( int argc, char* argv[] )
 {
-    
+    //! Batch mode
+    if ( argc == 3 && strcmp(argv[1], "--replay") == 0 )
+        return replayTrace(argv[2]);
+
+    if ( argc != 1 )
+    {
+        cerr << "usage: " << argv[0] << " [--replay trace|-]" << endl;
+        return 1;
+    }
 
     //! Display the application menu
-    displayMainMenu();
+    runMenu();
 
     //! Status message
     cout << "<<< Finish with success! >>>" << endl << endl;
 
     /*! Main return */
     return 0;
-}
\ No newline at end of file
+}
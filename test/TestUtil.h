@@ -0,0 +1,258 @@
+/*! \file */
+/*! \brief TestUtil.h.
+ *
+ *  Helpers shared by the tests: a check that stops the test with its line, the comparison
+ *  of a container with the sorted values it should hold, and the validator of the trees'
+ *  invariants (the trees name it as a friend).
+*/
+#ifndef TestUtil_H_
+#define TestUtil_H_
+
+#include <iostream>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <cstdlib>
+#include <cstdint>
+
+using namespace std;
+
+/*! The trees the validator knows (their headers come before this one in the tests) */
+template <class Comparable, class Compare, class Allocator, bool Inline> class RedBlackTree;
+template <class Comparable, class Compare> class CacheLineRedBlackTree;
+template <class Comparable> struct PathCopyNode;
+template <class Comparable> class ConcurrentRedBlackTree;
+template <class Comparable> class PersistentRedBlackTree;
+
+/*! Stops the test (exit status 1) if cond is false */
+#define CHECK(cond)                                                                          \
+    do                                                                                       \
+    {                                                                                        \
+        if ( !( cond ) )                                                                     \
+        {                                                                                    \
+            cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << endl;     \
+            exit(1);                                                                         \
+        }                                                                                    \
+    } while ( 0 )
+
+/*! True if the container iterates over the same values as ref, in the same order */
+template <class Container, class Reference>
+bool sameValues( const Container& c, const Reference& ref )
+{
+    return c.size() == ref.size() && equal(ref.begin(), ref.end(), c.begin());
+}
+
+/*! Recursive checks of the invariants, through the internals of the trees. valid() is false
+ *  at the first one broken: a red node with a red child, two paths with different black
+ *  heights, a wrong parent link, a value less than the one before it in order, a cached sub
+ *  tree size (ranked nodes) or a size() that doesn't match the nodes
+*/
+struct TreeValidator
+{
+    /*! RedBlackTree (inline form: sorted and within the inline capacity) */
+    template <class Comparable, class Compare, class Allocator, bool Inline>
+    static bool valid( const RedBlackTree<Comparable, Compare, Allocator, Inline>& tree )
+    {
+        typedef typename RedBlackTree<Comparable, Compare, Allocator, Inline>::Node Node;
+
+        if ( tree.isInline() )
+        {
+            const Comparable* values = tree.inlineValues();
+
+            for ( size_t i = 1; i < tree.m_size; i++ )
+                if ( tree.lessThan(values[i], values[i - 1]) )
+                    return false;
+
+            return tree.m_size <= tree.inlineCapacity;
+        }
+
+        const Node* rootPtr = tree.rightOf(tree.m_root);
+        const Comparable* previous = NULL;
+        size_t count = 0;
+
+        if ( tree.theLeaf->color() != Node::Black )
+            return false;
+
+        //! The root is black and hangs from the pseudo root
+        if ( rootPtr != tree.theLeaf && ( rootPtr->color() != Node::Black || tree.parentOf(rootPtr) != tree.m_root ) )
+            return false;
+
+        return blackHeight(tree, rootPtr, tree.m_root, previous, count) >= 0 && count == tree.m_size;
+    }
+
+    /*! CacheLineRedBlackTree (the 2-3-4 form): 1 to 3 values a node, every leaf at the same
+     *  depth, the parent links, the order, size() and the node count
+    */
+    template <class Comparable, class Compare>
+    static bool valid( const CacheLineRedBlackTree<Comparable, Compare>& tree )
+    {
+        typedef CacheLineRedBlackTree<Comparable, Compare> Tree;
+
+        const Comparable* previous = NULL;
+        size_t values = 0, nodes = 0;
+
+        if ( tree.m_root == Tree::NoNode )
+            return tree.m_size == 0 && tree.m_nodes == 0;
+
+        return depth(tree, tree.m_root, Tree::NoNode, previous, values, nodes) > 0 &&
+               values == tree.m_size && nodes == tree.m_nodes;
+    }
+
+    /*! A version of a path copied tree (NULL leaves, no parent links) holding size values.
+     *  Its nodes must all be shared: a published node never changes again
+    */
+    template <class Comparable>
+    static bool valid( const PathCopyNode<Comparable>* root, size_t size )
+    {
+        const Comparable* previous = NULL;
+        size_t count = 0;
+
+        if ( root != NULL && root->color != PathCopyNode<Comparable>::Black )
+            return false;
+
+        return blackHeight(root, previous, count) >= 0 && count == size;
+    }
+
+    /*! ConcurrentRedBlackTree: the version a reader sees. With writers running the size
+     *  may already be the one of a later version, so it is checked only when quiet
+    */
+    template <class Comparable>
+    static bool valid( const ConcurrentRedBlackTree<Comparable>& tree, bool quiet = true )
+    {
+        typename ConcurrentRedBlackTree<Comparable>::ReadGuard guard(tree);
+
+        const Comparable* previous = NULL;
+        size_t count = 0;
+
+        if ( !quiet )
+            return ( guard.root() == NULL || guard.root()->color == PathCopyNode<Comparable>::Black ) &&
+                   blackHeight(guard.root(), previous, count) >= 0;
+
+        return valid( guard.root(), tree.m_size.load() );
+    }
+
+    /*! PersistentRedBlackTree: its current version */
+    template <class Comparable>
+    static bool valid( const PersistentRedBlackTree<Comparable>& tree )
+    {
+        return valid( tree.m_version.m_root, tree.m_version.m_size );
+    }
+
+    private:
+
+        /*! Black height of the RedBlackTree sub tree at nodePtr (the leaf counts 1), -1 if broken.
+         *  previous is the value before the sub tree in order, count the nodes seen
+        */
+        template <class Tree, class Node, class Comparable>
+        static int blackHeight( const Tree& tree, const Node* nodePtr, const Node* parentPtr,
+                                const Comparable*& previous, size_t& count )
+        {
+            if ( nodePtr == tree.theLeaf )
+                return 1;
+
+            const Node* leftPtr = tree.leftOf(nodePtr);
+            const Node* rightPtr = tree.rightOf(nodePtr);
+            bool red = ( nodePtr->color() == Node::Red );
+
+            if ( tree.parentOf(nodePtr) != parentPtr )
+                return -1;
+
+            if ( red && ( leftPtr->color() == Node::Red || rightPtr->color() == Node::Red ) )
+                return -1;
+
+            int left = blackHeight(tree, leftPtr, nodePtr, previous, count);
+
+            if ( left < 0 || ( previous != NULL && tree.lessThan(nodePtr->value, *previous) ) )
+                return -1;
+
+            previous = &nodePtr->value;
+            count++;
+
+            int right = blackHeight(tree, rightPtr, nodePtr, previous, count);
+
+            //! Ranked nodes cache their sub tree size (the plain ones report 0)
+            size_t below = ( leftPtr == tree.theLeaf ? 0 : leftPtr->subtreeSize() ) +
+                           ( rightPtr == tree.theLeaf ? 0 : rightPtr->subtreeSize() );
+
+            if ( right != left || ( Node::ranked && nodePtr->subtreeSize() != below + 1 ) )
+                return -1;
+
+            return left + ( red ? 0 : 1 );
+        }
+
+        /*! Black height of a path copied sub tree (NULL counts 1), -1 if broken */
+        template <class Comparable>
+        static int blackHeight( const PathCopyNode<Comparable>* nodePtr, const Comparable*& previous, size_t& count )
+        {
+            typedef PathCopyNode<Comparable> Node;
+
+            if ( nodePtr == NULL )
+                return 1;
+
+            bool red = ( nodePtr->color == Node::Red );
+
+            if ( nodePtr->state != Node::Shared )
+                return -1;
+
+            if ( red && ( ( nodePtr->left != NULL && nodePtr->left->color == Node::Red ) ||
+                          ( nodePtr->right != NULL && nodePtr->right->color == Node::Red ) ) )
+                return -1;
+
+            int left = blackHeight(nodePtr->left, previous, count);
+
+            if ( left < 0 || ( previous != NULL && nodePtr->value < *previous ) )
+                return -1;
+
+            previous = &nodePtr->value;
+            count++;
+
+            int right = blackHeight(nodePtr->right, previous, count);
+
+            if ( right != left )
+                return -1;
+
+            return left + ( red ? 0 : 1 );
+        }
+
+        /*! Levels of the CacheLineRedBlackTree sub tree at node l (a leaf is 1), -1 if broken */
+        template <class Tree, class Comparable>
+        static int depth( const Tree& tree, uint32_t l, uint32_t parent, const Comparable*& previous,
+                          size_t& values, size_t& nodes )
+        {
+            const typename Tree::Node* nodePtr = tree.node(l);
+            int below = 0;
+
+            if ( nodePtr->parent != parent || nodePtr->count < 1 || nodePtr->count > 3 )
+                return -1;
+
+            nodes++;
+
+            for ( unsigned i = 0; i <= nodePtr->count; i++ )
+            {
+                //! Every child sub tree as deep as the first one
+                if ( !nodePtr->leaf() )
+                {
+                    int d = depth(tree, nodePtr->child[i], l, previous, values, nodes);
+
+                    if ( d < 0 || ( i > 0 && d != below ) )
+                        return -1;
+
+                    below = d;
+                }
+
+                if ( i == nodePtr->count )
+                    break;
+
+                if ( previous != NULL && tree.m_compare(nodePtr->key(i), *previous) )
+                    return -1;
+
+                previous = &nodePtr->key(i);
+                values++;
+            }
+
+            return below + 1;
+        }
+};
+
+#endif // TestUtil_H_
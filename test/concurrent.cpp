@@ -0,0 +1,257 @@
+/*! \file */
+/*! \brief concurrent.cpp.
+ *
+ *  Test: ConcurrentRedBlackTree. First one thread against std::multiset, then readers walking
+ *  the tree while writers change it: the keys no writer touches must always be found and
+ *  every version a reader visits must be a sorted red black tree. Last, the two halves of a
+ *  RedBlackTree split on HeapNodeAllocator (which share their leaf) changed by two threads at
+ *  once. Meant to be run under ThreadSanitizer too (make test-tsan).
+ *  Usage: bin/test_concurrent [writer operations]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <cstdlib>
+
+#include "ConcurrentRedBlackTree.h"
+#include "RedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+/*! One thread, random operations checked against std::multiset */
+void runSingle( int operations )
+{
+    ConcurrentRedBlackTree<int> tree;
+    multiset<int> ref;
+    minstd_rand random(1);
+
+    for ( int i = 0; i < operations; i++ )
+    {
+        int k = int( random() % 300 );
+
+        if ( random() % 3 )
+        {
+            tree.insert(k);
+            ref.insert(k);
+        }
+        else
+        {
+            multiset<int>::iterator it = ref.find(k);
+
+            CHECK( tree.remove(k) == ( it != ref.end() ) );
+
+            if ( it != ref.end() )
+                ref.erase(it);
+        }
+
+        if ( i % 997 == 0 )
+        {
+            vector<int> batch(5, k);
+            tree.insert_batch(batch.begin(), batch.end());
+            ref.insert(batch.begin(), batch.end());
+        }
+
+        CHECK( tree.size() == ref.size() );
+
+        if ( i % 97 == 0 )
+            CHECK( TreeValidator::valid(tree) );
+    }
+
+    CHECK( TreeValidator::valid(tree) );
+
+    vector<int> values;
+    tree.for_each( [&values]( int v ) { values.push_back(v); } );
+    CHECK( sameValues(values, ref) );
+
+    for ( int k = 0; k < 300; k++ )
+    {
+        int out = -1;
+
+        CHECK( tree.count(k) == ref.count(k) );
+        CHECK( tree.contains(k) == ( ref.count(k) > 0 ) );
+        CHECK( tree.find(k, out) == ( ref.count(k) > 0 ) );
+        CHECK( out == -1 || out == k );
+    }
+
+    tree.clear();
+    CHECK( tree.empty() && !tree.contains(1) );
+
+    cout << "  one thread: " << operations << " operations" << endl;
+}
+
+/*! Readers against writers: the even keys stay, the writers churn the odd ones */
+void runThreads( int operations )
+{
+    static const int Range = 1000, Readers = 4, Writers = 2;
+
+    ConcurrentRedBlackTree<string> tree;
+
+    for ( int k = 0; k < Range; k += 2 )
+        tree.insert( to_string(k) );
+
+    atomic<bool> stop(false);
+    atomic<long> reads(0);
+    vector<thread> readers, writers;
+
+    for ( int r = 0; r < Readers; r++ )
+    {
+        readers.push_back( thread( [&tree, &stop, &reads]()
+        {
+            long passes = 0;
+
+            while ( !stop.load() )
+            {
+                for ( int k = 0; k < Range; k += 2 )
+                {
+                    string out;
+                    CHECK( tree.find(to_string(k), out) && out == to_string(k) );
+                }
+
+                string previous;
+                bool sorted = true, first = true;
+
+                tree.for_each( [&]( const string& v )
+                {
+                    sorted = sorted && ( first || !( v < previous ) );
+                    previous = v;
+                    first = false;
+                } );
+
+                CHECK( sorted );
+
+                //! The version it reads is a red black tree (its size may be gone already)
+                CHECK( TreeValidator::valid(tree, false) );
+                passes++;
+            }
+
+            reads += passes;
+        } ) );
+    }
+
+    for ( int w = 0; w < Writers; w++ )
+    {
+        writers.push_back( thread( [&tree, operations, w]()
+        {
+            minstd_rand random(w + 1);
+
+            for ( int i = 0; i < operations; i++ )
+            {
+                string key = to_string( 1 + 2 * int( random() % ( Range / 2 ) ) );
+
+                if ( i % 2 )
+                    tree.insert(key);
+                else
+                    tree.remove(key);
+            }
+        } ) );
+    }
+
+    for ( size_t i = 0; i < writers.size(); i++ )
+        writers[i].join();
+
+    stop = true;
+
+    for ( size_t i = 0; i < readers.size(); i++ )
+        readers[i].join();
+
+    //! Every even key is still there, once
+    for ( int k = 0; k < Range; k += 2 )
+        CHECK( tree.count( to_string(k) ) == 1 );
+
+    CHECK( TreeValidator::valid(tree) );
+
+    cout << "  " << Readers << " readers, " << Writers << " writers: " << reads.load() << " passes, "
+         << tree.size() << " values at the end" << endl;
+}
+
+/*! The halves of a split tree (their nodes came from one tree) changed by one thread each */
+void runSplitHalves( int operations )
+{
+    typedef RedBlackTree< int, less<int>, HeapNodeAllocator< RBTreeNode<int> > > Tree;
+
+    Tree lower, upper;
+
+    for ( int k = 0; k < 2000; k++ )
+        lower.insert(k);
+
+    lower.split_at(1000, upper);
+    CHECK( lower.size() == 1000 && upper.size() == 1000 );
+
+    vector<multiset<int> > refs(2);
+    Tree* trees[2] = { &lower, &upper };
+    vector<thread> threads;
+
+    for ( int k = 0; k < 2000; k++ )
+        refs[k >= 1000].insert(k);
+
+    for ( int t = 0; t < 2; t++ )
+    {
+        threads.push_back( thread( [&trees, &refs, operations, t]()
+        {
+            Tree& tree = *trees[t];
+            multiset<int>& ref = refs[t];
+            minstd_rand random(t + 1);
+
+            for ( int i = 0; i < operations; i++ )
+            {
+                //! Emptied now and then, so the empty tree paths run too
+                if ( i % 5000 == 2500 )
+                {
+                    while ( !ref.empty() )
+                    {
+                        CHECK( tree.remove( *ref.begin() ) );
+                        ref.erase( ref.begin() );
+                    }
+                }
+
+                int k = 1000 * t + int( random() % 1000 );
+
+                if ( random() % 2 )
+                {
+                    tree.insert(k);
+                    ref.insert(k);
+                }
+                else
+                {
+                    multiset<int>::iterator it = ref.find(k);
+
+                    CHECK( tree.remove(k) == ( it != ref.end() ) );
+
+                    if ( it != ref.end() )
+                        ref.erase(it);
+                }
+            }
+        } ) );
+    }
+
+    for ( size_t i = 0; i < threads.size(); i++ )
+        threads[i].join();
+
+    CHECK( sameValues(lower, refs[0]) && TreeValidator::valid(lower) );
+    CHECK( sameValues(upper, refs[1]) && TreeValidator::valid(upper) );
+
+    cout << "  split halves on two threads: " << lower.size() << " and " << upper.size() << " values at the end" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    int operations = ( argc > 1 ) ? atoi(argv[1]) : 20000;
+
+    cout << "concurrent tree tests" << endl;
+
+    runSingle(operations);
+    runThreads(operations);
+    runSplitHalves(operations);
+
+    cout << "ok" << endl;
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*! \file */
+/*! \brief copy.cpp.
+ *
+ *  Test: copy, assignment and clear of trees big enough (1 << 20 values by default) that the
+ *  pool versions fork: the arena copy that relocates the links (NodePool) or keeps them
+ *  (IndexNodePool), the node by node copy (HeapNodeAllocator, string values, a pool left
+ *  mostly free by removals) and the parallel reclaim of the old nodes. Every copy must hold
+ *  the values of its source and change on its own. Meant to be run under ThreadSanitizer
+ *  too (make test-tsan).
+ *  Usage: bin/test_copy [values]
+*/
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+#include "RedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+/*! The value of key k (ints as they are, strings keep the order of k) */
+template <class Value>
+Value valueOf( int k );
+
+template <>
+int valueOf<int>( int k ) { return k; }
+
+template <>
+string valueOf<string>( int k ) { return "key " + to_string(100000000 + k); }
+
+/*! A copy of tree: same values, and a change to it leaves tree as it was */
+template <class Tree, class Value>
+void checkCopy( Tree& copy, const Tree& tree, const vector<Value>& values )
+{
+    CHECK( sameValues(copy, values) && TreeValidator::valid(copy) );
+    CHECK( sameValues(tree, values) );
+
+    if ( values.empty() )
+        return;
+
+    Value first = values.front(), last = values.back();
+
+    CHECK( copy.remove(first) && copy.remove(last) );
+    copy.insert(first);
+    copy.insert(first);
+
+    CHECK( copy.count(first) == 2 && !copy.contains(last) );
+    CHECK( tree.count(first) == 1 && tree.contains(last) );
+    CHECK( tree.size() == values.size() && copy.size() == values.size() );
+
+    CHECK( copy.remove(first) );
+    copy.insert(last);
+    CHECK( sameValues(copy, values) && TreeValidator::valid(copy) );
+}
+
+/*! Copies, assignments and clears of a tree of size values, with and without the pool */
+template <class Tree, class Value>
+void runTree( const char* name, int size, ThreadPool& pool )
+{
+    vector<Value> values(size);
+
+    for ( int k = 0; k < size; k++ )
+        values[k] = valueOf<Value>(2 * k);
+
+    Tree tree(values.begin(), values.end());
+    CHECK( sameValues(tree, values) && TreeValidator::valid(tree) );
+
+    //! Copy construction, forked and sequential
+    {
+        Tree copy(tree, &pool);
+        checkCopy(copy, tree, values);
+
+        Tree plain(tree);
+        checkCopy(plain, tree, values);
+    }
+
+    //! Assignment over a big tree (its nodes are reclaimed by the pool first)
+    {
+        vector<Value> odd(size / 2);
+
+        for ( int k = 0; k < size / 2; k++ )
+            odd[k] = valueOf<Value>(2 * k + 1);
+
+        Tree other(odd.begin(), odd.end());
+        other.assign(tree, &pool);
+        checkCopy(other, tree, values);
+
+        other.assign(Tree(), &pool);
+        CHECK( other.empty() );
+    }
+
+    //! A tree whose pool is mostly free (three values in four removed) is copied node by node
+    {
+        Tree sparse(tree);
+        vector<Value> kept;
+
+        for ( int k = 0; k < size; k++ )
+        {
+            if ( k % 4 == 0 )
+                kept.push_back(values[k]);
+            else
+                CHECK( sparse.remove(values[k]) );
+        }
+
+        Tree copy(sparse, &pool);
+        checkCopy(copy, sparse, kept);
+    }
+
+    //! Forked clear, then the tree is used again
+    {
+        Tree copy(tree, &pool);
+        copy.clear(&pool);
+        CHECK( copy.empty() && copy.begin() == copy.end() && !copy.contains(values.front()) );
+
+        copy.insert(values.back());
+        copy.insert(values.front());
+        CHECK( copy.size() == 2 && *copy.begin() == values.front() );
+
+        copy.assign(tree, &pool);
+        CHECK( sameValues(copy, values) );
+    }
+
+    //! The copies above are gone, the source is untouched
+    CHECK( sameValues(tree, values) );
+
+    cout << "  " << name << ": " << size << " values" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    int size = ( argc > 1 ) ? atoi(argv[1]) : 1 << 20;
+    ThreadPool pool(4);
+
+    cout << "copy tests (" << pool.size() << " workers)" << endl;
+
+    runTree< RedBlackTree<int>, int >("RedBlackTree (arena copy, links relocated)", size, pool);
+    runTree< RankedRedBlackTree<int>, int >("RankedRedBlackTree", size, pool);
+    runTree< CompactRedBlackTree<int>, int >("CompactRedBlackTree (arena copy, index links)", size, pool);
+    runTree< RedBlackTree< int, less<int>, HeapNodeAllocator< RBTreeNode<int> > >, int >("HeapNodeAllocator (node by node)", size, pool);
+    runTree< RedBlackTree<string>, string >("RedBlackTree<string> (node by node)", size / 4, pool);
+
+    cout << "ok" << endl;
+
+    return 0;
+}
@@ -0,0 +1,360 @@
+/*! \file */
+/*! \brief differential.cpp.
+ *
+ *  Test: random operations on the trees, checked step by step against std::multiset
+ *  (std::map for RedBlackMap), and find_many() against find(). Besides int in the default
+ *  order, the runs cover a custom order (greater<int>) and a non-arithmetic value (string).
+ *  The invariants of every tree (TreeValidator) are checked after each operation kind.
+ *  Usage: bin/test_differential [rounds]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <string>
+#include <functional>
+#include <cstdlib>
+
+#include "RedBlackTree.h"
+#include "RedBlackMap.h"
+#include "CacheLineRedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+typedef multiset<int> Reference;
+
+/*! The value of key k in a run on Value: k itself, or a string in the same order */
+template <class Value>
+Value valueOf( int k );
+
+template <>
+int valueOf<int>( int k ) { return k; }
+
+template <>
+string valueOf<string>( int k ) { return "key " + to_string(100000 + k); }
+
+/*! Order statistics, only checked on ranked trees (int, default order) */
+template <class Tree, class Ref>
+void checkRanks( const Tree&, const Ref&, false_type ) { /*! empty */ }
+
+template <class Tree>
+void checkRanks( const Tree& tree, const Reference& ref, true_type )
+{
+    vector<int> sorted(ref.begin(), ref.end());
+
+    for ( size_t k = 0; k < sorted.size(); k += 1 + sorted.size() / 16 )
+    {
+        CHECK( *tree.select(k) == sorted[k] );
+        CHECK( tree.rank(sorted[k]) == size_t( lower_bound(sorted.begin(), sorted.end(), sorted[k]) - sorted.begin() ) );
+    }
+
+    CHECK( tree.select( sorted.size() ) == tree.end() );
+    CHECK( tree.count_range(100, 300) == size_t( distance( ref.lower_bound(100), ref.upper_bound(300) ) ) );
+}
+
+/*! Every lookup of the keys in [0, range) */
+template <class Tree, class Ref>
+void checkLookups( const Tree& tree, const Ref& ref, int range )
+{
+    CHECK( sameValues(tree, ref) );
+
+    for ( int key = 0; key < range; key += 7 )
+    {
+        typename Ref::value_type k = valueOf<typename Ref::value_type>(key);
+
+        CHECK( tree.contains(k) == ( ref.count(k) > 0 ) );
+        CHECK( tree.count(k) == ref.count(k) );
+        CHECK( ( tree.find(k) != NULL ) == ( ref.count(k) > 0 ) );
+        CHECK( tree.find(k) == NULL || *tree.find(k) == k );
+
+        typename Tree::const_iterator lower = tree.lower_bound(k), upper = tree.upper_bound(k);
+        CHECK( ( lower == tree.end() ) == ( ref.lower_bound(k) == ref.end() ) );
+        CHECK( lower == tree.end() || *lower == *ref.lower_bound(k) );
+        CHECK( ( upper == tree.end() ) == ( ref.upper_bound(k) == ref.end() ) );
+        CHECK( upper == tree.end() || *upper == *ref.upper_bound(k) );
+    }
+
+    //! Backwards too
+    CHECK( equal( ref.rbegin(), ref.rend(), tree.rbegin() ) );
+}
+
+/*! find_many() against find() per key, for batches around the lockstep group (16) */
+template <class Value, class Tree>
+void checkFindMany( const Tree& tree, int range )
+{
+    static const size_t Batches[] = { 0, 1, 15, 16, 17, 33, 100 };
+    static const Value untouched = Value();
+
+    for ( size_t b = 0; b < sizeof(Batches) / sizeof(Batches[0]); b++ )
+    {
+        //! Keys in and around the range, so some are missing
+        vector<Value> keys( Batches[b] );
+
+        for ( size_t i = 0; i < keys.size(); i++ )
+            keys[i] = valueOf<Value>( rand() % ( range + 20 ) - 10 );
+
+        //! One slot more, which must stay untouched
+        vector<const Value*> found( keys.size() + 1, &untouched );
+
+        CHECK( tree.find_many(keys.begin(), keys.end(), found.begin()) == found.begin() + keys.size() );
+        CHECK( found.back() == &untouched );
+
+        for ( size_t i = 0; i < keys.size(); i++ )
+        {
+            //! Equal values are interchangeable, the two may point at different ones
+            CHECK( ( found[i] == NULL ) == ( tree.find(keys[i]) == NULL ) );
+            CHECK( found[i] == NULL || *found[i] == keys[i] );
+        }
+    }
+}
+
+/*! Random operations on a tree of type Tree (Ranked: it has select/rank) holding Value in
+ *  the order of Compare
+*/
+template <class Tree, bool Ranked = false, class Value = int, class Compare = less<Value> >
+void run( const char* name, int rounds, unsigned seed )
+{
+    static const int Range = 1000;
+
+    typedef multiset<Value, Compare> Ref;
+
+    Tree tree;
+    Ref ref;
+    Compare comp;
+    srand(seed);
+
+    for ( int round = 0; round < rounds; round++ )
+    {
+        //! Single insertions and removals, the tree often small (the inline form) or empty
+        int steps = rand() % 400;
+
+        for ( int i = 0; i < steps; i++ )
+        {
+            Value k = valueOf<Value>( rand() % Range );
+
+            if ( rand() % 5 < 3 )
+            {
+                if ( rand() % 2 )
+                    tree.insert(k);
+                else
+                    tree.emplace(k);
+
+                ref.insert(k);
+            }
+            else
+            {
+                typename Ref::iterator it = ref.find(k);
+
+                CHECK( tree.remove(k) == ( it != ref.end() ) );
+
+                if ( it != ref.end() )
+                    ref.erase(it);
+            }
+        }
+
+        CHECK( TreeValidator::valid(tree) );
+        checkLookups(tree, ref, Range);
+        checkRanks(tree, ref, integral_constant<bool, Ranked>());
+        checkFindMany<Value>(tree, Range);
+
+        switch ( rand() % 8 )
+        {
+            case 0:
+            {
+                //! Copy, then move back and forth
+                Tree copy(tree);
+                CHECK( TreeValidator::valid(copy) && sameValues(copy, ref) );
+
+                Tree moved( std::move(copy) );
+                CHECK( copy.empty() && sameValues(moved, ref) );
+
+                copy.insert( valueOf<Value>(1) );
+                tree = std::move(moved);
+                CHECK( moved.empty() );
+                break;
+            }
+            case 1:
+            {
+                //! Batch insertion
+                vector<Value> batch( rand() % 300 );
+
+                for ( size_t i = 0; i < batch.size(); i++ )
+                    batch[i] = valueOf<Value>( rand() % Range );
+
+                tree.insert_batch(batch.begin(), batch.end());
+                ref.insert(batch.begin(), batch.end());
+                CHECK( TreeValidator::valid(tree) );
+                break;
+            }
+            case 2:
+            {
+                //! Cut in two and put back together
+                Value key = valueOf<Value>( rand() % Range );
+                Tree upper;
+                tree.split_at(key, upper);
+
+                CHECK( tree.empty() || comp(*tree.rbegin(), key) );
+                CHECK( upper.empty() || !comp(*upper.begin(), key) );
+                CHECK( tree.size() + upper.size() == ref.size() );
+                CHECK( TreeValidator::valid(tree) && TreeValidator::valid(upper) );
+
+                tree.unite(upper);
+                break;
+            }
+            case 3:
+            {
+                int first = rand() % Range;
+                Value lo = valueOf<Value>(first), hi = valueOf<Value>( first + rand() % 100 );
+
+                if ( comp(hi, lo) )
+                    swap(lo, hi);
+
+                size_t expected = size_t( distance( ref.lower_bound(lo), ref.upper_bound(hi) ) );
+
+                CHECK( tree.erase_range(lo, hi) == expected );
+                ref.erase( ref.lower_bound(lo), ref.upper_bound(hi) );
+                break;
+            }
+            case 4:
+            case 5:
+            case 6:
+            {
+                //! Set algebra against the std algorithms on sorted ranges (multiset counts)
+                vector<Value> values( rand() % 200 );
+
+                for ( size_t i = 0; i < values.size(); i++ )
+                    values[i] = valueOf<Value>( rand() % Range );
+
+                sort(values.begin(), values.end(), comp);
+
+                Tree other( values.begin(), values.end() );
+                CHECK( TreeValidator::valid(other) );
+
+                vector<Value> expected;
+                int op = rand() % 3;
+
+                if ( op == 0 )
+                {
+                    tree.unite(other);
+                    set_union(ref.begin(), ref.end(), values.begin(), values.end(), back_inserter(expected), comp);
+                }
+                else if ( op == 1 )
+                {
+                    tree.intersect(other);
+                    set_intersection(ref.begin(), ref.end(), values.begin(), values.end(), back_inserter(expected), comp);
+                }
+                else
+                {
+                    tree.subtract(other);
+                    set_difference(ref.begin(), ref.end(), values.begin(), values.end(), back_inserter(expected), comp);
+                }
+
+                ref = Ref( expected.begin(), expected.end() );
+                break;
+            }
+            default:
+            {
+                //! Rare clear
+                if ( rand() % 4 == 0 )
+                {
+                    tree.clear();
+                    ref.clear();
+                }
+                break;
+            }
+        }
+
+        CHECK( TreeValidator::valid(tree) );
+        checkLookups(tree, ref, Range);
+
+        //! Red black shape: the longest path is at most twice the black height
+        TreeStats stats = tree.stats();
+        CHECK( stats.size == ref.size() );
+        CHECK( stats.height <= 2 * stats.blackHeight + 1 );
+    }
+
+    cout << "  " << name << ": " << rounds << " rounds, " << tree.size() << " values at the end" << endl;
+}
+
+/*! Random operations on a RedBlackMap against std::map */
+void runMap( int rounds, unsigned seed )
+{
+    RedBlackMap<int, long> tree;
+    map<int, long> ref;
+    srand(seed);
+
+    for ( int i = 0; i < rounds * 200; i++ )
+    {
+        int k = rand() % 2000;
+
+        switch ( rand() % 4 )
+        {
+            case 0:
+            {
+                bool inserted = tree.try_emplace(k, long(i)).second;
+                CHECK( inserted == ref.insert( make_pair(k, long(i)) ).second );
+                break;
+            }
+            case 1:
+                tree.insert_or_assign(k, long(i));
+                ref[k] = i;
+                break;
+            case 2:
+                tree[k] += 1;
+                ref[k] += 1;
+                break;
+            default:
+                CHECK( tree.erase(k) == ( ref.erase(k) > 0 ) );
+                break;
+        }
+
+        long* value = tree.find(k);
+        map<int, long>::iterator it = ref.find(k);
+
+        CHECK( ( value != NULL ) == ( it != ref.end() ) );
+        CHECK( value == NULL || *value == it->second );
+        CHECK( tree.size() == ref.size() );
+    }
+
+    vector< pair<int, long> > pairs;
+    tree.for_each( [&pairs]( int k, long v ) { pairs.push_back( make_pair(k, v) ); } );
+    CHECK(( pairs == vector< pair<int, long> >( ref.begin(), ref.end() ) ));
+
+    RedBlackMap<int, long> moved( std::move(tree) );
+    CHECK( tree.empty() && moved.size() == ref.size() );
+
+    cout << "  RedBlackMap: " << rounds * 200 << " operations, " << moved.size() << " keys at the end" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    int rounds = ( argc > 1 ) ? atoi(argv[1]) : 200;
+
+    cout << "differential tests against std::multiset / std::map" << endl;
+
+    run< RedBlackTree<int> >("RedBlackTree", rounds, 1);
+    run< SmallRedBlackTree<int> >("SmallRedBlackTree", rounds, 2);
+    run< CompactRedBlackTree<int> >("CompactRedBlackTree", rounds, 3);
+    run< PackedRedBlackTree<int> >("PackedRedBlackTree", rounds, 4);
+    run< RankedRedBlackTree<int>, true >("RankedRedBlackTree", rounds, 5);
+    run< RedBlackTree< int, less<int>, HeapNodeAllocator< RBTreeNode<int> > > >("RedBlackTree (heap)", rounds, 6);
+    run< RedBlackTree< int, less<int>, HeapNodeAllocator< RBTreeNode<int, true> > >, true >("RankedRedBlackTree (heap)", rounds, 9);
+    run< RedBlackTree< int, less<int>, HeapNodeAllocator< RBTreeNode<int> >, true > >("SmallRedBlackTree (heap)", rounds, 10);
+    run< CacheLineRedBlackTree<int> >("CacheLineRedBlackTree", rounds, 7);
+    run< RedBlackTree< int, greater<int> >, false, int, greater<int> >("RedBlackTree (greater)", rounds, 11);
+    run< SmallRedBlackTree< int, greater<int> >, false, int, greater<int> >("SmallRedBlackTree (greater)", rounds, 12);
+    run< CacheLineRedBlackTree< int, greater<int> >, false, int, greater<int> >("CacheLineRedBlackTree (greater)", rounds, 13);
+    run< RedBlackTree<string>, false, string >("RedBlackTree<string>", rounds, 14);
+    runMap(rounds, 8);
+
+    cout << "ok" << endl;
+
+    return 0;
+}
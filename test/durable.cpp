@@ -0,0 +1,434 @@
+/*! \file */
+/*! \brief durable.cpp.
+ *
+ *  Test: DurableRedBlackTree. Random writes checked against std::multiset, then the tree
+ *  reopened from its log under every sync policy, a log whose last record is torn (cut off
+ *  on reopen), compaction, writers of several threads sharing the syncs, a log that fails to
+ *  write (the tree refuses everything after) and a file that isn't a log (refused). The logs
+ *  are written to /tmp and removed.
+ *  Usage: bin/test_durable [operations]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+#include <csignal>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "DurableRedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+typedef DurableRedBlackTree<int> Tree;
+typedef Tree::Log Log;
+typedef multiset<int> Reference;
+
+/*! Size of the file at path */
+off_t fileSize( const string& path )
+{
+    struct stat info;
+    CHECK( stat(path.c_str(), &info) == 0 );
+    return info.st_size;
+}
+
+/*! Content and lookups of tree against ref */
+void checkTree( const Tree& tree, const Reference& ref )
+{
+    CHECK( tree.size() == ref.size() );
+
+    vector<int> values;
+    tree.for_each( [&values]( int v ) { values.push_back(v); } );
+    CHECK( sameValues(values, ref) );
+
+    for ( int k = 0; k < 1000; k += 17 )
+    {
+        CHECK( tree.count(k) == ref.count(k) );
+        CHECK( tree.contains(k) == ( ref.count(k) > 0 ) );
+    }
+}
+
+/*! Random writes; returns the last one (true: an insert) through lastInsert and lastValue */
+void change( Tree& tree, Reference& ref, minstd_rand& random, int steps, bool& lastInsert, int& lastValue )
+{
+    for ( int i = 0; i < steps; i++ )
+    {
+        int k = int( random() % 1000 );
+        Reference::iterator it = ref.find(k);
+
+        if ( random() % 3 || it == ref.end() )
+        {
+            tree.insert(k);
+            ref.insert(k);
+            lastInsert = true;
+        }
+        else
+        {
+            CHECK( tree.remove(k) );
+            ref.erase(it);
+            lastInsert = false;
+        }
+
+        lastValue = k;
+    }
+}
+
+/*! Writes, then reopens, under policy */
+void runReopen( const string& path, Log::SyncPolicy policy, const char* name, int operations )
+{
+    unlink( path.c_str() );
+
+    Reference ref;
+    minstd_rand random(1);
+    bool lastInsert = false;
+    int lastValue = 0;
+
+    for ( int session = 0; session < 4; session++ )
+    {
+        Tree tree(path, policy, chrono::milliseconds(5));
+        checkTree(tree, ref);
+
+        change(tree, ref, random, operations / 4, lastInsert, lastValue);
+        CHECK( !tree.remove(-1) );
+        checkTree(tree, ref);
+    }
+
+    Tree reopened(path, policy);
+    checkTree(reopened, ref);
+
+    cout << "  reopen (" << name << "): " << ref.size() << " values" << endl;
+}
+
+/*! A record cut in the middle (a crash during its write) is dropped, the others kept */
+void runTorn( const string& path )
+{
+    unlink( path.c_str() );
+
+    Reference ref;
+    minstd_rand random(2);
+    bool lastInsert = false;
+    int lastValue = 0;
+
+    {
+        Tree tree(path);
+        change(tree, ref, random, 500, lastInsert, lastValue);
+    }
+
+    CHECK( truncate( path.c_str(), fileSize(path) - 2 ) == 0 );
+
+    //! The last write is lost
+    if ( lastInsert )
+        ref.erase( ref.find(lastValue) );
+    else
+        ref.insert(lastValue);
+
+    {
+        Tree tree(path);
+        checkTree(tree, ref);
+
+        //! And the log goes on after the cut
+        tree.insert(7);
+        ref.insert(7);
+    }
+
+    Tree reopened(path);
+    checkTree(reopened, ref);
+
+    cout << "  torn record: dropped" << endl;
+}
+
+/*! compact() replaces the log by the sorted values */
+void runCompact( const string& path )
+{
+    unlink( path.c_str() );
+
+    Reference ref;
+    minstd_rand random(3);
+    bool lastInsert = false;
+    int lastValue = 0;
+
+    {
+        Tree tree(path, Log::SyncNever);
+        change(tree, ref, random, 5000, lastInsert, lastValue);
+
+        off_t before = fileSize(path);
+        tree.compact();
+        CHECK( fileSize(path) < before );
+        checkTree(tree, ref);
+
+        change(tree, ref, random, 500, lastInsert, lastValue);
+        tree.sync();
+    }
+
+    Tree reopened(path);
+    checkTree(reopened, ref);
+
+    cout << "  compact: " << ref.size() << " values" << endl;
+}
+
+/*! Compactions (automatic and asked for) while writers of other threads keep going */
+void runCompactThreads( const string& path )
+{
+    static const int Writers = 4, Writes = 40000;
+
+    unlink( path.c_str() );
+
+    vector<Reference> refs(Writers);
+    int compactions = 0;
+
+    {
+        Tree tree(path, Log::SyncNever);
+        vector<thread> writers;
+        atomic<int> running(Writers);
+
+        for ( int w = 0; w < Writers; w++ )
+        {
+            writers.push_back( thread( [&tree, &refs, &running, w]()
+            {
+                minstd_rand random(w + 1);
+
+                for ( int i = 0; i < Writes; i++ )
+                {
+                    int k = int( random() % 500 ) * Writers + w;
+                    Reference::iterator it = refs[w].find(k);
+
+                    if ( i % 2 && it != refs[w].end() )
+                    {
+                        CHECK( tree.remove(k) );
+                        refs[w].erase(it);
+                    }
+                    else
+                    {
+                        tree.insert(k);
+                        refs[w].insert(k);
+                    }
+                }
+
+                running--;
+            } ) );
+        }
+
+        //! A few asked for, then the log grows long enough (MinCompact) for an automatic one
+        while ( running.load() > 0 && compactions < 3 )
+        {
+            tree.compact();
+            compactions++;
+        }
+
+        for ( size_t i = 0; i < writers.size(); i++ )
+            writers[i].join();
+    }
+
+    Reference all;
+
+    for ( int w = 0; w < Writers; w++ )
+        all.insert(refs[w].begin(), refs[w].end());
+
+    Tree reopened(path);
+    checkTree(reopened, all);
+
+    cout << "  compactions under " << Writers << " writers: " << compactions << ", " << all.size() << " values" << endl;
+}
+
+/*! Writers of several threads (their own keys), every write synced */
+void runThreads( const string& path )
+{
+    static const int Writers = 4, Writes = 300;
+
+    unlink( path.c_str() );
+
+    vector<Reference> refs(Writers);
+
+    {
+        Tree tree(path);
+        vector<thread> writers;
+
+        for ( int w = 0; w < Writers; w++ )
+        {
+            writers.push_back( thread( [&tree, &refs, w]()
+            {
+                minstd_rand random(w + 1);
+
+                for ( int i = 0; i < Writes; i++ )
+                {
+                    int k = int( random() % 1000 ) * Writers + w;
+                    Reference::iterator it = refs[w].find(k);
+
+                    if ( i % 3 == 2 && it != refs[w].end() )
+                    {
+                        CHECK( tree.remove(k) );
+                        refs[w].erase(it);
+                    }
+                    else
+                    {
+                        tree.insert(k);
+                        refs[w].insert(k);
+                    }
+                }
+            } ) );
+        }
+
+        for ( size_t i = 0; i < writers.size(); i++ )
+            writers[i].join();
+    }
+
+    Reference all;
+
+    for ( int w = 0; w < Writers; w++ )
+        all.insert(refs[w].begin(), refs[w].end());
+
+    Tree reopened(path);
+    CHECK( reopened.size() == all.size() );
+
+    vector<int> values;
+    reopened.for_each( [&values]( int v ) { values.push_back(v); } );
+    CHECK( sameValues(values, all) );
+
+    cout << "  " << Writers << " writer threads: " << all.size() << " values" << endl;
+}
+
+/*! True if fn throws runtime_error */
+template <class Function>
+bool throws( Function fn )
+{
+    try
+    {
+        fn();
+    }
+    catch ( const runtime_error& )
+    {
+        return true;
+    }
+
+    return false;
+}
+
+/*! A write that fails (the file size limit is reached) fails the whole tree */
+void runFailed( const string& path )
+{
+    unlink( path.c_str() );
+
+    Reference ref;
+    size_t refused = 0;
+
+    //! Past the limit write() fails with EFBIG instead of raising SIGXFSZ
+    signal(SIGXFSZ, SIG_IGN);
+
+    struct rlimit old;
+    CHECK( getrlimit(RLIMIT_FSIZE, &old) == 0 );
+
+    {
+        Tree tree(path);
+
+        for ( int k = 0; k < 100; k++ )
+        {
+            tree.insert(k);
+            ref.insert(k);
+        }
+
+        tree.remove(0);
+        ref.erase(0);
+
+        //! Room for 10 more records and a half
+        off_t good = fileSize(path);
+        struct rlimit limit = old;
+        limit.rlim_cur = rlim_t( good + 10 * 9 + 4 );
+        CHECK( setrlimit(RLIMIT_FSIZE, &limit) == 0 );
+
+        for ( int k = 1000; !tree.failed(); k++ )
+        {
+            try
+            {
+                tree.insert(k);
+                ref.insert(k);
+            }
+            catch ( const runtime_error& )
+            {
+                refused++;
+            }
+        }
+
+        CHECK( setrlimit(RLIMIT_FSIZE, &old) == 0 );
+
+        //! The failed write was cut off: the file ends on the last good record
+        CHECK( fileSize(path) == good + 10 * 9 );
+
+        //! Nothing goes through a failed tree
+        CHECK( throws( [&tree]() { tree.insert(1); } ) );
+        CHECK( throws( [&tree]() { tree.remove(1); } ) );
+        CHECK( throws( [&tree]() { tree.size(); } ) );
+        CHECK( throws( [&tree]() { tree.contains(1); } ) );
+        CHECK( throws( [&tree]() { tree.count(1); } ) );
+        CHECK( throws( [&tree]() { tree.for_each( []( int ) {} ); } ) );
+        CHECK( throws( [&tree]() { tree.sync(); } ) );
+        CHECK( throws( [&tree]() { tree.compact(); } ) );
+    }
+
+    CHECK( refused == 1 );
+
+    //! The log holds the writes that returned
+    Tree reopened(path);
+    checkTree(reopened, ref);
+
+    cout << "  failed write: the tree refuses everything, the log holds " << ref.size() << " values" << endl;
+}
+
+/*! A file that isn't a log is refused */
+void runInvalid( const string& path )
+{
+    FILE* file = fopen(path.c_str(), "w");
+    CHECK( file != NULL );
+    fputs("not a log, not a log, not a log, not a log, not a log, not a log, not a log", file);
+    fclose(file);
+
+    bool refused = false;
+
+    try
+    {
+        Tree tree(path);
+    }
+    catch ( const runtime_error& )
+    {
+        refused = true;
+    }
+
+    CHECK( refused );
+
+    cout << "  invalid log: refused" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    int operations = ( argc > 1 ) ? atoi(argv[1]) : 4000;
+    string path = "/tmp/test_durable_" + to_string( getpid() ) + ".log";
+
+    cout << "durable tree tests" << endl;
+
+    runReopen(path, Log::SyncAlways, "SyncAlways", operations / 4);
+    runReopen(path, Log::SyncInterval, "SyncInterval", operations);
+    runReopen(path, Log::SyncNever, "SyncNever", operations);
+    runTorn(path);
+    runCompact(path);
+    runCompactThreads(path);
+    runThreads(path);
+    runFailed(path);
+    runInvalid(path);
+
+    unlink( path.c_str() );
+
+    cout << "ok" << endl;
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*! \file */
+/*! \brief frozen.cpp.
+ *
+ *  Test: FrozenRedBlackTree. Snapshots of random multisets of every size up to a few
+ *  hundred (and some bigger ones), with contains, find, count, lower_bound, upper_bound
+ *  and both iteration orders checked against std::multiset. 32 bit integral keys take the
+ *  AVX2 kernel when it is built (bin/test_frozen_avx2, see the makefile), long keys always
+ *  take the plain walk; unsigned keys cover the flipped sign bit of the kernel.
+ *  Usage: bin/test_frozen [rounds]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <random>
+#include <limits>
+#include <cstdlib>
+#include <cstdint>
+
+#include "RedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+/*! Every lookup of key (searched as a Key) against ref */
+template <class Comparable, class Key>
+void checkKey( const FrozenRedBlackTree<Comparable>& frozen, const multiset<Comparable>& ref, Key key )
+{
+    typedef typename FrozenRedBlackTree<Comparable>::const_iterator Iterator;
+
+    typename multiset<Comparable>::const_iterator lower = ref.lower_bound(Comparable(key));
+    typename multiset<Comparable>::const_iterator upper = ref.upper_bound(Comparable(key));
+
+    Iterator lo = frozen.lower_bound(key);
+    Iterator up = frozen.upper_bound(key);
+
+    CHECK( ( lo == frozen.end() ) == ( lower == ref.end() ) );
+    CHECK( lo == frozen.end() || *lo == *lower );
+    CHECK( ( up == frozen.end() ) == ( upper == ref.end() ) );
+    CHECK( up == frozen.end() || *up == *upper );
+
+    CHECK( frozen.count(key) == ref.count(Comparable(key)) );
+    CHECK( frozen.contains(key) == ( ref.count(Comparable(key)) > 0 ) );
+    CHECK( frozen.find(key) == NULL ? !frozen.contains(key) : *frozen.find(key) == Comparable(key) );
+    CHECK( frozen.equal_range(key) == make_pair(lo, up) );
+}
+
+/*! A snapshot of values, checked against them with keys inside and around the range */
+template <class Comparable>
+void checkSnapshot( const vector<Comparable>& values, minstd_rand& random )
+{
+    multiset<Comparable> ref(values.begin(), values.end());
+    RedBlackTree<Comparable> tree(values.begin(), values.end(), RedBlackTree<Comparable>::Unsorted);
+    FrozenRedBlackTree<Comparable> frozen = tree.freeze();
+
+    CHECK( frozen.size() == ref.size() );
+    CHECK( frozen.empty() == ref.empty() );
+    CHECK( sameValues(frozen, ref) );
+    CHECK( equal(ref.rbegin(), ref.rend(), frozen.rbegin()) );
+
+    //! The values, their neighbours and the extremes of the type
+    for ( size_t i = 0; i < values.size(); i++ )
+    {
+        checkKey(frozen, ref, values[i]);
+        checkKey(frozen, ref, Comparable( values[i] - 1 ));
+        checkKey(frozen, ref, Comparable( values[i] + 1 ));
+    }
+
+    checkKey(frozen, ref, numeric_limits<Comparable>::min());
+    checkKey(frozen, ref, numeric_limits<Comparable>::max());
+
+    for ( int i = 0; i < 50; i++ )
+        checkKey(frozen, ref, Comparable( random() ));
+
+    //! A long key takes the plain walk and must agree with the kernel
+    for ( size_t i = 0; i < values.size(); i++ )
+    {
+        CHECK( frozen.lower_bound( (long long)values[i] ) == frozen.lower_bound(values[i]) );
+        CHECK( frozen.upper_bound( (long long)values[i] ) == frozen.upper_bound(values[i]) );
+    }
+}
+
+/*! Random values of a type, size of them, drawn from range keys centred on base */
+template <class Comparable>
+vector<Comparable> randomValues( size_t size, uint32_t range, Comparable base, minstd_rand& random )
+{
+    vector<Comparable> values(size);
+
+    for ( size_t i = 0; i < size; i++ )
+        values[i] = Comparable( base + Comparable( random() % range ) - Comparable( range / 2 ) );
+
+    return values;
+}
+
+/*! Snapshots of every size up to limit, then of some bigger sizes */
+template <class Comparable>
+void runType( const char* name, Comparable base, int rounds )
+{
+    minstd_rand random(1);
+    size_t checked = 0;
+
+    for ( size_t size = 0; size <= 300; size++ )
+    {
+        //! Few distinct keys (long runs of equal values) and spread keys
+        checkSnapshot(randomValues<Comparable>(size, 1 + uint32_t(size / 4), base, random), random);
+        checkSnapshot(randomValues<Comparable>(size, 1000000, base, random), random);
+        checked += 2;
+    }
+
+    for ( int round = 0; round < rounds; round++ )
+    {
+        size_t size = 1000 + random() % 20000;
+        checkSnapshot(randomValues<Comparable>(size, uint32_t(size), base, random), random);
+        checked++;
+    }
+
+    cout << "  " << name << ": " << checked << " snapshots" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    int rounds = ( argc > 1 ) ? atoi(argv[1]) : 10;
+
+#if defined(__AVX2__)
+    cout << "frozen tree tests (AVX2 kernel)" << endl;
+#else
+    cout << "frozen tree tests" << endl;
+#endif
+
+    runType<int>("int", 0, rounds);
+    runType<unsigned>("unsigned (around the sign bit)", 1u << 31, rounds);
+    runType<unsigned>("unsigned (around 0)", 0, rounds);
+    runType<int64_t>("int64_t (plain walk)", 0, rounds);
+
+    cout << "ok" << endl;
+
+    return 0;
+}
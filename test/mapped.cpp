@@ -0,0 +1,246 @@
+/*! \file */
+/*! \brief mapped.cpp.
+ *
+ *  Test: binary images and MappedRedBlackTree. A tree saved and mapped back must hold the
+ *  same values; a truncated file, a bad magic and (with verify) a flipped byte in the array
+ *  must be refused. Then random inserts and removes on the overlays of a mapped tree, checked
+ *  against std::multiset, with promote() and a save of the changed tree reopened at the end.
+ *  The images are written to /tmp and removed.
+ *  Usage: bin/test_mapped [operations]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <string>
+#include <random>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "RedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+typedef RedBlackTree<int> Tree;
+typedef MappedRedBlackTree<int, Tree> Mapped;
+typedef multiset<int> Reference;
+
+/*! Size of the file at path */
+off_t fileSize( const string& path )
+{
+    struct stat info;
+    CHECK( stat(path.c_str(), &info) == 0 );
+    return info.st_size;
+}
+
+/*! Overwrites the byte at offset of the file at path with its bits flipped */
+void flipByte( const string& path, off_t offset )
+{
+    int fd = open(path.c_str(), O_RDWR);
+    CHECK( fd >= 0 );
+
+    unsigned char byte = 0;
+    CHECK( pread(fd, &byte, 1, offset) == 1 );
+    byte = (unsigned char)~byte;
+    CHECK( pwrite(fd, &byte, 1, offset) == 1 );
+
+    close(fd);
+}
+
+/*! True if open_mmap refuses the image at path */
+bool refused( const string& path, bool verify )
+{
+    try
+    {
+        Tree::open_mmap(path, verify);
+    }
+    catch ( const runtime_error& )
+    {
+        return true;
+    }
+
+    return false;
+}
+
+/*! Content and lookups of a mapped tree against ref */
+void checkMapped( const Mapped& mapped, const Reference& ref )
+{
+    CHECK( mapped.size() == ref.size() );
+    CHECK( mapped.empty() == ref.empty() );
+    CHECK( sameValues(mapped, ref) );
+
+    for ( int k = -1; k <= 1000; k += 7 )
+    {
+        CHECK( mapped.count(k) == ref.count(k) );
+        CHECK( mapped.contains(k) == ( ref.count(k) > 0 ) );
+        CHECK( mapped.find(k) == NULL ? ref.count(k) == 0 : *mapped.find(k) == k );
+    }
+}
+
+/*! A tree of random values in [0, 1000) and the same values in ref */
+Tree randomTree( size_t size, Reference& ref, minstd_rand& random )
+{
+    Tree tree;
+
+    for ( size_t i = 0; i < size; i++ )
+    {
+        int v = int( random() % 1000 );
+        tree.insert(v);
+        ref.insert(v);
+    }
+
+    return tree;
+}
+
+/*! save() then open_mmap() gives the same values back, for empty and bigger trees */
+void runRoundTrip( const string& path )
+{
+    minstd_rand random(1);
+    size_t sizes[] = { 0, 1, 2, 15, 16, 17, 1000, 50000 };
+
+    for ( size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ )
+    {
+        Reference ref;
+        Tree tree = randomTree(sizes[i], ref, random);
+
+        tree.save(path);
+
+        Mapped mapped = Tree::open_mmap(path, true);
+        CHECK( !mapped.dirty() );
+        checkMapped(mapped, ref);
+        CHECK( sameValues(mapped.base(), ref) );
+
+        //! The frozen snapshot of the image, without the overlays
+        FrozenRedBlackTree<int> frozen = FrozenRedBlackTree<int>::open_mmap(path);
+        CHECK( sameValues(frozen, ref) );
+    }
+
+    unlink( path.c_str() );
+
+    cout << "  round trip: ok" << endl;
+}
+
+/*! Truncated files, a bad magic and a flipped array byte are refused */
+void runInvalid( const string& path )
+{
+    minstd_rand random(2);
+    Reference ref;
+    Tree tree = randomTree(1000, ref, random);
+
+    //! Cut in the array (length mismatch), then in the header (too short)
+    tree.save(path);
+    CHECK( !refused(path, false) );
+    CHECK( truncate( path.c_str(), fileSize(path) - 1 ) == 0 );
+    CHECK( refused(path, false) );
+    CHECK( truncate( path.c_str(), fileSize(path) - 100 ) == 0 );
+    CHECK( refused(path, false) );
+    CHECK( truncate( path.c_str(), 10 ) == 0 );
+    CHECK( refused(path, false) );
+
+    //! Bad magic
+    tree.save(path);
+    flipByte(path, 0);
+    CHECK( refused(path, false) );
+
+    //! A flipped byte in the array only shows with verify
+    tree.save(path);
+    flipByte(path, fileSize(path) / 2);
+    CHECK( !refused(path, false) );
+    CHECK( refused(path, true) );
+
+    //! No file at all
+    unlink( path.c_str() );
+    CHECK( refused(path, false) );
+
+    cout << "  invalid images: refused" << endl;
+}
+
+/*! Random writes on the overlays of a mapped tree */
+void runOverlay( const string& path, int operations )
+{
+    minstd_rand random(3);
+    Reference ref;
+    Tree tree = randomTree(2000, ref, random);
+
+    tree.save(path);
+
+    Mapped mapped = Tree::open_mmap(path, true);
+    Reference base = ref;
+
+    for ( int i = 0; i < operations; i++ )
+    {
+        int k = int( random() % 1000 );
+
+        if ( random() % 2 )
+        {
+            mapped.insert(k);
+            ref.insert(k);
+        }
+        else
+        {
+            Reference::iterator it = ref.find(k);
+
+            CHECK( mapped.remove(k) == ( it != ref.end() ) );
+
+            if ( it != ref.end() )
+                ref.erase(it);
+        }
+
+        if ( i % 97 == 0 )
+            checkMapped(mapped, ref);
+    }
+
+    checkMapped(mapped, ref);
+    CHECK( mapped.dirty() );
+
+    //! The base is never written
+    CHECK( sameValues(mapped.base(), base) );
+
+    //! Everything in the heap
+    Tree promoted = mapped.promote();
+    CHECK( promoted.size() == ref.size() );
+    CHECK( sameValues(promoted, ref) );
+
+    //! The changed tree saved over its own image, then reopened
+    mapped.save(path);
+    CHECK( sameValues(mapped, ref) );
+
+    Mapped reopened = Tree::open_mmap(path, true);
+    CHECK( !reopened.dirty() );
+    checkMapped(reopened, ref);
+
+    //! Removing every value empties it
+    for ( Reference::iterator it = ref.begin(); it != ref.end(); ++it )
+        CHECK( reopened.remove(*it) );
+
+    CHECK( reopened.empty() && reopened.begin() == reopened.end() );
+    CHECK( !reopened.remove(0) );
+
+    unlink( path.c_str() );
+
+    cout << "  overlays: " << operations << " operations" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    int operations = ( argc > 1 ) ? atoi(argv[1]) : 20000;
+    string path = "/tmp/test_mapped_" + to_string( getpid() ) + ".rbt";
+
+    cout << "mapped tree tests" << endl;
+
+    runRoundTrip(path);
+    runInvalid(path);
+    runOverlay(path, operations);
+
+    cout << "ok" << endl;
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+/*! \file */
+/*! \brief persistent.cpp.
+ *
+ *  Test: PersistentRedBlackTree. Random operations checked against std::multiset, with
+ *  snapshots and copies kept along the way: each must still hold the values it had when it
+ *  was taken, whatever the tree and the other copies did afterwards. Then snapshots read and
+ *  dropped by other threads while the tree keeps changing (run it under make test-tsan too).
+ *  Usage: bin/test_persistent [operations]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <thread>
+#include <random>
+#include <cstdlib>
+
+#include "PersistentRedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+typedef PersistentRedBlackTree<int> Tree;
+typedef multiset<int> Reference;
+
+/*! The values of a snapshot or a tree, in order */
+template <class Version>
+vector<int> valuesOf( const Version& version )
+{
+    vector<int> values;
+    version.for_each( [&values]( int v ) { values.push_back(v); } );
+    return values;
+}
+
+/*! Lookups of a snapshot or a tree against what it should hold */
+template <class Version>
+void checkVersion( const Version& version, const Reference& ref )
+{
+    CHECK( version.size() == ref.size() );
+    CHECK( version.empty() == ref.empty() );
+    CHECK( sameValues(valuesOf(version), ref) );
+
+    for ( int k = 0; k < 500; k += 11 )
+    {
+        CHECK( version.count(k) == ref.count(k) );
+        CHECK( version.contains(k) == ( ref.count(k) > 0 ) );
+        CHECK( version.find(k) == NULL || *version.find(k) == k );
+    }
+}
+
+/*! Random changes of tree (and ref, which mirrors it) */
+void change( Tree& tree, Reference& ref, minstd_rand& random, int steps )
+{
+    for ( int i = 0; i < steps; i++ )
+    {
+        int k = int( random() % 500 );
+
+        if ( random() % 3 )
+        {
+            tree.insert(k);
+            ref.insert(k);
+        }
+        else
+        {
+            Reference::iterator it = ref.find(k);
+
+            CHECK( tree.remove(k) == ( it != ref.end() ) );
+
+            if ( it != ref.end() )
+                ref.erase(it);
+        }
+    }
+}
+
+/*! Snapshots and copies taken along the way stay as they were */
+void runVersions( int operations )
+{
+    Tree tree;
+    Reference ref;
+    minstd_rand random(1);
+
+    vector<Tree::Snapshot> snapshots;
+    vector<Reference> snapshotRefs;
+    vector<Tree> copies;
+    vector<Reference> copyRefs;
+
+    for ( int done = 0; done < operations; done += 100 )
+    {
+        change(tree, ref, random, 100);
+        checkVersion(tree, ref);
+        CHECK( TreeValidator::valid(tree) );
+
+        snapshots.push_back( tree.snapshot() );
+        snapshotRefs.push_back(ref);
+
+        //! A copy changes on its own, sharing the nodes it didn't touch
+        if ( random() % 4 == 0 )
+        {
+            copies.push_back(tree);
+            copyRefs.push_back(ref);
+            change(copies.back(), copyRefs.back(), random, 50);
+        }
+
+        //! Drop some of the old versions
+        if ( random() % 3 == 0 )
+        {
+            size_t i = random() % snapshots.size();
+            snapshots.erase( snapshots.begin() + i );
+            snapshotRefs.erase( snapshotRefs.begin() + i );
+        }
+
+        if ( random() % 20 == 0 )
+        {
+            tree.clear();
+            ref.clear();
+        }
+    }
+
+    for ( size_t i = 0; i < snapshots.size(); i++ )
+        checkVersion(snapshots[i], snapshotRefs[i]);
+
+    for ( size_t i = 0; i < copies.size(); i++ )
+    {
+        checkVersion(copies[i], copyRefs[i]);
+        CHECK( TreeValidator::valid(copies[i]) );
+    }
+
+    //! Assigning a tree shares the version too
+    Tree assigned;
+    assigned.insert(-1);
+    assigned = tree;
+    tree.insert(-2);
+    checkVersion(assigned, ref);
+    CHECK( TreeValidator::valid(assigned) && TreeValidator::valid(tree) );
+
+    cout << "  versions: " << operations << " operations, " << snapshots.size() << " snapshots and "
+         << copies.size() << " copies checked" << endl;
+}
+
+/*! Snapshots read and dropped by other threads while the tree changes */
+void runThreads( int operations )
+{
+    static const int Readers = 4;
+
+    Tree tree;
+    Reference ref;
+    minstd_rand random(2);
+    vector<thread> readers;
+
+    for ( int r = 0; r < Readers; r++ )
+    {
+        //! Each reader gets its own snapshot (a copy of the handle) and what it should hold
+        change(tree, ref, random, operations / ( 2 * Readers ));
+
+        Tree::Snapshot snapshot = tree.snapshot();
+        Reference expected = ref;
+
+        readers.push_back( thread( [snapshot, expected]()
+        {
+            for ( int pass = 0; pass < 20; pass++ )
+                checkVersion(snapshot, expected);
+        } ) );
+    }
+
+    //! Changes the tree (and frees what no version needs) while the readers run
+    change(tree, ref, random, operations / 2);
+
+    for ( size_t i = 0; i < readers.size(); i++ )
+        readers[i].join();
+
+    checkVersion(tree, ref);
+    CHECK( TreeValidator::valid(tree) );
+
+    cout << "  " << Readers << " reader threads on snapshots, " << tree.size() << " values at the end" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    int operations = ( argc > 1 ) ? atoi(argv[1]) : 20000;
+
+    cout << "persistent tree tests" << endl;
+
+    runVersions(operations);
+    runThreads(operations);
+
+    cout << "ok" << endl;
+
+    return 0;
+}
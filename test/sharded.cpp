@@ -0,0 +1,270 @@
+/*! \file */
+/*! \brief sharded.cpp.
+ *
+ *  Test: ShardedRedBlackTree. Random operations on one thread checked against std::multiset
+ *  (with batches, find_many, rebalances and the automatic moves of hot shards), the bounds
+ *  constructor, then writers inserting and removing at once (each on its own keys) while
+ *  readers look up keys nobody touches. Run it under make test-tsan too.
+ *  Usage: bin/test_sharded [operations]
+*/
+#include <iostream>
+#include <vector>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "ShardedRedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+typedef ShardedRedBlackTree<int> Tree;
+typedef multiset<int> Reference;
+
+/*! Content, lookups and shard layout of tree against ref */
+void checkTree( const Tree& tree, const Reference& ref, int range )
+{
+    CHECK( tree.size() == ref.size() );
+    CHECK( sameValues(tree, ref) );
+
+    vector<int> visited;
+    tree.for_each( [&visited]( int v ) { visited.push_back(v); } );
+    CHECK( sameValues(visited, ref) );
+
+    size_t total = 0;
+
+    for ( size_t i = 0; i < tree.shards(); i++ )
+        total += tree.shardSize(i);
+
+    CHECK( total == ref.size() );
+
+    vector<int> keys;
+
+    for ( int k = 0; k < range; k += 13 )
+    {
+        int out = -1;
+
+        CHECK( tree.count(k) == ref.count(k) );
+        CHECK( tree.contains(k) == ( ref.count(k) > 0 ) );
+        CHECK( tree.find(k, out) == ( ref.count(k) > 0 ) );
+        CHECK( out == -1 || out == k );
+        keys.push_back(k);
+    }
+
+    vector<bool> found;
+    tree.find_many(keys.begin(), keys.end(), back_inserter(found));
+    CHECK( found.size() == keys.size() );
+
+    for ( size_t i = 0; i < keys.size(); i++ )
+        CHECK( found[i] == ( ref.count(keys[i]) > 0 ) );
+}
+
+/*! One thread: random operations, the keys often crowded in one range */
+void runSingle( int operations )
+{
+    static const int Range = 20000;
+
+    Tree tree(4, 2);
+    Reference ref;
+    minstd_rand random(1);
+
+    for ( int done = 0; done < operations; done += 1000 )
+    {
+        //! Half of the rounds only hit the low tenth of the keys (hot shards)
+        int range = ( random() % 2 ) ? Range / 10 : Range;
+
+        for ( int i = 0; i < 1000; i++ )
+        {
+            int k = int( random() % range );
+
+            if ( random() % 4 )
+            {
+                tree.insert(k);
+                ref.insert(k);
+            }
+            else
+            {
+                Reference::iterator it = ref.find(k);
+
+                CHECK( tree.remove(k) == ( it != ref.end() ) );
+
+                if ( it != ref.end() )
+                    ref.erase(it);
+            }
+        }
+
+        vector<int> batch( random() % 2000 );
+
+        for ( size_t i = 0; i < batch.size(); i++ )
+            batch[i] = int( random() % Range );
+
+        tree.insert_batch(batch.begin(), batch.end());
+        ref.insert(batch.begin(), batch.end());
+
+        if ( random() % 5 == 0 )
+            tree.rebalance();
+
+        checkTree(tree, ref, Range);
+    }
+
+    tree.clear();
+    ref.clear();
+    checkTree(tree, ref, Range);
+
+    cout << "  one thread: " << operations << " operations, " << tree.shards() << " shards" << endl;
+}
+
+/*! Given bounds: values split as told, unsorted bounds refused */
+void runBounds( void )
+{
+    vector<int> bounds;
+    bounds.push_back(100);
+    bounds.push_back(200);
+
+    Tree tree(bounds, 1);
+    Reference ref;
+
+    for ( int k = 0; k < 300; k += 3 )
+    {
+        tree.insert(k);
+        ref.insert(k);
+    }
+
+    CHECK( tree.shards() == 3 );
+    CHECK( tree.shardSize(0) == 34 && tree.shardSize(1) == 33 && tree.shardSize(2) == 33 );
+    checkTree(tree, ref, 300);
+
+    bool refused = false;
+
+    try
+    {
+        vector<int> unsorted(bounds.rbegin(), bounds.rend());
+        Tree wrong(unsorted, 1);
+    }
+    catch ( const invalid_argument& )
+    {
+        refused = true;
+    }
+
+    CHECK( refused );
+
+    cout << "  bounds: ok" << endl;
+}
+
+/*! Writers on their own keys (k % Writers == w) and readers on keys nobody changes */
+void runThreads( int operations )
+{
+    static const int Writers = 3, Readers = 2, Stable = 1000;
+
+    Tree tree(4, 2);
+    vector<Reference> refs(Writers);
+
+    //! The stable keys are negative: no writer touches them
+    for ( int k = 1; k <= Stable; k++ )
+        tree.insert(-k);
+
+    atomic<bool> stop(false);
+    vector<thread> writers, readers;
+
+    for ( int r = 0; r < Readers; r++ )
+    {
+        readers.push_back( thread( [&tree, &stop]()
+        {
+            vector<int> keys;
+
+            for ( int k = 1; k <= Stable; k++ )
+                keys.push_back(-k);
+
+            while ( !stop.load() )
+            {
+                for ( int k = 1; k <= Stable; k += 7 )
+                    CHECK( tree.contains(-k) );
+
+                vector<bool> found;
+                tree.find_many(keys.begin(), keys.end(), back_inserter(found));
+
+                for ( size_t i = 0; i < found.size(); i++ )
+                    CHECK( found[i] );
+            }
+        } ) );
+    }
+
+    for ( int w = 0; w < Writers; w++ )
+    {
+        writers.push_back( thread( [&tree, &refs, operations, w]()
+        {
+            minstd_rand random(w + 1);
+            Reference& ref = refs[w];
+
+            for ( int i = 0; i < operations; i++ )
+            {
+                //! Crowded keys first, so the hot shards are moved while the others write
+                int range = ( i < operations / 2 ) ? 2000 : 200000;
+                int k = int( random() % range ) * Writers + w;
+
+                if ( random() % 4 )
+                {
+                    tree.insert(k);
+                    ref.insert(k);
+                }
+                else
+                {
+                    Reference::iterator it = ref.find(k);
+
+                    CHECK( tree.remove(k) == ( it != ref.end() ) );
+
+                    if ( it != ref.end() )
+                        ref.erase(it);
+                }
+
+                if ( i % 5000 == 0 )
+                {
+                    vector<int> batch(100, k);
+                    tree.insert_batch(batch.begin(), batch.end());
+                    ref.insert(batch.begin(), batch.end());
+                }
+            }
+        } ) );
+    }
+
+    for ( size_t i = 0; i < writers.size(); i++ )
+        writers[i].join();
+
+    stop = true;
+
+    for ( size_t i = 0; i < readers.size(); i++ )
+        readers[i].join();
+
+    Reference all;
+
+    for ( int k = 1; k <= Stable; k++ )
+        all.insert(-k);
+
+    for ( int w = 0; w < Writers; w++ )
+        all.insert(refs[w].begin(), refs[w].end());
+
+    checkTree(tree, all, 200000 * Writers);
+
+    cout << "  " << Writers << " writers, " << Readers << " readers: " << tree.size() << " values at the end" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( int argc, char* argv[] )
+{
+    int operations = ( argc > 1 ) ? atoi(argv[1]) : 50000;
+
+    cout << "sharded tree tests" << endl;
+
+    runSingle(operations);
+    runBounds();
+    runThreads(operations);
+
+    cout << "ok" << endl;
+
+    return 0;
+}
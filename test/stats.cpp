@@ -0,0 +1,166 @@
+/*! \file */
+/*! \brief stats.cpp.
+ *
+ *  Test: the RBTREE_STATS counters (the makefile builds this test with -DRBTREE_STATS). A
+ *  known number of inserts, removes and lookups must show up exactly in the operation
+ *  counts, the latency samples and the nodes built and freed; a tree built complete must
+ *  report the exact descent depths; two trees given the same operations must report the
+ *  same structural counters (comparisons, splits, rotations, color swaps).
+ *  Usage: bin/test_stats
+*/
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+
+#include "RedBlackTree.h"
+#include "TestUtil.h"
+
+using namespace std;
+
+#if !defined(RBTREE_STATS)
+#error "stats.cpp checks the counters: build it with -DRBTREE_STATS (see the makefile)"
+#endif
+
+/*! Operations of a kind recorded in stats */
+uint64_t operations( const TreeStats& stats, TreeStats::Operation op )
+{
+    return stats.operations[op].latency.count();
+}
+
+/*! Inserts, removes (some missing) and lookups, counted one by one */
+void runCounts( void )
+{
+    static const int Values = 1000, Removed = 300, Missing = 50;
+
+    RedBlackTree<int> tree;
+    TreeStats empty = tree.stats();
+
+    CHECK( empty.enabled );
+    CHECK( operations(empty, TreeStats::Insert) == 0 && operations(empty, TreeStats::Search) == 0 );
+    CHECK( empty.nodesAllocated.value() == 0 );
+
+    //! The two sentinels are built with the first value
+    static const uint64_t sentinels = 2;
+
+    for ( int k = 0; k < Values; k++ )
+        tree.insert( ( k * 7919 ) % Values );
+
+    for ( int k = 0; k < Removed; k++ )
+        CHECK( tree.remove(k) );
+
+    for ( int k = 0; k < Missing; k++ )
+        CHECK( !tree.remove(Values + k) );
+
+    size_t found = 0;
+
+    for ( int k = 0; k < Values; k++ )
+    {
+        found += tree.contains(k);
+        found += ( tree.find(k) != NULL );
+        found += tree.count(k);
+    }
+
+    CHECK( found == 3 * size_t( Values - Removed ) );
+
+    TreeStats stats = tree.stats();
+
+    CHECK( operations(stats, TreeStats::Insert) == uint64_t(Values) );
+    CHECK( operations(stats, TreeStats::Remove) == uint64_t(Removed + Missing) );
+    CHECK( operations(stats, TreeStats::Search) == uint64_t(3 * Values) );
+    CHECK( stats.nodesAllocated.value() == sentinels + uint64_t(Values) );
+    CHECK( stats.nodesFreed.value() == uint64_t(Removed) );
+
+    //! Every descent visits at least one node; fewer than 2^10 values are at most 2 * 10 high
+    for ( int op = 0; op < TreeStats::OperationCount; op++ )
+        CHECK( stats.operations[op].depthSum.value() >= operations(stats, TreeStats::Operation(op)) );
+
+    CHECK( stats.operations[TreeStats::Insert].depthMax.value() <= 2 * 10 );
+    CHECK( stats.operations[TreeStats::Remove].depthMax.value() <= 2 * 10 );
+
+    CHECK( stats.comparisons.value() >= stats.operations[TreeStats::Search].depthSum.value() );
+    CHECK( stats.leftRotations.value() + stats.rightRotations.value() > 0 );
+
+    //! A copy builds its own nodes
+    RedBlackTree<int> copy(tree);
+    CHECK( copy.stats().nodesAllocated.value() == uint64_t( tree.size() ) + sentinels );
+
+    cout << "  " << Values << " inserts, " << Removed + Missing << " removes, " << 3 * Values << " lookups: counted" << endl;
+}
+
+/*! A complete tree (2^levels - 1 values, built from a sorted range): every search goes down
+ *  exactly levels nodes
+*/
+void runDepths( void )
+{
+    static const int Levels = 10, Values = ( 1 << Levels ) - 1;
+
+    vector<int> sorted(Values);
+
+    for ( int k = 0; k < Values; k++ )
+        sorted[k] = 2 * k;
+
+    RedBlackTree<int> tree(sorted.begin(), sorted.end());
+
+    //! Hits and misses alike
+    for ( int k = 0; k < 2 * Values; k++ )
+        tree.contains(k);
+
+    TreeStats stats = tree.stats();
+    const OperationStats& search = stats.operations[TreeStats::Search];
+
+    CHECK( stats.height == Levels );
+    CHECK( operations(stats, TreeStats::Search) == uint64_t(2 * Values) );
+    CHECK( search.depthSum.value() == uint64_t(Levels) * uint64_t(2 * Values) );
+    CHECK( search.depthMax.value() == uint64_t(Levels) );
+    CHECK( search.meanDepth() == double(Levels) );
+
+    cout << "  complete tree of " << Values << " values: " << Levels << " nodes per search" << endl;
+}
+
+/*! The same operations give the same structural counters */
+void runRepeatable( void )
+{
+    RedBlackTree<int> a, b;
+
+    for ( int k = 0; k < 5000; k++ )
+    {
+        int v = ( k * 2654435761u ) % 10007;
+
+        a.insert(v);
+        b.insert(v);
+
+        if ( k % 3 == 0 )
+        {
+            a.remove(v / 2);
+            b.remove(v / 2);
+        }
+    }
+
+    TreeStats x = a.stats(), y = b.stats();
+
+    CHECK( x.comparisons.value() == y.comparisons.value() );
+    CHECK( x.splits.value() == y.splits.value() );
+    CHECK( x.leftRotations.value() == y.leftRotations.value() );
+    CHECK( x.rightRotations.value() == y.rightRotations.value() );
+    CHECK( x.colorSwaps.value() == y.colorSwaps.value() );
+    CHECK( x.operations[TreeStats::Insert].depthSum.value() == y.operations[TreeStats::Insert].depthSum.value() );
+
+    cout << "  same operations, same counters: " << x.comparisons.value() << " comparisons, "
+         << x.leftRotations.value() + x.rightRotations.value() << " rotations" << endl;
+}
+
+/********************************************//**
+* Main
+***********************************************/
+int main( void )
+{
+    cout << "tree statistics tests (RBTREE_STATS)" << endl;
+
+    runCounts();
+    runDepths();
+    runRepeatable();
+
+    cout << "ok" << endl;
+
+    return 0;
+}